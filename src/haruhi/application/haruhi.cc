@@ -54,7 +54,8 @@ Haruhi::Haruhi (int argc, char** argv, char** envp):
 
 	_haruhi = this;
 
-	Services::initialize();
+	if (OfflineRender::requested (argc, argv))
+		_offline_render = std::make_unique<OfflineRender> (OfflineRender::parse_arguments (argc, argv));
 
 	QPixmapCache::setCacheLimit (2048); // 2MB cache
 
@@ -73,6 +74,8 @@ Haruhi::Haruhi (int argc, char** argv, char** envp):
 
 	_settings->load();
 
+	Services::initialize (_haruhi_settings->graph_threads());
+
 	this->run_ui();
 
 	_settings->save();
@@ -105,9 +108,20 @@ Haruhi::run_ui()
 
 	_periodic_updater = std::make_unique<PeriodicUpdater> (30);
 	QObject::connect (_app.get(), SIGNAL (lastWindowClosed()), this, SLOT (quit_if_ok()));
-	session_loader();
-	if (_session)
+	if (_offline_render)
+	{
+		// No windows are shown, session quits when rendering is finished:
+		_session = std::make_unique<Session> (nullptr);
+		_session->load_session (QString::fromStdString (_offline_render->parameters().session_file));
+		_offline_render->start();
 		_app->exec();
+	}
+	else
+	{
+		session_loader();
+		if (_session)
+			_app->exec();
+	}
 	// Close current session:
 	_session.reset();
 	_periodic_updater.reset();
@@ -16,6 +16,7 @@
 
 // Standard:
 #include <cstddef>
+#include <cstdlib>
 #include <vector>
 
 // System:
@@ -27,6 +28,7 @@
 
 // Haruhi:
 #include <haruhi/config/all.h>
+#include <haruhi/application/offline_render.h>
 #include <haruhi/components/devices_manager/settings.h>
 #include <haruhi/settings/settings.h>
 #include <haruhi/settings/haruhi_settings.h>
@@ -97,6 +99,20 @@ class Haruhi:
 	SessionLoaderSettings*
 	session_loader_settings() const;
 
+	/**
+	 * Return OfflineRender object or nullptr
+	 * if Haruhi is not run in offline render mode.
+	 */
+	OfflineRender*
+	offline_render() const;
+
+	/**
+	 * Return process exit status: EXIT_FAILURE if offline
+	 * rendering has failed, EXIT_SUCCESS otherwise.
+	 */
+	int
+	exit_status() const;
+
   public slots:
 	/**
 	 * Show modal session loader dialog.
@@ -138,6 +154,7 @@ class Haruhi:
 	Unique<HasPresetsSettings>			_has_presets_settings;
 	Unique<SessionLoaderSettings>		_session_loader_settings;
 	bool								_ok_to_quit;
+	Unique<OfflineRender>				_offline_render;
 
 	// Other:
 	int		_argc;
@@ -208,6 +225,20 @@ Haruhi::session_loader_settings() const
 	return _session_loader_settings.get();
 }
 
+
+inline OfflineRender*
+Haruhi::offline_render() const
+{
+	return _offline_render.get();
+}
+
+
+inline int
+Haruhi::exit_status() const
+{
+	return _offline_render && _offline_render->failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 } // namespace Haruhi
 
 #endif
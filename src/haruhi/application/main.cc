@@ -42,6 +42,8 @@ int main (int argc, char** argv, char** envp)
 	SSEPow::initialize();
 #endif
 
+	int exit_status = EXIT_SUCCESS;
+
 	try {
 		if (argc == 2 && (strcmp (argv[1], "-v") == 0 || strcmp (argv[1], "--version") == 0))
 		{
@@ -54,7 +56,10 @@ int main (int argc, char** argv, char** envp)
 			std::clog << std::endl;
 		}
 		else
+		{
 			Haruhi::Haruhi haruhi (argc, argv, envp);
+			exit_status = haruhi.exit_status();
+		}
 	}
 	catch (...)
 	{
@@ -68,6 +73,6 @@ int main (int argc, char** argv, char** envp)
 	SSEPow::deinitialize();
 #endif
 
-	return EXIT_SUCCESS;
+	return exit_status;
 }
 
@@ -0,0 +1,126 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <cmath>
+
+// Qt:
+#include <QCoreApplication>
+#include <QMetaObject>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/exception.h>
+
+// Local:
+#include "offline_render.h"
+
+
+namespace Haruhi {
+
+OfflineRender::OfflineRender (Parameters const& parameters):
+	_parameters (parameters)
+{
+	_sequence.load (_parameters.input_file);
+	_length = std::ceil ((_sequence.duration() + _parameters.tail) * _parameters.sample_rate);
+
+	// Output transport truncates the file again when rendering starts:
+	if (!std::ofstream (_parameters.output_file, std::ios::out | std::ios::binary | std::ios::trunc))
+		throw Exception ("could not open output file", _parameters.output_file);
+}
+
+
+bool
+OfflineRender::requested (int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (std::strcmp (argv[i], "--render") == 0)
+			return true;
+	return false;
+}
+
+
+OfflineRender::Parameters
+OfflineRender::parse_arguments (int argc, char** argv)
+{
+	Parameters result;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		if (i + 1 >= argc)
+			throw Exception ("missing value for command line option", option);
+		std::string value = argv[++i];
+
+		try {
+			if (option == "--render")
+				result.session_file = value;
+			else if (option == "--input")
+				result.input_file = value;
+			else if (option == "--output")
+				result.output_file = value;
+			else if (option == "--sample-rate")
+				result.sample_rate = 1_Hz * std::stoi (value);
+			else if (option == "--period")
+				result.buffer_size = std::stoul (value);
+			else if (option == "--tail")
+				result.tail = 1_s * std::stod (value);
+			else
+				throw Exception ("unknown command line option", option);
+		}
+		catch (std::logic_error const&)
+		{
+			throw Exception ("invalid value for command line option", option + " " + value);
+		}
+	}
+
+	if (result.session_file.empty() || result.input_file.empty() || result.output_file.empty())
+		throw Exception ("offline rendering requires --render, --input and --output options");
+	if (result.sample_rate <= 0_Hz || result.buffer_size == 0)
+		throw Exception ("sample rate and period size must be positive");
+
+	return result;
+}
+
+
+void
+OfflineRender::advance (std::size_t samples)
+{
+	if (_rendering)
+	{
+		_position += samples;
+		if (_position >= _length && !_finished.load())
+		{
+			_finished.store (true);
+			QMetaObject::invokeMethod (QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+		}
+	}
+	else if (_start_requested.load())
+		_rendering = true;
+}
+
+
+void
+OfflineRender::fail()
+{
+	_failed.store (true);
+	if (!_finished.exchange (true))
+		QMetaObject::invokeMethod (QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+}
+
+} // namespace Haruhi
+
@@ -0,0 +1,217 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__APPLICATION__OFFLINE_RENDER_H__INCLUDED
+#define HARUHI__APPLICATION__OFFLINE_RENDER_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <string>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/lib/midi_sequence.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/noncopyable.h>
+
+
+namespace Haruhi {
+
+/**
+ * Offline (faster than realtime) rendering of a session, requested
+ * from command line:
+ *
+ *   haruhi --render <session-file> --input <midi-file> --output <audio-file>
+ *          [--sample-rate <Hz>] [--period <samples>] [--tail <seconds>]
+ *
+ * Input is a Standard MIDI File or an event script (see MIDI::Sequence).
+ * Output is written as 32-bit float WAV if file name ends with ".wav",
+ * otherwise as raw interleaved floats.
+ *
+ * When OfflineRender exists, audio and event backends use offline transports,
+ * which let Engine run processing rounds back-to-back. Audio transport calls
+ * advance() at the end of each round; rendering starts on the round following
+ * the start() call, so that event and audio transports always agree on position.
+ * Application quits when length() samples have been rendered.
+ */
+class OfflineRender: private Noncopyable
+{
+  public:
+	struct Parameters
+	{
+		std::string	session_file;
+		std::string	input_file;
+		std::string	output_file;
+		Frequency	sample_rate	= 48_kHz;
+		std::size_t	buffer_size	= 256;
+		Time		tail		= 2_s;
+	};
+
+  public:
+	/**
+	 * Loads input sequence and checks that output file can be created,
+	 * so that the render doesn't run in vain.
+	 * \throws	Exception if input can't be loaded or output can't be created.
+	 */
+	explicit
+	OfflineRender (Parameters const&);
+
+	/**
+	 * Return true if command line requests offline rendering.
+	 */
+	static bool
+	requested (int argc, char** argv);
+
+	/**
+	 * Parse command line.
+	 * \throws	Exception on invalid or missing arguments.
+	 */
+	static Parameters
+	parse_arguments (int argc, char** argv);
+
+	Parameters const&
+	parameters() const noexcept;
+
+	MIDI::Sequence const&
+	sequence() const noexcept;
+
+	/**
+	 * Return number of samples to render (sequence and tail).
+	 */
+	std::size_t
+	length() const noexcept;
+
+	/**
+	 * Start rendering on next processing round.
+	 * \threadsafe
+	 */
+	void
+	start() noexcept;
+
+	/**
+	 * Return true if rendering is in progress or has finished.
+	 * \entry	Engine thread only.
+	 */
+	bool
+	rendering() const noexcept;
+
+	/**
+	 * Return position (in samples) of current processing round.
+	 * \entry	Engine thread only.
+	 */
+	std::size_t
+	position() const noexcept;
+
+	/**
+	 * Advance position by given number of samples. Called by audio
+	 * transport at the end of each processing round. Quits application
+	 * when rendering is finished.
+	 * \entry	Engine thread only.
+	 */
+	void
+	advance (std::size_t samples);
+
+	/**
+	 * Return true if all samples have been rendered
+	 * or rendering has failed.
+	 * \threadsafe
+	 */
+	bool
+	finished() const noexcept;
+
+	/**
+	 * Abort rendering because output couldn't be written.
+	 * Quits application.
+	 * \threadsafe
+	 */
+	void
+	fail();
+
+	/**
+	 * Return true if rendering has failed.
+	 * \threadsafe
+	 */
+	bool
+	failed() const noexcept;
+
+  private:
+	Parameters		_parameters;
+	MIDI::Sequence	_sequence;
+	std::size_t		_length;
+	Atomic<bool>	_start_requested	{ false };
+	bool			_rendering			= false;
+	std::size_t		_position			= 0;
+	Atomic<bool>	_finished			{ false };
+	Atomic<bool>	_failed				{ false };
+};
+
+
+inline OfflineRender::Parameters const&
+OfflineRender::parameters() const noexcept
+{
+	return _parameters;
+}
+
+
+inline MIDI::Sequence const&
+OfflineRender::sequence() const noexcept
+{
+	return _sequence;
+}
+
+
+inline std::size_t
+OfflineRender::length() const noexcept
+{
+	return _length;
+}
+
+
+inline void
+OfflineRender::start() noexcept
+{
+	_start_requested.store (true);
+}
+
+
+inline bool
+OfflineRender::rendering() const noexcept
+{
+	return _rendering;
+}
+
+
+inline std::size_t
+OfflineRender::position() const noexcept
+{
+	return _position;
+}
+
+
+inline bool
+OfflineRender::finished() const noexcept
+{
+	return _finished.load();
+}
+
+
+inline bool
+OfflineRender::failed() const noexcept
+{
+	return _failed.load();
+}
+
+} // namespace Haruhi
+
+#endif
+
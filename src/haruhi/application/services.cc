@@ -12,6 +12,7 @@
  */
 
 // Standard:
+#include <algorithm>
 #include <cstddef>
 #include <fstream>
 #include <sstream>
@@ -36,6 +37,7 @@ namespace Haruhi {
 
 Unique<WorkPerformer>		Services::_hi_priority_work_performer;
 Unique<WorkPerformer>		Services::_lo_priority_work_performer;
+Unique<WorkPerformer>		Services::_graph_work_performer;
 Unique<CallOutDispatcher>	Services::_call_out_dispatcher;
 
 
@@ -51,10 +53,19 @@ CallOutDispatcher::customEvent (QEvent* event)
 
 
 void
-Services::initialize()
+Services::initialize (unsigned int graph_threads)
 {
-	_hi_priority_work_performer = std::make_unique<WorkPerformer> (std::thread::hardware_concurrency());
-	_lo_priority_work_performer = std::make_unique<WorkPerformer> (std::thread::hardware_concurrency());
+	unsigned int const cores = std::max (1u, std::thread::hardware_concurrency());
+	// Both RT performers run at the same time (graph units wait for work they put
+	// on the hi-priority one), so cores given to graph threads are taken from
+	// the hi-priority performer. The thread running a processing round executes
+	// graph steps too, so it isn't counted:
+	unsigned int const hi_priority_threads = std::max (1u, cores - std::min (cores, graph_threads));
+
+	_hi_priority_work_performer = std::make_unique<WorkPerformer> (hi_priority_threads, "Hi-priority");
+	_lo_priority_work_performer = std::make_unique<WorkPerformer> (cores, "Lo-priority");
+	if (graph_threads > 0)
+		_graph_work_performer = std::make_unique<WorkPerformer> (graph_threads, "Graph");
 	_call_out_dispatcher = std::make_unique<CallOutDispatcher>();
 }
 
@@ -64,6 +75,7 @@ Services::deinitialize()
 {
 	_hi_priority_work_performer.reset();
 	_lo_priority_work_performer.reset();
+	_graph_work_performer.reset();
 	_call_out_dispatcher.reset();
 }
 
@@ -85,6 +97,12 @@ Services::features()
 #ifdef HARUHI_IEEE754
 	features.push_back ("IEEE754");
 #endif
+#ifdef HARUHI_CPU_STATS
+	features.push_back ("CPU-STATS");
+#endif
+#ifdef HARUHI_TRACE
+	features.push_back ("TRACE");
+#endif
 
 	return features;
 }
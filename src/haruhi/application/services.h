@@ -84,9 +84,10 @@ class Services
 	/**
 	 * Initialize services.
 	 * Call AFTER initialization of QApplication.
+	 * \param	graph_threads Number of threads of graph_work_performer().
 	 */
 	static void
-	initialize();
+	initialize (unsigned int graph_threads = 0);
 
 	/**
 	 * Deinit.
@@ -107,6 +108,17 @@ class Services
 	static WorkPerformer*
 	lo_priority_work_performer();
 
+	/**
+	 * Return RT-prioritized work performer used by Graph
+	 * to process independent units concurrently.
+	 * It's separate from hi_priority_work_performer(), since units
+	 * processed by Graph wait for work they put on that one.
+	 * Return nullptr unless configured with graph_threads, since a single
+	 * synth processed serially benefits more from all cores rendering its voices.
+	 */
+	static WorkPerformer*
+	graph_work_performer();
+
 	/**
 	 * Return vector of compiled-in feature names.
 	 */
@@ -151,6 +163,7 @@ class Services
   private:
 	static Unique<WorkPerformer>		_hi_priority_work_performer;
 	static Unique<WorkPerformer>		_lo_priority_work_performer;
+	static Unique<WorkPerformer>		_graph_work_performer;
 	static Unique<CallOutDispatcher>	_call_out_dispatcher;
 };
 
@@ -192,6 +205,13 @@ Services::lo_priority_work_performer()
 }
 
 
+inline WorkPerformer*
+Services::graph_work_performer()
+{
+	return _graph_work_performer.get();
+}
+
+
 namespace ScreenLiterals {
 
 /**
@@ -0,0 +1,494 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/config/version.h>
+#include <haruhi/application/services.h>
+#include <haruhi/graph/event.h>
+#include <haruhi/session/cpu_stats_dump.h>
+#include <haruhi/utility/cpu_stats.h>
+#include <haruhi/utility/exception.h>
+#include <haruhi/utility/json.h>
+
+// Plugins:
+#include <plugins/yuki/part_manager.h>
+#include <plugins/yuki/part.h>
+
+// Local:
+#include "bench.h"
+
+
+namespace Haruhi {
+
+namespace BenchPrivate {
+
+/**
+ * Return value at given percentile (0…100) of sorted values.
+ */
+inline double
+percentile (std::vector<double> const& sorted, double p)
+{
+	if (sorted.empty())
+		return 0.0;
+	std::size_t const index = std::ceil (p / 100.0 * sorted.size());
+	return sorted[std::min (std::max<std::size_t> (index, 1), sorted.size()) - 1];
+}
+
+
+inline unsigned int
+parse_in_range (std::string const& option, std::string const& value, unsigned int min, unsigned int max)
+{
+	unsigned long result = std::stoul (value);
+	if (result < min || result > max)
+		throw Exception ("value out of range for command line option", option + " " + value + " (" + std::to_string (min) + "…" + std::to_string (max) + ")");
+	return result;
+}
+
+} // namespace BenchPrivate
+
+
+Bench::Driver::Driver (MIDI::Sequence const& sequence):
+	Unit ("urn://haruhi.mulabs.org/bench/driver/1", "Bench driver"),
+	_sequence (sequence)
+{
+	voice_out		= std::make_unique<EventPort> (this, "Voice control", Port::Output);
+	pitch_out		= std::make_unique<EventPort> (this, "Voice pitch", Port::Output);
+	velocity_out	= std::make_unique<EventPort> (this, "Voice velocity", Port::Output);
+	controller_out	= std::make_unique<EventPort> (this, "Controller", Port::Output);
+	pitchbend_out	= std::make_unique<EventPort> (this, "Pitchbend", Port::Output);
+
+	std::fill (std::begin (_voice_ids), std::end (_voice_ids), OmniVoice);
+}
+
+
+Bench::Driver::~Driver()
+{
+	voice_out.reset();
+	pitch_out.reset();
+	velocity_out.reset();
+	controller_out.reset();
+	pitchbend_out.reset();
+}
+
+
+void
+Bench::Driver::registered()
+{
+	enable();
+}
+
+
+void
+Bench::Driver::unregistered()
+{
+	_next_event = 0;
+	_position = 0;
+}
+
+
+void
+Bench::Driver::process()
+{
+	clear_outputs();
+
+	std::size_t const begin = _position;
+	std::size_t const end = begin + graph()->buffer_size();
+	auto const& events = _sequence.events();
+
+	for (; _next_event < events.size(); ++_next_event)
+	{
+		auto const& timed_event = events[_next_event];
+		std::size_t const sample = std::round (timed_event.time * graph()->sample_rate());
+		if (sample >= end)
+			break;
+		handle_event (timed_event.event, sample > begin ? sample - begin : 0);
+	}
+
+	_position = end;
+}
+
+
+void
+Bench::Driver::handle_event (MIDI::Event const& midi_event, std::size_t frame)
+{
+	Time const t = graph()->timestamp();
+
+	auto push = [frame] (EventPort* port, auto event) {
+		event.set_frame (frame);
+		port->buffer()->push (event);
+	};
+
+	auto note_off = [&] (uint8_t note) {
+		if (_voice_ids[note] != OmniVoice)
+		{
+			push (voice_out.get(), VoiceEvent (t, note, _voice_ids[note], VoiceEvent::Action::Drop));
+			_voice_ids[note] = OmniVoice;
+		}
+	};
+
+	switch (midi_event.type)
+	{
+		case MIDI::Event::NoteOn:
+		{
+			uint8_t const note = midi_event.note_on.note;
+			note_off (note);
+			if (midi_event.note_on.velocity == 0)
+				break;
+
+			VoiceID const voice_id = VoiceEvent::allocate_voice_id();
+			_voice_ids[note] = voice_id;
+			push (voice_out.get(), VoiceEvent (t, note, voice_id, VoiceEvent::Action::Create));
+			push (velocity_out.get(), VoiceControllerEvent (t, voice_id, midi_event.note_on.velocity / 127.0f));
+			push (pitch_out.get(), VoiceControllerEvent (t, voice_id, VoiceEvent::frequency_from_key_id (note, graph()->master_tune()).Hz()));
+			break;
+		}
+
+		case MIDI::Event::NoteOff:
+			note_off (midi_event.note_off.note);
+			break;
+
+		case MIDI::Event::Controller:
+			push (controller_out.get(), ControllerEvent (t, midi_event.controller.value / 127.0f));
+			break;
+
+		case MIDI::Event::Pitchbend:
+			push (pitchbend_out.get(), ControllerEvent (t, (midi_event.pitchbend.value + 8192) / 16383.0f));
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+Bench::Bench (Parameters const& parameters):
+	_parameters (parameters)
+{
+	if (_parameters.pattern_file.empty())
+		make_default_pattern (_sequence, _parameters.voices, _parameters.warmup + _parameters.duration);
+	else
+		_sequence.load (_parameters.pattern_file);
+
+	_graph.synchronize ([&] {
+		_graph.set_sample_rate (_parameters.sample_rate);
+		_graph.set_buffer_size (_parameters.buffer_size);
+	});
+
+	// Same as Session does:
+	_graph.set_work_performer (Services::graph_work_performer());
+
+	_driver = std::make_unique<Driver> (_sequence);
+	_graph.register_unit (_driver.get());
+
+	_yuki = static_cast<Yuki::Plugin*> (_yuki_factory.create_plugin (0, nullptr));
+	_graph.register_unit (_yuki);
+
+	Yuki::PartManager* part_manager = _yuki->part_manager();
+	part_manager->main_params()->polyphony.set (_parameters.voices);
+	part_manager->main_params()->oversampling.set (_parameters.oversampling);
+
+	std::vector<Yuki::Part*> parts;
+	for (unsigned int i = 0; i < _parameters.parts; ++i)
+	{
+		Yuki::Part* part = part_manager->add_part();
+		Yuki::Params::Voice& voice_params = part->part_params()->voice;
+		voice_params.unison_index.set (_parameters.unison);
+		if (_parameters.filter_stages > 0)
+		{
+			voice_params.filters[0].enabled.set (1);
+			voice_params.filters[0].stages.set (_parameters.filter_stages);
+		}
+		parts.push_back (part);
+	}
+
+	for (unsigned int i = 0; i < _parameters.freeverbs; ++i)
+	{
+		_freeverbs.push_back (_freeverb_factory.create_plugin (0, nullptr));
+		_graph.register_unit (_freeverbs.back());
+	}
+
+	_graph.synchronize ([&] {
+		Yuki::PartManager::MainPorts* ports = part_manager->ports();
+		_driver->voice_out->connect_to (ports->voice_in.get());
+		_driver->pitch_out->connect_to (ports->voice_pitch.get());
+		_driver->velocity_out->connect_to (ports->voice_velocity.get());
+		_driver->pitchbend_out->connect_to (ports->pitchbend.get());
+		for (Yuki::Part* part: parts)
+			_driver->controller_out->connect_to (part->ports()->filter_frequency[0].get());
+
+		// Chain reverbs after Yuki:
+		Port* left = ports->audio_out[0].get();
+		Port* right = ports->audio_out[1].get();
+		for (Haruhi::Plugin* freeverb: _freeverbs)
+		{
+			left->connect_to (find_port (freeverb->inputs(), "In 1"));
+			right->connect_to (find_port (freeverb->inputs(), "In 2"));
+			left = find_port (freeverb->outputs(), "Out 1");
+			right = find_port (freeverb->outputs(), "Out 2");
+		}
+	});
+
+	_graph.update_execution_plan();
+}
+
+
+Bench::~Bench()
+{
+	for (Haruhi::Plugin* freeverb: _freeverbs)
+	{
+		_graph.unregister_unit (freeverb);
+		_freeverb_factory.destroy_plugin (freeverb);
+	}
+	_graph.unregister_unit (_yuki);
+	_yuki_factory.destroy_plugin (_yuki);
+	_graph.unregister_unit (_driver.get());
+	_driver.reset();
+	_graph.set_work_performer (nullptr);
+}
+
+
+Bench::Parameters
+Bench::parse_arguments (int argc, char** argv)
+{
+	using BenchPrivate::parse_in_range;
+
+	Parameters result;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		if (i + 1 >= argc)
+			throw Exception ("missing value for command line option", option);
+		std::string value = argv[++i];
+
+		try {
+			if (option == "--parts")
+				result.parts = parse_in_range (option, value, 1, 64);
+			else if (option == "--voices")
+				result.voices = parse_in_range (option, value, 1, 128);
+			else if (option == "--unison")
+				result.unison = parse_in_range (option, value, 1, 10);
+			else if (option == "--oversampling")
+				result.oversampling = parse_in_range (option, value, 1, 16);
+			else if (option == "--filter-stages")
+				result.filter_stages = parse_in_range (option, value, 0, 5);
+			else if (option == "--freeverbs")
+				result.freeverbs = parse_in_range (option, value, 0, 64);
+			else if (option == "--graph-threads")
+				result.graph_threads = parse_in_range (option, value, 0, 64);
+			else if (option == "--sample-rate")
+				result.sample_rate = 1_Hz * parse_in_range (option, value, 1, 384000);
+			else if (option == "--period")
+				result.buffer_size = parse_in_range (option, value, 1, 8192);
+			else if (option == "--duration")
+				result.duration = 1_s * std::stod (value);
+			else if (option == "--warmup")
+				result.warmup = 1_s * std::stod (value);
+			else if (option == "--pattern")
+				result.pattern_file = value;
+			else if (option == "--output")
+				result.output_file = value;
+			else
+				throw Exception ("unknown command line option", option);
+		}
+		catch (std::logic_error const&)
+		{
+			throw Exception ("invalid value for command line option", option + " " + value);
+		}
+	}
+
+	if (result.duration <= 0_s || result.warmup < 0_s)
+		throw Exception ("duration must be positive and warmup non-negative");
+
+	return result;
+}
+
+
+void
+Bench::run()
+{
+	std::size_t const warmup_rounds = std::ceil (_parameters.warmup * _parameters.sample_rate / _parameters.buffer_size);
+	std::size_t const measured_rounds = std::ceil (_parameters.duration * _parameters.sample_rate / _parameters.buffer_size);
+
+	_round_times.clear();
+	_round_voices.clear();
+	_round_times.reserve (measured_rounds);
+	_round_voices.reserve (measured_rounds);
+
+	for (std::size_t i = 0; i < warmup_rounds; ++i)
+		round();
+
+	for (std::size_t i = 0; i < measured_rounds; ++i)
+	{
+		_round_times.push_back (round());
+		_round_voices.push_back (_yuki->voices_number());
+	}
+}
+
+
+void
+Bench::report (std::ostream& out) const
+{
+	using BenchPrivate::percentile;
+
+	std::vector<double> sorted = _round_times;
+	std::sort (sorted.begin(), sorted.end());
+
+	double const period = _parameters.buffer_size / _parameters.sample_rate.Hz();
+	double const total_time = std::accumulate (_round_times.begin(), _round_times.end(), 0.0);
+	double const total_voices = std::accumulate (_round_voices.begin(), _round_voices.end(), 0.0);
+	double const mean_time = sorted.empty() ? 0.0 : total_time / sorted.size();
+	double const mean_voices = _round_voices.empty() ? 0.0 : total_voices / _round_voices.size();
+	unsigned int const max_voices = _round_voices.empty() ? 0 : *std::max_element (_round_voices.begin(), _round_voices.end());
+	std::size_t const overruns = std::count_if (sorted.begin(), sorted.end(), [&](double t) { return t > period; });
+
+	auto us = [](double seconds) { return 1e6 * seconds; };
+
+	out << std::fixed << std::setprecision (3);
+	out << "{\n";
+	out << "\t\"commit\": " << json_quoted (Version::commit) << ",\n";
+	out << "\t\"branch\": " << json_quoted (Version::branch) << ",\n";
+	out << "\t\"parameters\": {\n";
+	out << "\t\t\"parts\": " << _parameters.parts << ",\n";
+	out << "\t\t\"voices\": " << _parameters.voices << ",\n";
+	out << "\t\t\"unison\": " << _parameters.unison << ",\n";
+	out << "\t\t\"oversampling\": " << _parameters.oversampling << ",\n";
+	out << "\t\t\"filter_stages\": " << _parameters.filter_stages << ",\n";
+	out << "\t\t\"freeverbs\": " << _parameters.freeverbs << ",\n";
+	out << "\t\t\"sample_rate\": " << _parameters.sample_rate.Hz() << ",\n";
+	out << "\t\t\"period\": " << _parameters.buffer_size << ",\n";
+	out << "\t\t\"duration_s\": " << _parameters.duration.s() << ",\n";
+	out << "\t\t\"warmup_s\": " << _parameters.warmup.s() << ",\n";
+	out << "\t\t\"pattern\": " << json_quoted (_parameters.pattern_file.empty() ? "built-in" : _parameters.pattern_file) << ",\n";
+	out << "\t\t\"graph_threads\": " << _parameters.graph_threads << "\n";
+	out << "\t},\n";
+	out << "\t\"rounds\": " << sorted.size() << ",\n";
+	out << "\t\"period_us\": " << us (period) << ",\n";
+	out << "\t\"round_time_us\": {\n";
+	out << "\t\t\"min\": " << us (percentile (sorted, 0.0)) << ",\n";
+	out << "\t\t\"mean\": " << us (mean_time) << ",\n";
+	out << "\t\t\"p50\": " << us (percentile (sorted, 50.0)) << ",\n";
+	out << "\t\t\"p90\": " << us (percentile (sorted, 90.0)) << ",\n";
+	out << "\t\t\"p99\": " << us (percentile (sorted, 99.0)) << ",\n";
+	out << "\t\t\"p999\": " << us (percentile (sorted, 99.9)) << ",\n";
+	out << "\t\t\"max\": " << us (percentile (sorted, 100.0)) << "\n";
+	out << "\t},\n";
+	out << "\t\"budget_fraction\": {\n";
+	out << "\t\t\"mean\": " << mean_time / period << ",\n";
+	out << "\t\t\"p99\": " << percentile (sorted, 99.0) / period << ",\n";
+	out << "\t\t\"max\": " << percentile (sorted, 100.0) / period << "\n";
+	out << "\t},\n";
+	out << "\t\"overruns\": " << overruns << ",\n";
+	out << "\t\"voices\": {\n";
+	out << "\t\t\"mean\": " << mean_voices << ",\n";
+	out << "\t\t\"max\": " << max_voices << "\n";
+	out << "\t},\n";
+	out << "\t\"voice_samples_per_s\": " << (total_time > 0.0 ? total_voices * _parameters.buffer_size / total_time : 0.0) << ",\n";
+	out << "\t\"realtime_factor\": " << (total_time > 0.0 ? sorted.size() * period / total_time : 0.0);
+	if (CPUStats::enabled())
+	{
+		out << ",\n\t\"cpu_stats\": ";
+		dump_cpu_stats (out, &_graph, 1);
+	}
+	out << "\n}" << std::endl;
+}
+
+
+void
+Bench::make_default_pattern (MIDI::Sequence& sequence, unsigned int voices, Time duration)
+{
+	Time const chord_length = 1_s;
+	Time const controller_interval = 10_ms;
+	Time const sweep_period = 4_s;
+
+	sequence.clear();
+
+	// Chords. Notes of previous chord are released at the same time
+	// new ones are started, so the number of voices stays constant:
+	std::vector<uint8_t> previous_notes;
+	for (unsigned int c = 0; c * chord_length < duration; ++c)
+	{
+		Time const t = c * chord_length;
+
+		for (uint8_t note: previous_notes)
+		{
+			MIDI::Event event;
+			event.type = MIDI::Event::NoteOff;
+			event.note_off.channel = 0;
+			event.note_off.note = note;
+			event.note_off.velocity = 0;
+			sequence.add (t, event);
+		}
+		previous_notes.clear();
+
+		for (unsigned int v = 0; v < voices; ++v)
+		{
+			MIDI::Event event;
+			event.type = MIDI::Event::NoteOn;
+			event.note_on.channel = 0;
+			// Shift notes with each chord. Since 7 and 128 are coprime,
+			// each note in a chord is different:
+			event.note_on.note = (v * 7 + c * 5) % 128;
+			event.note_on.velocity = 64 + (v * 13 + c * 7) % 64;
+			previous_notes.push_back (event.note_on.note);
+			sequence.add (t, event);
+		}
+	}
+
+	// Filter cutoff sweep:
+	for (unsigned int i = 0; i * controller_interval < duration; ++i)
+	{
+		Time const t = i * controller_interval;
+		MIDI::Event event;
+		event.type = MIDI::Event::Controller;
+		event.controller.channel = 0;
+		event.controller.number = 1;
+		event.controller.value = 64 + 63 * std::sin (2.0 * M_PI * t.s() / sweep_period.s());
+		sequence.add (t, event);
+	}
+}
+
+
+Port*
+Bench::find_port (Ports const& ports, std::string const& name)
+{
+	for (Port* port: ports)
+		if (port->name() == name)
+			return port;
+	throw Exception ("port not found", name);
+}
+
+
+double
+Bench::round()
+{
+	auto const begin = std::chrono::steady_clock::now();
+	_graph.enter_processing_round();
+	_graph.leave_processing_round();
+	auto const end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double> (end - begin).count();
+}
+
+} // namespace Haruhi
+
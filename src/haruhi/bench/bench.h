@@ -0,0 +1,203 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__BENCH__BENCH_H__INCLUDED
+#define HARUHI__BENCH__BENCH_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/graph/graph.h>
+#include <haruhi/graph/unit.h>
+#include <haruhi/graph/event_port.h>
+#include <haruhi/lib/midi_sequence.h>
+#include <haruhi/plugin/plugin.h>
+#include <haruhi/utility/noncopyable.h>
+
+// Plugins:
+#include <plugins/yuki/yuki.h>
+#include <plugins/yuki/plugin.h>
+#include <plugins/freeverb/freeverb.h>
+
+
+namespace Haruhi {
+
+/**
+ * Headless benchmark of the synthesis graph.
+ *
+ * Builds a Graph with one Yuki instance (configurable number of parts,
+ * voices, unison voices, oversampling and filter stages) followed by a chain
+ * of Freeverb instances. No audio or event backend is used: processing rounds
+ * are run back-to-back by the benchmark itself and each one is timed.
+ *
+ * Notes and controllers come from a scripted pattern: either a MIDI file or
+ * event script (see MIDI::Sequence), or a built-in pattern that keeps exactly
+ * the requested number of voices sounding while sweeping filter cutoff.
+ *
+ * Results are written as JSON, so they can be compared across commits.
+ */
+class Bench: private Noncopyable
+{
+  public:
+	struct Parameters
+	{
+		unsigned int	parts			= 1;
+		unsigned int	voices			= 16;
+		unsigned int	unison			= 1;
+		unsigned int	oversampling	= 1;
+		// 0 disables filters:
+		unsigned int	filter_stages	= 0;
+		unsigned int	freeverbs		= 0;
+		// Threads of the Graph work performer:
+		unsigned int	graph_threads	= 0;
+		Frequency		sample_rate		= 48_kHz;
+		std::size_t		buffer_size		= 256;
+		Time			duration		= 10_s;
+		// Rounds run before measurement starts:
+		Time			warmup			= 1_s;
+		// Empty means built-in pattern:
+		std::string		pattern_file;
+		// Empty means standard output:
+		std::string		output_file;
+	};
+
+	/**
+	 * Plays MIDI::Sequence into Yuki's voice and controller ports,
+	 * the way DevicesManager::Controller does with events from event backend.
+	 * Controller events (any number) modulate filter frequency of all parts,
+	 * pitchbend goes to Yuki's pitchbend port.
+	 */
+	class Driver: public Unit
+	{
+	  public:
+		Driver (MIDI::Sequence const&);
+
+		~Driver();
+
+		/**
+		 * Return number of samples played so far.
+		 */
+		std::size_t
+		position() const noexcept;
+
+		/*
+		 * Unit API
+		 */
+
+		void
+		registered() override;
+
+		void
+		unregistered() override;
+
+		void
+		process() override;
+
+	  private:
+		void
+		handle_event (MIDI::Event const&, std::size_t frame);
+
+	  public:
+		Unique<EventPort>	voice_out;
+		Unique<EventPort>	pitch_out;
+		Unique<EventPort>	velocity_out;
+		Unique<EventPort>	controller_out;
+		Unique<EventPort>	pitchbend_out;
+
+	  private:
+		MIDI::Sequence const&	_sequence;
+		std::size_t				_next_event		= 0;
+		std::size_t				_position		= 0;
+		VoiceID					_voice_ids[128];
+	};
+
+  public:
+	/**
+	 * Build graph and load pattern.
+	 * \throws	Exception if pattern can't be loaded.
+	 */
+	explicit
+	Bench (Parameters const&);
+
+	~Bench();
+
+	/**
+	 * Parse command line.
+	 * \throws	Exception on invalid arguments.
+	 */
+	static Parameters
+	parse_arguments (int argc, char** argv);
+
+	/**
+	 * Run warmup and measured rounds.
+	 */
+	void
+	run();
+
+	/**
+	 * Write JSON report of the last run().
+	 */
+	void
+	report (std::ostream&) const;
+
+  private:
+	/**
+	 * Fill sequence with built-in pattern: chords of given number
+	 * of notes, each chord replacing the previous one, plus controller sweep.
+	 */
+	static void
+	make_default_pattern (MIDI::Sequence&, unsigned int voices, Time duration);
+
+	/**
+	 * Find unit's port by name.
+	 * \throws	Exception if there's no such port.
+	 */
+	static Port*
+	find_port (Ports const&, std::string const& name);
+
+	/**
+	 * Run one processing round, return its duration in seconds.
+	 */
+	double
+	round();
+
+  private:
+	Parameters						_parameters;
+	MIDI::Sequence					_sequence;
+	Graph							_graph;
+	YukiFactory						_yuki_factory;
+	FreeverbFactory					_freeverb_factory;
+	Unique<Driver>					_driver;
+	Yuki::Plugin*					_yuki			= nullptr;
+	std::vector<Haruhi::Plugin*>	_freeverbs;
+	// Measured rounds:
+	std::vector<double>				_round_times;
+	std::vector<unsigned int>		_round_voices;
+};
+
+
+inline std::size_t
+Bench::Driver::position() const noexcept
+{
+	return _position;
+}
+
+} // namespace Haruhi
+
+#endif
+
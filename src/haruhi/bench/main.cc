@@ -0,0 +1,98 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+
+// System:
+#include <locale.h>
+
+// Qt:
+#include <QApplication>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/application/services.h>
+#include <haruhi/session/periodic_updater.h>
+#include <haruhi/utility/exception.h>
+#include <haruhi/utility/fast_pow.h>
+
+// Local:
+#include "bench.h"
+
+
+/**
+ * Usage:
+ *   bench [--parts <n>] [--voices <n>] [--unison <n>] [--oversampling <n>]
+ *         [--filter-stages <n>] [--freeverbs <n>] [--graph-threads <n>]
+ *         [--sample-rate <Hz>] [--period <samples>]
+ *         [--duration <seconds>] [--warmup <seconds>] [--pattern <midi-or-script-file>]
+ *         [--output <json-file>]
+ */
+int main (int argc, char** argv)
+{
+	setenv ("LC_ALL", "POSIX", 1);
+	setlocale (LC_ALL, "POSIX");
+	// Plugins are QWidgets, but nothing is ever shown:
+	setenv ("QT_QPA_PLATFORM", "offscreen", 0);
+
+	LookupPow::initialize();
+#ifdef HARUHI_HAS_SSE_POW
+	SSEPow::initialize();
+#endif
+
+	int result = EXIT_SUCCESS;
+
+	try {
+		Haruhi::Bench::Parameters parameters = Haruhi::Bench::parse_arguments (argc, argv);
+
+		QApplication app (argc, argv);
+		Haruhi::Services::initialize (parameters.graph_threads);
+
+		{
+			Haruhi::PeriodicUpdater periodic_updater (30);
+			Haruhi::Bench bench (parameters);
+			bench.run();
+
+			if (parameters.output_file.empty())
+				bench.report (std::cout);
+			else
+			{
+				std::ofstream output (parameters.output_file);
+				if (!output.good())
+					throw Exception ("could not open output file", parameters.output_file);
+				bench.report (output);
+			}
+		}
+
+		Haruhi::Services::deinitialize();
+	}
+	catch (Exception const& e)
+	{
+		std::cerr << "bench: " << e.what();
+		if (*e.details())
+			std::cerr << ": " << e.details();
+		std::cerr << std::endl;
+		result = EXIT_FAILURE;
+	}
+
+	LookupPow::deinitialize();
+#ifdef HARUHI_HAS_SSE_POW
+	SSEPow::deinitialize();
+#endif
+
+	return result;
+}
+
@@ -14,6 +14,7 @@
 // Standard:
 #include <cstddef>
 #include <cstdlib>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <algorithm>
@@ -34,6 +35,7 @@
 
 // Local:
 #include "transports/jack_transport.h"
+#include "transports/offline_transport.h"
 #include "backend.h"
 
 
@@ -49,7 +51,10 @@ Backend::Backend (QString const& client_name, QWidget* parent):
 	_master_volume_port = std::make_unique<EventPort> (this, "Master Volume", Port::Input);
 	_panic_port = std::make_unique<EventPort> (this, "Panic", Port::Input);
 
-	_transport = std::make_unique<JackTransport> (this);
+	if (OfflineRender* offline_render = Haruhi::haruhi()->offline_render())
+		_transport = std::make_unique<OfflineTransport> (this, offline_render);
+	else
+		_transport = std::make_unique<JackTransport> (this);
 
 	_connect_retry_timer = std::make_unique<QTimer> (this);
 	QObject::connect (_connect_retry_timer.get(), SIGNAL (timeout()), this, SLOT (connect()));
@@ -209,6 +214,13 @@ Backend::data_ready()
 		return;
 	}
 
+	// Rounds are run by transport, nothing to do here:
+	if (_round)
+	{
+		usleep ((33_ms).us());
+		return;
+	}
+
 	_ports_lock.synchronize ([&] {
 		// Use Master Volume control to adjust volume of outputs:
 		_master_volume_smoother.fill (_master_volume_smoother_buffer.begin(),
@@ -245,6 +257,35 @@ Backend::data_ready()
 }
 
 
+bool
+Backend::set_synchronous_round (Round round)
+{
+	// Transport must not call old round after it's replaced:
+	if (round)
+	{
+		_round = round;
+		if (!_transport->set_synchronous_round ([this] { return synchronous_round(); }))
+		{
+			_round = nullptr;
+			return false;
+		}
+	}
+	else
+	{
+		_transport->set_synchronous_round (Transport::Round());
+		_round = round;
+	}
+	return true;
+}
+
+
+bool
+Backend::synchronous() const
+{
+	return _round && _transport->connected() && _transport->active();
+}
+
+
 void
 Backend::peak_levels (LevelsMap& levels)
 {
@@ -579,6 +620,77 @@ Backend::dummy_round()
 }
 
 
+bool
+Backend::synchronous_round()
+{
+	// Never wait for locks in audio subsystem's callback:
+	Mutex::TryLock graph_lock (*graph());
+	if (!graph_lock.acquired())
+		return false;
+
+	Mutex::TryLock ports_lock (_ports_lock);
+	if (!ports_lock.acquired())
+		return false;
+
+	std::size_t const samples = graph()->buffer_size();
+	auto aligned = [] (Sample* data) -> bool {
+		return reinterpret_cast<std::uintptr_t> (data) % 16 == 0;
+	};
+
+	// Use audio subsystem's buffers directly if they're suitable for SIMD
+	// operations, otherwise copy data:
+	for (auto& p: _inputs)
+	{
+		if (!p.second->ready())
+			continue;
+		AudioBuffer* buffer = p.second->port()->buffer();
+		Sample* data = p.first->direct_buffer();
+		if (!data)
+			buffer->clear();
+		else if (aligned (data))
+			buffer->attach (data);
+		else
+			std::copy (data, data + samples, buffer->begin());
+	}
+
+	for (auto& p: _outputs)
+	{
+		Sample* data = p.first->direct_buffer();
+		if (!p.second->ready())
+		{
+			if (data)
+				std::fill (data, data + samples, 0.0f);
+		}
+		else if (data && aligned (data))
+			p.second->port()->buffer()->attach (data);
+	}
+
+	_round();
+
+	// Use Master Volume control to adjust volume of outputs:
+	_master_volume_smoother.fill (_master_volume_smoother_buffer.begin(),
+								  _master_volume_smoother_buffer.end(),
+								  master_volume());
+	for (auto& p: _outputs)
+	{
+		AudioBuffer* buffer = p.second->port()->buffer();
+		if (p.second->ready())
+		{
+			buffer->attenuate (&_master_volume_smoother_buffer);
+			Sample* data = p.first->direct_buffer();
+			if (data && data != buffer->begin())
+				std::copy (buffer->begin(), buffer->end(), data);
+		}
+		buffer->detach();
+	}
+
+	for (auto& p: _inputs)
+		p.second->port()->buffer()->detach();
+
+	return true;
+}
+
+
 void
 Backend::retry_connect()
 {
@@ -130,6 +130,12 @@ class Backend:
 	void
 	data_ready() override;
 
+	bool
+	set_synchronous_round (Round) override;
+
+	bool
+	synchronous() const override;
+
 	void
 	peak_levels (LevelsMap& levels_map) override;
 
@@ -254,6 +260,14 @@ class Backend:
 	void
 	dummy_round();
 
+	/**
+	 * Called by transport from within audio subsystem's callback.
+	 * Hands audio subsystem's buffers to graph ports and runs _round.
+	 * \returns	false if graph or ports were locked and round was skipped.
+	 */
+	bool
+	synchronous_round();
+
 	void
 	retry_connect();
 
@@ -285,6 +299,9 @@ class Backend:
 	// For smoothing master volume:
 	AudioBuffer				_master_volume_smoother_buffer;
 	DSP::OnePoleSmoother	_master_volume_smoother;
+
+	// Round run from audio subsystem's callback in synchronous mode:
+	Round					_round;
 };
 
 
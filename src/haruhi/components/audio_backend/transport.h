@@ -17,6 +17,7 @@
 // Standard:
 #include <cstddef>
 #include <string>
+#include <functional>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -39,6 +40,12 @@ class Backend;
 class Transport
 {
   public:
+	/**
+	 * Processing round run from within audio subsystem's callback.
+	 * Should return false if round could not be run (eg. graph was locked).
+	 */
+	typedef std::function<bool()> Round;
+
 	class Port
 	{
 	  public:
@@ -59,6 +66,14 @@ class Transport
 		virtual AudioBuffer*
 		buffer();
 
+		/**
+		 * Returns audio subsystem's memory for this port, so it can be used
+		 * without copying. Valid only inside synchronous round.
+		 * Default implementation returns nullptr (not available).
+		 */
+		virtual Sample*
+		direct_buffer();
+
 	  private:
 		Transport*	_transport;
 		AudioBuffer	_buffer;
@@ -130,6 +145,16 @@ class Transport
 	virtual void
 	data_ready() = 0;
 
+	/**
+	 * Makes transport call given round directly from audio subsystem's
+	 * callback, instead of just transferring data to/from port buffers
+	 * and waking up thread waiting in data_ready(). Pass empty Round
+	 * to restore default behaviour.
+	 * \returns	false if transport has no such callback.
+	 */
+	virtual bool
+	set_synchronous_round (Round) = 0;
+
 	/**
 	 * Creates input port with given name.
 	 * Should never return 0, instead it should throw
@@ -177,6 +202,13 @@ Transport::Port::buffer()
 }
 
 
+inline Sample*
+Transport::Port::direct_buffer()
+{
+	return nullptr;
+}
+
+
 inline
 Transport::Transport (Backend* backend):
 	_backend (backend)
@@ -15,6 +15,9 @@
 #include <cstddef>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <memory>
 
 // System:
 #include <signal.h>
@@ -28,6 +31,8 @@
 #include <haruhi/components/audio_backend/backend.h>
 #include <haruhi/components/audio_backend/transport.h>
 #include <haruhi/components/audio_backend/exception.h>
+#include <haruhi/utility/thread.h>
+#include <haruhi/utility/trace.h>
 
 // Local:
 #include "jack_transport.h"
@@ -96,6 +101,13 @@ JackTransport::JackPort::rename (std::string const& new_name)
 }
 
 
+Sample*
+JackTransport::JackPort::direct_buffer()
+{
+	return jack_buffer();
+}
+
+
 void
 JackTransport::JackPort::reinit()
 {
@@ -121,6 +133,7 @@ JackTransport::JackPort::destroy()
 {
 	if (transport()->connected())
 		jack_port_unregister (static_cast<JackTransport*> (transport())->jack_client(), _jack_port);
+	_jack_port = 0;
 }
 
 
@@ -170,6 +183,18 @@ JackTransport::connect (std::string const& client_name)
 		if (jack_set_buffer_size_callback (_jack_client, s_buffer_size_change, vthis))
 			throw ConnectException ("could not setup buffer size change callback", __func__);
 
+		if (Trace::enabled())
+		{
+			if (jack_set_thread_init_callback (_jack_client, s_thread_init, vthis))
+				throw ConnectException ("could not setup thread init callback", __func__);
+		}
+
+		if (Trace::enabled() || CPUStats::enabled())
+		{
+			if (jack_set_xrun_callback (_jack_client, s_xrun, vthis))
+				throw ConnectException ("could not setup xrun callback", __func__);
+		}
+
 		jack_on_shutdown (_jack_client, s_shutdown, vthis);
 
 		c_sample_rate_change (jack_get_sample_rate (_jack_client));
@@ -179,6 +204,7 @@ JackTransport::connect (std::string const& client_name)
 		lock_ports();
 		for (JackPort* p: _ports)
 			p->reinit();
+		update_outputs_snapshot();
 		unlock_ports();
 	}
 	catch (Exception const& e)
@@ -198,6 +224,7 @@ JackTransport::disconnect()
 		lock_ports();
 		for (JackPort* p: _ports)
 			p->destroy();
+		update_outputs_snapshot();
 		unlock_ports();
 		jack_client_t* c = _jack_client;
 		_jack_client = 0;
@@ -246,6 +273,19 @@ JackTransport::data_ready()
 }
 
 
+bool
+JackTransport::set_synchronous_round (Round round)
+{
+	lock_ports();
+	_round = round;
+	_synchronous.store (!!round);
+	unlock_ports();
+	// Wake up thread that may wait in data_ready():
+	_data_ready.post();
+	return true;
+}
+
+
 JackTransport::Port*
 JackTransport::create_input (std::string const& port_name)
 {
@@ -263,6 +303,7 @@ JackTransport::create_output (std::string const& port_name)
 	JackPort* port = new JackPort (this, JackPort::Output, port_name);
 	lock_ports();
 	_ports.insert (port);
+	update_outputs_snapshot();
 	unlock_ports();
 	return port;
 }
@@ -273,6 +314,8 @@ JackTransport::destroy_port (Port* port)
 {
 	lock_ports();
 	_ports.erase (static_cast<JackPort*> (port));
+	// JACK port is unregistered when deleted, so it must be out of the snapshot first:
+	update_outputs_snapshot();
 	unlock_ports();
 	delete port;
 }
@@ -297,17 +340,84 @@ JackTransport::ignore_sigpipe()
 
 
 int
-JackTransport::c_process (jack_nframes_t)
+JackTransport::c_process (jack_nframes_t samples)
 {
-	lock_ports();
-	for (JackPort* p: _ports)
-		p->transfer_data();
-	unlock_ports();
-	_data_ready.post();
+	Trace::Span span ("JACK process", samples);
+
+	if (_synchronous.load())
+	{
+		// Never wait in the synchronous round. Ports lock is taken only for
+		// a moment when ports are added/removed or resized. Set of ports
+		// can't be accessed without it, so in such case the period is skipped.
+		// JACK doesn't clear output buffers, so output silence:
+		Mutex::TryLock ports_lock (_ports_mutex);
+		if (ports_lock.acquired())
+			process_ports();
+		else
+			silence_outputs (samples);
+	}
+	else
+	{
+		lock_ports();
+		process_ports();
+		unlock_ports();
+	}
 	return 0;
 }
 
 
+void
+JackTransport::process_ports()
+{
+	if (_round)
+	{
+		// Round uses JACK buffers directly. If it couldn't be run,
+		// output silence:
+		if (!_round())
+			for (JackPort* p: _ports)
+				if (p->_direction == JackPort::Output)
+					if (Sample* jbuf = p->jack_buffer())
+						std::fill (jbuf, jbuf + backend()->graph()->buffer_size(), 0.0f);
+	}
+	else
+	{
+		for (JackPort* p: _ports)
+			p->transfer_data();
+		_data_ready.post();
+	}
+}
+
+
+void
+JackTransport::silence_outputs (jack_nframes_t samples)
+{
+	// Increment readers before loading the snapshot, so that
+	// update_outputs_snapshot() doesn't free it while it's used:
+	_outputs_readers.fetch_add (1);
+	if (JackPorts const* outputs = _outputs_snapshot.load())
+		for (jack_port_t* port: *outputs)
+			if (void* jbuf = jack_port_get_buffer (port, samples))
+				std::memset (jbuf, 0, sizeof (Sample) * samples);
+	_outputs_readers.fetch_sub (1);
+}
+
+
+void
+JackTransport::update_outputs_snapshot()
+{
+	auto outputs = std::make_unique<JackPorts>();
+	for (JackPort* p: _ports)
+		if (p->_direction == JackPort::Output && p->_jack_port)
+			outputs->push_back (p->_jack_port);
+
+	_outputs_snapshot.store (outputs.get());
+	// Readers that came after the store above use the new snapshot:
+	while (_outputs_readers.load() > 0)
+		Thread::yield();
+	_outputs = std::move (outputs);
+}
+
+
 int
 JackTransport::c_sample_rate_change (jack_nframes_t sample_rate)
 {
@@ -341,6 +451,24 @@ JackTransport::c_shutdown()
 }
 
 
+void
+JackTransport::s_thread_init (void*)
+{
+	Trace::register_thread ("JACK process");
+}
+
+
+int
+JackTransport::s_xrun (void* klass)
+{
+	Graph* graph = static_cast<JackTransport*> (klass)->backend()->graph();
+	if (graph)
+		graph->mark_xrun();
+	Trace::mark_xrun();
+	return 0;
+}
+
+
 void
 JackTransport::s_log_error (const char* message)
 {
@@ -27,6 +27,7 @@
 #include <cstddef>
 #include <string>
 #include <set>
+#include <vector>
 
 // Libs:
 #include <jack/jack.h>
@@ -34,6 +35,7 @@
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/components/audio_backend/transport.h>
+#include <haruhi/utility/atomic.h>
 #include <haruhi/utility/semaphore.h>
 #include <haruhi/utility/mutex.h>
 
@@ -96,6 +98,9 @@ class JackTransport: public Transport
 		void
 		rename (std::string const&) override;
 
+		Sample*
+		direct_buffer() override;
+
 	  private:
 		/**
 		 * Create actual JACK port.
@@ -127,6 +132,7 @@ class JackTransport: public Transport
 
   private:
 	typedef std::set<JackPort*> Ports;
+	typedef std::vector<jack_port_t*> JackPorts;
 
   public:
 	JackTransport (Backend* backend);
@@ -167,6 +173,9 @@ class JackTransport: public Transport
 	void
 	data_ready() override;
 
+	bool
+	set_synchronous_round (Round) override;
+
 	Port*
 	create_input (std::string const& port_name) override;
 
@@ -195,6 +204,28 @@ class JackTransport: public Transport
 	int
 	c_process (jack_nframes_t samples);
 
+	/**
+	 * Run synchronous round or transfer data between JACK and port buffers.
+	 * \entry	Ports lock held.
+	 */
+	void
+	process_ports();
+
+	/**
+	 * Fill buffers of all output JACK ports with silence.
+	 * Uses the outputs snapshot, so it doesn't need the ports lock.
+	 */
+	void
+	silence_outputs (jack_nframes_t samples);
+
+	/**
+	 * Replace the outputs snapshot with current output JACK ports.
+	 * Waits until c_process() stops using the old one.
+	 * \entry	Ports lock held.
+	 */
+	void
+	update_outputs_snapshot();
+
 	/**
 	 * Called when changing sample rate.
 	 */
@@ -229,6 +260,19 @@ class JackTransport: public Transport
 	static void
 	s_shutdown (void* klass);
 
+	/**
+	 * Called in JACK's processing thread before it starts.
+	 * Registers the thread for tracing.
+	 */
+	static void
+	s_thread_init (void* klass);
+
+	/**
+	 * Called by JACK on xrun. Tells the graph and trace about it.
+	 */
+	static int
+	s_xrun (void* klass);
+
 	static void
 	s_log_error (const char*);
 
@@ -241,6 +285,15 @@ class JackTransport: public Transport
 	bool			_active;
 	Mutex			_ports_mutex;
 	Semaphore		_data_ready;
+	// Round called from c_process(), guarded by _ports_mutex:
+	Round			_round;
+	// True if _round is set. Tells c_process() not to block on _ports_mutex:
+	Atomic<bool>	_synchronous	{ false };
+	// Output JACK ports, readable without _ports_mutex. The snapshot is owned
+	// by _outputs, _outputs_readers counts c_process() calls using it:
+	Unique<JackPorts>			_outputs;
+	Atomic<JackPorts const*>	_outputs_snapshot	{ nullptr };
+	Atomic<int>					_outputs_readers	{ 0 };
 };
 
 
@@ -0,0 +1,299 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+// System:
+#include <unistd.h>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/graph/graph.h>
+#include <haruhi/components/audio_backend/backend.h>
+
+// Local:
+#include "offline_transport.h"
+
+
+namespace Haruhi {
+
+namespace AudioBackendImpl {
+
+namespace OfflineTransportPrivate {
+
+template<class Value>
+	inline void
+	write_le (std::ostream& stream, Value value)
+	{
+		for (std::size_t i = 0; i < sizeof (Value); ++i)
+			stream.put (static_cast<char> ((static_cast<uint64_t> (value) >> (8 * i)) & 0xff));
+	}
+
+} // namespace OfflineTransportPrivate
+
+
+OfflineTransport::OfflinePort::OfflinePort (Transport* transport, Direction direction, std::string const& name):
+	Port (transport),
+	_direction (direction),
+	_name (name)
+{
+	buffer()->resize (transport->backend()->graph()->buffer_size());
+}
+
+
+void
+OfflineTransport::OfflinePort::rename (std::string const& new_name)
+{
+	_name = new_name;
+}
+
+
+OfflineTransport::OfflineTransport (Backend* backend, OfflineRender* render):
+	Transport (backend),
+	_render (render),
+	_connected (false),
+	_active (false),
+	_wav (false),
+	_channels (0),
+	_written_frames (0)
+{ }
+
+
+OfflineTransport::~OfflineTransport()
+{
+	disconnect();
+}
+
+
+void
+OfflineTransport::connect (std::string const&)
+{
+	auto const& parameters = _render->parameters();
+	Graph* graph = backend()->graph();
+
+	lock_ports();
+	for (OfflinePort* p: _ports)
+		p->buffer()->resize (parameters.buffer_size);
+	unlock_ports();
+
+	graph->synchronize ([&] {
+		graph->set_sample_rate (parameters.sample_rate);
+		graph->set_buffer_size (parameters.buffer_size);
+	});
+
+	_connected = true;
+}
+
+
+void
+OfflineTransport::disconnect()
+{
+	if (_connected)
+	{
+		deactivate();
+		close_output();
+		_connected = false;
+	}
+}
+
+
+void
+OfflineTransport::activate()
+{
+	if (connected())
+		_active = true;
+}
+
+
+void
+OfflineTransport::deactivate()
+{
+	_active = false;
+}
+
+
+void
+OfflineTransport::data_ready()
+{
+	if (_render->rendering() && !_render->finished())
+	{
+		// First rendered period:
+		if (_render->position() == 0)
+			open_output();
+
+		std::size_t const remaining = _render->length() - _render->position();
+		write_frames (std::min (remaining, backend()->graph()->buffer_size()));
+	}
+
+	_render->advance (backend()->graph()->buffer_size());
+
+	if (_render->finished())
+	{
+		close_output();
+		// Nothing more to render, don't spin while application quits:
+		usleep ((10_ms).us());
+	}
+}
+
+
+bool
+OfflineTransport::set_synchronous_round (Round)
+{
+	// There's no audio subsystem callback, Engine thread runs rounds:
+	return false;
+}
+
+
+OfflineTransport::Port*
+OfflineTransport::create_input (std::string const& port_name)
+{
+	OfflinePort* port = new OfflinePort (this, OfflinePort::Input, port_name);
+	port->buffer()->clear();
+	lock_ports();
+	_ports.push_back (port);
+	unlock_ports();
+	return port;
+}
+
+
+OfflineTransport::Port*
+OfflineTransport::create_output (std::string const& port_name)
+{
+	OfflinePort* port = new OfflinePort (this, OfflinePort::Output, port_name);
+	lock_ports();
+	_ports.push_back (port);
+	unlock_ports();
+	return port;
+}
+
+
+void
+OfflineTransport::destroy_port (Port* port)
+{
+	lock_ports();
+	_ports.erase (std::remove (_ports.begin(), _ports.end(), static_cast<OfflinePort*> (port)), _ports.end());
+	unlock_ports();
+	delete port;
+}
+
+
+void
+OfflineTransport::open_output()
+{
+	std::string const& file_name = _render->parameters().output_file;
+	std::string const wav_suffix = ".wav";
+
+	_wav = file_name.size() >= wav_suffix.size() &&
+		   file_name.compare (file_name.size() - wav_suffix.size(), wav_suffix.size(), wav_suffix) == 0;
+
+	lock_ports();
+	_channels = std::count_if (_ports.begin(), _ports.end(), [](OfflinePort* p) {
+		return p->direction() == OfflinePort::Output;
+	});
+	unlock_ports();
+
+	_written_frames = 0;
+	_output.open (file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!_output.good())
+	{
+		std::cerr << "could not open output file " << file_name << std::endl;
+		_render->fail();
+	}
+	else if (_wav)
+		write_wav_header();
+}
+
+
+void
+OfflineTransport::write_frames (std::size_t frames)
+{
+	_interleaved.assign (frames * _channels, 0.0f);
+
+	lock_ports();
+	std::size_t channel = 0;
+	for (OfflinePort* p: _ports)
+	{
+		if (p->direction() != OfflinePort::Output)
+			continue;
+		// Ports created after rendering started are not written:
+		if (channel == _channels)
+			break;
+		Sample const* source = p->buffer()->begin();
+		for (std::size_t f = 0; f < frames; ++f)
+			_interleaved[f * _channels + channel] = source[f];
+		++channel;
+	}
+	unlock_ports();
+
+	// Floats are written in host byte order, which is little-endian on supported platforms:
+	_output.write (reinterpret_cast<char const*> (_interleaved.data()), _interleaved.size() * sizeof (float));
+	_written_frames += frames;
+
+	if (!_output.good())
+	{
+		std::cerr << "could not write output file " << _render->parameters().output_file << std::endl;
+		_render->fail();
+	}
+}
+
+
+void
+OfflineTransport::close_output()
+{
+	if (!_output.is_open())
+		return;
+
+	if (_wav)
+	{
+		_output.seekp (0);
+		write_wav_header();
+	}
+	_output.close();
+}
+
+
+void
+OfflineTransport::write_wav_header()
+{
+	using OfflineTransportPrivate::write_le;
+
+	uint16_t const format_ieee_float = 3;
+	uint16_t const bits_per_sample = 32;
+	uint16_t const block_align = _channels * bits_per_sample / 8;
+	uint32_t const sample_rate = _render->parameters().sample_rate.Hz();
+	uint32_t const data_size = _written_frames * block_align;
+
+	_output.write ("RIFF", 4);
+	write_le<uint32_t> (_output, 36 + data_size);
+	_output.write ("WAVE", 4);
+	_output.write ("fmt ", 4);
+	write_le<uint32_t> (_output, 16);
+	write_le<uint16_t> (_output, format_ieee_float);
+	write_le<uint16_t> (_output, _channels);
+	write_le<uint32_t> (_output, sample_rate);
+	write_le<uint32_t> (_output, sample_rate * block_align);
+	write_le<uint16_t> (_output, block_align);
+	write_le<uint16_t> (_output, bits_per_sample);
+	_output.write ("data", 4);
+	write_le<uint32_t> (_output, data_size);
+}
+
+} // namespace AudioBackendImpl
+
+} // namespace Haruhi
+
@@ -0,0 +1,196 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__COMPONENTS__AUDIO_BACKEND__TRANSPORTS__OFFLINE_TRANSPORT_H__INCLUDED
+#define HARUHI__COMPONENTS__AUDIO_BACKEND__TRANSPORTS__OFFLINE_TRANSPORT_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/application/offline_render.h>
+#include <haruhi/components/audio_backend/transport.h>
+#include <haruhi/utility/mutex.h>
+
+
+namespace Haruhi {
+
+namespace AudioBackendImpl {
+
+/**
+ * File-based audio transport used for offline rendering.
+ * data_ready() doesn't wait for anything, so Engine runs processing rounds
+ * as fast as possible. Output ports are written interleaved (in order
+ * of creation) to the output file, input ports are silent.
+ */
+class OfflineTransport: public Transport
+{
+  public:
+	class OfflinePort: public Port
+	{
+	  public:
+		enum Direction { Input, Output };
+
+	  public:
+		OfflinePort (Transport*, Direction, std::string const& name);
+
+		Direction
+		direction() const;
+
+		/*
+		 * Transport::Port API
+		 */
+
+		void
+		rename (std::string const&) override;
+
+	  private:
+		Direction	_direction;
+		std::string	_name;
+	};
+
+  private:
+	typedef std::vector<OfflinePort*> Ports;
+
+  public:
+	OfflineTransport (Backend* backend, OfflineRender* render);
+
+	~OfflineTransport();
+
+	/*
+	 * Transport API
+	 */
+
+	void
+	connect (std::string const& client_name) override;
+
+	void
+	disconnect() override;
+
+	bool
+	connected() const override;
+
+	void
+	activate() override;
+
+	void
+	deactivate() override;
+
+	bool
+	active() const override;
+
+	void
+	lock_ports() override;
+
+	void
+	unlock_ports() override;
+
+	void
+	data_ready() override;
+
+	bool
+	set_synchronous_round (Round) override;
+
+	Port*
+	create_input (std::string const& port_name) override;
+
+	Port*
+	create_output (std::string const& port_name) override;
+
+	void
+	destroy_port (Port*) override;
+
+  private:
+	/**
+	 * Open output file and write header. Number of channels
+	 * is fixed from now on.
+	 */
+	void
+	open_output();
+
+	/**
+	 * Write given number of frames from output ports.
+	 */
+	void
+	write_frames (std::size_t frames);
+
+	/**
+	 * Update header and close output file.
+	 */
+	void
+	close_output();
+
+	/**
+	 * Write WAV header for current number of channels and frames.
+	 */
+	void
+	write_wav_header();
+
+  private:
+	OfflineRender*		_render;
+	Ports				_ports;
+	bool				_connected;
+	bool				_active;
+	Mutex				_ports_mutex;
+	std::ofstream		_output;
+	bool				_wav;
+	std::size_t			_channels;
+	std::size_t			_written_frames;
+	std::vector<float>	_interleaved;
+};
+
+
+inline OfflineTransport::OfflinePort::Direction
+OfflineTransport::OfflinePort::direction() const
+{
+	return _direction;
+}
+
+
+inline bool
+OfflineTransport::connected() const
+{
+	return _connected;
+}
+
+
+inline bool
+OfflineTransport::active() const
+{
+	return _active;
+}
+
+
+inline void
+OfflineTransport::lock_ports()
+{
+	_ports_mutex.lock();
+}
+
+
+inline void
+OfflineTransport::unlock_ports()
+{
+	_ports_mutex.unlock();
+}
+
+} // namespace AudioBackendImpl
+
+} // namespace Haruhi
+
+#endif
+
@@ -118,6 +118,12 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 	bool handled = false;
 	Time const& t = midi_event.timestamp;
 
+	// Events inherit frame offset of the MIDI event:
+	auto push = [&buffer, &midi_event] (auto event) {
+		event.set_frame (midi_event.frame);
+		buffer.push (event);
+	};
+
 	switch (midi_event.type)
 	{
 		case MIDI::Event::NoteOn:
@@ -134,22 +140,22 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 			{
 				// If there was previously note-on on that key, send voice-off:
 				if (device._voice_ids[midi_event.note_on.note] != OmniVoice)
-					buffer.push (new VoiceEvent (t, midi_event.note_on.note, device._voice_ids[midi_event.note_on.note], VoiceEvent::Action::Drop));
+					push (VoiceEvent (t, midi_event.note_on.note, device._voice_ids[midi_event.note_on.note], VoiceEvent::Action::Drop));
 
 				device._voice_ids[midi_event.note_on.note] = device._allocated_voice_id;
-				buffer.push (new VoiceEvent (t, midi_event.note_on.note, device._allocated_voice_id, VoiceEvent::Action::Create));
+				push (VoiceEvent (t, midi_event.note_on.note, device._allocated_voice_id, VoiceEvent::Action::Create));
 				handled = true;
 			}
 
 			if (note_on_velocity_filter && (note_velocity_channel == 0 || note_velocity_channel == midi_event.note_on.channel + 1))
 			{
-				buffer.push (new VoiceControllerEvent (t, device._allocated_voice_id, velocity));
+				push (VoiceControllerEvent (t, device._allocated_voice_id, velocity));
 				handled = true;
 			}
 
 			if (note_pitch_filter && (note_pitch_channel == 0 || note_pitch_channel == midi_event.note_on.channel + 1))
 			{
-				buffer.push (new VoiceControllerEvent (t, device._allocated_voice_id,
+				push (VoiceControllerEvent (t, device._allocated_voice_id,
 							 static_cast<Haruhi::ControllerEvent::Value> (VoiceEvent::frequency_from_key_id (midi_event.note_on.note, graph->master_tune()).Hz())));
 				handled = true;
 			}
@@ -162,7 +168,7 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 
 			if (note_filter && (note_channel == 0 || note_channel == midi_event.note_off.channel + 1))
 			{
-				buffer.push (new VoiceEvent (t, midi_event.note_off.note, device._voice_ids[midi_event.note_off.note], VoiceEvent::Action::Drop));
+				push (VoiceEvent (t, midi_event.note_off.note, device._voice_ids[midi_event.note_off.note], VoiceEvent::Action::Drop));
 				device._allocated_voice_id = device._voice_ids[midi_event.note_off.note];
 				device._voice_ids[midi_event.note_off.note] = OmniVoice;
 				handled = true;
@@ -170,7 +176,7 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 
 			if (note_off_velocity_filter && (note_velocity_channel == 0 || note_velocity_channel == midi_event.note_off.channel + 1))
 			{
-				buffer.push (new VoiceControllerEvent (t, device._allocated_voice_id, velocity));
+				push (VoiceControllerEvent (t, device._allocated_voice_id, velocity));
 				handled = true;
 			}
 			break;
@@ -184,7 +190,7 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 				if (controller_filter && (controller_channel == 0 || controller_channel == midi_event.controller.channel + 1) && controller_number == static_cast<int> (midi_event.controller.number))
 				{
 					float const fvalue = value / 127.0f;
-					buffer.push (new ControllerEvent (t, fvalue));
+					push (ControllerEvent (t, fvalue));
 					handled = true;
 					if (smoothing > 0_ms)
 						controller_smoothing_setup (t, fvalue, 1_ms, smoothing, graph->sample_rate());
@@ -196,7 +202,7 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 			if (pitchbend_filter && (pitchbend_channel == 0 || pitchbend_channel == midi_event.pitchbend.channel + 1))
 			{
 				float const fvalue = midi_event.pitchbend.value == 0 ? 0.5f : (midi_event.pitchbend.value + 8192) / 16382.0f;
-				buffer.push (new ControllerEvent (t, fvalue));
+				push (ControllerEvent (t, fvalue));
 				handled = true;
 				if (smoothing > 0_ms)
 					controller_smoothing_setup (t, fvalue, 1_ms, smoothing, graph->sample_rate());
@@ -211,7 +217,7 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 				if (channel_pressure_filter && (channel_pressure_channel == 0 || channel_pressure_channel == midi_event.channel_pressure.channel + 1))
 				{
 					float const fvalue = value / 127.0f;
-					buffer.push (new ControllerEvent (t, fvalue));
+					push (ControllerEvent (t, fvalue));
 					handled = true;
 					if (smoothing > 0_ms)
 						channel_pressure_smoothing_setup (t, fvalue, 1_ms, smoothing, graph->sample_rate());
@@ -231,7 +237,7 @@ Controller::handle_event (MIDI::Event const& midi_event, Device& device, EventBu
 					if (device._voice_ids[key] == OmniVoice)
 						break;
 					float const fvalue = value / 127.0f;
-					buffer.push (new VoiceControllerEvent (t, device._voice_ids[key], fvalue));
+					push (VoiceControllerEvent (t, device._voice_ids[key], fvalue));
 					handled = true;
 					if (smoothing > 0_ms)
 						key_pressure_smoothing_setup (key, t, fvalue, 1_ms, smoothing, graph->sample_rate());
@@ -261,7 +267,7 @@ Controller::generate_smoothing_events (EventBuffer& buffer, Graph* graph)
 				sp->current = sp->target;
 			else
 				sp->current = sp->smoother.process (sp->target, graph->buffer_size());
-			buffer.push (new ControllerEvent (t, sp->current));
+			buffer.push (ControllerEvent (t, sp->current));
 		}
 	}
 
@@ -274,7 +280,7 @@ Controller::generate_smoothing_events (EventBuffer& buffer, Graph* graph)
 				ks.current = ks.target;
 			else
 				ks.current = ks.smoother.process (ks.target, graph->buffer_size());
-			buffer.push (new VoiceControllerEvent (t, key, ks.current));
+			buffer.push (VoiceControllerEvent (t, key, ks.current));
 		}
 	}
 }
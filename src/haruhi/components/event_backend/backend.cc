@@ -13,6 +13,7 @@
 
 // Standard:
 #include <cstddef>
+#include <algorithm>
 #include <memory>
 
 // Qt:
@@ -34,6 +35,7 @@
 
 // Local:
 #include "transports/alsa_transport.h"
+#include "transports/offline_transport.h"
 #include "backend.h"
 #include "device_with_port_dialog.h"
 #include "controller_with_port_dialog.h"
@@ -50,7 +52,10 @@ Backend::Backend (QString const& client_name, QWidget* parent):
 	EventBackend ("╸Devices╺"),
 	_client_name (client_name)
 {
-	_transport = std::make_unique<AlsaTransport> (this);
+	if (OfflineRender* offline_render = Haruhi::haruhi()->offline_render())
+		_transport = std::make_unique<OfflineTransport> (this, offline_render);
+	else
+		_transport = std::make_unique<AlsaTransport> (this);
 
 	// Widgets
 
@@ -192,24 +197,40 @@ Backend::process()
 	{
 		auto transport_port = h.first;
 		auto device_item = h.second;
+		auto const& controllers = *device_item->controllers();
+
+		// Controllers in learning mode must see all events:
+		bool const learning = std::any_of (controllers.begin(), controllers.end(),
+										   [](ControllerWithPortItem* c) { return c->learning(); });
+
+		auto dispatch = [&] (MIDI::Event const& m, ControllerWithPortItem* c) {
+			if (c->ready() && c->handle_event (m, *device_item))
+				handle_event_for_learnables (m, c->port());
+		};
 
 		// For each event that comes from transport:
 		for (MIDI::Event& m: transport_port->buffer())
 		{
-			// For each Controller:
-			for (auto* c: *device_item->controllers())
+			if (learning)
 			{
-				if (c->ready())
-				{
-					if (c->handle_event (m, *device_item))
-						handle_event_for_learnables (m, c->port());
-					on_event (m);
-				}
+				for (auto* c: controllers)
+					dispatch (m, c);
 			}
+			else
+			{
+				// Only to Controllers which accept the event:
+				for (auto* c: device_item->dispatch_index().subscribers (m))
+					dispatch (m, c);
+			}
+			on_event (m);
 		}
 
+		// Learning could change filters:
+		if (learning)
+			device_item->invalidate_dispatch_index();
+
 		// For each Controller:
-		for (auto* c: *device_item->controllers())
+		for (auto* c: controllers)
 			c->generate_smoothing_events();
 	}
 }
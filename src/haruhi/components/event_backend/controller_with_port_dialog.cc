@@ -35,7 +35,10 @@ ControllerWithPortDialog::apply (ControllerItem* item) const
 	ControllerDialog::apply (item);
 	auto controller_item = dynamic_cast<ControllerWithPortItem*> (item);
 	if (controller_item)
+	{
 		controller_item->update_name();
+		controller_item->update_filters();
+	}
 }
 
 } // namespace EventBackendImpl
@@ -36,6 +36,7 @@ ControllerWithPortItem::ControllerWithPortItem (DeviceWithPortItem* parent, Devi
 	backend()->graph()->synchronize ([&] {
 		_port = std::make_unique<EventPort> (backend(), controller->name().toStdString(), Port::Output, parent->port_group());
 		_device_item->controllers()->insert (this);
+		_device_item->invalidate_dispatch_index();
 	});
 	// Fully constructed:
 	set_ready (true);
@@ -46,6 +47,7 @@ ControllerWithPortItem::~ControllerWithPortItem()
 {
 	Mutex::Lock lock (*backend()->graph());
 	_device_item->controllers()->erase (this);
+	_device_item->invalidate_dispatch_index();
 	_port.reset();
 }
 
@@ -57,6 +59,13 @@ ControllerWithPortItem::update_name()
 }
 
 
+void
+ControllerWithPortItem::update_filters()
+{
+	_device_item->invalidate_dispatch_index();
+}
+
+
 bool
 ControllerWithPortItem::handle_event (MIDI::Event const& midi_event, DeviceWithPortItem& device_item)
 {
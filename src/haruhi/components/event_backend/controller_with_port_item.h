@@ -59,6 +59,13 @@ class ControllerWithPortItem:
 	void
 	update_name();
 
+	/**
+	 * Should be called after controller's filters have been changed,
+	 * so that MIDI events are dispatched accordingly.
+	 */
+	void
+	update_filters();
+
 	/**
 	 * Create and push new Event into core graph.
 	 * Returns true if event has been actually passed by port.
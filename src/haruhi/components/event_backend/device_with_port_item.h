@@ -20,10 +20,12 @@
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/graph/port_group.h>
+#include <haruhi/utility/atomic.h>
 #include <haruhi/utility/saveable_state.h>
 #include <haruhi/components/devices_manager/device_item.h>
 
 // Local:
+#include "dispatch_index.h"
 #include "port_item.h"
 #include "tree.h"
 #include "transport.h"
@@ -45,7 +47,7 @@ class DeviceWithPortItem:
 	friend class Tree;
 
   public:
-	typedef std::set<ControllerWithPortItem*> Controllers;
+	typedef DispatchIndex::Controllers Controllers;
 
   public:
 	DeviceWithPortItem (Backend* backend, Tree* parent, DevicesManager::Device* device);
@@ -55,6 +57,22 @@ class DeviceWithPortItem:
 	Controllers*
 	controllers();
 
+	/**
+	 * Return index of controllers by MIDI messages they accept.
+	 * Rebuilds the index if it has been invalidated.
+	 * Graph must be locked.
+	 */
+	DispatchIndex const&
+	dispatch_index();
+
+	/**
+	 * Causes dispatch index to be rebuilt before next use.
+	 * Should be called when controllers or their filters change.
+	 * \entry	Any thread.
+	 */
+	void
+	invalidate_dispatch_index() noexcept;
+
 	Transport::Port*
 	transport_port() const;
 
@@ -82,6 +100,8 @@ class DeviceWithPortItem:
   private:
 	Transport::Port*	_transport_port;
 	Unique<PortGroup>	_port_group;
+	DispatchIndex		_dispatch_index;
+	Atomic<bool>		_dispatch_index_valid	{ false };
 };
 
 
@@ -92,6 +112,22 @@ DeviceWithPortItem::controllers()
 }
 
 
+inline DispatchIndex const&
+DeviceWithPortItem::dispatch_index()
+{
+	if (!_dispatch_index_valid.exchange (true))
+		_dispatch_index.rebuild (_controllers);
+	return _dispatch_index;
+}
+
+
+inline void
+DeviceWithPortItem::invalidate_dispatch_index() noexcept
+{
+	_dispatch_index_valid.store (false);
+}
+
+
 inline Transport::Port*
 DeviceWithPortItem::transport_port() const
 {
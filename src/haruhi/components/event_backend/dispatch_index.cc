@@ -0,0 +1,124 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/components/devices_manager/controller.h>
+
+// Local:
+#include "dispatch_index.h"
+#include "controller_with_port_item.h"
+
+
+namespace Haruhi {
+
+namespace EventBackendImpl {
+
+constexpr std::size_t DispatchIndex::ChannelsNumber;
+constexpr std::size_t DispatchIndex::ControllersNumber;
+
+
+void
+DispatchIndex::rebuild (Controllers const& controllers)
+{
+	// Clearing vectors keeps their capacity, so rebuilding
+	// usually doesn't allocate:
+	for (ChannelsTable* table: { &_note_on, &_note_off, &_pitchbend, &_channel_pressure, &_key_pressure })
+		for (Subscribers& s: *table)
+			s.clear();
+	for (ChannelsTable& table: _controller)
+		for (Subscribers& s: table)
+			s.clear();
+
+	for (ControllerWithPortItem* c: controllers)
+	{
+		DevicesManager::Controller const* f = c->controller();
+
+		if (f->note_filter)
+		{
+			subscribe (_note_on, f->note_channel, c);
+			subscribe (_note_off, f->note_channel, c);
+		}
+		if (f->note_on_velocity_filter)
+			subscribe (_note_on, f->note_velocity_channel, c);
+		if (f->note_off_velocity_filter)
+			subscribe (_note_off, f->note_velocity_channel, c);
+		if (f->note_pitch_filter)
+			subscribe (_note_on, f->note_pitch_channel, c);
+		if (f->controller_filter && f->controller_number >= 0 && static_cast<std::size_t> (f->controller_number) < ControllersNumber)
+			subscribe (_controller[f->controller_number], f->controller_channel, c);
+		if (f->pitchbend_filter)
+			subscribe (_pitchbend, f->pitchbend_channel, c);
+		if (f->channel_pressure_filter)
+			subscribe (_channel_pressure, f->channel_pressure_channel, c);
+		if (f->key_pressure_filter)
+			subscribe (_key_pressure, f->key_pressure_channel, c);
+	}
+}
+
+
+DispatchIndex::Subscribers const&
+DispatchIndex::subscribers (MIDI::Event const& event) const noexcept
+{
+	switch (event.type)
+	{
+		case MIDI::Event::NoteOn:
+			return _note_on[event.note_on.channel % ChannelsNumber];
+
+		case MIDI::Event::NoteOff:
+			return _note_off[event.note_off.channel % ChannelsNumber];
+
+		case MIDI::Event::Controller:
+			return _controller[event.controller.number % ControllersNumber][event.controller.channel % ChannelsNumber];
+
+		case MIDI::Event::Pitchbend:
+			return _pitchbend[event.pitchbend.channel % ChannelsNumber];
+
+		case MIDI::Event::MonoPressure:
+			return _channel_pressure[event.channel_pressure.channel % ChannelsNumber];
+
+		case MIDI::Event::PolyPressure:
+			return _key_pressure[event.key_pressure.channel % ChannelsNumber];
+	}
+
+	return _none;
+}
+
+
+void
+DispatchIndex::subscribe (ChannelsTable& table, int channel, ControllerWithPortItem* controller)
+{
+	// Controllers are added one after another, so it's enough
+	// to check the last subscriber to avoid duplicates:
+	auto add = [controller] (Subscribers& subscribers) {
+		if (subscribers.empty() || subscribers.back() != controller)
+			subscribers.push_back (controller);
+	};
+
+	// Channel 0 means 'all':
+	if (channel == 0)
+	{
+		for (Subscribers& s: table)
+			add (s);
+	}
+	else if (channel > 0 && static_cast<std::size_t> (channel) <= ChannelsNumber)
+		add (table[channel - 1]);
+}
+
+} // namespace EventBackendImpl
+
+} // namespace Haruhi
+
@@ -0,0 +1,90 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__COMPONENTS__EVENT_BACKEND__DISPATCH_INDEX_H__INCLUDED
+#define HARUHI__COMPONENTS__EVENT_BACKEND__DISPATCH_INDEX_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <array>
+#include <set>
+#include <vector>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/lib/midi.h>
+
+
+namespace Haruhi {
+
+namespace EventBackendImpl {
+
+class ControllerWithPortItem;
+
+/**
+ * Maps MIDI messages (by type, channel and controller number)
+ * to controllers whose filters accept them, so that incoming
+ * messages are passed only to interested controllers.
+ *
+ * Must be rebuilt whenever set of controllers or their filters change.
+ */
+class DispatchIndex
+{
+  public:
+	typedef std::set<ControllerWithPortItem*>		Controllers;
+	typedef std::vector<ControllerWithPortItem*>	Subscribers;
+
+	static constexpr std::size_t ChannelsNumber		= 16;
+	static constexpr std::size_t ControllersNumber	= 128;
+
+  private:
+	typedef std::array<Subscribers, ChannelsNumber> ChannelsTable;
+
+  public:
+	/**
+	 * Rebuilds index for given controllers.
+	 * Subscribers are kept in the same order as controllers.
+	 */
+	void
+	rebuild (Controllers const&);
+
+	/**
+	 * Return controllers interested in given MIDI event.
+	 */
+	Subscribers const&
+	subscribers (MIDI::Event const&) const noexcept;
+
+  private:
+	/**
+	 * Adds controller to the table for given channel,
+	 * or to all channels if channel is 0.
+	 */
+	static void
+	subscribe (ChannelsTable&, int channel, ControllerWithPortItem*);
+
+  private:
+	ChannelsTable									_note_on;
+	ChannelsTable									_note_off;
+	std::array<ChannelsTable, ControllersNumber>	_controller;
+	ChannelsTable									_pitchbend;
+	ChannelsTable									_channel_pressure;
+	ChannelsTable									_key_pressure;
+	Subscribers										_none;
+};
+
+} // namespace EventBackendImpl
+
+} // namespace Haruhi
+
+#endif
+
@@ -17,6 +17,7 @@
 // Standard:
 #include <cstddef>
 #include <string>
+#include <vector>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -36,10 +37,14 @@ class Backend;
 class Transport
 {
   public:
-	typedef std::list<MIDI::Event> MidiBuffer;
+	typedef std::vector<MIDI::Event> MidiBuffer;
 
 	class Port
 	{
+	  public:
+		// Number of events preallocated in the buffer:
+		static constexpr std::size_t BufferCapacity = 256;
+
 	  public:
 		Port (Transport* transport);
 
@@ -139,7 +144,9 @@ class Transport
 inline
 Transport::Port::Port (Transport* transport):
 	_transport (transport)
-{ }
+{
+	_buffer.reserve (BufferCapacity);
+}
 
 
 inline Transport*
@@ -14,6 +14,11 @@
 // Standard:
 #include <cstddef>
 #include <string>
+#include <vector>
+#include <cmath>
+
+// System:
+#include <poll.h>
 
 // Libs:
 #include <alsa/asoundlib.h>
@@ -21,6 +26,8 @@
 
 // Haruhi:
 #include <haruhi/components/event_backend/backend.h>
+#include <haruhi/graph/graph.h>
+#include <haruhi/utility/numeric.h>
 
 // Local:
 #include "alsa_transport.h"
@@ -30,6 +37,11 @@ namespace Haruhi {
 
 namespace EventBackendImpl {
 
+constexpr std::size_t	AlsaTransport::InputQueueCapacity;
+constexpr int			AlsaTransport::PollTimeout;
+constexpr std::size_t	AlsaTransport::MaxPorts;
+
+
 AlsaTransport::AlsaPort::AlsaPort (Transport* transport, Direction direction, std::string const& name):
 	Port (transport),
 	_direction (direction),
@@ -93,9 +105,19 @@ AlsaTransport::AlsaPort::reinit()
 		switch (_direction)
 		{
 			case Input:
-				_alsa_port = snd_seq_create_simple_port (static_cast<AlsaTransport*> (transport())->seq(), _name.c_str(),
-														 SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
-														 SND_SEQ_PORT_TYPE_SYNTHESIZER | SND_SEQ_PORT_TYPE_SOFTWARE);
+				// Make ALSA timestamp incoming events with real time of our queue,
+				// so that events can be placed at correct frames:
+				snd_seq_port_info_set_name (_alsa_port_info, _name.c_str());
+				snd_seq_port_info_set_capability (_alsa_port_info, SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE);
+				snd_seq_port_info_set_type (_alsa_port_info, SND_SEQ_PORT_TYPE_SYNTHESIZER | SND_SEQ_PORT_TYPE_SOFTWARE);
+				snd_seq_port_info_set_midi_channels (_alsa_port_info, 16);
+				snd_seq_port_info_set_timestamping (_alsa_port_info, 1);
+				snd_seq_port_info_set_timestamp_real (_alsa_port_info, 1);
+				snd_seq_port_info_set_timestamp_queue (_alsa_port_info, alsa_transport()->_queue);
+				if (snd_seq_create_port (alsa_transport()->seq(), _alsa_port_info) >= 0)
+					_alsa_port = snd_seq_port_info_get_port (_alsa_port_info);
+				else
+					_alsa_port = -1;
 				break;
 			case Output:
 				_alsa_port = snd_seq_create_simple_port (static_cast<AlsaTransport*> (transport())->seq(), _name.c_str(),
@@ -115,30 +137,86 @@ AlsaTransport::AlsaPort::destroy()
 }
 
 
+AlsaTransport::InputThread::InputThread (AlsaTransport* transport):
+	_transport (transport)
+{
+}
+
+
+AlsaTransport::InputThread::~InputThread()
+{
+	quit();
+	wait();
+}
+
+
+void
+AlsaTransport::InputThread::quit() noexcept
+{
+	_quit.store (true);
+}
+
+
+void
+AlsaTransport::InputThread::run()
+{
+	snd_seq_t* seq = _transport->seq();
+	std::vector<pollfd> descriptors (::snd_seq_poll_descriptors_count (seq, POLLIN));
+	::snd_seq_poll_descriptors (seq, descriptors.data(), descriptors.size(), POLLIN);
+
+	while (!_quit.load())
+		if (::poll (descriptors.data(), descriptors.size(), PollTimeout) > 0)
+			_transport->read_events();
+}
+
+
 AlsaTransport::AlsaTransport (Backend* backend):
 	Transport (backend),
-	_seq (0)
-{ }
+	_seq (0),
+	_queue (-1),
+	_queue_status (0),
+	_input_queue (InputQueueCapacity)
+{
+	if (::snd_seq_queue_status_malloc (&_queue_status))
+		throw;
+	_ports_index.fill (nullptr);
+}
 
 
 AlsaTransport::~AlsaTransport()
 {
 	disconnect();
+	if (_queue_status)
+		::snd_seq_queue_status_free (_queue_status);
 }
 
 
 void
 AlsaTransport::connect (std::string const& client_name)
 {
-	if (snd_seq_open (&_seq, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK))
+	// Output is needed to start the timestamping queue:
+	if (snd_seq_open (&_seq, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK))
 		throw Exception ("could not open default ALSA midi sequencer", __func__);
 	// Free some not-sure-what-is-it-for cache allocated implicitly by ALSA, to prevent
 	// memory leaks inside alsalib:
 	snd_config_update_free_global();
 	snd_seq_set_client_name (_seq, client_name.c_str());
+	// Queue for timestamping events. If it fails, events will get frame 0:
+	_queue = snd_seq_alloc_named_queue (_seq, client_name.c_str());
+	if (_queue >= 0)
+	{
+		snd_seq_start_queue (_seq, _queue, nullptr);
+		snd_seq_drain_output (_seq);
+	}
 	// Switch all ports online:
 	for (auto& p: _ports)
 		p.second->reinit();
+	backend()->graph()->synchronize ([&] {
+		update_ports_index();
+	});
+	// Start reading events:
+	_input_thread = std::make_unique<InputThread> (this);
+	_input_thread->start();
 }
 
 
@@ -147,8 +225,13 @@ AlsaTransport::disconnect()
 {
 	if (_seq)
 	{
+		// Stop reading events before closing the sequencer:
+		_input_thread.reset();
 		for (auto& p: _ports)
 			p.second->destroy();
+		if (_queue >= 0)
+			snd_seq_free_queue (_seq, _queue);
+		_queue = -1;
 		snd_seq_t* c = _seq;
 		_seq = 0;
 		snd_seq_close (c);
@@ -168,7 +251,10 @@ AlsaTransport::create_input (std::string const& port_name)
 {
 	auto port = std::make_unique<AlsaPort> (this, AlsaPort::Input, port_name);
 	auto raw_ptr = port.get();
-	_ports[port->alsa_port()] = std::move (port);
+	backend()->graph()->synchronize ([&] {
+		_ports[port->alsa_port()] = std::move (port);
+		update_ports_index();
+	});
 	return raw_ptr;
 }
 
@@ -178,7 +264,10 @@ AlsaTransport::create_output (std::string const& port_name)
 {
 	auto port = std::make_unique<AlsaPort> (this, AlsaPort::Output, port_name);
 	auto raw_ptr = port.get();
-	_ports[port->alsa_port()] = std::move (port);
+	backend()->graph()->synchronize ([&] {
+		_ports[port->alsa_port()] = std::move (port);
+		update_ports_index();
+	});
 	return raw_ptr;
 }
 
@@ -186,7 +275,19 @@ AlsaTransport::create_output (std::string const& port_name)
 void
 AlsaTransport::destroy_port (Port* port)
 {
-	_ports.erase (static_cast<AlsaPort*> (port)->alsa_port());
+	std::unique_ptr<AlsaPort> destroyed;
+	backend()->graph()->synchronize ([&] {
+		auto p = _ports.find (static_cast<AlsaPort*> (port)->alsa_port());
+		if (p != _ports.end())
+		{
+			destroyed = std::move (p->second);
+			_ports.erase (p);
+		}
+		update_ports_index();
+	});
+	// Delete ALSA port outside of the lock, not to stall the processing round.
+	// sync() can't see it anymore:
+	destroyed.reset();
 }
 
 
@@ -196,33 +297,90 @@ AlsaTransport::sync()
 	if (!connected())
 		return;
 
-	::snd_seq_event_t* e = 0;
-	Time t = backend()->graph()->timestamp();
+	Time const t = backend()->graph()->timestamp();
+	double const now = Time::now().s();
+
+	// Ports and their index are modified only with Graph locked,
+	// and Graph is locked for the whole processing round.
 
 	// Clear all buffers:
 	for (auto& p: _ports)
 		p.second->buffer().clear();
 
-	while (::snd_seq_event_input (_seq, &e) >= 0)
+	InputEvent input;
+	while (_input_queue.pop (input))
 	{
-		Ports::iterator h = _ports.find (e->dest.port);
-		if (h == _ports.end())
-			std::cerr << "Warning: could not find port given by ALSA sequencer (" << static_cast<int> (e->dest.port) << ") — ignoring" << std::endl;
-		else
+		// Event may be addressed to a port destroyed after it was read:
+		AlsaPort* port = _ports_index[input.event.dest.port];
+		if (!port)
+			continue;
+
+		MIDI::Event midi;
+		if (map_alsa_to_internal (midi, &input.event))
 		{
-			MidiBuffer& buf = h->second->buffer();
-			MIDI::Event midi;
-			if (map_alsa_to_internal (midi, e))
-			{
-				midi.timestamp = t;
-				buf.push_back (midi);
-			}
+			midi.timestamp = t;
+			midi.frame = event_frame (input.time, now);
+			port->buffer().push_back (midi);
 		}
+	}
+}
+
+
+double
+AlsaTransport::queue_time() const
+{
+	if (_queue < 0 || ::snd_seq_get_queue_status (_seq, _queue, _queue_status) < 0)
+		return 0.0;
+
+	::snd_seq_real_time_t const* time = ::snd_seq_queue_status_get_real_time (_queue_status);
+	return time->tv_sec + 1e-9 * time->tv_nsec;
+}
+
+
+void
+AlsaTransport::read_events()
+{
+	::snd_seq_event_t* e = 0;
+	// Relate queue time to Time::now(), which is used by the processing thread:
+	double const now = Time::now().s();
+	double const queue_now = queue_time();
+
+	while (::snd_seq_event_input (_seq, &e) >= 0)
+	{
+		InputEvent input;
+		input.event = *e;
+		input.time = now;
+		if (queue_now != 0.0 && (e->flags & SND_SEQ_TIME_STAMP_MASK) == SND_SEQ_TIME_STAMP_REAL)
+			input.time -= queue_now - (e->time.time.tv_sec + 1e-9 * e->time.time.tv_nsec);
+
+		if (!_input_queue.push (input))
+			std::cerr << "Warning: ALSA input queue is full — dropping event" << std::endl;
 		::snd_seq_free_event (e);
 	}
 }
 
 
+std::size_t
+AlsaTransport::event_frame (double time, double now) const
+{
+	Graph* graph = backend()->graph();
+	// Samples that passed since the event arrived:
+	double const age = (now - time) * graph->sample_rate().Hz();
+	double const frame = std::round (graph->buffer_size() - age);
+	return clamped<double> (frame, 0.0, graph->buffer_size() - 1.0);
+}
+
+
+void
+AlsaTransport::update_ports_index()
+{
+	_ports_index.fill (nullptr);
+	for (auto& p: _ports)
+		if (p.second->alsa_port() >= 0 && static_cast<std::size_t> (p.second->alsa_port()) < MaxPorts)
+			_ports_index[p.second->alsa_port()] = p.second.get();
+}
+
+
 bool
 AlsaTransport::learning_possible() const
 {
@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <string>
 #include <map>
+#include <array>
 
 // Libs:
 #include <alsa/asoundlib.h>
@@ -27,6 +28,10 @@
 #include <haruhi/config/all.h>
 #include <haruhi/components/event_backend/transport.h>
 #include <haruhi/lib/midi.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/lock_free_queue.h>
+#include <haruhi/utility/memory.h>
+#include <haruhi/utility/thread.h>
 
 
 namespace Haruhi {
@@ -35,6 +40,10 @@ namespace EventBackendImpl {
 
 /**
  * ALSA event transport.
+ *
+ * Events are read from the sequencer by a separate input thread
+ * and passed to the processing thread through a lock-free queue,
+ * so that sync() doesn't do any system calls.
  */
 class AlsaTransport: public Transport
 {
@@ -98,6 +107,48 @@ class AlsaTransport: public Transport
   private:
 	using Ports = std::map<int, std::unique_ptr<AlsaPort>>;
 
+	/**
+	 * Event read from the sequencer, waiting for processing.
+	 */
+	struct InputEvent
+	{
+		::snd_seq_event_t	event;
+		// Arrival time (on Time::now() clock) in seconds:
+		double				time;
+	};
+
+	/**
+	 * Reads events from the sequencer and puts them into input queue.
+	 */
+	class InputThread: public Thread
+	{
+	  public:
+		InputThread (AlsaTransport*);
+
+		~InputThread();
+
+		/**
+		 * Tells thread to exit. It will do so within PollTimeout.
+		 */
+		void
+		quit() noexcept;
+
+	  protected:
+		void
+		run() override;
+
+	  private:
+		AlsaTransport*	_transport;
+		Atomic<bool>	_quit { false };
+	};
+
+	// Max number of events waiting for processing:
+	static constexpr std::size_t	InputQueueCapacity	= 4096;
+	// How often input thread checks if it should quit [ms]:
+	static constexpr int			PollTimeout			= 100;
+	// ALSA port numbers are 8-bit:
+	static constexpr std::size_t	MaxPorts			= 256;
+
   public:
 	AlsaTransport (Backend* backend);
 
@@ -145,10 +196,49 @@ class AlsaTransport: public Transport
 	static bool
 	map_alsa_to_internal (MIDI::Event& midi, ::snd_seq_event_t* event);
 
+	/**
+	 * Return current time of the sequencer queue used to timestamp
+	 * incoming events, in seconds. Return 0 if unavailable.
+	 */
+	double
+	queue_time() const;
+
+	/**
+	 * Reads all pending events from the sequencer and
+	 * puts them into input queue. Called by input thread.
+	 */
+	void
+	read_events();
+
+	/**
+	 * Compute frame offset for an event in the processing round.
+	 * Events received during the previous period are placed at the same
+	 * relative position in the current one, which adds constant latency
+	 * of one period, but avoids quantizing events to period boundaries.
+	 * \param	time Arrival time of the event in seconds.
+	 * \param	now Current time in seconds.
+	 */
+	std::size_t
+	event_frame (double time, double now) const;
+
+	/**
+	 * Updates ports lookup table by ALSA port numbers.
+	 * Must be called when ports are created, destroyed or reinitialized.
+	 * \entry	Graph locked, since sync() reads the table.
+	 */
+	void
+	update_ports_index();
+
   private:
 	// ALSA sequencer:
-	snd_seq_t*	_seq;
-	Ports		_ports;
+	snd_seq_t*							_seq;
+	// Queue used to timestamp incoming events:
+	int									_queue;
+	snd_seq_queue_status_t*				_queue_status;
+	Ports								_ports;
+	std::array<AlsaPort*, MaxPorts>		_ports_index;
+	LockFreeQueue<InputEvent>			_input_queue;
+	Unique<InputThread>					_input_thread;
 };
 
 
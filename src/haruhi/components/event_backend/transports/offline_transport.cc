@@ -0,0 +1,130 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/graph/graph.h>
+#include <haruhi/components/event_backend/backend.h>
+
+// Local:
+#include "offline_transport.h"
+
+
+namespace Haruhi {
+
+namespace EventBackendImpl {
+
+OfflineTransport::OfflinePort::OfflinePort (Transport* transport, Direction direction, std::string const& name):
+	Port (transport),
+	_direction (direction),
+	_name (name)
+{ }
+
+
+void
+OfflineTransport::OfflinePort::rename (std::string const& new_name)
+{
+	_name = new_name;
+}
+
+
+OfflineTransport::OfflineTransport (Backend* backend, OfflineRender* render):
+	Transport (backend),
+	_render (render),
+	_connected (false),
+	_next_event (0)
+{ }
+
+
+void
+OfflineTransport::connect (std::string const&)
+{
+	_next_event = 0;
+	_connected = true;
+}
+
+
+void
+OfflineTransport::disconnect()
+{
+	_connected = false;
+}
+
+
+OfflineTransport::Port*
+OfflineTransport::create_input (std::string const& port_name)
+{
+	_ports.push_back (std::make_unique<OfflinePort> (this, OfflinePort::Input, port_name));
+	return _ports.back().get();
+}
+
+
+OfflineTransport::Port*
+OfflineTransport::create_output (std::string const& port_name)
+{
+	_ports.push_back (std::make_unique<OfflinePort> (this, OfflinePort::Output, port_name));
+	return _ports.back().get();
+}
+
+
+void
+OfflineTransport::destroy_port (Port* port)
+{
+	_ports.erase (std::remove_if (_ports.begin(), _ports.end(), [port](std::unique_ptr<OfflinePort> const& p) {
+		return p.get() == port;
+	}), _ports.end());
+}
+
+
+void
+OfflineTransport::sync()
+{
+	for (auto& p: _ports)
+		p->buffer().clear();
+
+	if (!connected() || !_render->rendering())
+		return;
+
+	Graph* graph = backend()->graph();
+	Time const t = graph->timestamp();
+	std::size_t const begin = _render->position();
+	std::size_t const end = begin + graph->buffer_size();
+	auto const& events = _render->sequence().events();
+
+	for (; _next_event < events.size(); ++_next_event)
+	{
+		auto const& timed_event = events[_next_event];
+		std::size_t const sample = std::round (timed_event.time * graph->sample_rate());
+		if (sample >= end)
+			break;
+
+		MIDI::Event midi = timed_event.event;
+		midi.timestamp = t;
+		midi.frame = sample > begin ? sample - begin : 0;
+
+		for (auto& p: _ports)
+			if (p->direction() == OfflinePort::Input)
+				p->buffer().push_back (midi);
+	}
+}
+
+} // namespace EventBackendImpl
+
+} // namespace Haruhi
+
@@ -0,0 +1,128 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__COMPONENTS__EVENT_BACKEND__TRANSPORTS__OFFLINE_TRANSPORT_H__INCLUDED
+#define HARUHI__COMPONENTS__EVENT_BACKEND__TRANSPORTS__OFFLINE_TRANSPORT_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/application/offline_render.h>
+#include <haruhi/components/event_backend/transport.h>
+#include <haruhi/utility/memory.h>
+
+
+namespace Haruhi {
+
+namespace EventBackendImpl {
+
+/**
+ * Event transport used for offline rendering.
+ * Plays events from OfflineRender's sequence to all input ports,
+ * with sample-accurate frame offsets. Output ports are ignored.
+ */
+class OfflineTransport: public Transport
+{
+  public:
+	class OfflinePort: public Port
+	{
+	  public:
+		enum Direction { Input, Output };
+
+	  public:
+		OfflinePort (Transport*, Direction, std::string const& name);
+
+		Direction
+		direction() const;
+
+		void
+		rename (std::string const&) override;
+
+	  private:
+		Direction	_direction;
+		std::string	_name;
+	};
+
+  private:
+	typedef std::vector<std::unique_ptr<OfflinePort>> Ports;
+
+  public:
+	OfflineTransport (Backend* backend, OfflineRender* render);
+
+	/*
+	 * Transport API
+	 */
+
+	void
+	connect (std::string const& client_name) override;
+
+	void
+	disconnect() override;
+
+	bool
+	connected() const override;
+
+	Port*
+	create_input (std::string const& port_name) override;
+
+	Port*
+	create_output (std::string const& port_name) override;
+
+	void
+	destroy_port (Port*) override;
+
+	void
+	sync() override;
+
+	bool
+	learning_possible() const override;
+
+  private:
+	OfflineRender*	_render;
+	Ports			_ports;
+	bool			_connected;
+	// Index of next sequence event to play:
+	std::size_t		_next_event;
+};
+
+
+inline OfflineTransport::OfflinePort::Direction
+OfflineTransport::OfflinePort::direction() const
+{
+	return _direction;
+}
+
+
+inline bool
+OfflineTransport::connected() const
+{
+	return _connected;
+}
+
+
+inline bool
+OfflineTransport::learning_possible() const
+{
+	return false;
+}
+
+} // namespace EventBackendImpl
+
+} // namespace Haruhi
+
+#endif
+
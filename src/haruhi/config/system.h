@@ -32,6 +32,10 @@
 #define HARUHI_SSE3
 #endif
 
+#ifdef __AVX2__
+#define HARUHI_AVX2
+#endif
+
 
 // Fixes for std::ostream which has broken support for unsigned/signed/char types
 // and prints 8-bit integers like they were characters.
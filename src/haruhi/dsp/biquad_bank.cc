@@ -0,0 +1,248 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+// Standard:
+#include <cstddef>
+#include <algorithm>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+// Local:
+#include "biquad_bank.h"
+
+
+namespace Haruhi {
+
+namespace DSP {
+
+constexpr std::size_t BiquadBank::Lanes;
+constexpr std::size_t BiquadBank::MaxStages;
+
+
+BiquadBank::BiquadBank (std::size_t stages) noexcept:
+	_stages_number (stages)
+{
+	assert (stages <= MaxStages);
+
+	std::fill (reinterpret_cast<Sample*> (_stages), reinterpret_cast<Sample*> (_stages + _stages_number), 0.0f);
+}
+
+
+void
+BiquadBank::set_coefficients (std::size_t stage, std::size_t lane, Sample const* a, Sample const* b) noexcept
+{
+	assert (stage < _stages_number);
+	assert (lane < Lanes);
+
+	Stage& s = _stages[stage];
+	s.coefficients[B0][lane] = b[0];
+	s.coefficients[B1][lane] = b[1];
+	s.coefficients[B2][lane] = b[2];
+	s.coefficients[A1][lane] = a[1];
+	s.coefficients[A2][lane] = a[2];
+	for (auto& d: s.deltas)
+		d[lane] = 0.0f;
+}
+
+
+void
+BiquadBank::set_target_coefficients (std::size_t stage, std::size_t lane, Sample const* a, Sample const* b, std::size_t samples) noexcept
+{
+	assert (stage < _stages_number);
+	assert (lane < Lanes);
+
+	if (samples == 0)
+		return;
+
+	Stage& s = _stages[stage];
+	Sample const target[CoefficientsNumber] = { b[0], b[1], b[2], a[1], a[2] };
+	for (std::size_t c = 0; c < CoefficientsNumber; ++c)
+	{
+		s.deltas[c][lane] = (target[c] - s.coefficients[c][lane]) / samples;
+		if (s.deltas[c][lane] != 0.0f)
+			_interpolate = true;
+	}
+}
+
+
+void
+BiquadBank::load_state (std::size_t stage, std::size_t lane, Sample const* previous_inputs, Sample const* previous_outputs) noexcept
+{
+	assert (stage < _stages_number);
+	assert (lane < Lanes);
+
+	Stage& s = _stages[stage];
+	s.x1[lane] = previous_inputs[0];
+	s.x2[lane] = previous_inputs[1];
+	s.y1[lane] = previous_outputs[0];
+	s.y2[lane] = previous_outputs[1];
+}
+
+
+void
+BiquadBank::store_state (std::size_t stage, std::size_t lane, Sample* previous_inputs, Sample* previous_outputs) const noexcept
+{
+	assert (stage < _stages_number);
+	assert (lane < Lanes);
+
+	Stage const& s = _stages[stage];
+	previous_inputs[0] = s.x1[lane];
+	previous_inputs[1] = s.x2[lane];
+	previous_outputs[0] = s.y1[lane];
+	previous_outputs[1] = s.y2[lane];
+}
+
+
+void
+BiquadBank::process (Sample* const* buffers, std::size_t samples, std::size_t split) noexcept
+{
+	if (_interpolate)
+	{
+		process_impl<true> (buffers, samples, split);
+
+		// Coefficients reached their targets:
+		for (std::size_t i = 0; i < _stages_number; ++i)
+			std::fill (&_stages[i].deltas[0][0], &_stages[i].deltas[0][0] + CoefficientsNumber * Lanes, 0.0f);
+		_interpolate = false;
+	}
+	else
+		process_impl<false> (buffers, samples, split);
+}
+
+
+#ifdef HARUHI_SSE1
+template<bool Interpolate>
+	inline __m128
+	BiquadBank::vec4_cascade (__m128 x, Stage* begin, Stage* end) noexcept
+	{
+		for (Stage* s = begin; s != end; ++s)
+		{
+			__m128 const x1 = _mm_load_ps (s->x1);
+			__m128 const y1 = _mm_load_ps (s->y1);
+			__m128 y = _mm_mul_ps (_mm_load_ps (s->coefficients[B0]), x);
+			y = _mm_add_ps (y, _mm_mul_ps (_mm_load_ps (s->coefficients[B1]), x1));
+			y = _mm_add_ps (y, _mm_mul_ps (_mm_load_ps (s->coefficients[B2]), _mm_load_ps (s->x2)));
+			y = _mm_sub_ps (y, _mm_mul_ps (_mm_load_ps (s->coefficients[A1]), y1));
+			y = _mm_sub_ps (y, _mm_mul_ps (_mm_load_ps (s->coefficients[A2]), _mm_load_ps (s->y2)));
+			_mm_store_ps (s->x2, x1);
+			_mm_store_ps (s->x1, x);
+			_mm_store_ps (s->y2, y1);
+			_mm_store_ps (s->y1, y);
+			x = y;
+
+			if (Interpolate)
+				for (std::size_t c = 0; c < CoefficientsNumber; ++c)
+					_mm_store_ps (s->coefficients[c], _mm_add_ps (_mm_load_ps (s->coefficients[c]), _mm_load_ps (s->deltas[c])));
+		}
+		return x;
+	}
+#endif
+
+
+template<bool Interpolate>
+	inline Sample
+	BiquadBank::cascade (Sample x, std::size_t l, Stage* begin, Stage* end) noexcept
+	{
+		for (Stage* s = begin; s != end; ++s)
+		{
+			auto const& c = s->coefficients;
+			Sample const y = c[B0][l] * x + c[B1][l] * s->x1[l] + c[B2][l] * s->x2[l] - c[A1][l] * s->y1[l] - c[A2][l] * s->y2[l];
+			s->x2[l] = s->x1[l];
+			s->x1[l] = x;
+			s->y2[l] = s->y1[l];
+			s->y1[l] = y;
+			x = y;
+
+			if (Interpolate)
+				for (std::size_t k = 0; k < CoefficientsNumber; ++k)
+					s->coefficients[k][l] += s->deltas[k][l];
+		}
+		return x;
+	}
+
+
+template<bool Interpolate>
+	void
+	BiquadBank::process_impl (Sample* const* buffers, std::size_t samples, std::size_t split) noexcept
+	{
+		assert (split <= _stages_number);
+
+		Stage* const begin = _stages;
+		Stage* const middle = _stages + split;
+		Stage* const end = _stages + _stages_number;
+		// Protect from denormals by adding a constant.
+		// This will propagate to further stages:
+		Sample const dc = 1e-30f;
+
+#ifdef HARUHI_SSE1
+		__m128 const vdc = _mm_set_ps1 (dc);
+
+		auto step = [&] (__m128 x) -> __m128 {
+			x = _mm_add_ps (x, vdc);
+			__m128 y = vec4_cascade<Interpolate> (x, begin, middle);
+			if (middle != end)
+				y = _mm_add_ps (y, vec4_cascade<Interpolate> (x, middle, end));
+			return y;
+		};
+
+		std::size_t i = 0;
+		// Load four samples of each lane and transpose, so that each vector
+		// holds one sample of all lanes:
+		for (; i + 4 <= samples; i += 4)
+		{
+			__m128 v[Lanes];
+			for (std::size_t l = 0; l < Lanes; ++l)
+				v[l] = buffers[l] ? _mm_loadu_ps (buffers[l] + i) : _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS (v[0], v[1], v[2], v[3]);
+			for (std::size_t k = 0; k < 4; ++k)
+				v[k] = step (v[k]);
+			_MM_TRANSPOSE4_PS (v[0], v[1], v[2], v[3]);
+			for (std::size_t l = 0; l < Lanes; ++l)
+				if (buffers[l])
+					_mm_storeu_ps (buffers[l] + i, v[l]);
+		}
+
+		for (; i < samples; ++i)
+		{
+			alignas (16) Sample x[Lanes];
+			for (std::size_t l = 0; l < Lanes; ++l)
+				x[l] = buffers[l] ? buffers[l][i] : 0.0f;
+			_mm_store_ps (x, step (_mm_load_ps (x)));
+			for (std::size_t l = 0; l < Lanes; ++l)
+				if (buffers[l])
+					buffers[l][i] = x[l];
+		}
+#else
+		for (std::size_t l = 0; l < Lanes; ++l)
+		{
+			if (!buffers[l])
+				continue;
+
+			for (std::size_t i = 0; i < samples; ++i)
+			{
+				Sample const x = buffers[l][i] + dc;
+				Sample y = cascade<Interpolate> (x, l, begin, middle);
+				if (middle != end)
+					y += cascade<Interpolate> (x, l, middle, end);
+				buffers[l][i] = y;
+			}
+		}
+#endif
+	}
+
+} // namespace DSP
+
+} // namespace Haruhi
+
@@ -0,0 +1,161 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+#ifndef HARUHI__DSP__BIQUAD_BANK_H__INCLUDED
+#define HARUHI__DSP__BIQUAD_BANK_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+// System:
+#ifdef HARUHI_SSE1
+#include <xmmintrin.h>
+#endif
+
+
+namespace Haruhi {
+
+namespace DSP {
+
+/**
+ * Runs independent cascades of biquad filters in lockstep, one cascade per lane.
+ * The recurrence can't be vectorized along time, but it can across lanes:
+ * coefficients and states are stored as structure of arrays, so each step
+ * is done for all lanes with single SIMD instructions.
+ *
+ * Stages use direct form I, same as DSP::Filter<3, IIR>, so state can be moved
+ * between Filter objects and the bank with load_state() and store_state().
+ *
+ * Coefficients can be interpolated linearly sample by sample during process(),
+ * for smooth modulation of filter parameters. The interpolated filter stays
+ * stable, because the region of stable denominators (a1, a2) is convex.
+ */
+class BiquadBank
+{
+  public:
+	static constexpr std::size_t Lanes		= 4;
+	static constexpr std::size_t MaxStages	= 16;
+
+  private:
+	enum { B0, B1, B2, A1, A2, CoefficientsNumber };
+
+	// Coefficients and state of one stage for all lanes:
+	struct alignas (16) Stage
+	{
+		Sample	coefficients[CoefficientsNumber][Lanes];
+		// Per-sample coefficient increments:
+		Sample	deltas[CoefficientsNumber][Lanes];
+		Sample	x1[Lanes];
+		Sample	x2[Lanes];
+		Sample	y1[Lanes];
+		Sample	y2[Lanes];
+	};
+
+  public:
+	/**
+	 * Create bank with given number of stages in each lane.
+	 * All coefficients and states are zeroed.
+	 */
+	explicit
+	BiquadBank (std::size_t stages) noexcept;
+
+	/**
+	 * Return number of stages.
+	 */
+	std::size_t
+	stages() const noexcept;
+
+	/**
+	 * Set coefficients of a stage in given lane.
+	 * \param	a, b Coefficients as in ImpulseResponse<3, IIR>: b[0..2] is the numerator,
+	 *			a[1..2] the denominator, a[0] is ignored.
+	 */
+	void
+	set_coefficients (std::size_t stage, std::size_t lane, Sample const* a, Sample const* b) noexcept;
+
+	/**
+	 * Make coefficients of a stage in given lane change linearly from ones set
+	 * with set_coefficients() to given ones during the next process() call.
+	 * \param	samples Number of samples in the next process() call.
+	 */
+	void
+	set_target_coefficients (std::size_t stage, std::size_t lane, Sample const* a, Sample const* b, std::size_t samples) noexcept;
+
+	/**
+	 * Load state of a stage in given lane.
+	 * \param	previous_inputs, previous_outputs Last two samples, the most recent first.
+	 */
+	void
+	load_state (std::size_t stage, std::size_t lane, Sample const* previous_inputs, Sample const* previous_outputs) noexcept;
+
+	/**
+	 * Store state of a stage in given lane, in format used by load_state().
+	 */
+	void
+	store_state (std::size_t stage, std::size_t lane, Sample* previous_inputs, Sample* previous_outputs) const noexcept;
+
+	/**
+	 * Filter buffers in place, buffers[i] with i-th lane.
+	 * Lanes with nullptr buffers are fed with silence.
+	 *
+	 * Stages [0, split) and [split, stages()) form two cascades fed with
+	 * the same input, whose outputs are summed. If split == stages(),
+	 * all stages form a single cascade.
+	 */
+	void
+	process (Sample* const* buffers, std::size_t samples, std::size_t split) noexcept;
+
+  private:
+	template<bool Interpolate>
+		void
+		process_impl (Sample* const* buffers, std::size_t samples, std::size_t split) noexcept;
+
+#ifdef HARUHI_SSE1
+	/**
+	 * Run one sample of all lanes through stages [begin, end).
+	 */
+	template<bool Interpolate>
+		static __m128
+		vec4_cascade (__m128 x, Stage* begin, Stage* end) noexcept;
+#endif
+
+	/**
+	 * Run one sample of given lane through stages [begin, end).
+	 */
+	template<bool Interpolate>
+		static Sample
+		cascade (Sample x, std::size_t lane, Stage* begin, Stage* end) noexcept;
+
+  private:
+	std::size_t	_stages_number;
+	bool		_interpolate	= false;
+	Stage		_stages[MaxStages];
+};
+
+
+inline std::size_t
+BiquadBank::stages() const noexcept
+{
+	return _stages_number;
+}
+
+} // namespace DSP
+
+} // namespace Haruhi
+
+#endif
+
@@ -0,0 +1,323 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+// Standard:
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+// System:
+#ifdef HARUHI_SSE1
+#include <xmmintrin.h>
+#endif
+
+// Local:
+#include "decimator.h"
+
+
+namespace Haruhi {
+
+namespace DSP {
+
+// Stopband attenuation in dB:
+static constexpr double Attenuation = 90.0;
+// Passband edge relative to the output sample rate:
+static constexpr double PassBand = 0.4;
+
+
+/**
+ * Modified Bessel function of the first kind, order 0.
+ */
+static double
+bessel_i0 (double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (unsigned int k = 1; term > 1e-12 * sum; ++k)
+	{
+		term *= (0.5 * x / k) * (0.5 * x / k);
+		sum += term;
+	}
+	return sum;
+}
+
+
+/**
+ * Kaiser window for tap at distance x from the center,
+ * where half_length is the distance at which window reaches zero.
+ */
+static double
+kaiser (double x, double half_length)
+{
+	double const beta = 0.1102 * (Attenuation - 8.7);
+	double const r = x / half_length;
+	return bessel_i0 (beta * std::sqrt (std::max (0.0, 1.0 - r * r))) / bessel_i0 (beta);
+}
+
+
+/**
+ * Return length of Kaiser-windowed FIR filter for given transition width
+ * (relative to the sample rate).
+ */
+static std::size_t
+kaiser_length (double transition)
+{
+	return std::ceil ((Attenuation - 7.95) / (14.36 * transition));
+}
+
+
+Decimator::Decimator (unsigned int factor)
+{
+	set_factor (factor);
+}
+
+
+void
+Decimator::set_factor (unsigned int factor)
+{
+	assert (factor >= 1);
+
+	_factor = factor;
+	_stages.clear();
+
+	unsigned int odd_factor = factor;
+	// Input rate of the current stage, relative to the output rate:
+	double rate = factor;
+	while (odd_factor % 2 == 0)
+	{
+		double const output_rate = rate / 2;
+		// Halfband stage passes PassBand and must reject frequencies folding back into it:
+		_stages.push_back (make_halfband_stage ((output_rate - 2.0 * PassBand) / rate));
+		odd_factor /= 2;
+		rate = output_rate;
+	}
+
+	if (odd_factor > 1)
+		_stages.push_back (make_fir_stage (odd_factor));
+
+	clear();
+}
+
+
+void
+Decimator::reserve (std::size_t input_size)
+{
+	for (std::size_t i = 0; i < _stages.size(); ++i)
+	{
+		Stage& stage = _stages[i];
+		if (stage.factor == 2)
+		{
+			stage.input.resize (std::max (stage.input.size(), stage.history + input_size / 2));
+			stage.input_odd.resize (std::max (stage.input_odd.size(), stage.history + input_size / 2));
+		}
+		else
+			stage.input.resize (std::max (stage.input.size(), stage.history + input_size));
+
+		input_size /= stage.factor;
+		_buffers[i % 2].resize (std::max (_buffers[i % 2].size(), input_size));
+	}
+}
+
+
+void
+Decimator::clear() noexcept
+{
+	for (Stage& stage: _stages)
+	{
+		std::fill (stage.input.begin(), stage.input.end(), 0.0f);
+		std::fill (stage.input_odd.begin(), stage.input_odd.end(), 0.0f);
+	}
+}
+
+
+void
+Decimator::decimate (Sample const* input, std::size_t input_size, Sample* output)
+{
+	assert (input_size % _factor == 0);
+
+	if (_stages.empty())
+	{
+		std::copy (input, input + input_size, output);
+		return;
+	}
+
+	reserve (input_size);
+
+	for (std::size_t i = 0; i < _stages.size(); ++i)
+	{
+		Stage& stage = _stages[i];
+		Sample* target = i + 1 == _stages.size() ? output : _buffers[i % 2].data();
+
+		if (stage.factor == 2)
+			process_halfband (stage, input, input_size, target);
+		else
+			process_fir (stage, input, input_size, target);
+
+		input = target;
+		input_size /= stage.factor;
+	}
+}
+
+
+Decimator::Stage
+Decimator::make_halfband_stage (float transition)
+{
+	// Halfband filter has 4K - 1 taps, every other tap is zero except the center one:
+	std::size_t const k = std::max<std::size_t> (2, (kaiser_length (transition) + 4) / 4);
+	double const half_length = 2 * k;
+
+	Stage stage;
+	stage.factor = 2;
+	stage.history = 2 * k - 1;
+	stage.coefficients.resize (k);
+
+	// Non-zero taps are at odd distances from the center, coefficient[j]
+	// is for distance 2K - 1 - 2j (and for the symmetric tap):
+	double sum = 0.0;
+	std::vector<double> taps (k);
+	for (std::size_t j = 0; j < k; ++j)
+	{
+		double const t = 2 * k - 1 - 2 * j;
+		taps[j] = std::sin (0.5 * M_PI * t) / (M_PI * t) * kaiser (t, half_length);
+		sum += 2.0 * taps[j];
+	}
+
+	// Normalize for unity gain at DC (center tap is 0.5):
+	for (std::size_t j = 0; j < k; ++j)
+		stage.coefficients[j] = 0.5 * taps[j] / sum;
+
+	return stage;
+}
+
+
+Decimator::Stage
+Decimator::make_fir_stage (unsigned int factor)
+{
+	double const cutoff = 0.5 / factor;
+	double const transition = 2.0 * (0.5 - PassBand) / factor;
+	// Odd length, so that there's a center tap:
+	std::size_t const length = kaiser_length (transition) | 1;
+	double const center = 0.5 * (length - 1);
+
+	Stage stage;
+	stage.factor = factor;
+	// Pad with zeros to multiple of 4 for vectorized dot products:
+	stage.coefficients.resize ((length + 3) / 4 * 4, 0.0f);
+	stage.history = stage.coefficients.size() - factor;
+
+	double sum = 0.0;
+	std::vector<double> taps (length);
+	for (std::size_t i = 0; i < length; ++i)
+	{
+		double const t = i - center;
+		double const sinc = t == 0.0 ? 1.0 : std::sin (2.0 * M_PI * cutoff * t) / (2.0 * M_PI * cutoff * t);
+		taps[i] = sinc * kaiser (t, center + 1.0);
+		sum += taps[i];
+	}
+
+	for (std::size_t i = 0; i < length; ++i)
+		stage.coefficients[i] = taps[i] / sum;
+
+	return stage;
+}
+
+
+void
+Decimator::process_halfband (Stage& stage, Sample const* input, std::size_t input_size, Sample* output) noexcept
+{
+	std::size_t const h = stage.history;
+	std::size_t const k = stage.coefficients.size();
+	std::size_t const n = input_size / 2;
+	float const* const c = stage.coefficients.data();
+	Sample* const even = stage.input.data();
+	Sample* const odd = stage.input_odd.data();
+
+	// Split into polyphase components:
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		even[h + i] = input[2 * i];
+		odd[h + i] = input[2 * i + 1];
+	}
+
+	// Output m is 0.5 * even[m + K] + sum of c[j] * (odd[m + j] + odd[m + 2K - 1 - j]):
+	std::size_t m = 0;
+#ifdef HARUHI_SSE1
+	__m128 const half = _mm_set_ps1 (0.5f);
+	for (; m + 4 <= n; m += 4)
+	{
+		__m128 sum = _mm_mul_ps (half, _mm_loadu_ps (even + m + k));
+		for (std::size_t j = 0; j < k; ++j)
+		{
+			__m128 const pair = _mm_add_ps (_mm_loadu_ps (odd + m + j), _mm_loadu_ps (odd + m + h - j));
+			sum = _mm_add_ps (sum, _mm_mul_ps (_mm_set_ps1 (c[j]), pair));
+		}
+		_mm_storeu_ps (output + m, sum);
+	}
+#endif
+	for (; m < n; ++m)
+	{
+		Sample sum = 0.5f * even[m + k];
+		for (std::size_t j = 0; j < k; ++j)
+			sum += c[j] * (odd[m + j] + odd[m + h - j]);
+		output[m] = sum;
+	}
+
+	// Keep history for the next block:
+	std::copy (even + n, even + n + h, even);
+	std::copy (odd + n, odd + n + h, odd);
+}
+
+
+void
+Decimator::process_fir (Stage& stage, Sample const* input, std::size_t input_size, Sample* output) noexcept
+{
+	std::size_t const h = stage.history;
+	std::size_t const r = stage.factor;
+	std::size_t const length = stage.coefficients.size();
+	std::size_t const n = input_size / r;
+	float const* const c = stage.coefficients.data();
+	Sample* const x = stage.input.data();
+
+	std::copy (input, input + input_size, x + h);
+
+	// Compute only every r-th sample of the filtered signal:
+	for (std::size_t m = 0; m < n; ++m)
+	{
+		Sample const* const xm = x + m * r;
+#ifdef HARUHI_SSE1
+		__m128 sum = _mm_setzero_ps();
+		for (std::size_t i = 0; i < length; i += 4)
+			sum = _mm_add_ps (sum, _mm_mul_ps (_mm_loadu_ps (c + i), _mm_loadu_ps (xm + i)));
+		sum = _mm_add_ps (sum, _mm_movehl_ps (sum, sum));
+		sum = _mm_add_ss (sum, _mm_shuffle_ps (sum, sum, 1));
+		output[m] = _mm_cvtss_f32 (sum);
+#else
+		Sample sum = 0.0f;
+		for (std::size_t i = 0; i < length; ++i)
+			sum += c[i] * xm[i];
+		output[m] = sum;
+#endif
+	}
+
+	// Keep history for the next block:
+	std::copy (x + input_size, x + input_size + h, x);
+}
+
+} // namespace DSP
+
+} // namespace Haruhi
+
@@ -0,0 +1,143 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+#ifndef HARUHI__DSP__DECIMATOR_H__INCLUDED
+#define HARUHI__DSP__DECIMATOR_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <vector>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+
+namespace Haruhi {
+
+namespace DSP {
+
+/**
+ * Antialiasing filter and decimator for oversampled signals.
+ *
+ * Decimation factor is split into a cascade of polyphase halfband FIR stages,
+ * one for each factor of 2, followed by a polyphase FIR stage for the remaining
+ * odd factor. Each stage computes only the samples it outputs. Early stages run
+ * at higher rates but need only wide transition bands, so they're short.
+ *
+ * Passband extends to 0.4 of the output sample rate, stopband attenuation
+ * is at least 80 dB. Filters have linear phase.
+ */
+class Decimator
+{
+	struct Stage
+	{
+		unsigned int		factor;
+		// Number of past input samples (per phase for halfband stages)
+		// needed by the filter:
+		std::size_t			history;
+		// Halfband stages keep only the first half of non-zero (and symmetric)
+		// coefficients of the odd phase:
+		std::vector<float>	coefficients;
+		// Input samples preceded by history. Halfband stages keep
+		// even samples in input and odd samples in input_odd:
+		std::vector<Sample>	input;
+		std::vector<Sample>	input_odd;
+	};
+
+  public:
+	/**
+	 * \param	factor Decimation factor, 1 means no filtering at all.
+	 */
+	explicit
+	Decimator (unsigned int factor = 1);
+
+	/**
+	 * Return decimation factor.
+	 */
+	unsigned int
+	factor() const noexcept;
+
+	/**
+	 * Set new decimation factor. Recomputes filters and clears state.
+	 */
+	void
+	set_factor (unsigned int factor);
+
+	/**
+	 * Preallocate buffers for blocks of given number of input samples,
+	 * so that decimate() doesn't allocate memory.
+	 */
+	void
+	reserve (std::size_t input_size);
+
+	/**
+	 * Reset filters state to silence.
+	 */
+	void
+	clear() noexcept;
+
+	/**
+	 * Filter and decimate a block of samples.
+	 * \param	input_size Number of input samples, must be multiple of factor().
+	 * \param	output Buffer for input_size / factor() samples.
+	 */
+	void
+	decimate (Sample const* input, std::size_t input_size, Sample* output);
+
+  private:
+	/**
+	 * Create halfband stage.
+	 * \param	transition Width of the transition band, relative to stage's input rate.
+	 */
+	static Stage
+	make_halfband_stage (float transition);
+
+	/**
+	 * Create generic stage for given odd factor.
+	 */
+	static Stage
+	make_fir_stage (unsigned int factor);
+
+	/**
+	 * Process input_size samples by a halfband stage.
+	 */
+	static void
+	process_halfband (Stage&, Sample const* input, std::size_t input_size, Sample* output) noexcept;
+
+	/**
+	 * Process input_size samples by a generic stage.
+	 */
+	static void
+	process_fir (Stage&, Sample const* input, std::size_t input_size, Sample* output) noexcept;
+
+  private:
+	unsigned int		_factor = 1;
+	std::vector<Stage>	_stages;
+	// Ping-pong buffers for results of intermediate stages:
+	std::vector<Sample>	_buffers[2];
+};
+
+
+inline unsigned int
+Decimator::factor() const noexcept
+{
+	return _factor;
+}
+
+} // namespace DSP
+
+} // namespace Haruhi
+
+#endif
+
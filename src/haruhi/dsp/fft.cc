@@ -13,6 +13,7 @@
 
 // Standard:
 #include <cstddef>
+#include <new>
 
 // Haruhi:
 #include <haruhi/config/system.h>
@@ -28,6 +29,7 @@ namespace Haruhi {
 namespace DSP {
 
 Mutex FFT::_plan_mutex;
+std::map<std::size_t, FFT::Real::Plans> FFT::Real::_plans_cache;
 
 
 FFT::Vector::Vector (std::size_t samples):
@@ -117,6 +119,49 @@ FFT::Inverse::transform() noexcept
 	_target.normalize();
 }
 
+
+FFT::Real::Real (std::size_t size):
+	_size (size),
+	// fftwf_malloc() gives the same alignment to all buffers, so they
+	// can be used with plans created for other buffers:
+	_signal (static_cast<float*> (fftwf_malloc (size * sizeof (float)))),
+	_spectrum (static_cast<Complex*> (fftwf_malloc ((size / 2 + 1) * sizeof (Complex))))
+{
+	if (!_signal || !_spectrum)
+	{
+		fftwf_free (_signal);
+		fftwf_free (_spectrum);
+		throw std::bad_alloc();
+	}
+
+	_plans = plans_for (size, _signal, _spectrum);
+}
+
+
+FFT::Real::~Real()
+{
+	fftwf_free (_signal);
+	fftwf_free (_spectrum);
+}
+
+
+FFT::Real::Plans
+FFT::Real::plans_for (std::size_t size, float* signal, Complex* spectrum)
+{
+	Mutex::Lock lock (FFT::_plan_mutex);
+
+	auto p = _plans_cache.find (size);
+	if (p != _plans_cache.end())
+		return p->second;
+
+	// FFTW_ESTIMATE doesn't touch buffers:
+	Plans plans;
+	plans.forward = fftwf_plan_dft_r2c_1d (size, signal, reinterpret_cast<fftwf_complex*> (spectrum), FFTW_ESTIMATE);
+	plans.inverse = fftwf_plan_dft_c2r_1d (size, reinterpret_cast<fftwf_complex*> (spectrum), signal, FFTW_ESTIMATE);
+	_plans_cache[size] = plans;
+	return plans;
+}
+
 } // namespace DSP
 
 } // namespace Haruhi
@@ -17,6 +17,7 @@
 // Standard:
 #include <cstddef>
 #include <complex>
+#include <map>
 
 // Lib:
 #include <fftw3.h>
@@ -99,6 +100,89 @@ class FFT
 		Vector&		_target;
 	};
 
+	/**
+	 * Single-precision transforms of real signals (FFTW's r2c and c2r).
+	 * Plans are created once per size and cached, so objects are cheap
+	 * to create. Each object has its own buffers, so many threads
+	 * may transform at once, each with its own Real object.
+	 */
+	class Real: private Noncopyable
+	{
+	  public:
+		typedef std::complex<float> Complex;
+
+	  private:
+		struct Plans
+		{
+			fftwf_plan	forward;
+			fftwf_plan	inverse;
+		};
+
+	  public:
+		/**
+		 * \param	size Number of real samples.
+		 * 			Spectrum has size/2 + 1 bins.
+		 */
+		explicit
+		Real (std::size_t size);
+
+		~Real();
+
+		/**
+		 * Return number of real samples.
+		 */
+		std::size_t
+		size() const noexcept;
+
+		/**
+		 * Return number of bins in spectrum.
+		 */
+		std::size_t
+		spectrum_size() const noexcept;
+
+		/**
+		 * Access real signal buffer.
+		 */
+		float*
+		signal() const noexcept;
+
+		/**
+		 * Access spectrum buffer.
+		 */
+		Complex*
+		spectrum() const noexcept;
+
+		/**
+		 * Transform signal() into spectrum().
+		 */
+		void
+		forward() noexcept;
+
+		/**
+		 * Transform spectrum() back into signal(). Result is not normalized
+		 * (it's multiplied by size()). Contents of spectrum() are destroyed.
+		 */
+		void
+		inverse() noexcept;
+
+	  private:
+		/**
+		 * Return plans for given size. Creates them
+		 * if they're not yet cached.
+		 */
+		static Plans
+		plans_for (std::size_t size, float* signal, Complex* spectrum);
+
+	  private:
+		std::size_t		_size;
+		float*			_signal;
+		Complex*		_spectrum;
+		Plans			_plans;
+
+		// Plans are kept until the program ends:
+		static std::map<std::size_t, Plans>	_plans_cache;
+	};
+
   public:
 	virtual void
 	transform() = 0;
@@ -136,6 +220,49 @@ FFT::Vector::size() const noexcept
 	return _size;
 }
 
+
+inline std::size_t
+FFT::Real::size() const noexcept
+{
+	return _size;
+}
+
+
+inline std::size_t
+FFT::Real::spectrum_size() const noexcept
+{
+	return _size / 2 + 1;
+}
+
+
+inline float*
+FFT::Real::signal() const noexcept
+{
+	return _signal;
+}
+
+
+inline FFT::Real::Complex*
+FFT::Real::spectrum() const noexcept
+{
+	return _spectrum;
+}
+
+
+inline void
+FFT::Real::forward() noexcept
+{
+	// New-array execute functions are thread-safe for the shared plan:
+	fftwf_execute_dft_r2c (_plans.forward, _signal, reinterpret_cast<fftwf_complex*> (_spectrum));
+}
+
+
+inline void
+FFT::Real::inverse() noexcept
+{
+	fftwf_execute_dft_c2r (_plans.inverse, reinterpret_cast<fftwf_complex*> (_spectrum), _signal);
+}
+
 } // namespace DSP
 
 } // namespace Haruhi
@@ -13,12 +13,16 @@
 
 // Standard:
 #include <cstddef>
+#include <algorithm>
 
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/dsp/fft.h>
+#include <haruhi/utility/atomic.h>
 #include <haruhi/utility/exception.h>
 #include <haruhi/utility/numeric.h>
+#include <haruhi/utility/shared.h>
+#include <haruhi/utility/thread.h>
 
 // Local:
 #include "fft_filler.h"
@@ -28,6 +32,108 @@ namespace Haruhi {
 
 namespace DSP {
 
+/**
+ * State of one fill() call shared by all threads computing tables.
+ */
+struct FFTFiller::Job
+{
+	/**
+	 * Compute tables until there are none left.
+	 */
+	void
+	work();
+
+	unsigned int						samples;
+	std::function<bool()>				cancel_predicate;
+	// Spectrum of the whole wave:
+	Spectrum							spectrum;
+	// Number of harmonics to keep in each table:
+	std::vector<unsigned int>			harmonics;
+	std::vector<std::vector<Sample>>	tables;
+	Atomic<std::size_t>					next_table		{ 0 };
+	Atomic<std::size_t>					finished_tables	{ 0 };
+	Atomic<bool>						cancelled		{ false };
+};
+
+
+/**
+ * Helps computing tables on WorkPerformer's thread.
+ * Helper may be started after all tables have been computed and fill()
+ * has returned, so it keeps Job alive by itself and deletes itself
+ * when done.
+ */
+class FFTFiller::HelperUnit: public WorkPerformer::Unit
+{
+  public:
+	explicit
+	HelperUnit (Shared<Job> const& job) noexcept;
+
+	void
+	execute() override;
+
+  protected:
+	void
+	done() override;
+
+  private:
+	Shared<Job> _job;
+};
+
+
+void
+FFTFiller::Job::work()
+{
+	FFT::Real fft (samples);
+	Sample const scale = 1.0f / samples;
+
+	while (true)
+	{
+		std::size_t const t = next_table.fetch_add (1);
+		if (t >= tables.size())
+			break;
+
+		if (!cancelled.load() && cancel_predicate && cancel_predicate())
+			cancelled.store (true);
+
+		if (!cancelled.load())
+		{
+			// Bandlimit spectrum. 0 frequency is at index 0, max freq is at index samples/2:
+			std::size_t const kept = std::min<std::size_t> (harmonics[t] + 1, fft.spectrum_size());
+			std::copy (spectrum.begin(), spectrum.begin() + kept, fft.spectrum());
+			std::fill (fft.spectrum() + kept, fft.spectrum() + fft.spectrum_size(), FFT::Real::Complex (0.0f, 0.0f));
+
+			fft.inverse();
+
+			std::vector<Sample>& table = tables[t];
+			for (unsigned int i = 0; i < samples; ++i)
+				table[i] = fft.signal()[i] * scale;
+		}
+
+		finished_tables.fetch_add (1);
+	}
+}
+
+
+FFTFiller::HelperUnit::HelperUnit (Shared<Job> const& job) noexcept:
+	_job (job)
+{ }
+
+
+void
+FFTFiller::HelperUnit::execute()
+{
+	_job->work();
+}
+
+
+void
+FFTFiller::HelperUnit::done()
+{
+	// Nobody waits for helpers and Performer doesn't touch units after done():
+	delete this;
+}
+
+
 FFTFiller::FFTFiller (Wave* wave, bool autoscale, Sample scale_epsilon) noexcept:
 	_wave (wave),
 	_autoscale (autoscale),
@@ -41,75 +147,126 @@ FFTFiller::FFTFiller (Wave* wave, bool autoscale, Sample scale_epsilon) noexcept
 void
 FFTFiller::fill (Wavetable* wavetable, unsigned int samples)
 {
-#define CHECK_INTERRUPT do { if (interrupted()) { wavetable->drop_tables(); return; } } while (false)
+	_was_interrupted = false;
+
+	if (samples < 1024)
+		throw Exception ("samples number must be at least 1024");
 
+	// Create freq. spectrum of original wave:
+	FFT::Real fft (samples);
+	Sample max = 0.0f;
+	for (unsigned int i = 0; i < samples; ++i)
+	{
+		fft.signal()[i] = (*_wave)(1.0f * i / samples, 0, 0);
+		max = std::max (max, std::abs (fft.signal()[i]));
+	}
+	fft.forward();
+
+	fill_from_spectrum (wavetable, Spectrum (fft.spectrum(), fft.spectrum() + fft.spectrum_size()), max);
+}
+
+
+void
+FFTFiller::fill (Wavetable* wavetable, Spectrum const& spectrum)
+{
 	_was_interrupted = false;
 
-	if (samples < 4096)
-		throw Exception ("samples number must be at least 4096");
+	unsigned int const samples = 2 * (std::max<std::size_t> (spectrum.size(), 1) - 1);
+	if (samples < 1024)
+		throw Exception ("samples number must be at least 1024");
 
-	Wavetable::Tables tables;
+	Sample max = 0.0f;
+	if (_autoscale)
+	{
+		FFT::Real fft (samples);
+		std::copy (spectrum.begin(), spectrum.end(), fft.spectrum());
+		fft.inverse();
+		for (unsigned int i = 0; i < samples; ++i)
+			max = std::max (max, std::abs (fft.signal()[i]));
+		max /= samples;
+	}
+
+	fill_from_spectrum (wavetable, spectrum, max);
+}
+
+
+FFTFiller::Spectrum
+FFTFiller::wave_spectrum (Wave const& wave, unsigned int samples)
+{
+	FFT::Real fft (samples);
+	for (unsigned int i = 0; i < samples; ++i)
+		fft.signal()[i] = wave (1.0f * i / samples, 0, 0);
+	fft.forward();
+
+	return Spectrum (fft.spectrum(), fft.spectrum() + fft.spectrum_size());
+}
+
+
+void
+FFTFiller::fill_from_spectrum (Wavetable* wavetable, Spectrum spectrum, Sample max)
+{
+#define CHECK_INTERRUPT do { if (interrupted()) { wavetable->drop_tables(); return; } } while (false)
+
+	unsigned int const samples = 2 * (spectrum.size() - 1);
 
 	wavetable->drop_tables();
 	wavetable->set_wavetables_size (samples);
 
+	Shared<Job> job (new Job());
+	job->samples = samples;
+	job->cancel_predicate = _cancel_predicate;
+
 	// Compute max freqs. for tables:
+	std::vector<float> max_frequencies;
 	unsigned int const tables_num = 36; // New table about every 4 semitones
 	float const expand_coeff = 1.25; // Min max frequency: ~19kHz
 	for (unsigned int i = 0; i < tables_num; ++i)
-		tables[0.5f - 0.5f * (std::pow (expand_coeff, i) - 1) / std::pow (expand_coeff, i)].resize (samples);
-
-	FFT::Vector source (samples);
-	FFT::Vector target (samples);
-
-	FFT::Forward forward (source);
-	FFT::Inverse inverse (source, target);
-
-	// Create freq. spectrum of original wave:
-	Sample max = 0.0f, new_max;
-	for (unsigned int i = 0; i < samples; ++i)
 	{
-		source[i].real ((*_wave)(1.0f * i / (samples), 0, 0));
-		source[i].imag (0.0f);
-		if ((new_max = std::abs (source[i].real())) > max)
-			max = new_max;
+		float const max_frequency = 0.5f - 0.5f * (std::pow (expand_coeff, i) - 1) / std::pow (expand_coeff, i);
+		unsigned int const harmonics = 1.0f / (2.0f * max_frequency);
+		max_frequencies.push_back (max_frequency);
+		job->harmonics.push_back (harmonics);
+		// This table already holds all harmonics that fit in given number of samples,
+		// tables for lower frequencies would be the same:
+		if (2 * harmonics >= samples)
+			break;
 	}
+	job->tables.resize (max_frequencies.size(), std::vector<Sample> (samples));
+
 	if (_autoscale && max > _scale_epsilon)
-		for (unsigned int i = 0; i < samples; ++i)
-			source[i].real (source[i].real() / max);
-	forward.transform();
+		for (auto& c: spectrum)
+			c /= max;
+	job->spectrum = std::move (spectrum);
+
+	CHECK_INTERRUPT;
 
 	// Create wavetables by bandlimiting obtained spectrum.
-	// 0 frequency is at index 0, max freq is at index samples/2.
-	for (auto& t: tables)
+	// Other threads help if they're free, and this thread
+	// computes whatever is left:
+	if (_work_performer)
 	{
-		CHECK_INTERRUPT;
+		std::vector<WorkPerformer::Unit*> helpers;
+		unsigned int const helpers_num = std::min<std::size_t> (_work_performer->threads_number(), job->tables.size()) - 1;
+		for (unsigned int i = 0; i < helpers_num; ++i)
+			helpers.push_back (new HelperUnit (job));
+		_work_performer->add (helpers.begin(), helpers.end());
+	}
 
-		int range = (int)samples * t.first; // t->first is max_frequency
+	job->work();
 
-		int samples_left = 1.0f / (2.0f * t.first);
-		range = clamped (range, 0, static_cast<int> (samples));
+	// Wait for tables being computed by helpers:
+	while (job->finished_tables.load() < job->tables.size())
+		Thread::yield();
 
-		// Clear some frequencies:
-		for (unsigned int i = samples_left + 1; i <= samples - samples_left; ++i)
-		{
-			source[i].real (0.0f);
-			source[i].imag (0.0f);
-		}
-		// Transform spectrum and put it into @target:
-		inverse.transform();
+	_was_interrupted = job->cancelled.load();
+	CHECK_INTERRUPT;
 
-		// Copy result into wavetable:
-		for (unsigned int i = 0; i < samples; ++i)
-			t.second[i] = target[i].real();
-	}
+	Wavetable::Tables tables;
+	for (std::size_t t = 0; t < max_frequencies.size(); ++t)
+		tables[max_frequencies[t]] = std::move (job->tables[t]);
 
 	// Create wavetables:
-	for (auto& t: tables)
-	{
-		CHECK_INTERRUPT;
-		wavetable->add_table (std::move (t.second), t.first);
-	}
+	wavetable->set_tables (std::move (tables));
 
 #undef CHECK_INTERRUPT
 }
@@ -22,8 +22,10 @@
 
 // Haruhi:
 #include <haruhi/config/all.h>
+#include <haruhi/dsp/fft.h>
 #include <haruhi/dsp/wave.h>
 #include <haruhi/dsp/wavetable.h>
+#include <haruhi/utility/work_performer.h>
 
 
 namespace Haruhi {
@@ -32,9 +34,22 @@ namespace DSP {
 
 /**
  * Uses FFT to fill Wavetables using given Wave object.
+ *
+ * Wave is sampled and transformed once (or its spectrum is given directly),
+ * then each bandlimited table is computed with its own inverse transform.
+ * These transforms are independent, so if WorkPerformer is set, they're
+ * spread among its threads.
  */
 class FFTFiller: public Wavetable::Filler
 {
+	struct Job;
+	class HelperUnit;
+
+  public:
+	// Spectrum of a real signal, as computed by FFT::Real: bin k
+	// holds k-th harmonic, there are samples/2 + 1 bins:
+	typedef std::vector<FFT::Real::Complex> Spectrum;
+
   public:
 	/**
 	 * Creates filler.
@@ -50,16 +65,41 @@ class FFTFiller: public Wavetable::Filler
 	 * If cancel predicate returns true, the filling is interrupted and
 	 * fill() method returns false. Cancel predicate should be as fast as possible,
 	 * since it will be called many times during the fill.
+	 * When WorkPerformer is used, predicate is called from its threads too.
 	 */
 	void
 	set_cancel_predicate (std::function<bool()> cancel_predicate) noexcept;
 
 	/**
-	 * Fill the wavetable.
+	 * Set WorkPerformer used to compute tables in parallel.
+	 * If nullptr (default), all work is done by the thread calling fill().
+	 * fill() may be called from one of WorkPerformer's threads, it
+	 * doesn't wait for other units to be started.
+	 */
+	void
+	set_work_performer (WorkPerformer*) noexcept;
+
+	/**
+	 * Fill the wavetable by sampling the wave.
+	 * \param	samples Number of samples in each table, at least 1024.
 	 */
 	void
 	fill (Wavetable* wavetable, unsigned int samples);
 
+	/**
+	 * Fill the wavetable from given spectrum of the wave.
+	 * Wave passed to the constructor is not used and may be nullptr.
+	 * \param	spectrum Spectrum for tables of at least 1024 samples.
+	 */
+	void
+	fill (Wavetable* wavetable, Spectrum const& spectrum);
+
+	/**
+	 * Sample the wave and return its spectrum.
+	 */
+	static Spectrum
+	wave_spectrum (Wave const& wave, unsigned int samples);
+
 	/**
 	 * Return the wave used to fill wavetables.
 	 */
@@ -73,6 +113,13 @@ class FFTFiller: public Wavetable::Filler
 	was_interrupted() const noexcept;
 
   private:
+	/**
+	 * Compute bandlimited tables from spectrum of the wave.
+	 * \param	max Max absolute value of the wave, for autoscaling.
+	 */
+	void
+	fill_from_spectrum (Wavetable* wavetable, Spectrum spectrum, Sample max);
+
 	/**
 	 * Return true if cancel predicate is set and returns true.
 	 * Also set _was_interrupted flag.
@@ -86,6 +133,7 @@ class FFTFiller: public Wavetable::Filler
 	Sample					_scale_epsilon;
 	std::function<bool()>	_cancel_predicate;
 	bool					_was_interrupted;
+	WorkPerformer*			_work_performer		= nullptr;
 };
 
 
@@ -96,6 +144,13 @@ FFTFiller::set_cancel_predicate (std::function<bool()> cancel_predicate) noexcep
 }
 
 
+inline void
+FFTFiller::set_work_performer (WorkPerformer* work_performer) noexcept
+{
+	_work_performer = work_performer;
+}
+
+
 inline Wave*
 FFTFiller::wave() const noexcept
 {
@@ -113,7 +168,7 @@ FFTFiller::was_interrupted() const noexcept
 inline bool
 FFTFiller::interrupted() noexcept
 {
-	return _was_interrupted = _cancel_predicate && _cancel_predicate();
+	return _was_interrupted = _was_interrupted || (_cancel_predicate && _cancel_predicate());
 }
 
 } // namespace DSP
@@ -39,7 +39,6 @@ template<unsigned int tOrder, int tResponseType>
 		static const unsigned int Order = tOrder;
 		static const int ResponseType = tResponseType;
 
-	  private:
 		typedef ImpulseResponse<Order, ResponseType> ImpulseResponseType;
 
 	  public:
@@ -63,6 +62,26 @@ template<unsigned int tOrder, int tResponseType>
 		void
 		assign_impulse_response (ImpulseResponseType* impulse_response) noexcept;
 
+		/**
+		 * Return assigned impulse response.
+		 */
+		ImpulseResponseType*
+		impulse_response() const noexcept;
+
+		/**
+		 * Access previous input samples, the most recent first.
+		 * Lets other processors (like BiquadBank) continue filtering
+		 * where this filter stopped and vice versa.
+		 */
+		Sample*
+		previous_inputs() noexcept;
+
+		/**
+		 * Access previous output samples, the most recent first.
+		 */
+		Sample*
+		previous_outputs() noexcept;
+
 		/**
 		 * Note: input and output sequences must be distinct!
 		 * InputIterator and OutputIterator must implement concept of RandomAccessIterator.
@@ -121,6 +140,30 @@ template<unsigned int O, int R>
 	}
 
 
+template<unsigned int O, int R>
+	inline typename Filter<O, R>::ImpulseResponseType*
+	Filter<O, R>::impulse_response() const noexcept
+	{
+		return _impulse_response;
+	}
+
+
+template<unsigned int O, int R>
+	inline Sample*
+	Filter<O, R>::previous_inputs() noexcept
+	{
+		return _px;
+	}
+
+
+template<unsigned int O, int R>
+	inline Sample*
+	Filter<O, R>::previous_outputs() noexcept
+	{
+		return _py;
+	}
+
+
 template<unsigned int O, int R>
 	template<class InputIterator, class OutputIterator>
 		inline void
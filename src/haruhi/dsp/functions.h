@@ -27,6 +27,11 @@
 #include <haruhi/utility/numeric.h>
 #include <haruhi/utility/fast_pow.h>
 
+// System:
+#ifdef HARUHI_SSE1
+#include <xmmintrin.h>
+#endif
+
 
 namespace Haruhi {
 
@@ -56,6 +61,34 @@ template<unsigned int series, class Sample>
 	}
 
 
+#ifdef HARUHI_SSE1
+/**
+ * Vectorized version of base_sin<5>(), computes four sines at once.
+ * Defined in [-1.0, 1.0].
+ */
+inline __m128
+vec4_base_sin_5 (__m128 x) noexcept
+{
+	__m128 const one = _mm_set_ps1 (1.0f);
+	__m128 const half = _mm_set_ps1 (0.5f);
+	// x > 0.5 => x = 1 - x; x < -0.5 => x = -1 - x:
+	__m128 const above = _mm_cmpgt_ps (x, half);
+	__m128 const below = _mm_cmplt_ps (x, _mm_sub_ps (_mm_setzero_ps(), half));
+	__m128 const edge = _mm_or_ps (above, below);
+	__m128 const mirror = _mm_or_ps (_mm_and_ps (above, one), _mm_andnot_ps (above, _mm_sub_ps (_mm_setzero_ps(), one)));
+	x = _mm_or_ps (_mm_and_ps (edge, _mm_sub_ps (mirror, x)), _mm_andnot_ps (edge, x));
+	x = _mm_mul_ps (x, _mm_set_ps1 (M_PI));
+	__m128 const xx = _mm_mul_ps (x, x);
+	__m128 r = _mm_set_ps1 (1.0f/362880.0f);
+	r = _mm_sub_ps (_mm_mul_ps (r, xx), _mm_set_ps1 (1.0f/5040.0f));
+	r = _mm_add_ps (_mm_mul_ps (r, xx), _mm_set_ps1 (1.0f/120.0f));
+	r = _mm_sub_ps (_mm_mul_ps (r, xx), _mm_set_ps1 (1.0f/6.0f));
+	r = _mm_add_ps (_mm_mul_ps (r, xx), one);
+	return _mm_mul_ps (x, r);
+}
+#endif
+
+
 namespace ParametricWaves {
 
 #define HARUHI_CLONABLE(klass)		\
@@ -17,6 +17,8 @@
 // Standard:
 #include <cstddef>
 #include <vector>
+#include <complex>
+#include <cmath>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -92,6 +94,19 @@ class HarmonicsWave: public Wave
 	Harmonics const&
 	harmonics() const noexcept;
 
+	/**
+	 * Computes spectrum of this wave directly from spectrum of the inner wave,
+	 * without sampling it: each harmonic is the inner spectrum scaled, shifted
+	 * in phase and stretched to multiples of harmonic's number. Frequencies
+	 * that don't fit in the spectrum are dropped, so the result doesn't alias.
+	 * \param	inner_spectrum is the forward FFT of the inner wave, bin k
+	 *			holding k-th harmonic.
+	 * \param	spectrum is filled with the result, same size as inner_spectrum.
+	 */
+	template<class Complex>
+		void
+		compute_spectrum (std::vector<Complex> const& inner_spectrum, std::vector<Complex>& spectrum) const;
+
   private:
 	Harmonics _harmonics;
 };
@@ -161,6 +176,30 @@ HarmonicsWave::harmonics() const noexcept
 	return _harmonics;
 }
 
+
+template<class Complex>
+	inline void
+	HarmonicsWave::compute_spectrum (std::vector<Complex> const& inner_spectrum, std::vector<Complex>& spectrum) const
+	{
+		std::size_t const n = inner_spectrum.size();
+		spectrum.assign (n, Complex (0.0f, 0.0f));
+
+		for (Harmonics::size_type h = 0; h < _harmonics.size(); ++h)
+		{
+			Harmonic const& harmonic = _harmonics[h];
+			if (harmonic.value == 0.0f)
+				continue;
+
+			// Phase offset of 0.5 * phase period shifts bin k by k * pi * phase radians.
+			// Rotation is accumulated in double precision to keep it accurate on high bins:
+			std::size_t const m = h + 1;
+			std::complex<double> const step = std::polar (1.0, M_PI * harmonic.phase);
+			std::complex<double> rotation = harmonic.value;
+			for (std::size_t k = 0; k * m < n; ++k, rotation *= step)
+				spectrum[k * m] += Complex (rotation * std::complex<double> (inner_spectrum[k]));
+		}
+	}
+
 } // namespace DSP
 
 } // namespace Haruhi
@@ -22,11 +22,56 @@ namespace Haruhi {
 
 namespace DSP {
 
+constexpr uint32_t Noise::Multiplier;
+constexpr uint32_t Noise::Multiplier_2;
+constexpr uint32_t Noise::Multiplier_3;
+constexpr uint32_t Noise::Multiplier_4;
+constexpr float Noise::Scale;
+
+
 Noise::State::State() noexcept
 {
 	w = ::rand() % (RAND_MAX - 10) + 9;
 }
 
+
+void
+Noise::fill (Sample* begin, Sample* end, State& s) const noexcept
+{
+	Sample* x = begin;
+
+#ifdef HARUHI_SSE2
+	if (end - x >= 4)
+	{
+		// Lanes hold four consecutive states of the generator.
+		// Advance each one by four steps at once:
+		__m128i const step = _mm_set1_epi32 (Multiplier_4);
+		__m128i w = vec4_mul (_mm_set1_epi32 (s.w), _mm_set_epi32 (Multiplier_4, Multiplier_3, Multiplier_2, Multiplier));
+		__m128i last = w;
+
+		for (; end - x >= 4; x += 4)
+		{
+			_mm_storeu_ps (x, vec4_sample (w));
+			last = w;
+			w = vec4_mul (w, step);
+		}
+
+		s.w = _mm_cvtsi128_si32 (_mm_shuffle_epi32 (last, _MM_SHUFFLE (3, 3, 3, 3)));
+	}
+#endif
+
+	for (; x != end; ++x)
+		*x = get (s);
+}
+
+
+Noise::State&
+Noise::state() noexcept
+{
+	static thread_local State state;
+	return state;
+}
+
 } // namespace DSP
 
 } // namespace Haruhi
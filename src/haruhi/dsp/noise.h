@@ -18,12 +18,14 @@
 #include <cstddef>
 #include <cstdlib>
 #include <stdint.h>
-#include <map>
 
 // Haruhi:
 #include <haruhi/config/all.h>
-#include <haruhi/utility/mutex.h>
-#include <haruhi/utility/thread.h>
+
+// System:
+#ifdef HARUHI_SSE2
+#include <emmintrin.h>
+#endif
 
 // Local:
 #include "wave.h"
@@ -33,6 +35,11 @@ namespace Haruhi {
 
 namespace DSP {
 
+/**
+ * White noise from multiplicative LCG w ← w · 16807 (mod 2³²).
+ * State is kept outside of the generator, so it can be used by many threads at once:
+ * either pass own State object to get()/fill() or use thread-local state().
+ */
 class Noise: public Wave
 {
   public:
@@ -44,11 +51,9 @@ class Noise: public Wave
 		State() noexcept;
 
 	  private:
-		int32_t w;
+		uint32_t w;
 	};
 
-	typedef std::map<Thread::ID, State> States;
-
   public:
 	Noise() noexcept;
 
@@ -59,25 +64,60 @@ class Noise: public Wave
 	operator() (Sample, Sample, std::size_t) const noexcept override;
 
 	/**
-	 * Faster getter of noise value (not polymorphic).
+	 * Return noise sample using state of calling thread.
+	 * Prefer get (State&) in loops, since access to thread-local
+	 * state isn't free.
 	 */
 	Sample
 	get() const noexcept;
 
 	/**
-	 * Faster equivalent of get().
+	 * Return noise sample.
 	 */
 	Sample
 	get (State& s) const noexcept;
 
+#ifdef HARUHI_SSE2
+	/**
+	 * Return next four noise samples, same as four calls to get (State&) would.
+	 */
+	__m128
+	vec4_get (State& s) const noexcept;
+#endif
+
+	/**
+	 * Fill buffer with noise. Gives the same sequence as calling get (State&)
+	 * for each sample, but generates four samples at once where possible.
+	 */
+	void
+	fill (Sample* begin, Sample* end, State& s) const noexcept;
+
 	/**
 	 * Returns reference to State object for calling thread.
 	 */
-	State&
+	static State&
 	state() noexcept;
 
   private:
-	States mutable _states;
+	static constexpr uint32_t	Multiplier		= 16807;
+	static constexpr uint32_t	Multiplier_2	= Multiplier * Multiplier;
+	static constexpr uint32_t	Multiplier_3	= Multiplier_2 * Multiplier;
+	static constexpr uint32_t	Multiplier_4	= Multiplier_3 * Multiplier;
+	static constexpr float		Scale			= 4.6566129e-010f;
+
+#ifdef HARUHI_SSE2
+	/**
+	 * Multiply 32-bit integers in each lane, modulo 2³².
+	 */
+	static __m128i
+	vec4_mul (__m128i a, __m128i b) noexcept;
+
+	/**
+	 * Convert states to samples in range [-1, 1].
+	 */
+	static __m128
+	vec4_sample (__m128i w) noexcept;
+#endif
 };
 
 
@@ -97,25 +137,47 @@ Noise::operator() (Sample, Sample, std::size_t) const noexcept
 inline Sample
 Noise::get() const noexcept
 {
-	return get (_states[Thread::id()]);
+	return get (state());
 }
 
 
 inline Sample
 Noise::get (State& s) const noexcept
 {
-	s.w *= 16807;
-	return s.w * 4.6566129e-010f;
+	s.w *= Multiplier;
+	return static_cast<int32_t> (s.w) * Scale;
 }
 
 
-inline Noise::State&
-Noise::state() noexcept
+#ifdef HARUHI_SSE2
+inline __m128
+Noise::vec4_get (State& s) const noexcept
 {
-	// Find or create state for current thread:
-	return _states[Thread::id()];
+	__m128i const w = vec4_mul (_mm_set1_epi32 (s.w), _mm_set_epi32 (Multiplier_4, Multiplier_3, Multiplier_2, Multiplier));
+	s.w = _mm_cvtsi128_si32 (_mm_shuffle_epi32 (w, _MM_SHUFFLE (3, 3, 3, 3)));
+	return vec4_sample (w);
 }
 
+
+inline __m128i
+Noise::vec4_mul (__m128i a, __m128i b) noexcept
+{
+	// SSE2 has no 32-bit multiplication, so multiply even and odd lanes separately
+	// as 64-bit numbers and take lower halves of the results:
+	__m128i const even = _mm_mul_epu32 (a, b);
+	__m128i const odd = _mm_mul_epu32 (_mm_srli_epi64 (a, 32), _mm_srli_epi64 (b, 32));
+	return _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (0, 0, 2, 0)),
+							   _mm_shuffle_epi32 (odd, _MM_SHUFFLE (0, 0, 2, 0)));
+}
+
+
+inline __m128
+Noise::vec4_sample (__m128i w) noexcept
+{
+	return _mm_mul_ps (_mm_cvtepi32_ps (w), _mm_set_ps1 (Scale));
+}
+#endif
+
 } // namespace DSP
 
 } // namespace Haruhi
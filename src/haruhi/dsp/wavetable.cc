@@ -13,6 +13,8 @@
 
 // Standard:
 #include <cstddef>
+#include <algorithm>
+#include <iterator>
 
 // Haruhi:
 #include <haruhi/dsp/functions.h>
@@ -25,10 +27,19 @@ namespace Haruhi {
 
 namespace DSP {
 
+constexpr std::size_t	Wavetable::PointSize;
+constexpr std::size_t	Wavetable::GuardPoints;
+constexpr int			Wavetable::BinBits;
+constexpr int			Wavetable::MinExponent;
+constexpr int			Wavetable::MaxExponent;
+constexpr std::size_t	Wavetable::Bins;
+
+
 Wavetable::WaveAdapter&
 Wavetable::WaveAdapter::operator= (WaveAdapter const& other)
 {
 	_wavetable = other._wavetable;
+	set_interpolation (other.interpolation());
 	return *this;
 }
 
@@ -36,14 +47,93 @@ Wavetable::WaveAdapter::operator= (WaveAdapter const& other)
 void
 Wavetable::add_table (std::vector<Sample>&& samples, float max_frequency)
 {
-	_tables[max_frequency] = std::move (samples);
+	assert (samples.size() == _size);
+
+	auto position = std::lower_bound (_max_frequencies.begin(), _max_frequencies.end(), max_frequency);
+	std::size_t level = std::distance (_max_frequencies.begin(), position);
+
+	if (position != _max_frequencies.end() && *position == max_frequency)
+		copy_table (level, samples);
+	else
+	{
+		_max_frequencies.insert (position, max_frequency);
+		_points.insert (_points.begin() + level * _stride, _stride, 0.0f);
+		copy_table (level, samples);
+	}
+
+	update_levels();
+}
+
+
+void
+Wavetable::set_tables (Tables&& tables)
+{
+	_max_frequencies.clear();
+	_points.resize (tables.size() * _stride);
+
+	// Map is sorted by frequency:
+	for (auto& t: tables)
+	{
+		assert (t.second.size() == _size);
+
+		copy_table (_max_frequencies.size(), t.second);
+		_max_frequencies.push_back (t.first);
+	}
+
+	tables.clear();
+	update_levels();
 }
 
 
 void
 Wavetable::drop_tables() noexcept
 {
-	_tables.clear();
+	_max_frequencies.clear();
+	_points.clear();
+}
+
+
+void
+Wavetable::set_wavetables_size (std::size_t size) noexcept
+{
+	if (size != _size)
+	{
+		drop_tables();
+		_size = size;
+		_stride = PointSize * (size + GuardPoints);
+	}
+}
+
+
+void
+Wavetable::copy_table (std::size_t level, std::vector<Sample> const& samples) noexcept
+{
+	Sample* const table = _points.data() + level * _stride;
+
+	for (std::size_t i = 0; i < _size + GuardPoints; ++i)
+	{
+		std::size_t const k = i % _size;
+		Sample* const point = table + PointSize * i;
+		point[0] = samples[k];
+		// Slope for cubic interpolation:
+		point[1] = 0.5f * (samples[(k + 1) % _size] - samples[(k + _size - 1) % _size]);
+	}
+}
+
+
+void
+Wavetable::update_levels() noexcept
+{
+	std::size_t const last = _max_frequencies.empty() ? 0 : _max_frequencies.size() - 1;
+
+	for (std::size_t bin = 0; bin < Bins; ++bin)
+	{
+		// Lowest frequency that falls into this bin (first bin also gets everything below):
+		float const mantissa = 1.0f + static_cast<float> (bin & ((1u << BinBits) - 1)) / (1u << BinBits);
+		float const bin_frequency = bin == 0 ? 0.0f : std::ldexp (mantissa, MinExponent + static_cast<int> (bin >> BinBits));
+		auto position = std::lower_bound (_max_frequencies.begin(), _max_frequencies.end(), bin_frequency);
+		_levels[bin] = std::min<std::size_t> (std::distance (_max_frequencies.begin(), position), last);
+	}
 }
 
 } // namespace DSP
@@ -16,21 +16,45 @@
 
 // Standard:
 #include <cstddef>
+#include <cstdint>
 #include <cmath>
 #include <vector>
+#include <array>
 #include <algorithm>
 #include <map>
 
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/dsp/wave.h>
+#include <haruhi/utility/atomic.h>
 #include <haruhi/utility/numeric.h>
 
+// System:
+#ifdef HARUHI_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef HARUHI_AVX2
+#include <immintrin.h>
+#endif
+
 
 namespace Haruhi {
 
 namespace DSP {
 
+/**
+ * Set of bandlimited tables of the same wave, each to be used
+ * up to a given frequency (mip-map levels).
+ *
+ * All tables are stored in one contiguous block. Each sample is stored
+ * together with precomputed slope of the wave at that point, so that
+ * cubic interpolation needs only one load per output sample. Each table
+ * is followed by a few guard points copied from its beginning, so that
+ * interpolation never has to wrap indexes. Level for a frequency is found
+ * in constant time: frequency's exponent and highest bits of mantissa
+ * index a precomputed array of levels, which is then corrected by at most
+ * a comparison or two.
+ */
 class Wavetable
 {
 	friend void
@@ -38,9 +62,16 @@ class Wavetable
 
   public:
 	// Maps frequency to array of samples. Frequency is max frequency for which
-	// given table can be used. Use lower_bound method to find correct table.
+	// given table can be used. Used by fillers to pass all tables at once.
 	typedef std::map<float, std::vector<Sample>> Tables;
 
+	enum Interpolation
+	{
+		Linear	= 0,
+		Hermite	= 1,	// 4-point cubic Hermite (Catmull-Rom)
+		Optimal	= 2,	// 4-point, 3rd order polynomial with least-squares error for signals oversampled 2x or more
+	};
+
 	/**
 	 * All filler classes (that is classes that fill wavetables with samples)
 	 * should inherit this class.
@@ -57,7 +88,7 @@ class Wavetable
 	{
 	  public:
 		// Ctor
-		WaveAdapter (Wavetable* wavetable) noexcept;
+		WaveAdapter (Wavetable* wavetable, Interpolation = Hermite) noexcept;
 
 		// Ctor
 		WaveAdapter (WaveAdapter const&) = default;
@@ -68,111 +99,422 @@ class Wavetable
 		Sample
 		operator() (Sample phase, Sample frequency, std::size_t sample) const noexcept override;
 
+		/**
+		 * Return adapted wavetable.
+		 */
+		Wavetable*
+		wavetable() const noexcept;
+
+		/**
+		 * Set interpolation used when accessing wavetable.
+		 * \threadsafe
+		 */
+		void
+		set_interpolation (Interpolation) noexcept;
+
+		/**
+		 * Return interpolation used when accessing wavetable.
+		 */
+		Interpolation
+		interpolation() const noexcept;
+
 	  private:
-		Wavetable* _wavetable;
+		Wavetable*				_wavetable;
+		// Changed by UI while render jobs read it:
+		Atomic<Interpolation>	_interpolation;
 	};
 
+  private:
+	// Each point is a sample and wave's slope at that sample:
+	static constexpr std::size_t	PointSize			= 2;
+	// Guard points stored after each table:
+	static constexpr std::size_t	GuardPoints			= 2;
+	// Frequencies are mapped to levels with 2^BinBits bins per octave,
+	// covering range [2^MinExponent, 2^MaxExponent):
+	static constexpr int			BinBits				= 3;
+	static constexpr int			MinExponent			= -24;
+	static constexpr int			MaxExponent			= 2;
+	static constexpr std::size_t	Bins				= (MaxExponent - MinExponent) << BinBits;
+
   public:
 	/**
 	 * Adds wavetable.
-	 * \param	table Array of samples. Wavetable takes ownership of the pointer.
+	 * \param	samples Array of samples, must have wavetables_size() samples.
 	 * \param	max_frequency Maximum frequency for which this array can be used.
 	 */
 	void
 	add_table (std::vector<Sample>&& samples, float max_frequency);
 
 	/**
-	 * Deletes previously allocated tables using delete operator.
+	 * Replaces all tables at once. Faster than adding tables one by one.
+	 * Each table must have wavetables_size() samples.
+	 */
+	void
+	set_tables (Tables&& tables);
+
+	/**
+	 * Deletes previously allocated tables.
 	 */
 	void
 	drop_tables() noexcept;
 
 	/**
 	 * Sets new number of samples in wavetables.
-	 * Must be called by filler.
+	 * Must be called by filler before adding tables.
+	 * Drops existing tables if size changes.
 	 */
 	void
 	set_wavetables_size (std::size_t size) noexcept;
 
+	/**
+	 * Return number of samples in each table.
+	 */
+	std::size_t
+	wavetables_size() const noexcept;
+
 	/**
 	 * Return true if wavetable has been computed and can be used.
 	 */
 	bool
 	computed() const noexcept;
 
+	/**
+	 * Return index of table to use for given frequency:
+	 * the table with the lowest max_frequency that is not lower than frequency,
+	 * or the last one if there's no such table.
+	 * Must be computed().
+	 */
+	std::size_t
+	level_for_frequency (float frequency) const noexcept;
+
 	/**
 	 * Before accessing samples, check if you can do that with computed().
 	 * There must be at least one table added and frequency must be between
 	 * 0 and 0.5. Otherwise behavior of this method is undefined.
 	 */
 	Sample
-	operator() (Sample phase, Sample frequency) const noexcept;
+	operator() (Sample phase, Sample frequency, Interpolation) const noexcept;
+
+	/**
+	 * Return sample from table at given level.
+	 * \param	phase Must be in range [0, 1].
+	 */
+	Sample
+	sample (std::size_t level, Sample phase, Interpolation) const noexcept;
+
+	/**
+	 * Interpolate between points (y0, m0) and (y1, m1), where m is the slope,
+	 * that is half the difference between neighbour samples.
+	 * \param	t Position between points, [0, 1].
+	 */
+	static Sample
+	interpolate (Interpolation, Sample t, Sample y0, Sample m0, Sample y1, Sample m1) noexcept;
+
+#ifdef HARUHI_SSE2
+	/**
+	 * Return offsets of tables to use for given four frequencies,
+	 * to be passed to the vectorized operator().
+	 */
+	__m128i
+	table_offsets (__m128 frequency) const noexcept;
+
+	/**
+	 * Vectorized version of operator(), returns four samples at once.
+	 * Phases must be in range [0, 1).
+	 */
+	__m128
+	operator() (__m128 phase, __m128 frequency, Interpolation) const noexcept;
+
+	/**
+	 * Return four samples from tables at given offsets
+	 * (obtained with table_offsets()).
+	 * Phases must be in range [0, 1].
+	 */
+	__m128
+	operator() (__m128 phase, __m128i table_offsets, Interpolation) const noexcept;
+
+	/**
+	 * Vectorized interpolate().
+	 */
+	static __m128
+	vec4_interpolate (Interpolation, __m128 t, __m128 y0, __m128 m0, __m128 y1, __m128 m1) noexcept;
+#endif
 
   private:
 	/**
-	 * Returns wavetable index to use for given frequency.
-	 * There must be at least one table in set.
+	 * Return pointer to the first point of table at given level.
+	 */
+	Sample const*
+	table (std::size_t level) const noexcept;
+
+	/**
+	 * Compute points of the table at given level from samples.
+	 */
+	void
+	copy_table (std::size_t level, std::vector<Sample> const& samples) noexcept;
+
+	/**
+	 * Recompute the frequency to level mapping.
+	 */
+	void
+	update_levels() noexcept;
+
+	/**
+	 * Return index into _levels for given frequency.
 	 */
-	std::vector<Sample> const&
-	table_for_frequency (float frequency) const noexcept;
+	static std::size_t
+	bin_for_frequency (float frequency) noexcept;
 
   private:
-	Tables			_tables;
+	// Max frequencies of tables, in ascending order:
+	std::vector<float>					_max_frequencies;
+	// Points of all tables, in the same order:
+	std::vector<Sample>					_points;
 	// Number of samples in each table:
-	std::size_t		_size = 0;
+	std::size_t							_size	= 0;
+	// Distance between consecutive tables in _points:
+	std::size_t							_stride	= PointSize * GuardPoints;
+	// Lowest level that can be used for frequencies in each bin:
+	std::array<std::uint16_t, Bins>		_levels	{ };
 
 	// NOTE: Remember about swap() when adding new fields!
 };
 
 
 inline
-Wavetable::WaveAdapter::WaveAdapter (Wavetable* wavetable) noexcept:
+Wavetable::WaveAdapter::WaveAdapter (Wavetable* wavetable, Interpolation interpolation) noexcept:
 	Wave (true),
-	_wavetable (wavetable)
+	_wavetable (wavetable),
+	_interpolation (interpolation)
 { }
 
 
 inline Sample
 Wavetable::WaveAdapter::operator() (Sample phase, Sample frequency, std::size_t) const noexcept
 {
-	return _wavetable->operator() (phase, frequency);
+	return _wavetable->operator() (phase, frequency, interpolation());
+}
+
+
+inline Wavetable*
+Wavetable::WaveAdapter::wavetable() const noexcept
+{
+	return _wavetable;
 }
 
 
 inline void
-Wavetable::set_wavetables_size (std::size_t size) noexcept
+Wavetable::WaveAdapter::set_interpolation (Interpolation interpolation) noexcept
 {
-	_size = size;
+	_interpolation.store (interpolation, std::memory_order_relaxed);
+}
+
+
+inline Wavetable::Interpolation
+Wavetable::WaveAdapter::interpolation() const noexcept
+{
+	return _interpolation.load (std::memory_order_relaxed);
+}
+
+
+inline std::size_t
+Wavetable::wavetables_size() const noexcept
+{
+	return _size;
 }
 
 
 inline bool
 Wavetable::computed() const noexcept
 {
-	return !_tables.empty();
+	return !_max_frequencies.empty();
+}
+
+
+inline std::size_t
+Wavetable::level_for_frequency (float frequency) const noexcept
+{
+	std::size_t level = _levels[bin_for_frequency (frequency)];
+	std::size_t const last = _max_frequencies.size() - 1;
+	// Bins are narrower than spacing between tables, so this
+	// usually takes at most one step:
+	while (level < last && _max_frequencies[level] < frequency)
+		++level;
+	return level;
+}
+
+
+inline Sample
+Wavetable::operator() (Sample phase, Sample frequency, Interpolation interpolation) const noexcept
+{
+	return sample (level_for_frequency (frequency), mod1 (phase), interpolation);
+}
+
+
+inline Sample
+Wavetable::sample (std::size_t level, Sample phase, Interpolation interpolation) const noexcept
+{
+	float const p = phase * _size;
+	int const k = static_cast<int> (p);
+	Sample const* const point = table (level) + PointSize * k;
+	return interpolate (interpolation, p - k, point[0], point[1], point[2], point[3]);
 }
 
 
 inline Sample
-Wavetable::operator() (Sample phase, Sample frequency) const noexcept
+Wavetable::interpolate (Interpolation interpolation, Sample t, Sample y0, Sample m0, Sample y1, Sample m1) noexcept
+{
+	switch (interpolation)
+	{
+		case Linear:
+			return y0 + t * (y1 - y0);
+
+		case Hermite:
+		{
+			Sample const d = y1 - y0;
+			Sample const c2 = 3.0f * d - 2.0f * m0 - m1;
+			Sample const c3 = m0 + m1 - 2.0f * d;
+			return ((c3 * t + c2) * t + m0) * t + y0;
+		}
+
+		case Optimal:
+		{
+			// Symmetric form as in Niemitalo's "Polynomial Interpolators for High-Quality
+			// Resampling of Oversampled Audio", coefficients fitted to be exact for DC
+			// and linear signals and to minimize error for frequencies up to 1/4 of
+			// sample rate. Outer samples are y[-1] = y1 - 2 m0, y[2] = y0 + 2 m1:
+			Sample const z = t - 0.5f;
+			Sample const even1 = y1 + y0;
+			Sample const odd1 = y1 - y0;
+			Sample const even2 = even1 + 2.0f * (m1 - m0);
+			Sample const odd2 = 2.0f * (m0 + m1) - odd1;
+			Sample const c0 = even1 * 0.5867830898f + even2 * -0.0867830898f;
+			Sample const c1 = odd1 * 1.154172051f + odd2 * -0.05139068375f;
+			Sample const c2 = even1 * -0.3499799724f + even2 * 0.3499799724f;
+			Sample const c3 = odd1 * -0.6185690033f + odd2 * 0.2061896678f;
+			return ((c3 * z + c2) * z + c1) * z + c0;
+		}
+	}
+
+	return y0;
+}
+
+
+#ifdef HARUHI_SSE2
+inline __m128i
+Wavetable::table_offsets (__m128 frequency) const noexcept
+{
+	alignas (16) float frequencies[4];
+	alignas (16) int32_t offsets[4];
+
+	_mm_store_ps (frequencies, frequency);
+	for (int i = 0; i < 4; ++i)
+		offsets[i] = level_for_frequency (frequencies[i]) * _stride;
+
+	return _mm_load_si128 (reinterpret_cast<__m128i const*> (offsets));
+}
+
+
+inline __m128
+Wavetable::operator() (__m128 phase, __m128 frequency, Interpolation interpolation) const noexcept
+{
+	return operator() (phase, table_offsets (frequency), interpolation);
+}
+
+
+inline __m128
+Wavetable::operator() (__m128 phase, __m128i table_offsets, Interpolation interpolation) const noexcept
+{
+	__m128 const p = _mm_mul_ps (phase, _mm_set_ps1 (_size));
+	__m128i const k = _mm_cvttps_epi32 (p);
+	__m128 const t = _mm_sub_ps (p, _mm_cvtepi32_ps (k));
+	// Point has two floats:
+	__m128i const indexes = _mm_add_epi32 (table_offsets, _mm_add_epi32 (k, k));
+	Sample const* const points = _points.data();
+
+# ifdef HARUHI_AVX2
+	if (interpolation == Linear)
+	{
+		__m128 const y0 = _mm_i32gather_ps (points, indexes, sizeof (Sample));
+		__m128 const y1 = _mm_i32gather_ps (points + PointSize, indexes, sizeof (Sample));
+		return _mm_add_ps (y0, _mm_mul_ps (t, _mm_sub_ps (y1, y0)));
+	}
+# endif
+
+	alignas (16) int32_t i[4];
+	_mm_store_si128 (reinterpret_cast<__m128i*> (i), indexes);
+	// Each load gets y0, m0, y1, m1 for one lane:
+	__m128 y0 = _mm_loadu_ps (points + i[0]);
+	__m128 m0 = _mm_loadu_ps (points + i[1]);
+	__m128 y1 = _mm_loadu_ps (points + i[2]);
+	__m128 m1 = _mm_loadu_ps (points + i[3]);
+	_MM_TRANSPOSE4_PS (y0, m0, y1, m1);
+
+	return vec4_interpolate (interpolation, t, y0, m0, y1, m1);
+}
+
+
+inline __m128
+Wavetable::vec4_interpolate (Interpolation interpolation, __m128 t, __m128 y0, __m128 m0, __m128 y1, __m128 m1) noexcept
+{
+	switch (interpolation)
+	{
+		case Linear:
+			return _mm_add_ps (y0, _mm_mul_ps (t, _mm_sub_ps (y1, y0)));
+
+		case Hermite:
+		{
+			__m128 const d = _mm_sub_ps (y1, y0);
+			__m128 const m01 = _mm_add_ps (m0, m1);
+			__m128 const c2 = _mm_sub_ps (_mm_mul_ps (_mm_set_ps1 (3.0f), d), _mm_add_ps (m01, m0));
+			__m128 const c3 = _mm_sub_ps (m01, _mm_add_ps (d, d));
+			__m128 r = _mm_add_ps (_mm_mul_ps (c3, t), c2);
+			r = _mm_add_ps (_mm_mul_ps (r, t), m0);
+			return _mm_add_ps (_mm_mul_ps (r, t), y0);
+		}
+
+		case Optimal:
+		{
+			__m128 const two = _mm_set_ps1 (2.0f);
+			__m128 const z = _mm_sub_ps (t, _mm_set_ps1 (0.5f));
+			__m128 const even1 = _mm_add_ps (y1, y0);
+			__m128 const odd1 = _mm_sub_ps (y1, y0);
+			__m128 const even2 = _mm_add_ps (even1, _mm_mul_ps (two, _mm_sub_ps (m1, m0)));
+			__m128 const odd2 = _mm_sub_ps (_mm_mul_ps (two, _mm_add_ps (m0, m1)), odd1);
+			__m128 const c0 = _mm_add_ps (_mm_mul_ps (even1, _mm_set_ps1 (0.5867830898f)), _mm_mul_ps (even2, _mm_set_ps1 (-0.0867830898f)));
+			__m128 const c1 = _mm_add_ps (_mm_mul_ps (odd1, _mm_set_ps1 (1.154172051f)), _mm_mul_ps (odd2, _mm_set_ps1 (-0.05139068375f)));
+			__m128 const c2 = _mm_add_ps (_mm_mul_ps (even1, _mm_set_ps1 (-0.3499799724f)), _mm_mul_ps (even2, _mm_set_ps1 (0.3499799724f)));
+			__m128 const c3 = _mm_add_ps (_mm_mul_ps (odd1, _mm_set_ps1 (-0.6185690033f)), _mm_mul_ps (odd2, _mm_set_ps1 (0.2061896678f)));
+			__m128 r = _mm_add_ps (_mm_mul_ps (c3, z), c2);
+			r = _mm_add_ps (_mm_mul_ps (r, z), c1);
+			return _mm_add_ps (_mm_mul_ps (r, z), c0);
+		}
+	}
+
+	return y0;
+}
+#endif
+
+
+inline Sample const*
+Wavetable::table (std::size_t level) const noexcept
 {
-	auto& table = table_for_frequency (frequency);
-	const float p = mod1 (phase) * _size;
-	const int k = static_cast<int> (p);
-	const Sample v1 = table[k];
-	const Sample v2 = table[(k + 1) % _size];
-	// Linear approximation:
-	return v1 + (p - k) * (v2 - v1);
+	return _points.data() + level * _stride;
 }
 
 
-inline std::vector<Sample> const&
-Wavetable::table_for_frequency (float frequency) const noexcept
+inline std::size_t
+Wavetable::bin_for_frequency (float frequency) noexcept
 {
-	Tables::const_iterator t = _tables.lower_bound (frequency);
-	if (t == _tables.end())
-		return _tables.rbegin()->second;
-	return t->second;
+	if (!(frequency > 0.0f))
+		return 0;
+
+	// Exponent and highest mantissa bits of IEEE-754 float give
+	// a logarithmic scale:
+	union { float f; uint32_t i; } u;
+	u.f = frequency;
+	std::intptr_t const bin = static_cast<std::intptr_t> (u.i >> (23 - BinBits)) - ((127 + MinExponent) << BinBits);
+	return clamped<std::intptr_t> (bin, 0, Bins - 1);
 }
 
 
@@ -187,8 +529,11 @@ Wavetable::table_for_frequency (float frequency) const noexcept
 inline void
 swap (Wavetable& w1, Wavetable& w2)
 {
-	std::swap (w1._tables, w2._tables);
+	std::swap (w1._max_frequencies, w2._max_frequencies);
+	std::swap (w1._points, w2._points);
 	std::swap (w1._size, w2._size);
+	std::swap (w1._stride, w2._stride);
+	std::swap (w1._levels, w2._levels);
 }
 
 } // namespace DSP
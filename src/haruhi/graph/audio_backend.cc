@@ -43,5 +43,19 @@ AudioBackend::set_master_volume (Sample volume) noexcept
 	_master_volume.store (volume);
 }
 
+
+bool
+AudioBackend::set_synchronous_round (Round)
+{
+	return false;
+}
+
+
+bool
+AudioBackend::synchronous() const
+{
+	return false;
+}
+
 } // namespace Haruhi
 
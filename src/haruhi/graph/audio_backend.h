@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <string>
 #include <map>
+#include <functional>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -40,6 +41,9 @@ class AudioBackend: public Backend
 	// Maps audio port to peak level of its audio data:
 	typedef std::map<AudioPort*, Sample> LevelsMap;
 
+	// Processing round (enter_processing_round() … leave_processing_round()):
+	typedef std::function<void()> Round;
+
   public:
 	AudioBackend (std::string const& title);
 
@@ -51,6 +55,29 @@ class AudioBackend: public Backend
 	virtual void
 	data_ready() = 0;
 
+	/**
+	 * Makes audio backend run given round directly from audio subsystem's
+	 * callback (synchronous mode). This removes one period of latency and
+	 * context switches between audio subsystem and engine thread. Buffers
+	 * of backend's ports are handed directly to audio subsystem, when possible.
+	 * Empty Round restores default mode.
+	 *
+	 * While rounds are run synchronously, data_ready() only idles.
+	 * \returns	false if synchronous mode is not supported.
+	 * 			Default implementation returns false.
+	 * \entry	Engine thread only.
+	 */
+	virtual bool
+	set_synchronous_round (Round);
+
+	/**
+	 * Returns true if rounds are currently run from audio subsystem's
+	 * callback, so that engine shouldn't run them itself.
+	 * \entry	Engine thread only.
+	 */
+	virtual bool
+	synchronous() const;
+
 	/**
 	 * Returns audio levels for output ports for UV-meters.
 	 * Audio levels are recomputed every time in data_ready().
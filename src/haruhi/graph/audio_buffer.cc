@@ -34,7 +34,8 @@ AudioBuffer::AudioBuffer (std::size_t samples):
 	// Allocate aligned memory for SIMD instructions:
 	_data (allocate (samples)),
 	_size (samples),
-	_end (_data + _size)
+	_end (_data + _size),
+	_own_data (_data)
 {
 	clear();
 }
@@ -42,18 +43,19 @@ AudioBuffer::AudioBuffer (std::size_t samples):
 
 AudioBuffer::~AudioBuffer() noexcept
 {
-	deallocate (_data);
+	deallocate (_own_data);
 }
 
 
 void
 AudioBuffer::resize (std::size_t samples)
 {
+	detach();
 	if (_size != samples)
 	{
-		deallocate (_data);
+		deallocate (_own_data);
 		_size = samples;
-		_data = allocate (_size);
+		_data = _own_data = allocate (_size);
 		_end = _data + _size;
 		clear();
 	}
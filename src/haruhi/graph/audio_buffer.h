@@ -17,6 +17,7 @@
 // Standard:
 #include <cstddef>
 #include <cstdlib>
+#include <cstdint>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -132,10 +133,25 @@ class AudioBuffer
 
 	/**
 	 * Resize buffer to given number of samples.
+	 * Detaches external memory, if attached.
 	 */
 	void
 	resize (std::size_t size);
 
+	/**
+	 * Use external memory (eg. provided by audio subsystem) instead of
+	 * own buffer, until detach() is called. Memory must hold size() samples
+	 * and be 16-byte aligned.
+	 */
+	void
+	attach (Sample* data) noexcept;
+
+	/**
+	 * Go back to using own memory.
+	 */
+	void
+	detach() noexcept;
+
 	/**
 	 * Return buffer size (in samples).
 	 */
@@ -182,6 +198,8 @@ class AudioBuffer
 	Sample*		_data;
 	std::size_t	_size;
 	Sample*		_end;
+	// Memory owned by the buffer (differs from _data when attached):
+	Sample*		_own_data;
 };
 
 
@@ -308,6 +326,23 @@ AudioBuffer::negate() noexcept
 }
 
 
+inline void
+AudioBuffer::attach (Sample* data) noexcept
+{
+	assert (reinterpret_cast<std::uintptr_t> (data) % 16 == 0);
+	_data = data;
+	_end = _data + _size;
+}
+
+
+inline void
+AudioBuffer::detach() noexcept
+{
+	_data = _own_data;
+	_end = _data + _size;
+}
+
+
 inline std::size_t
 AudioBuffer::size() const noexcept
 {
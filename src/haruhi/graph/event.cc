@@ -17,7 +17,6 @@
 
 // Haruhi:
 #include <haruhi/config/all.h>
-#include <haruhi/utility/pool_allocator.h>
 
 // Local:
 #include "event.h"
@@ -25,11 +24,6 @@
 
 namespace Haruhi {
 
-POOL_ALLOCATOR_FOR (Event)
-POOL_ALLOCATOR_FOR (ControllerEvent)
-POOL_ALLOCATOR_FOR (VoiceEvent)
-POOL_ALLOCATOR_FOR (VoiceControllerEvent)
-
 VoiceID VoiceEvent::_last_voice_id = 0;
 
 } // namespace Haruhi
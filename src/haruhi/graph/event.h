@@ -16,12 +16,13 @@
 
 // Standard:
 #include <cstddef>
+#include <cmath>
 #include <inttypes.h>
+#include <type_traits>
+#include <variant>
 
 // Haruhi:
 #include <haruhi/config/all.h>
-#include <haruhi/utility/pool_allocator.h>
-#include <haruhi/utility/memory.h>
 
 
 namespace Haruhi {
@@ -38,10 +39,15 @@ typedef int VoiceID;
 static constexpr int MaxKeyID = 127;
 
 
-class Event: public FastShared
+/**
+ * Base class for all events.
+ *
+ * Events are plain values, trivially copyable and without virtual methods,
+ * so that they can be stored inline in EventBuffers (see EventRecord)
+ * without any heap allocation or reference counting.
+ */
+class Event
 {
-	USES_POOL_ALLOCATOR (Event)
-
   public:
 	// Enum for descendant classes. For performance reasons
 	// no dynamic_casting is done, instead use `type() const`
@@ -53,74 +59,60 @@ class Event: public FastShared
 		VoiceControllerEventType,
 	};
 
-  public:
-	Event (EventType type, Time timestamp) noexcept;
-
   protected:
-	// Hide copy constructor from public:
-	Event (Event const& other) noexcept;
+	Event (EventType type, Time timestamp) noexcept;
 
 	void
 	set_event_type (EventType type) noexcept;
 
   public:
-	virtual ~Event() = default;
-
 	Time
 	timestamp() const noexcept;
 
-	bool
-	operator< (Event const& other) const noexcept;
-
-	virtual Event*
-	clone() const = 0;
+	/**
+	 * Return offset (in samples) of the event from the beginning
+	 * of current processing round.
+	 */
+	std::size_t
+	frame() const noexcept;
 
 	/**
-	 * Identifies descendant class.
+	 * Set frame offset. Should be set only by event's creator.
 	 */
-	EventType
-	event_type() const noexcept;
+	void
+	set_frame (std::size_t frame) noexcept;
 
-  public:
 	/**
-	 * Used for comparison two pointer to events
-	 * by their timestamp. It is Strict Weak Ordering function object.
+	 * Compares events by frame offsets and then by timestamps.
 	 */
-	static bool
-	strict_weak_ordering (Event const* first, Event const* second) noexcept;
+	bool
+	operator< (Event const& other) const noexcept;
 
 	/**
-	 * Same as strict_weak_ordering() but for Shared containers.
+	 * Identifies descendant class.
 	 */
-	static bool
-	shared_strict_weak_ordering (Shared<Event> const& first, Shared<Event> const& second) noexcept;
+	EventType
+	event_type() const noexcept;
 
   private:
-	Time		_timestamp;
-	EventType	_event_type;
+	// Time itself is not trivially copyable, so keep its internal value:
+	Time::ValueType	_timestamp;
+	std::size_t		_frame		= 0;
+	EventType		_event_type;
 };
 
 
 class ControllerEvent: public Event
 {
-	USES_POOL_ALLOCATOR (ControllerEvent)
-
   public:
 	typedef float Value;
 
   public:
 	ControllerEvent (Time timestamp, Value value) noexcept;
 
-  protected:
-	ControllerEvent (ControllerEvent const& other) noexcept;
-
-  public:
 	Value
 	value() const noexcept;
 
-	ControllerEvent*
-	clone() const override;
-
   private:
 	Value _value;
 };
@@ -128,8 +120,6 @@ class ControllerEvent: public Event
 
 class VoiceEvent: public Event
 {
-	USES_POOL_ALLOCATOR (VoiceEvent)
-
   public:
 	enum class Action {
 		Create,		// Create new voice.
@@ -139,10 +129,6 @@ class VoiceEvent: public Event
   public:
 	VoiceEvent (Time timestamp, KeyID key_id, VoiceID voice_id, Action action) noexcept;
 
-  protected:
-	VoiceEvent (VoiceEvent const& other) noexcept;
-
-  public:
 	KeyID
 	key_id() const noexcept;
 
@@ -152,9 +138,6 @@ class VoiceEvent: public Event
 	Action
 	action() const noexcept;
 
-	VoiceEvent*
-	clone() const override;
-
 	// TODO move to MIDI utilities
 	static Frequency
 	frequency_from_key_id (KeyID, Frequency master_tune) noexcept;
@@ -172,21 +155,12 @@ class VoiceEvent: public Event
 
 class VoiceControllerEvent: public ControllerEvent
 {
-	USES_POOL_ALLOCATOR (VoiceControllerEvent)
-
   public:
 	VoiceControllerEvent (Time timestamp, VoiceID voice_id, Value value) noexcept;
 
-  protected:
-	VoiceControllerEvent (VoiceControllerEvent const& other) noexcept;
-
-  public:
 	VoiceID
 	voice_id() const noexcept;
 
-	VoiceControllerEvent*
-	clone() const override;
-
 	/**
 	 * Interpret event value as frequency in Hertz.
 	 */
@@ -198,17 +172,48 @@ class VoiceControllerEvent: public ControllerEvent
 };
 
 
-inline
-Event::Event (EventType type, Time timestamp) noexcept:
-	_timestamp (timestamp),
-	_event_type (type)
-{ }
+/**
+ * Holds any kind of event by value. This is what EventBuffers store.
+ * Use as<SpecificEvent>() to access specific event.
+ */
+class EventRecord
+{
+  public:
+	template<class SpecificEvent>
+		EventRecord (SpecificEvent const& event) noexcept;
+
+	/**
+	 * Return reference to the base class of stored event.
+	 */
+	Event const&
+	event() const noexcept;
+
+	/**
+	 * Return pointer to stored event if it's of type SpecificEvent,
+	 * nullptr otherwise.
+	 */
+	template<class SpecificEvent>
+		SpecificEvent const*
+		as() const noexcept;
+
+	/**
+	 * Compares stored events.
+	 */
+	bool
+	operator< (EventRecord const& other) const noexcept;
+
+  private:
+	std::variant<ControllerEvent, VoiceEvent, VoiceControllerEvent> _event;
+};
+
+
+static_assert (std::is_trivially_copyable<EventRecord>::value, "EventRecord must be trivially copyable");
 
 
 inline
-Event::Event (Event const& other) noexcept:
-	_timestamp (other._timestamp),
-	_event_type (other._event_type)
+Event::Event (EventType type, Time timestamp) noexcept:
+	_timestamp (timestamp.internal()),
+	_event_type (type)
 { }
 
 
@@ -222,35 +227,37 @@ Event::set_event_type (EventType type) noexcept
 inline Time
 Event::timestamp() const noexcept
 {
-	return _timestamp;
+	return Time::from_internal (_timestamp);
 }
 
 
-inline bool
-Event::operator< (Event const& other) const noexcept
+inline std::size_t
+Event::frame() const noexcept
 {
-	return timestamp() < other.timestamp();
+	return _frame;
 }
 
 
-inline Event::EventType
-Event::event_type() const noexcept
+inline void
+Event::set_frame (std::size_t frame) noexcept
 {
-	return _event_type;
+	_frame = frame;
 }
 
 
 inline bool
-Event::strict_weak_ordering (Event const* first, Event const* second) noexcept
+Event::operator< (Event const& other) const noexcept
 {
-	return first->timestamp() < second->timestamp();
+	if (frame() != other.frame())
+		return frame() < other.frame();
+	return timestamp() < other.timestamp();
 }
 
 
-inline bool
-Event::shared_strict_weak_ordering (Shared<Event> const& first, Shared<Event> const& second) noexcept
+inline Event::EventType
+Event::event_type() const noexcept
 {
-	return first->timestamp() < second->timestamp();
+	return _event_type;
 }
 
 
@@ -261,13 +268,6 @@ ControllerEvent::ControllerEvent (Time timestamp, Value value) noexcept:
 { }
 
 
-inline
-ControllerEvent::ControllerEvent (ControllerEvent const& other) noexcept:
-	Event (other),
-	_value (other._value)
-{ }
-
-
 inline ControllerEvent::Value
 ControllerEvent::value() const noexcept
 {
@@ -275,13 +275,6 @@ ControllerEvent::value() const noexcept
 }
 
 
-inline ControllerEvent*
-ControllerEvent::clone() const
-{
-	return new ControllerEvent (*this);
-}
-
-
 inline
 VoiceEvent::VoiceEvent (Time timestamp, KeyID key_id, VoiceID voice_id, Action action) noexcept:
 	Event (VoiceEventType, timestamp),
@@ -294,15 +287,6 @@ VoiceEvent::VoiceEvent (Time timestamp, KeyID key_id, VoiceID voice_id, Action a
 }
 
 
-inline
-VoiceEvent::VoiceEvent (VoiceEvent const& other) noexcept:
-	Event (other),
-	_key_id (other._key_id),
-	_voice_id (other._voice_id),
-	_action (other._action)
-{ }
-
-
 inline KeyID
 VoiceEvent::key_id() const noexcept
 {
@@ -324,13 +308,6 @@ VoiceEvent::action() const noexcept
 }
 
 
-inline VoiceEvent*
-VoiceEvent::clone() const
-{
-	return new VoiceEvent (*this);
-}
-
-
 inline Frequency
 VoiceEvent::frequency_from_key_id (KeyID key_id, Frequency master_tune) noexcept
 {
@@ -354,13 +331,6 @@ VoiceControllerEvent::VoiceControllerEvent (Time timestamp, VoiceID voice_id, Va
 }
 
 
-inline
-VoiceControllerEvent::VoiceControllerEvent (VoiceControllerEvent const& other) noexcept:
-	ControllerEvent (other),
-	_voice_id (other._voice_id)
-{ }
-
-
 inline VoiceID
 VoiceControllerEvent::voice_id() const noexcept
 {
@@ -368,17 +338,44 @@ VoiceControllerEvent::voice_id() const noexcept
 }
 
 
-inline VoiceControllerEvent*
-VoiceControllerEvent::clone() const
+inline Frequency
+VoiceControllerEvent::frequency() const noexcept
+{
+	return 1_Hz * value();
+}
+
+
+template<class SpecificEvent>
+	inline
+	EventRecord::EventRecord (SpecificEvent const& event) noexcept:
+		_event (event)
+	{ }
+
+
+inline Event const&
+EventRecord::event() const noexcept
 {
-	return new VoiceControllerEvent (*this);
+	switch (_event.index())
+	{
+		case 0:		return *std::get_if<0> (&_event);
+		case 1:		return *std::get_if<1> (&_event);
+		default:	return *std::get_if<2> (&_event);
+	}
 }
 
 
-inline Frequency
-VoiceControllerEvent::frequency() const noexcept
+template<class SpecificEvent>
+	inline SpecificEvent const*
+	EventRecord::as() const noexcept
+	{
+		return std::get_if<SpecificEvent> (&_event);
+	}
+
+
+inline bool
+EventRecord::operator< (EventRecord const& other) const noexcept
 {
-	return 1_Hz * value();
+	return event() < other.event();
 }
 
 } // namespace Haruhi
@@ -12,9 +12,8 @@
  */
 
 // Standard:
-#include <iterator>
+#include <cstddef>
 #include <algorithm>
-#include <ext/algorithm>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -29,9 +28,26 @@ namespace Haruhi {
 POOL_ALLOCATOR_FOR (EventBuffer)
 
 
-EventBuffer::EventBuffer() noexcept:
-	_sorted (true)
+constexpr std::size_t EventBuffer::DefaultCapacity;
+
+
+EventBuffer::EventBuffer()
+{
+	_events.reserve (DefaultCapacity);
+}
+
+
+void
+EventBuffer::set_capacity (std::size_t capacity)
+{
+	_events.reserve (std::max (DefaultCapacity, capacity));
+}
+
+
+void
+EventBuffer::set_max_merge_sources (std::size_t sources_number)
 {
+	_merge_positions.reserve (sources_number);
 }
 
 
@@ -39,7 +55,88 @@ void
 EventBuffer::mixin (EventBuffer const* other)
 {
 	auto other_buffer = static_cast<EventBuffer const*> (other);
-	_events.insert (_events.end(), other_buffer->_events.begin(), other_buffer->_events.end());
+	Events const& other_events = other_buffer->_events;
+
+	if (other_events.empty())
+		return;
+
+	assert (other_buffer != this);
+
+	std::size_t const capacity = _events.capacity();
+	std::size_t i = _events.size();
+	std::size_t j = other_events.size();
+	std::size_t k = i + j;
+
+	// Merge from the back, so that no temporary storage is needed.
+	// On equal events, those from this buffer go first. The latest
+	// events that don't fit are dropped:
+	_events.resize (std::min (k, capacity), other_events.front());
+	while (j > 0)
+	{
+		EventRecord const& event = i > 0 && other_events[j - 1] < _events[i - 1]
+			? _events[--i]
+			: other_events[--j];
+
+		if (--k < capacity)
+			_events[k] = event;
+		else
+			++_dropped_events;
+	}
+
+	update_last_value();
+}
+
+
+void
+EventBuffer::merge (EventBuffer const* const* sources, std::size_t sources_number)
+{
+	_events.clear();
+
+	switch (sources_number)
+	{
+		case 0:
+			return;
+
+		// Most ports have at most one connection:
+		case 1:
+		{
+			Events const& events = sources[0]->_events;
+			std::size_t const n = std::min (events.size(), _events.capacity());
+			_events.assign (events.begin(), events.begin() + n);
+			_dropped_events += events.size() - n;
+			update_last_value();
+			return;
+		}
+	}
+
+	// Doesn't allocate, if set_max_merge_sources() was called:
+	_merge_positions.assign (sources_number, 0);
+
+	for (;;)
+	{
+		// Find source with the earliest pending event. On equal events
+		// prefer earlier source:
+		std::size_t best = sources_number;
+		for (std::size_t s = 0; s < sources_number; ++s)
+		{
+			Events const& events = sources[s]->_events;
+			std::size_t const p = _merge_positions[s];
+
+			if (p < events.size() && (best == sources_number || events[p] < sources[best]->_events[_merge_positions[best]]))
+				best = s;
+		}
+
+		if (best == sources_number)
+			break;
+
+		EventRecord const& event = sources[best]->_events[_merge_positions[best]++];
+		if (_events.size() < _events.capacity())
+			_events.push_back (event);
+		else
+			++_dropped_events;
+	}
+
+	update_last_value();
 }
 
 } // namespace Haruhi
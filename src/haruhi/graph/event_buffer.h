@@ -16,12 +16,12 @@
 
 // Standard:
 #include <cstddef>
-#include <set>
-#include <list>
+#include <vector>
+#include <algorithm>
+#include <optional>
 
 // Haruhi:
 #include <haruhi/config/all.h>
-#include <haruhi/utility/memory.h>
 #include <haruhi/utility/pool_allocator.h>
 
 // Local:
@@ -30,19 +30,51 @@
 
 namespace Haruhi {
 
+/**
+ * Holds events for one processing round. Events are stored by value
+ * in preallocated storage and are always kept sorted by their frames
+ * and timestamps, so that mixing buffers is a simple merge.
+ *
+ * Storage never grows during processing round. Events that don't fit
+ * are dropped and counted in dropped_events().
+ */
 class EventBuffer
 {
 	USES_POOL_ALLOCATOR (EventBuffer)
 
   public:
-	typedef std::vector<Shared<Event>> Events;
+	typedef std::vector<EventRecord> Events;
+
+	// Minimum number of events the buffer can hold:
+	static constexpr std::size_t DefaultCapacity = 32;
 
   public:
-	EventBuffer() noexcept;
+	EventBuffer();
 
 	void
 	clear() noexcept;
 
+	/**
+	 * Make room for given number of events.
+	 * Allocates, so must not be called during processing round.
+	 */
+	void
+	set_capacity (std::size_t capacity);
+
+	/**
+	 * Prepare merge() for given number of sources.
+	 * Allocates, so must not be called during processing round.
+	 */
+	void
+	set_max_merge_sources (std::size_t sources_number);
+
+	/**
+	 * Return number of events dropped so far, because
+	 * they didn't fit in the buffer.
+	 */
+	std::size_t
+	dropped_events() const noexcept;
+
 	/**
 	 * Mixes in other buffer into this one.
 	 * Other buffer must be static_castable to EventBuffer.
@@ -50,15 +82,27 @@ class EventBuffer
 	void
 	mixin (EventBuffer const*);
 
+	/**
+	 * Replaces contents of this buffer with events
+	 * from given buffers (k-way merge).
+	 * \param	sources Array of buffers to merge. Must not contain this buffer.
+	 * \param	sources_number Size of the array.
+	 */
 	void
-	push (Shared<Event> const& event);
+	merge (EventBuffer const* const* sources, std::size_t sources_number);
 
 	/**
-	 * May resort events.
+	 * Adds event to the buffer. Events should be pushed
+	 * in order of their frames, otherwise they need to be
+	 * moved to keep the buffer sorted. If buffer is full,
+	 * event is dropped.
 	 */
-	Events&
-	events() noexcept;
+	void
+	push (EventRecord const& event);
 
+	/**
+	 * Return events sorted by their frames and timestamps.
+	 */
 	Events const&
 	events() const noexcept;
 
@@ -68,13 +112,27 @@ class EventBuffer
 	bool
 	empty() const noexcept;
 
+	/**
+	 * Return value of the last ControllerEvent that went through
+	 * the buffer, also in previous processing rounds.
+	 * Empty if there was none.
+	 */
+	std::optional<ControllerEvent::Value> const&
+	last_value() const noexcept;
+
   private:
+	/**
+	 * Updates _last_value from the last ControllerEvent in the buffer.
+	 */
 	void
-	ensure_sorted() const noexcept;
+	update_last_value() noexcept;
 
   private:
-	mutable bool	_sorted;
-	mutable Events	_events;
+	Events									_events;
+	std::optional<ControllerEvent::Value>	_last_value;
+	// Positions in source buffers, used by merge():
+	std::vector<std::size_t>				_merge_positions;
+	std::size_t								_dropped_events		= 0;
 };
 
 
@@ -85,26 +143,35 @@ EventBuffer::clear() noexcept
 }
 
 
-inline void
-EventBuffer::push (Shared<Event> const& event)
+inline std::size_t
+EventBuffer::dropped_events() const noexcept
 {
-	_sorted = false;
-	_events.push_back (event);
+	return _dropped_events;
 }
 
 
-inline EventBuffer::Events&
-EventBuffer::events() noexcept
+inline void
+EventBuffer::push (EventRecord const& event)
 {
-	ensure_sorted();
-	return _events;
+	if (_events.size() == _events.capacity())
+	{
+		++_dropped_events;
+		return;
+	}
+
+	if (_events.empty() || !(event < _events.back()))
+		_events.push_back (event);
+	else
+		_events.insert (std::upper_bound (_events.begin(), _events.end(), event), event);
+
+	if (event.as<ControllerEvent>())
+		update_last_value();
 }
 
 
 inline EventBuffer::Events const&
 EventBuffer::events() const noexcept
 {
-	ensure_sorted();
 	return _events;
 }
 
@@ -116,13 +183,23 @@ EventBuffer::empty() const noexcept
 }
 
 
+inline std::optional<ControllerEvent::Value> const&
+EventBuffer::last_value() const noexcept
+{
+	return _last_value;
+}
+
+
 inline void
-EventBuffer::ensure_sorted() const noexcept
+EventBuffer::update_last_value() noexcept
 {
-	if (!_sorted)
+	for (auto r = _events.rbegin(); r != _events.rend(); ++r)
 	{
-		std::sort (_events.begin(), _events.end(), Event::shared_strict_weak_ordering);
-		_sorted = true;
+		if (auto controller_event = r->as<ControllerEvent>())
+		{
+			_last_value = controller_event->value();
+			break;
+		}
 	}
 }
 
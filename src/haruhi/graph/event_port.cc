@@ -34,6 +34,9 @@ EventPort::EventPort (Unit* unit, std::string const& name, Port::Direction direc
 	if (g)
 		g->lock();
 	register_me();
+	// Resize buffer:
+	if (graph())
+		graph_updated();
 	if (g)
 		g->unlock();
 }
@@ -50,6 +53,13 @@ EventPort::~EventPort()
 }
 
 
+void
+EventPort::graph_updated()
+{
+	buffer()->set_capacity (graph()->buffer_size());
+}
+
+
 void
 EventPort::clear_buffer()
 {
@@ -65,11 +75,25 @@ EventPort::mixin (Port* other)
 }
 
 
+bool
+EventPort::push_change (ControllerEvent::Value value)
+{
+	auto const& last_value = buffer()->last_value();
+
+	if (last_value && *last_value == value)
+		return false;
+
+	buffer()->push (ControllerEvent (Time::now(), value));
+	return true;
+}
+
+
 void
 EventPort::no_input()
 {
+	// Consumers will see the default value once, not every round:
 	if (_default_value_set)
-		buffer()->push (new ControllerEvent (Time::now(), _default_value));
+		push_change (_default_value);
 }
 
 } // namespace Haruhi
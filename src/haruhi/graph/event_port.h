@@ -62,7 +62,8 @@ class EventPort: public Port
 
 	/**
 	 * Set default ControllerEvent that will be inserted into buffer,
-	 * when nothing is connected to the Input port.
+	 * when nothing is connected to the Input port. The event is inserted
+	 * only when current value of the port is different than the default.
 	 */
 	void
 	set_default_value (ControllerEvent::Value value) noexcept;
@@ -73,6 +74,22 @@ class EventPort: public Port
 	void
 	disable_default_value() noexcept;
 
+	/**
+	 * Return current value of the port, that is value of the last
+	 * ControllerEvent that went through the port (also in previous
+	 * processing rounds), or default value if there was none.
+	 */
+	ControllerEvent::Value
+	value() const noexcept;
+
+	/**
+	 * Push ControllerEvent with given value into the buffer,
+	 * unless current value of the port is already equal to it.
+	 * \returns	true if event has been pushed.
+	 */
+	bool
+	push_change (ControllerEvent::Value value);
+
 	/*
 	 * Port implementation
 	 */
@@ -83,8 +100,11 @@ class EventPort: public Port
 	void
 	mixin (Port*) override;
 
+	/**
+	 * Makes room in the buffer for one event per sample.
+	 */
 	void
-	graph_updated() override { }
+	graph_updated() override;
 
   protected:
 	void
@@ -125,6 +145,13 @@ EventPort::disable_default_value() noexcept
 	_default_value_set = false;
 }
 
+
+inline ControllerEvent::Value
+EventPort::value() const noexcept
+{
+	return buffer()->last_value().value_or (_default_value);
+}
+
 } // namespace Haruhi
 
 #endif
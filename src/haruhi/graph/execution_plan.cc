@@ -0,0 +1,432 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <utility>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/thread.h>
+
+// Local:
+#include "execution_plan.h"
+#include "audio_port.h"
+#include "event_buffer.h"
+#include "event_port.h"
+#include "unit.h"
+
+
+namespace Haruhi {
+
+constexpr std::size_t ExecutionPlan::NotPlanned;
+constexpr char ExecutionPlan::UnitProcessSpan[];
+constexpr unsigned int ExecutionPlan::SpinsBeforeParking;
+
+thread_local ExecutionPlan::ProcessingStep const* ExecutionPlan::_processing_step = nullptr;
+
+
+ExecutionPlan::StepWorkUnit::StepWorkUnit (ExecutionPlan* plan, std::size_t step_index) noexcept:
+	_plan (plan),
+	_step_index (step_index),
+	_pending (0),
+	_processed (false)
+{ }
+
+
+void
+ExecutionPlan::StepWorkUnit::execute()
+{
+	// If the step has been taken by another thread, that thread
+	// will also queue its successors:
+	_plan->execute (_step_index);
+}
+
+
+void
+ExecutionPlan::compile (Units const& units, Unit* first_unit)
+{
+	clear();
+
+	Units visited;
+
+	if (first_unit && units.find (first_unit) != units.end())
+		add_unit (first_unit, units, visited);
+	for (Unit* u: units)
+		add_unit (u, units, visited);
+
+	_event_sources.resize (_event_mixes.size());
+	compile_dependencies();
+}
+
+
+void
+ExecutionPlan::set_work_performer (WorkPerformer* work_performer)
+{
+	_work_performer = work_performer;
+}
+
+
+void
+ExecutionPlan::clear()
+{
+	_steps.clear();
+	_audio_inputs.clear();
+	_event_inputs.clear();
+	_audio_mixes.clear();
+	_event_mixes.clear();
+	_event_sources.clear();
+	_successors.clear();
+	_reachable.clear();
+	_reachable_words = 0;
+	_work_units.clear();
+	_cursor = 0;
+}
+
+
+void
+ExecutionPlan::reset()
+{
+	for (Step& s: _steps)
+		s.unit->_synced.store (false, std::memory_order_relaxed);
+	_cursor = 0;
+}
+
+
+void
+ExecutionPlan::add_unit (Unit* unit, Units const& units, Units& visited)
+{
+	if (!visited.insert (unit).second)
+		return;
+
+	// Sources first. Units already visited but not yet added
+	// close a cycle and will be processed after this one:
+	for (Port* input: unit->inputs())
+		for (Port* source: input->back_connections())
+			if (units.find (source->unit()) != units.end())
+				add_unit (source->unit(), units, visited);
+
+	Step step;
+	step.unit = unit;
+	step.audio_inputs_begin = _audio_inputs.size();
+	step.event_inputs_begin = _event_inputs.size();
+
+	for (Port* input: unit->inputs())
+	{
+		if (auto audio_input = dynamic_cast<AudioPort*> (input))
+		{
+			AudioInput ai;
+			ai.buffer = audio_input->buffer();
+			ai.mixes_begin = _audio_mixes.size();
+			for (Port* source: input->back_connections())
+				if (auto audio_source = dynamic_cast<AudioPort*> (source))
+					if (units.find (source->unit()) != units.end())
+						_audio_mixes.push_back ({ source->unit(), audio_source->buffer() });
+			ai.mixes_end = _audio_mixes.size();
+			_audio_inputs.push_back (ai);
+		}
+		else if (auto event_input = dynamic_cast<EventPort*> (input))
+		{
+			EventInput ei;
+			ei.port = event_input;
+			ei.buffer = event_input->buffer();
+			ei.mixes_begin = _event_mixes.size();
+			for (Port* source: input->back_connections())
+				if (auto event_source = dynamic_cast<EventPort*> (source))
+					if (units.find (source->unit()) != units.end())
+						_event_mixes.push_back ({ source->unit(), event_source->buffer() });
+			ei.mixes_end = _event_mixes.size();
+			ei.buffer->set_max_merge_sources (ei.mixes_end - ei.mixes_begin);
+			_event_inputs.push_back (ei);
+		}
+	}
+
+	step.audio_inputs_end = _audio_inputs.size();
+	step.event_inputs_end = _event_inputs.size();
+	step.successors_begin = 0;
+	step.successors_end = 0;
+	step.dependencies = 0;
+
+	unit->_execution_plan_index = _steps.size();
+	_steps.push_back (step);
+}
+
+
+void
+ExecutionPlan::compile_dependencies()
+{
+	// Edges (earlier step, later step), without duplicates:
+	std::set<std::pair<std::size_t, std::size_t>> edges;
+
+	auto add_edge = [&] (std::size_t target, Unit const* source_unit) {
+		std::size_t source = source_unit->_execution_plan_index;
+		if (source < target)
+			edges.insert ({ source, target });
+		else if (target < source && source != NotPlanned)
+			edges.insert ({ target, source });
+	};
+
+	for (std::size_t i = 0; i < _steps.size(); ++i)
+	{
+		Step const& step = _steps[i];
+		for (std::size_t a = step.audio_inputs_begin; a < step.audio_inputs_end; ++a)
+			for (std::size_t m = _audio_inputs[a].mixes_begin; m < _audio_inputs[a].mixes_end; ++m)
+				add_edge (i, _audio_mixes[m].source_unit);
+		for (std::size_t e = step.event_inputs_begin; e < step.event_inputs_end; ++e)
+			for (std::size_t m = _event_inputs[e].mixes_begin; m < _event_inputs[e].mixes_end; ++m)
+				add_edge (i, _event_mixes[m].source_unit);
+	}
+
+	// Edges are sorted by the first step, so successors
+	// of each step form a continuous range:
+	auto edge = edges.begin();
+	for (std::size_t i = 0; i < _steps.size(); ++i)
+	{
+		Step& step = _steps[i];
+		step.successors_begin = _successors.size();
+		for (; edge != edges.end() && edge->first == i; ++edge)
+		{
+			_successors.push_back (edge->second);
+			_steps[edge->second].dependencies += 1;
+		}
+		step.successors_end = _successors.size();
+	}
+
+	// Successors always come later in the plan, so reachability
+	// can be computed in one pass from the last step:
+	_reachable_words = (_steps.size() + 63) / 64;
+	_reachable.assign (_steps.size() * _reachable_words, 0);
+	for (std::size_t i = _steps.size(); i-- > 0; )
+	{
+		uint64_t* reachable = &_reachable[i * _reachable_words];
+		for (std::size_t k = _steps[i].successors_begin; k < _steps[i].successors_end; ++k)
+		{
+			std::size_t const successor = _successors[k];
+			uint64_t const* successor_reachable = &_reachable[successor * _reachable_words];
+			for (std::size_t w = 0; w < _reachable_words; ++w)
+				reachable[w] |= successor_reachable[w];
+			reachable[successor / 64] |= uint64_t (1) << (successor % 64);
+		}
+	}
+
+	for (std::size_t i = 0; i < _steps.size(); ++i)
+		_work_units.push_back (std::make_unique<StepWorkUnit> (this, i));
+}
+
+
+bool
+ExecutionPlan::execute (std::size_t index)
+{
+	Step const& step = _steps[index];
+	Unit* unit = step.unit;
+
+	// Claim the unit, so that it's processed once even if
+	// another thread tries to sync it at the same time:
+	if (unit->_synced.exchange (true, std::memory_order_acq_rel))
+		return false;
+
+	if (unit->_enabled)
+	{
+		ProcessingStep const processing_step { this, index, _processing_step };
+		_processing_step = &processing_step;
+
+		// Disabled source units are skipped, their output is treated as silence:
+		for (std::size_t i = step.audio_inputs_begin; i < step.audio_inputs_end; ++i)
+		{
+			AudioInput const& input = _audio_inputs[i];
+			input.buffer->clear();
+			for (std::size_t m = input.mixes_begin; m < input.mixes_end; ++m)
+				if (_audio_mixes[m].source_unit->_enabled)
+					input.buffer->mixin (_audio_mixes[m].source_buffer);
+		}
+
+		for (std::size_t i = step.event_inputs_begin; i < step.event_inputs_end; ++i)
+		{
+			EventInput const& input = _event_inputs[i];
+			if (input.mixes_begin == input.mixes_end)
+			{
+				input.buffer->clear();
+				input.port->no_input();
+			}
+			else
+			{
+				// Each input has its own range in _event_sources, so this
+				// is safe to do from concurrently executed steps:
+				EventBuffer const** sources = &_event_sources[input.mixes_begin];
+				std::size_t sources_number = 0;
+				for (std::size_t m = input.mixes_begin; m < input.mixes_end; ++m)
+					if (_event_mixes[m].source_unit->_enabled)
+						sources[sources_number++] = _event_mixes[m].source_buffer;
+				input.buffer->merge (sources, sources_number);
+			}
+		}
+
+		{
+			Trace::Span span (UnitProcessSpan, unit->id());
+			CPUStats::Measurement measurement (unit->_cpu_stats);
+			unit->process();
+		}
+
+		_processing_step = processing_step.previous;
+	}
+
+	if (_work_performer)
+	{
+		_work_units[index]->_processed.store (true, std::memory_order_release);
+
+		for (std::size_t i = step.successors_begin; i < step.successors_end; ++i)
+		{
+			StepWorkUnit* successor = _work_units[_successors[i]].get();
+			if (successor->_pending.fetch_sub (1, std::memory_order_acq_rel) == 1)
+				_work_performer->add (successor);
+		}
+
+		_processed_steps.fetch_add (1, std::memory_order_release);
+		wake_sleepers();
+	}
+
+	return true;
+}
+
+
+void
+ExecutionPlan::execute_parallel()
+{
+	// Called again from within a unit being processed,
+	// or after the plan has been executed in this round:
+	if (_parallel_running.load() || _cursor >= _steps.size())
+		return;
+
+	_parallel_running.store (true);
+	_processed_steps.store (0);
+
+	for (auto& w: _work_units)
+	{
+		w->_pending.store (_steps[w->_step_index].dependencies);
+		w->_processed.store (false);
+	}
+	for (auto& w: _work_units)
+		if (_steps[w->_step_index].dependencies == 0)
+			_work_performer->add (w.get());
+
+	// Process ready steps in this thread too, instead of only waiting for workers.
+	// Steps are taken with Unit::_synced, so the work units queued for steps
+	// processed here will find them taken and return immediately:
+	std::size_t first = 0;
+	wait_until ([&] { return _processed_steps.load (std::memory_order_acquire) == _steps.size(); }, first);
+
+	// Work units may be reused only after they're done:
+	for (auto& w: _work_units)
+		w->wait();
+
+	_cursor = _steps.size();
+	_parallel_running.store (false);
+}
+
+
+bool
+ExecutionPlan::execute_ready_step (std::size_t& first)
+{
+	for (; first < _steps.size() && _work_units[first]->_processed.load (std::memory_order_acquire); ++first)
+		continue;
+
+	for (std::size_t i = first; i < _steps.size(); ++i)
+		if (!_steps[i].unit->_synced.load (std::memory_order_relaxed) &&
+			_work_units[i]->_pending.load (std::memory_order_acquire) == 0 &&
+			execute (i))
+		{
+			return true;
+		}
+
+	return false;
+}
+
+
+void
+ExecutionPlan::wait_for_step (std::size_t index)
+{
+	StepWorkUnit const& work_unit = *_work_units[index];
+
+	if (work_unit._processed.load (std::memory_order_acquire))
+		return;
+
+	for (ProcessingStep const* p = _processing_step; p; p = p->previous)
+	{
+		if (p->plan != this)
+			continue;
+		// Unit syncing itself, or one of units that are being processed
+		// by this thread. Serial execution would also return here:
+		if (p->index == index)
+			return;
+		// Requested step waits for the one this thread is processing, so waiting for it
+		// would never end. Serial execution would process it with incomplete inputs,
+		// here it's left for its turn:
+		if (depends_on (index, p->index))
+			return;
+	}
+
+	// Other steps this thread processes while waiting can't wait for ones above
+	// in the list for the same reason, so this doesn't deadlock:
+	std::size_t first = 0;
+	wait_until ([&] { return work_unit._processed.load (std::memory_order_acquire); }, first);
+}
+
+
+template<class Predicate>
+	void
+	ExecutionPlan::wait_until (Predicate done, std::size_t& first)
+	{
+		unsigned int spins = 0;
+
+		while (!done())
+		{
+			if (execute_ready_step (first))
+				spins = 0;
+			else if (++spins < SpinsBeforeParking)
+				Thread::spin_pause();
+			else
+			{
+				spins = 0;
+				// Either this thread sees done() or a step that has just become
+				// ready, or the thread that processed the step sees this one
+				// in _sleepers:
+				_sleepers.fetch_add (1);
+				std::atomic_thread_fence (std::memory_order_seq_cst);
+				if (!done() && !execute_ready_step (first))
+					_progress.wait();
+				else
+				{
+					// Withdraw, unless another thread has already
+					// counted this one in and is going to post:
+					unsigned int sleepers = _sleepers.load();
+					while (sleepers > 0 && !_sleepers.compare_exchange_weak (sleepers, sleepers - 1))
+						continue;
+					if (sleepers == 0)
+						_progress.wait();
+				}
+			}
+		}
+	}
+
+
+void
+ExecutionPlan::wake_sleepers() noexcept
+{
+	std::atomic_thread_fence (std::memory_order_seq_cst);
+	if (_sleepers.load (std::memory_order_relaxed) > 0)
+		for (unsigned int n = _sleepers.exchange (0); n > 0; --n)
+			_progress.post();
+}
+
+} // namespace Haruhi
+
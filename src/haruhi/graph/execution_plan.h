@@ -0,0 +1,358 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__GRAPH__EXECUTION_PLAN_H__INCLUDED
+#define HARUHI__GRAPH__EXECUTION_PLAN_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <limits>
+#include <set>
+#include <vector>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/noncopyable.h>
+#include <haruhi/utility/semaphore.h>
+#include <haruhi/utility/trace.h>
+#include <haruhi/utility/work_performer.h>
+
+
+namespace Haruhi {
+
+class Unit;
+class Port;
+class AudioPort;
+class AudioBuffer;
+class EventBuffer;
+
+/**
+ * Flat, topologically sorted list of Units to process in a round,
+ * compiled from the Graph's connections.
+ *
+ * Each step knows in advance which buffers must be cleared and mixed
+ * into its unit's input ports, so processing a round doesn't need
+ * recursive Port::sync() calls nor dynamic_casts on port types.
+ * Units are ordered so that sources come before their consumers;
+ * on cycles the unit that closes the cycle sees previous round's data,
+ * as it was with on-demand syncing.
+ *
+ * If WorkPerformer is set, steps are run on its threads and on the thread
+ * that requested processing as soon as all units they depend on are
+ * processed, so units without data dependencies between them are
+ * processed concurrently.
+ *
+ * Plan must be recompiled whenever Units, Ports or connections
+ * change. Graph takes care of that.
+ *
+ * Not thread-safe. Graph must be locked when using plan.
+ */
+class ExecutionPlan: private Noncopyable
+{
+  public:
+	typedef std::set<Unit*> Units;
+
+	// Index of unit that is not part of the plan:
+	static constexpr std::size_t NotPlanned = std::numeric_limits<std::size_t>::max();
+
+	// Name of trace spans of Unit::process(). Span argument is unit ID:
+	static constexpr char UnitProcessSpan[] = "Unit::process";
+
+  private:
+	// Number of unsuccessful attempts to find a ready step, after which
+	// a waiting thread goes to sleep until another step is processed:
+	static constexpr unsigned int SpinsBeforeParking = 1000;
+
+  private:
+	struct AudioMix
+	{
+		Unit const*			source_unit;
+		AudioBuffer const*	source_buffer;
+	};
+
+	struct EventMix
+	{
+		Unit const*			source_unit;
+		EventBuffer const*	source_buffer;
+	};
+
+	struct AudioInput
+	{
+		AudioBuffer*		buffer;
+		std::size_t			mixes_begin;
+		std::size_t			mixes_end;
+	};
+
+	struct EventInput
+	{
+		Port*				port;
+		EventBuffer*		buffer;
+		std::size_t			mixes_begin;
+		std::size_t			mixes_end;
+	};
+
+	struct Step
+	{
+		Unit*				unit;
+		std::size_t			audio_inputs_begin;
+		std::size_t			audio_inputs_end;
+		std::size_t			event_inputs_begin;
+		std::size_t			event_inputs_end;
+		// Steps that must wait for this one (indexes into _successors):
+		std::size_t			successors_begin;
+		std::size_t			successors_end;
+		// Number of steps this one must wait for:
+		unsigned int		dependencies;
+	};
+
+	/**
+	 * Step being processed by current thread. Steps processed
+	 * recursively (when a unit syncs another one) form a list.
+	 */
+	struct ProcessingStep
+	{
+		ExecutionPlan const*	plan;
+		std::size_t				index;
+		ProcessingStep const*	previous;
+	};
+
+	/**
+	 * Executes one step on WorkPerformer's thread, unless another
+	 * thread has already taken it.
+	 */
+	class StepWorkUnit: public WorkPerformer::Unit
+	{
+		friend class ExecutionPlan;
+
+	  public:
+		StepWorkUnit (ExecutionPlan*, std::size_t step_index) noexcept;
+
+		void
+		execute() override;
+
+	  private:
+		ExecutionPlan*			_plan;
+		std::size_t				_step_index;
+		// Number of dependencies not yet processed in current round:
+		Atomic<unsigned int>	_pending;
+		// Set when step is processed in current round:
+		Atomic<bool>			_processed;
+	};
+
+  public:
+	/**
+	 * Compiles new plan for given units. Previous plan is discarded.
+	 * \param	units Units to put into the plan.
+	 * \param	first_unit Unit whose dependencies should be scheduled first.
+	 * 			May be nullptr.
+	 */
+	void
+	compile (Units const& units, Unit* first_unit);
+
+	/**
+	 * Sets WorkPerformer used to process independent units concurrently.
+	 * If nullptr, units are processed serially by the thread that
+	 * requests processing.
+	 */
+	void
+	set_work_performer (WorkPerformer*);
+
+	/**
+	 * Discards the plan. Doesn't touch units, since some of them
+	 * may not exist anymore.
+	 */
+	void
+	clear();
+
+	/**
+	 * Marks all planned units as not synced and rewinds the plan
+	 * to the first step. Call at the beginning of processing round.
+	 */
+	void
+	reset();
+
+	/**
+	 * Executes all not yet executed steps up to and including
+	 * the step at given index. In parallel mode whole plan
+	 * is executed on first call in a round, and calls made
+	 * from within units being processed wait until the step
+	 * at given index is processed.
+	 */
+	void
+	execute_up_to (std::size_t index);
+
+	/**
+	 * Executes all remaining steps.
+	 */
+	void
+	execute_all();
+
+	/**
+	 * Return number of steps in the plan.
+	 */
+	std::size_t
+	size() const noexcept;
+
+  private:
+	/**
+	 * Recursively adds the unit and all units it depends on.
+	 */
+	void
+	add_unit (Unit* unit, Units const& units, Units& visited);
+
+	/**
+	 * Computes dependencies between steps for parallel execution.
+	 * Connection from a later step to an earlier one (a cycle) makes
+	 * the later step wait for the earlier one, to keep the same data
+	 * flow as in serial execution.
+	 */
+	void
+	compile_dependencies();
+
+	/**
+	 * Gathers inputs and processes the unit, unless the step
+	 * has already been taken by this or another thread.
+	 * In parallel mode also queues successors that have all
+	 * their dependencies done.
+	 * \returns	true if step has been processed by this call.
+	 */
+	bool
+	execute (std::size_t index);
+
+	/**
+	 * Executes all steps on WorkPerformer's threads and on the calling
+	 * thread and waits for them to finish. Does nothing if called
+	 * again in the same round.
+	 */
+	void
+	execute_parallel();
+
+	/**
+	 * Processes first not yet taken step, starting at index first,
+	 * that has all its dependencies done. Updates first to skip
+	 * steps already processed.
+	 * \returns	false if there was no step ready to be processed.
+	 */
+	bool
+	execute_ready_step (std::size_t& first);
+
+	/**
+	 * Waits until step at given index is processed, processing ready
+	 * steps in the meantime. Used when a unit syncs another one
+	 * during parallel execution.
+	 */
+	void
+	wait_for_step (std::size_t index);
+
+	/**
+	 * Processes ready steps until done() returns true. If there are no ready
+	 * steps for a while, sleeps until next step is processed by another thread,
+	 * so that spinning doesn't take CPU from threads that do actual work.
+	 */
+	template<class Predicate>
+		void
+		wait_until (Predicate done, std::size_t& first);
+
+	/**
+	 * Wakes up threads sleeping in wait_until().
+	 * Call after a step has been marked as processed.
+	 */
+	void
+	wake_sleepers() noexcept;
+
+	/**
+	 * Return true if step at step_index has to wait for the step
+	 * at dependency_index, directly or indirectly.
+	 */
+	bool
+	depends_on (std::size_t step_index, std::size_t dependency_index) const noexcept;
+
+  private:
+	std::vector<Step>					_steps;
+	std::vector<AudioInput>				_audio_inputs;
+	std::vector<EventInput>				_event_inputs;
+	std::vector<AudioMix>				_audio_mixes;
+	std::vector<EventMix>				_event_mixes;
+	// Enabled source buffers of event inputs, collected when executing steps
+	// (ranges correspond to those of _event_mixes):
+	std::vector<EventBuffer const*>		_event_sources;
+	std::vector<std::size_t>			_successors;
+	// For each step, bitset of steps that depend on it directly or indirectly
+	// (_reachable_words words per step):
+	std::vector<uint64_t>				_reachable;
+	std::size_t							_reachable_words	= 0;
+	std::vector<Unique<StepWorkUnit>>	_work_units;
+	WorkPerformer*						_work_performer		= nullptr;
+	Atomic<bool>						_parallel_running	{ false };
+	// Number of steps processed in current round in parallel mode:
+	Atomic<std::size_t>					_processed_steps	{ 0 };
+	// Number of threads sleeping in wait_until() and semaphore they sleep on:
+	Atomic<unsigned int>				_sleepers			{ 0 };
+	Semaphore							_progress;
+	// Index of the next step to execute:
+	std::size_t							_cursor				= 0;
+	// Innermost step processed by current thread, if any:
+	static thread_local ProcessingStep const*	_processing_step;
+};
+
+
+inline void
+ExecutionPlan::execute_up_to (std::size_t index)
+{
+	if (_work_performer)
+	{
+		if (_parallel_running.load())
+			wait_for_step (index);
+		else
+			execute_parallel();
+	}
+	else
+	{
+		// Note that execute() may recursively advance _cursor:
+		while (_cursor <= index && _cursor < _steps.size())
+			execute (_cursor++);
+	}
+}
+
+
+inline void
+ExecutionPlan::execute_all()
+{
+	if (_work_performer)
+		execute_parallel();
+	else
+	{
+		while (_cursor < _steps.size())
+			execute (_cursor++);
+	}
+}
+
+
+inline std::size_t
+ExecutionPlan::size() const noexcept
+{
+	return _steps.size();
+}
+
+
+inline bool
+ExecutionPlan::depends_on (std::size_t step_index, std::size_t dependency_index) const noexcept
+{
+	return (_reachable[dependency_index * _reachable_words + step_index / 64] >> (step_index % 64)) & 1;
+}
+
+} // namespace Haruhi
+
+#endif
+
@@ -90,6 +90,7 @@ Graph::register_unit (Unit* unit)
 	synchronize ([&] {
 		unit->_graph = this;
 		_units.insert (unit);
+		invalidate_execution_plan();
 		unit->graph_updated();
 		// Signal:
 		unit_registered (unit);
@@ -114,6 +115,8 @@ Graph::unregister_unit (Unit* unit)
 		p->unit_unregistered();
 	_units.erase (f);
 	unit->_graph = 0;
+	unit->_execution_plan_index = ExecutionPlan::NotPlanned;
+	discard_execution_plan();
 	// Signal:
 	unit_unregistered (unit);
 }
@@ -124,11 +127,19 @@ Graph::enter_processing_round()
 {
 	lock();
 	_timestamp = Time::now();
+	if (CPUStats::enabled() || Trace::enabled())
+		_round_start = CPUStats::now();
 	_inside_processing_round = true;
 	_dummy_syncing = false;
+	// Plan is compiled by update_execution_plan(). If it's outdated,
+	// previous one is used, or none if it has been discarded:
+	if (_execution_plan_discarded)
+	{
+		clear_execution_plan();
+		_execution_plan_discarded = false;
+	}
 	// Wakeup all Units:
-	for (Unit* u: _units)
-		u->_synced = false;
+	_execution_plan.reset();
 }
 
 
@@ -137,15 +148,101 @@ Graph::leave_processing_round()
 {
 	_dummy_syncing = true;
 	// Bump only unsynced Units:
-	for (Unit* u: _units)
-		if (!u->_synced && u->_enabled)
-			u->sync();
+	_execution_plan.execute_all();
 	_inside_processing_round = false;
 	compute_next_tempo_tick();
+	if (CPUStats::enabled() || Trace::enabled())
+		account_round();
 	unlock();
 }
 
 
+void
+Graph::account_round() noexcept
+{
+	CPUStats::Nanoseconds const now = CPUStats::now();
+	bool const overrun = now - _round_start > period_budget();
+	bool const xrun = _xrun_reported.exchange (false, std::memory_order_relaxed);
+
+	if (CPUStats::enabled())
+	{
+		_round_cpu_stats.record (now - _round_start);
+		if (overrun || xrun)
+		{
+			// Correlate samples of all units with this overrun:
+			_round_cpu_stats.mark_overrun();
+			for (Unit* u: _units)
+				if (u->_enabled)
+					u->_cpu_stats.mark_overrun();
+		}
+	}
+
+	if (Trace::enabled())
+	{
+		Trace::record ("Graph round", _buffer_size, _round_start, now);
+		if (overrun)
+			Trace::mark_xrun();
+	}
+}
+
+
+void
+Graph::invalidate_execution_plan()
+{
+	synchronize ([&] {
+		if (_execution_plan_valid)
+		{
+			_execution_plan_valid = false;
+			// Signal:
+			execution_plan_invalidated();
+		}
+	});
+}
+
+
+void
+Graph::discard_execution_plan()
+{
+	synchronize ([&] {
+		// Steps of current plan may be being executed,
+		// in such case it's discarded on next round:
+		if (_inside_processing_round)
+			_execution_plan_discarded = true;
+		else
+			clear_execution_plan();
+		invalidate_execution_plan();
+	});
+}
+
+
+void
+Graph::update_execution_plan()
+{
+	synchronize ([&] {
+		assert (!_inside_processing_round);
+
+		if (!_execution_plan_valid)
+		{
+			_execution_plan.compile (_units, _audio_backend);
+			_execution_plan_valid = true;
+			_execution_plan_discarded = false;
+		}
+	});
+}
+
+
+void
+Graph::clear_execution_plan()
+{
+	_execution_plan.clear();
+	// Nothing will be mixed into backend's inputs, so don't
+	// let it output their last contents over and over:
+	if (_audio_backend)
+		for (Port* p: _audio_backend->inputs())
+			p->clear_buffer();
+}
+
+
 void
 Graph::panic()
 {
@@ -154,6 +251,15 @@ Graph::panic()
 }
 
 
+void
+Graph::set_work_performer (WorkPerformer* work_performer)
+{
+	synchronize ([&] {
+		_execution_plan.set_work_performer (work_performer);
+	});
+}
+
+
 void
 Graph::set_buffer_size (std::size_t buffer_size)
 {
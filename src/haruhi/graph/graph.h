@@ -20,10 +20,14 @@
 
 // Haruhi:
 #include <haruhi/config/all.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/cpu_stats.h>
 #include <haruhi/utility/mutex.h>
 #include <haruhi/utility/signal.h>
+#include <haruhi/utility/trace.h>
 
 // Local:
+#include "execution_plan.h"
 #include "unit.h"
 
 
@@ -124,6 +128,15 @@ class Graph: public RecursiveMutex
 	void
 	panic();
 
+	/**
+	 * Sets WorkPerformer used to process units that don't depend
+	 * on each other concurrently. Pass nullptr to process all
+	 * units in the thread that runs processing round.
+	 * Performer's threads should have real-time priority.
+	 */
+	void
+	set_work_performer (WorkPerformer*);
+
 	/**
 	 * Returns buffer size for audio buffers.
 	 */
@@ -205,10 +218,79 @@ class Graph: public RecursiveMutex
 	uint64_t
 	next_tempo_tick() const noexcept;
 
+	/**
+	 * Returns time available for one processing round,
+	 * that is duration of one buffer.
+	 */
+	CPUStats::Nanoseconds
+	period_budget() const noexcept;
+
+	/**
+	 * Returns statistics of processing round durations.
+	 * Rounds that exceeded period_budget() or that were followed
+	 * by xrun reported with mark_xrun() are accounted as overruns,
+	 * and so are samples of all units processed in such round.
+	 * Empty unless compiled with HARUHI_CPU_STATS.
+	 */
+	CPUStats const&
+	round_cpu_stats() const noexcept;
+
+	/**
+	 * Tells that audio subsystem reported an xrun. Next accounted
+	 * round is then counted as overrun in CPU statistics.
+	 * \threadsafe
+	 */
+	void
+	mark_xrun() noexcept;
+
+	/**
+	 * Marks execution plan as outdated. Should be called on every change
+	 * of graph topology (units, ports, connections). Plan isn't compiled here,
+	 * since changes usually come in batches (eg. when loading a plugin),
+	 * and compiling it on each one would keep the processing round locked out.
+	 * Emits execution_plan_invalidated when the plan becomes outdated.
+	 * Until update_execution_plan() is called, rounds use previous plan, which
+	 * still refers only to existing units and ports.
+	 * Locks the graph.
+	 */
+	void
+	invalidate_execution_plan();
+
+	/**
+	 * Like invalidate_execution_plan(), but also discards current plan, so that
+	 * it can't refer to units or ports being removed. Until the plan is compiled
+	 * again, rounds don't process any units.
+	 * Locks the graph.
+	 */
+	void
+	discard_execution_plan();
+
+	/**
+	 * Compiles execution plan, if it's outdated. Call after a batch of changes
+	 * to graph topology. Must not be called from within a processing round.
+	 * Locks the graph.
+	 */
+	void
+	update_execution_plan();
+
   private:
 	void
 	compute_next_tempo_tick();
 
+	/**
+	 * Records duration of current processing round in CPU statistics
+	 * and trace, and marks overruns.
+	 */
+	void
+	account_round() noexcept;
+
+	/**
+	 * Discards execution plan and clears audio backend's inputs.
+	 * \entry	Graph locked, outside of processing round.
+	 */
+	void
+	clear_execution_plan();
+
   public:
 	// Signals.
 	// It is not defined from within what thread these signals will be emitted.
@@ -222,17 +304,30 @@ class Graph: public RecursiveMutex
 	Signal::Emiter<Port*, Unit*>	port_registered;
 	Signal::Emiter<Port*, Unit*>	port_unregistered;
 	Signal::Emiter<PortGroup*>		port_group_renamed;
+	// Emitted with graph locked, when execution plan becomes outdated.
+	// Receiver should arrange for update_execution_plan() to be called:
+	Signal::Emiter<>				execution_plan_invalidated;
 
   private:
 	// Set of all registered units:
 	Units			_units;
 
+	// Order in which units are processed:
+	ExecutionPlan	_execution_plan;
+	bool			_execution_plan_valid		= true;
+	// Set when plan is discarded from within processing round:
+	bool			_execution_plan_discarded	= false;
+
 	// True between calls of start_/finish_processing_round:
 	bool			_inside_processing_round	= false;
 	bool			_dummy_syncing				= false;
 
 	// Timestamp of last enter_processing_round:
 	Time			_timestamp;
+	CPUStats::Nanoseconds	_round_start		= 0;
+	CPUStats		_round_cpu_stats;
+	// Set by audio subsystem's xrun notification:
+	Atomic<bool>	_xrun_reported				{ false };
 	unsigned int	_next_tempo_tick			= 0;
 
 	// Graph parameters:
@@ -275,6 +370,29 @@ Graph::sample_rate() const noexcept
 }
 
 
+inline CPUStats::Nanoseconds
+Graph::period_budget() const noexcept
+{
+	if (_sample_rate.Hz() <= 0.0)
+		return 0;
+	return 1e9 * _buffer_size / _sample_rate.Hz();
+}
+
+
+inline CPUStats const&
+Graph::round_cpu_stats() const noexcept
+{
+	return _round_cpu_stats;
+}
+
+
+inline void
+Graph::mark_xrun() noexcept
+{
+	_xrun_reported.store (true, std::memory_order_relaxed);
+}
+
+
 inline Frequency
 Graph::tempo() const noexcept
 {
@@ -95,7 +95,10 @@ Port::connect_to (Port* port)
 		_forward_connections.insert (port);
 		port->_back_connections.insert (this);
 		if (graph())
+		{
+			graph()->invalidate_execution_plan();
 			graph()->port_connected_to (this, port);
+		}
 	}
 }
 
@@ -106,7 +109,10 @@ Port::disconnect_from (Port* port)
 	_forward_connections.erase (port);
 	port->_back_connections.erase (this);
 	if (graph())
+	{
+		graph()->invalidate_execution_plan();
 		graph()->port_disconnected_from (this, port);
+	}
 }
 
 
@@ -127,25 +133,10 @@ Port::disconnect()
 void
 Port::sync()
 {
+	// Output buffers are ready after unit is processed, input buffers are
+	// gathered by the execution plan right before that:
 	if (unit()->enabled())
-	{
-		if (_direction == Output)
-			unit()->sync();
-		else if (_direction == Input)
-		{
-			clear_buffer();
-			if (_back_connections.empty())
-				no_input();
-			else
-			{
-				for (Port* p: _back_connections)
-				{
-					p->sync();
-					mixin (p);
-				}
-			}
-		}
-	}
+		unit()->sync();
 	else
 		clear_buffer();
 }
@@ -184,7 +175,10 @@ Port::register_me()
 	}
 	// Send notification:
 	if (graph())
+	{
+		graph()->invalidate_execution_plan();
 		graph()->port_registered (this, _unit);
+	}
 }
 
 
@@ -199,7 +193,10 @@ Port::unregister_me()
 	}
 	// Send notification:
 	if (graph())
+	{
+		graph()->discard_execution_plan();
 		graph()->port_unregistered (this, _unit);
+	}
 }
 
 
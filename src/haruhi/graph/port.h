@@ -49,6 +49,7 @@ class Port:
 {
 	friend class Unit;
 	friend class Graph;
+	friend class ExecutionPlan;
 
   public:
 	/**
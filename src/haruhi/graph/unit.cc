@@ -34,6 +34,7 @@ Unit::Unit (std::string const& urn, std::string const& title, int id) noexcept:
 	_graph (0),
 	_synced (true),
 	_enabled (false),
+	_execution_plan_index (ExecutionPlan::NotPlanned),
 	_urn (urn),
 	_title (title),
 	_original_title (title)
@@ -45,8 +46,6 @@ Unit::Unit (std::string const& urn, std::string const& title, int id) noexcept:
 Unit::~Unit()
 {
 	free_id (id());
-	// Prevent processing:
-	Mutex::Lock lock (_processing_mutex);
 	// Check if unit is properly disabled when destroyed:
 	assert (!enabled());
 	assert (!graph());
@@ -79,24 +78,26 @@ Unit::sync()
 	// Prevent syncing when not in processing round:
 	assert (_graph->_inside_processing_round);
 
-	// Check if we can acquire processing lock. If not, unit
-	// is disabled - don't wait for it.
-	// This prevents disabling unit when it's being processed.
-	Mutex::TryLock lock (_processing_mutex);
-	if (lock.acquired() && !_synced && _enabled)
-	{
-		_synced = true;
-		this->process();
-	}
+	// Graph is locked for the whole processing round, so unit
+	// can't be disabled while it's being processed. _synced isn't checked
+	// here, since in parallel mode the unit may be taken by another thread
+	// and not yet processed; plan waits for it in such case.
+	if (_enabled && _execution_plan_index != ExecutionPlan::NotPlanned)
+		_graph->_execution_plan.execute_up_to (_execution_plan_index);
 }
 
 
 void
 Unit::disable() noexcept
 {
-	// Wait for processing end:
-	Mutex::Lock lock (_processing_mutex);
-	_enabled = false;
+	// Wait for processing end. Processing round holds Graph lock:
+	if (_graph)
+	{
+		Mutex::Lock lock (*_graph);
+		_enabled = false;
+	}
+	else
+		_enabled = false;
 }
 
 
@@ -127,8 +128,9 @@ Unit::panic()
 void
 Unit::sync_inputs()
 {
-	for (Port* p: _inputs)
-		p->sync();
+	// Inputs are gathered before process() is called,
+	// just make sure that happened:
+	sync();
 }
 
 /**
@@ -18,11 +18,14 @@
 #include <cstddef>
 #include <string>
 #include <set>
+#include <vector>
+#include <utility>
 
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/utility/noncopyable.h>
 #include <haruhi/utility/atomic.h>
+#include <haruhi/utility/cpu_stats.h>
 #include <haruhi/utility/mutex.h>
 
 // Local:
@@ -46,6 +49,7 @@ class Unit: private Noncopyable
 {
 	friend class Graph;
 	friend class Port;
+	friend class ExecutionPlan;
 
 	typedef std::set<int> IDs;
 
@@ -76,6 +80,8 @@ class Unit: private Noncopyable
 
 	/**
 	 * Synchronizes unit - calls its process() method.
+	 * Units that precede this one in Graph's execution plan
+	 * are processed first.
 	 */
 	void
 	sync();
@@ -117,6 +123,7 @@ class Unit: private Noncopyable
 
 	/**
 	 * Disables unit. Disabled units aren't synced.
+	 * Waits for current processing round to finish.
 	 * May not be called inside of processing round.
 	 */
 	void
@@ -189,6 +196,22 @@ class Unit: private Noncopyable
 	virtual int
 	voices_number() const;
 
+	/**
+	 * Return statistics of time spent in process().
+	 * Empty unless compiled with HARUHI_CPU_STATS.
+	 */
+	CPUStats const&
+	cpu_stats() const noexcept;
+
+	/**
+	 * Append additional, unit-specific CPU statistics (eg. per-part render
+	 * times of a synthesizer) as pairs of name and snapshot.
+	 * Default implementation adds nothing.
+	 * \threadsafe
+	 */
+	virtual void
+	collect_cpu_stats (std::vector<std::pair<std::string, CPUStats::Snapshot>>&) const;
+
 	/**
 	 * Ordering helper.
 	 */
@@ -200,7 +223,8 @@ class Unit: private Noncopyable
 	 * Synchronizes all connected inputs.
 	 * Any input must be synchronized before accessing it's buffers.
 	 * Multiple synchronizations are allowed (unit will synchronize
-	 * only once).
+	 * only once). Inputs are already gathered by the execution plan
+	 * when process() is called, so this is cheap.
 	 *
 	 * May be only called inside of processing round.
 	 */
@@ -252,22 +276,25 @@ class Unit: private Noncopyable
 	free_id (int id);
 
   private:
-	static IDs	_ids;
+	static IDs		_ids;
 	// IDs are not checked to be unique.
-	int			_id;
+	int				_id;
+
+	Graph*			_graph;
+	// Set by the thread that processes the unit in current round:
+	Atomic<bool>	_synced;
+	bool			_enabled;
+	// Position in Graph's execution plan:
+	std::size_t		_execution_plan_index;
 
-	Graph*		_graph;
-	bool		_synced;
-	bool		_enabled;
-	// Used by disable() and sync() methods:
-	Mutex		_processing_mutex;
+	std::string		_urn;
+	std::string		_title;
+	std::string		_original_title;
 
-	std::string	_urn;
-	std::string	_title;
-	std::string	_original_title;
+	Ports			_inputs;
+	Ports			_outputs;
 
-	Ports		_inputs;
-	Ports		_outputs;
+	CPUStats		_cpu_stats;
 };
 
 
@@ -334,6 +361,13 @@ Unit::outputs() const noexcept
 }
 
 
+inline CPUStats const&
+Unit::cpu_stats() const noexcept
+{
+	return _cpu_stats;
+}
+
+
 inline int
 Unit::voices_number() const
 {
@@ -341,6 +375,11 @@ Unit::voices_number() const
 }
 
 
+inline void
+Unit::collect_cpu_stats (std::vector<std::pair<std::string, CPUStats::Snapshot>>&) const
+{ }
+
+
 inline bool
 Unit::compare_by_title (Unit const* first, Unit const* second) noexcept
 {
@@ -13,6 +13,8 @@
 
 // Standard:
 #include <cstddef>
+#include <algorithm>
+#include <limits>
 
 // Haruhi:
 #include <haruhi/graph/event.h>
@@ -44,25 +46,37 @@ ControllerProxy::~ControllerProxy()
 
 void
 ControllerProxy::process_events()
+{
+	process_events (0, std::numeric_limits<std::size_t>::max());
+}
+
+
+void
+ControllerProxy::process_events (std::size_t begin_frame, std::size_t end_frame)
 {
 	auto buffer = _event_port->buffer();
 
 	if (!buffer->events().empty())
 	{
-		for (auto& event: buffer->events())
+		// Events are sorted by frame offsets:
+		for (auto& record: buffer->events())
 		{
-			switch (event->event_type())
+			Event const& event = record.event();
+
+			if (event.frame() < begin_frame)
+				continue;
+			if (event.frame() >= end_frame)
+				break;
+
+			switch (event.event_type())
 			{
 				case Event::ControllerEventType:
-				{
-					auto ce = static_cast<ControllerEvent const*> (event.get());
-					process_event (ce);
+					process_event (record.as<ControllerEvent>());
 					break;
-				}
 
 				case Event::VoiceControllerEventType:
 				{
-					auto vce = static_cast<VoiceControllerEvent const*> (event.get());
+					auto vce = record.as<VoiceControllerEvent>();
 					on_voice_controller_event (vce, param()->adapter()->forward_normalized (vce->value()));
 					break;
 				}
@@ -74,5 +88,15 @@ ControllerProxy::process_events()
 	}
 }
 
+
+std::size_t
+ControllerProxy::next_event_frame (std::size_t frame, std::size_t end_frame) const
+{
+	for (auto& record: _event_port->buffer()->events())
+		if (record.event().frame() > frame)
+			return std::min (record.event().frame(), end_frame);
+	return end_frame;
+}
+
 } // namespace v06
 } // namespace Haruhi
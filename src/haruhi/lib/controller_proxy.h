@@ -94,6 +94,20 @@ class ControllerProxy: public Signal::Receiver
 	void
 	process_events();
 
+	/**
+	 * Processes only events with frame offsets in range [begin_frame, end_frame).
+	 * Allows splitting processing at event boundaries.
+	 */
+	void
+	process_events (std::size_t begin_frame, std::size_t end_frame);
+
+	/**
+	 * Return frame offset of the first event in assigned EventPort's buffer
+	 * that is greater than given frame, or end_frame if there is none.
+	 */
+	std::size_t
+	next_event_frame (std::size_t frame, std::size_t end_frame) const;
+
 	/**
 	 * Processes given event - propagates changes to controlled
 	 * parameter and requests periodic-update on widget.
@@ -89,6 +89,7 @@ struct Event
 
   public:
 	Time		timestamp;
+	std::size_t	frame		= 0; // Offset in samples from the beginning of processing round.
 	Type		type;
 	ID			id; // Unique identifier.
 
@@ -0,0 +1,411 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/exception.h>
+
+// Local:
+#include "midi_sequence.h"
+
+
+namespace Haruhi {
+
+namespace MIDI {
+
+namespace SequencePrivate {
+
+/**
+ * Reads big-endian numbers and variable-length quantities
+ * from Standard MIDI File data.
+ */
+class SmfReader
+{
+  public:
+	SmfReader (std::string const& data, std::size_t begin, std::size_t end):
+		_data (data),
+		_position (begin),
+		_end (end)
+	{ }
+
+	bool
+	at_end() const
+	{
+		return _position >= _end;
+	}
+
+	std::size_t
+	position() const
+	{
+		return _position;
+	}
+
+	uint8_t
+	peek() const
+	{
+		if (at_end())
+			throw Exception ("unexpected end of MIDI file");
+		return static_cast<uint8_t> (_data[_position]);
+	}
+
+	uint8_t
+	byte()
+	{
+		uint8_t result = peek();
+		++_position;
+		return result;
+	}
+
+	uint32_t
+	number (std::size_t bytes)
+	{
+		uint32_t result = 0;
+		for (std::size_t i = 0; i < bytes; ++i)
+			result = (result << 8) | byte();
+		return result;
+	}
+
+	uint32_t
+	vlq()
+	{
+		uint32_t result = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			uint8_t b = byte();
+			result = (result << 7) | (b & 0x7f);
+			if (!(b & 0x80))
+				return result;
+		}
+		throw Exception ("invalid variable-length quantity in MIDI file");
+	}
+
+	void
+	skip (std::size_t bytes)
+	{
+		if (_end - _position < bytes)
+			throw Exception ("unexpected end of MIDI file");
+		_position += bytes;
+	}
+
+  private:
+	std::string const&	_data;
+	std::size_t			_position;
+	std::size_t			_end;
+};
+
+
+struct TickEvent
+{
+	uint64_t	tick;
+	Event		event;
+};
+
+
+struct TempoChange
+{
+	uint64_t	tick;
+	uint32_t	us_per_quarter;
+};
+
+} // namespace SequencePrivate
+
+
+void
+Sequence::add (Time time, Event const& event)
+{
+	// Insert after events with equal time to keep order of addition:
+	auto position = std::upper_bound (_events.begin(), _events.end(), time,
+									  [](Time t, TimedEvent const& e) { return t < e.time; });
+	_events.insert (position, { time, event });
+}
+
+
+void
+Sequence::load (std::string const& file_name)
+{
+	std::ifstream file (file_name, std::ios::binary);
+	if (!file)
+		throw Exception ("could not open MIDI sequence file", file_name);
+
+	std::string data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char>());
+
+	if (data.compare (0, 4, "MThd") == 0)
+		parse_smf (data);
+	else
+		parse_script (data);
+}
+
+
+void
+Sequence::parse_smf (std::string const& data)
+{
+	SequencePrivate::SmfReader header (data, 0, data.size());
+
+	if (header.number (4) != 0x4d546864) // "MThd"
+		throw Exception ("not a Standard MIDI File");
+	std::size_t header_length = header.number (4);
+	if (header_length < 6)
+		throw Exception ("invalid MIDI file header");
+	uint32_t format = header.number (2);
+	uint32_t tracks = header.number (2);
+	uint32_t division = header.number (2);
+	header.skip (header_length - 6);
+
+	if (format > 1)
+		throw Exception ("unsupported MIDI file format", std::to_string (format));
+
+	std::vector<SequencePrivate::TickEvent> tick_events;
+	std::vector<SequencePrivate::TempoChange> tempo_changes;
+
+	for (uint32_t t = 0; t < tracks && !header.at_end(); ++t)
+	{
+		uint32_t chunk_type = header.number (4);
+		std::size_t chunk_length = header.number (4);
+		std::size_t chunk_begin = header.position();
+		header.skip (chunk_length);
+		// Skip unknown chunks:
+		if (chunk_type != 0x4d54726b) // "MTrk"
+			continue;
+
+		SequencePrivate::SmfReader track (data, chunk_begin, chunk_begin + chunk_length);
+		uint64_t tick = 0;
+		uint8_t running_status = 0;
+
+		while (!track.at_end())
+		{
+			tick += track.vlq();
+
+			uint8_t status = track.peek();
+			if (status & 0x80)
+				track.byte();
+			else if (running_status)
+				status = running_status;
+			else
+				throw Exception ("MIDI data byte without status");
+
+			if (status == 0xff)
+			{
+				uint8_t type = track.byte();
+				uint32_t length = track.vlq();
+				if (type == 0x51 && length == 3)
+					tempo_changes.push_back ({ tick, track.number (3) });
+				else if (type == 0x2f)
+					break;
+				else
+					track.skip (length);
+				continue;
+			}
+			else if (status == 0xf0 || status == 0xf7)
+			{
+				track.skip (track.vlq());
+				continue;
+			}
+
+			running_status = status;
+			uint8_t channel = status & 0x0f;
+			Event event;
+
+			switch (status & 0xf0)
+			{
+				case 0x80:
+					event.type = Event::NoteOff;
+					event.note_off.channel = channel;
+					event.note_off.note = track.byte();
+					event.note_off.velocity = track.byte();
+					break;
+
+				case 0x90:
+					event.note_on.channel = channel;
+					event.note_on.note = track.byte();
+					event.note_on.velocity = track.byte();
+					// NoteOn with zero velocity means NoteOff:
+					event.type = event.note_on.velocity > 0 ? Event::NoteOn : Event::NoteOff;
+					break;
+
+				case 0xa0:
+					event.type = Event::PolyPressure;
+					event.key_pressure.channel = channel;
+					event.key_pressure.note = track.byte();
+					event.key_pressure.value = track.byte();
+					break;
+
+				case 0xb0:
+					event.type = Event::Controller;
+					event.controller.channel = channel;
+					event.controller.number = track.byte();
+					event.controller.value = track.byte();
+					break;
+
+				case 0xc0:
+					// Program change is not supported:
+					track.byte();
+					continue;
+
+				case 0xd0:
+					event.type = Event::MonoPressure;
+					event.channel_pressure.channel = channel;
+					event.channel_pressure.value = track.byte();
+					break;
+
+				case 0xe0:
+				{
+					uint8_t lsb = track.byte();
+					uint8_t msb = track.byte();
+					event.type = Event::Pitchbend;
+					event.pitchbend.channel = channel;
+					event.pitchbend.value = ((msb & 0x7f) << 7 | (lsb & 0x7f)) - 8192;
+					break;
+				}
+
+				default:
+					throw Exception ("invalid MIDI status byte");
+			}
+
+			tick_events.push_back ({ tick, event });
+		}
+	}
+
+	// Convert ticks to time:
+	auto by_tick = [](auto const& a, auto const& b) { return a.tick < b.tick; };
+	std::stable_sort (tick_events.begin(), tick_events.end(), by_tick);
+	std::stable_sort (tempo_changes.begin(), tempo_changes.end(), by_tick);
+
+	_events.clear();
+	_events.reserve (tick_events.size());
+
+	if (division & 0x8000)
+	{
+		// SMPTE division: frames per second and ticks per frame:
+		int fps = -static_cast<int8_t> (division >> 8);
+		int ticks_per_frame = division & 0xff;
+		if (fps <= 0 || ticks_per_frame == 0)
+			throw Exception ("invalid SMPTE division in MIDI file");
+		for (auto const& e: tick_events)
+			_events.push_back ({ 1_s * (static_cast<double> (e.tick) / (fps * ticks_per_frame)), e.event });
+	}
+	else
+	{
+		if (division == 0)
+			throw Exception ("invalid division in MIDI file");
+
+		auto tempo = tempo_changes.begin();
+		uint64_t tempo_tick = 0;
+		double tempo_seconds = 0.0;
+		// Default tempo is 120 BPM:
+		double seconds_per_tick = 0.5 / division;
+
+		for (auto const& e: tick_events)
+		{
+			for (; tempo != tempo_changes.end() && tempo->tick <= e.tick; ++tempo)
+			{
+				tempo_seconds += (tempo->tick - tempo_tick) * seconds_per_tick;
+				tempo_tick = tempo->tick;
+				seconds_per_tick = 1e-6 * tempo->us_per_quarter / division;
+			}
+			_events.push_back ({ 1_s * (tempo_seconds + (e.tick - tempo_tick) * seconds_per_tick), e.event });
+		}
+	}
+}
+
+
+void
+Sequence::parse_script (std::string const& script)
+{
+	std::istringstream lines (script);
+	std::string line;
+	std::size_t line_number = 0;
+
+	_events.clear();
+
+	while (std::getline (lines, line))
+	{
+		++line_number;
+
+		std::istringstream fields (line);
+		double seconds;
+		std::string type;
+
+		if (!(fields >> seconds))
+		{
+			fields.clear();
+			fields.str (line);
+			std::string first;
+			// Allow empty lines and comments:
+			if (!(fields >> first) || first[0] == '#')
+				continue;
+			throw Exception ("invalid time in event script", "line " + std::to_string (line_number));
+		}
+
+		int channel = 0, a = 0, b = 0;
+		fields >> type >> channel >> a;
+		bool const two_values = type != "pitchbend" && type != "channel-pressure";
+		if (two_values)
+			fields >> b;
+
+		if (!fields || channel < 1 || channel > 16)
+			throw Exception ("invalid event in event script", "line " + std::to_string (line_number));
+
+		Event event;
+		uint8_t const ch = channel - 1;
+
+		if (type == "note-on")
+		{
+			event.type = Event::NoteOn;
+			event.note_on = { ch, static_cast<uint8_t> (a), static_cast<uint8_t> (b) };
+		}
+		else if (type == "note-off")
+		{
+			event.type = Event::NoteOff;
+			event.note_off = { ch, static_cast<uint8_t> (a), static_cast<uint8_t> (b) };
+		}
+		else if (type == "controller")
+		{
+			event.type = Event::Controller;
+			event.controller = { ch, static_cast<uint8_t> (a), static_cast<uint8_t> (b) };
+		}
+		else if (type == "pitchbend")
+		{
+			event.type = Event::Pitchbend;
+			event.pitchbend = { ch, static_cast<int16_t> (a) };
+		}
+		else if (type == "channel-pressure")
+		{
+			event.type = Event::MonoPressure;
+			event.channel_pressure = { ch, static_cast<uint8_t> (a) };
+		}
+		else if (type == "key-pressure")
+		{
+			event.type = Event::PolyPressure;
+			event.key_pressure = { ch, static_cast<uint8_t> (a), static_cast<uint8_t> (b) };
+		}
+		else
+			throw Exception ("unknown event type in event script", type);
+
+		add (1_s * seconds, event);
+	}
+}
+
+} // namespace MIDI
+
+} // namespace Haruhi
+
@@ -0,0 +1,139 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__LIB__MIDI_SEQUENCE_H__INCLUDED
+#define HARUHI__LIB__MIDI_SEQUENCE_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+// Local:
+#include "midi.h"
+
+
+namespace Haruhi {
+
+namespace MIDI {
+
+/**
+ * List of MIDI events, each with time relative to the start of the sequence.
+ * Events are kept sorted by time; events with equal times keep order in which
+ * they were added.
+ *
+ * Can be loaded from Standard MIDI File (formats 0 and 1) or from event script.
+ * Event script is a text file with one event per line:
+ *
+ *   <seconds> note-on <channel> <note> <velocity>
+ *   <seconds> note-off <channel> <note> <velocity>
+ *   <seconds> controller <channel> <number> <value>
+ *   <seconds> pitchbend <channel> <value -8192…8191>
+ *   <seconds> channel-pressure <channel> <value>
+ *   <seconds> key-pressure <channel> <note> <value>
+ *
+ * Channels are numbered 1…16. Empty lines and lines starting with '#' are ignored.
+ */
+class Sequence
+{
+  public:
+	struct TimedEvent
+	{
+		Time	time;
+		Event	event;
+	};
+
+	typedef std::vector<TimedEvent> Events;
+
+  public:
+	/**
+	 * Add event to the sequence.
+	 */
+	void
+	add (Time time, Event const& event);
+
+	/**
+	 * Remove all events.
+	 */
+	void
+	clear();
+
+	/**
+	 * Load events from file. Standard MIDI Files are recognized by
+	 * their header, other files are parsed as event scripts.
+	 * Replaces current events.
+	 * \throws	Exception if file can't be read or parsed.
+	 */
+	void
+	load (std::string const& file_name);
+
+	/**
+	 * Parse Standard MIDI File contents.
+	 * \throws	Exception on parse error.
+	 */
+	void
+	parse_smf (std::string const& data);
+
+	/**
+	 * Parse event script.
+	 * \throws	Exception on parse error.
+	 */
+	void
+	parse_script (std::string const& script);
+
+	/**
+	 * Return sorted events.
+	 */
+	Events const&
+	events() const noexcept;
+
+	/**
+	 * Return time of the last event.
+	 */
+	Time
+	duration() const noexcept;
+
+  private:
+	Events	_events;
+};
+
+
+inline void
+Sequence::clear()
+{
+	_events.clear();
+}
+
+
+inline Sequence::Events const&
+Sequence::events() const noexcept
+{
+	return _events;
+}
+
+
+inline Time
+Sequence::duration() const noexcept
+{
+	return _events.empty() ? 0_s : _events.back().time;
+}
+
+} // namespace MIDI
+
+} // namespace Haruhi
+
+#endif
+
@@ -0,0 +1,163 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iomanip>
+#include <ostream>
+#include <algorithm>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/application/services.h>
+#include <haruhi/graph/graph.h>
+#include <haruhi/graph/unit.h>
+#include <haruhi/utility/cpu_stats.h>
+#include <haruhi/utility/json.h>
+#include <haruhi/utility/work_performer.h>
+
+// Local:
+#include "cpu_stats_dump.h"
+
+
+namespace Haruhi {
+
+namespace CPUStatsDumpPrivate {
+
+typedef std::vector<std::pair<std::string, CPUStats::Snapshot>> NamedSnapshots;
+
+
+struct UnitStats
+{
+	int				id;
+	std::string		urn;
+	std::string		title;
+	CPUStats::Snapshot	snapshot;
+	NamedSnapshots	details;
+};
+
+
+void
+write_snapshot (std::ostream& out, CPUStats::Snapshot const& s)
+{
+	auto us = [](CPUStats::Nanoseconds ns) { return 1e-3 * ns; };
+
+	out << "{ \"samples\": " << s.samples
+		<< ", \"mean_us\": " << us (s.mean())
+		<< ", \"p50_us\": " << us (s.percentile (50.0))
+		<< ", \"p99_us\": " << us (s.percentile (99.0))
+		<< ", \"p999_us\": " << us (s.percentile (99.9))
+		<< ", \"worst_us\": " << us (s.worst)
+		<< ", \"last_us\": " << us (s.last)
+		<< ", \"overruns\": " << s.overruns
+		<< ", \"overrun_mean_us\": " << us (s.overruns > 0 ? s.overrun_total / s.overruns : 0)
+		<< ", \"overrun_worst_us\": " << us (s.overrun_worst)
+		<< " }";
+}
+
+} // namespace CPUStatsDumpPrivate
+
+
+void
+dump_cpu_stats (std::ostream& out, Graph const* graph, unsigned int indent)
+{
+	using namespace CPUStatsDumpPrivate;
+
+	CPUStats::Nanoseconds period_budget = 0;
+	CPUStats::Snapshot round;
+	std::vector<UnitStats> units;
+
+	graph->synchronize ([&] {
+		period_budget = graph->period_budget();
+		round = graph->round_cpu_stats().snapshot();
+		for (Unit* u: graph->units())
+		{
+			units.push_back ({ u->id(), u->urn(), u->title(), u->cpu_stats().snapshot(), { } });
+			u->collect_cpu_stats (units.back().details);
+		}
+	});
+
+	// Most expensive units first:
+	std::sort (units.begin(), units.end(), [](UnitStats const& a, UnitStats const& b) {
+		return a.snapshot.total > b.snapshot.total;
+	});
+
+	NamedSnapshots work_performers;
+	auto add_work_performer = [&] (char const* name, WorkPerformer* work_performer) {
+		if (work_performer)
+			work_performers.emplace_back (name, work_performer->cpu_stats());
+	};
+	add_work_performer ("hi_priority", Services::hi_priority_work_performer());
+	add_work_performer ("lo_priority", Services::lo_priority_work_performer());
+	add_work_performer ("graph", Services::graph_work_performer());
+
+	std::string const i1 (indent + 1, '\t');
+	std::string const i2 (indent + 2, '\t');
+	std::string const i3 (indent + 3, '\t');
+
+	std::ios::fmtflags const flags = out.flags();
+	std::streamsize const precision = out.precision();
+	out << std::fixed << std::setprecision (3);
+
+	out << "{\n";
+	out << i1 << "\"enabled\": " << (CPUStats::enabled() ? "true" : "false") << ",\n";
+	out << i1 << "\"period_budget_us\": " << 1e-3 * period_budget << ",\n";
+	out << i1 << "\"round\": ";
+	write_snapshot (out, round);
+	out << ",\n";
+
+	out << i1 << "\"units\": [\n";
+	for (std::size_t i = 0; i < units.size(); ++i)
+	{
+		UnitStats const& u = units[i];
+		out << i2 << "{\n";
+		out << i3 << "\"id\": " << u.id << ",\n";
+		out << i3 << "\"urn\": " << json_quoted (u.urn) << ",\n";
+		out << i3 << "\"title\": " << json_quoted (u.title) << ",\n";
+		out << i3 << "\"process\": ";
+		write_snapshot (out, u.snapshot);
+		out << (u.details.empty() ? "\n" : ",\n");
+		if (!u.details.empty())
+		{
+			out << i3 << "\"details\": {\n";
+			for (std::size_t d = 0; d < u.details.size(); ++d)
+			{
+				out << i3 << "\t" << json_quoted (u.details[d].first) << ": ";
+				write_snapshot (out, u.details[d].second);
+				out << (d + 1 < u.details.size() ? ",\n" : "\n");
+			}
+			out << i3 << "}\n";
+		}
+		out << i2 << "}" << (i + 1 < units.size() ? ",\n" : "\n");
+	}
+	out << i1 << "],\n";
+
+	out << i1 << "\"work_performers\": {\n";
+	for (std::size_t i = 0; i < work_performers.size(); ++i)
+	{
+		out << i2 << json_quoted (work_performers[i].first) << ": ";
+		write_snapshot (out, work_performers[i].second);
+		out << (i + 1 < work_performers.size() ? ",\n" : "\n");
+	}
+	out << i1 << "}\n";
+	out << std::string (indent, '\t') << "}";
+
+	out.flags (flags);
+	out.precision (precision);
+}
+
+} // namespace Haruhi
+
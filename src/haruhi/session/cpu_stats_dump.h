@@ -0,0 +1,43 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__SESSION__CPU_STATS_DUMP_H__INCLUDED
+#define HARUHI__SESSION__CPU_STATS_DUMP_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <ostream>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+
+namespace Haruhi {
+
+class Graph;
+
+/**
+ * Write CPU statistics of the graph (processing rounds and period budget),
+ * of all its units and of the global work performers as a JSON object.
+ * Graph is locked only for the time needed to copy statistics.
+ *
+ * \param	indent Number of tabs prepended to each line except the first one,
+ *			so that the object can be embedded into other JSON documents.
+ */
+extern void
+dump_cpu_stats (std::ostream&, Graph const*, unsigned int indent = 0);
+
+} // namespace Haruhi
+
+#endif
+
@@ -19,6 +19,7 @@
 #include <haruhi/utility/thread.h>
 #include <haruhi/utility/semaphore.h>
 #include <haruhi/utility/atomic.h>
+#include <haruhi/utility/trace.h>
 
 // Local:
 #include "engine.h"
@@ -26,8 +27,9 @@
 
 namespace Haruhi {
 
-Engine::Engine (Session* session):
+Engine::Engine (Session* session, Mode mode):
 	_session (session),
+	_mode (mode),
 	_quit (false),
 	_panic_pressed (false)
 {
@@ -45,18 +47,38 @@ Engine::~Engine()
 void
 Engine::run()
 {
+	AudioBackend* audio_backend = _session->graph()->audio_backend();
+
+	Trace::register_thread ("Engine");
+
+	if (_mode == Mode::Synchronous)
+		audio_backend->set_synchronous_round ([this] { round(); });
+
 	for (;;)
 	{
-		_session->graph()->enter_processing_round();
-		_session->graph()->audio_backend()->sync();
-		adjust_master_volume();
-		check_panic_button();
-		_session->graph()->leave_processing_round();
+		if (!audio_backend->synchronous())
+			round();
+		// Not part of round(), since in synchronous mode that
+		// runs in audio subsystem's real-time callback:
 		_session->update_level_meters();
-		_session->graph()->audio_backend()->data_ready();
+		audio_backend->data_ready();
 		if (_quit.load())
 			break;
 	}
+
+	if (_mode == Mode::Synchronous)
+		audio_backend->set_synchronous_round (AudioBackend::Round());
+}
+
+
+void
+Engine::round()
+{
+	_session->graph()->enter_processing_round();
+	_session->graph()->audio_backend()->sync();
+	adjust_master_volume();
+	check_panic_button();
+	_session->graph()->leave_processing_round();
 }
 
 
@@ -67,11 +89,8 @@ Engine::adjust_master_volume()
 	auto const& events = buffer->events();
 	for (auto& e: events)
 	{
-		if (e->event_type() == Event::ControllerEventType)
-		{
-			auto controller_event = static_cast<ControllerEvent const*> (e.get());
+		if (auto controller_event = e.as<ControllerEvent>())
 			_session->set_master_volume (controller_event->value());
-		}
 	}
 }
 
@@ -81,11 +100,10 @@ Engine::check_panic_button()
 {
 	auto buffer = _session->graph()->audio_backend()->panic_port()->buffer();
 	auto const& events = buffer->events();
-	for (auto e: events)
+	for (auto& e: events)
 	{
-		if (e->event_type() == Event::ControllerEventType)
+		if (auto controller_event = e.as<ControllerEvent>())
 		{
-			auto controller_event = static_cast<ControllerEvent const*> (e.get());
 			if (controller_event->value() >= 0.5 && _panic_pressed == false)
 			{
 				_panic_pressed = true;
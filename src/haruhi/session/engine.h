@@ -29,7 +29,18 @@ namespace Haruhi {
 class Engine: public Thread
 {
   public:
-	Engine (Session* session);
+	enum class Mode
+	{
+		// Engine thread runs rounds and hands data to audio backend
+		// in data_ready(). Adds one period of latency:
+		Threaded,
+		// Rounds are run from audio subsystem's callback. Engine thread runs
+		// them only when audio backend can't do that (eg. is disconnected):
+		Synchronous,
+	};
+
+  public:
+	Engine (Session* session, Mode mode = Mode::Threaded);
 
 	/**
 	 * Normal way to stop Engine is to delete it.
@@ -47,6 +58,12 @@ class Engine: public Thread
 	run() override;
 
   private:
+	/**
+	 * Run one processing round.
+	 */
+	void
+	round();
+
 	/**
 	 * Reads events from audio_backend()->master_volume_port()
 	 * and adjusts volume knob.
@@ -63,6 +80,7 @@ class Engine: public Thread
 
   private:
 	Session*		_session;
+	Mode			_mode;
 	Atomic<bool>	_quit;
 	bool			_panic_pressed;
 };
@@ -13,7 +13,7 @@
 
 // Standard:
 #include <cstddef>
-#include <set>
+#include <algorithm>
 
 // Qt:
 #include <QTimer>
@@ -30,6 +30,8 @@ namespace Haruhi {
 
 PeriodicUpdater* PeriodicUpdater::_singleton = nullptr;
 
+constexpr std::size_t PeriodicUpdater::QueueCapacity;
+
 
 void
 PeriodicUpdater::Receiver::schedule_for_update()
@@ -45,12 +47,15 @@ PeriodicUpdater::Receiver::forget_about_update()
 }
 
 
-PeriodicUpdater::PeriodicUpdater (int period_ms)
+PeriodicUpdater::PeriodicUpdater (int period_ms):
+	_queue (QueueCapacity)
 {
 	if (PeriodicUpdater::_singleton)
 		throw Exception ("PeriodicUpdater is a signleton, and can be instantiated only once");
 	PeriodicUpdater::_singleton = this;
 
+	_pending.reserve (QueueCapacity);
+
 	_timer = std::make_unique<QTimer> (this);
 	QObject::connect (_timer.get(), SIGNAL (timeout()), this, SLOT (timeout()));
 	_timer->start (period_ms);
@@ -65,33 +70,49 @@ PeriodicUpdater::~PeriodicUpdater()
 
 
 void
-PeriodicUpdater::schedule (Receiver* receiver)
+PeriodicUpdater::schedule (Receiver* receiver) noexcept
 {
-	Mutex::Lock lock (_set_mutex);
-	_set.insert (receiver);
+	if (receiver->_scheduled.exchange (true, std::memory_order_acq_rel))
+		return;
+
+	// If the queue is full, clear the flag so that next schedule() can retry:
+	if (!_queue.push (receiver))
+		receiver->_scheduled.store (false, std::memory_order_release);
 }
 
 
 void
 PeriodicUpdater::forget (Receiver* receiver)
 {
-	Mutex::Lock lock (_set_mutex);
-	_set.erase (receiver);
+	// Receiver may still be in the queue, so move it to _pending first:
+	take_scheduled();
+	_pending.erase (std::remove (_pending.begin(), _pending.end(), receiver), _pending.end());
+	receiver->_scheduled.store (false, std::memory_order_release);
 }
 
 
 void
-PeriodicUpdater::timeout()
+PeriodicUpdater::take_scheduled()
 {
-	Set copy;
+	Receiver* receiver;
+	while (_queue.pop (receiver))
+		_pending.push_back (receiver);
+}
 
-	_set_mutex.synchronize ([&] {
-		copy = _set;
-		_set.clear();
-	});
 
-	for (auto w: copy)
+void
+PeriodicUpdater::timeout()
+{
+	take_scheduled();
+
+	for (auto w: _pending)
+	{
+		// Clear the flag before update, so that changes made
+		// during periodic_update() get scheduled again:
+		w->_scheduled.store (false, std::memory_order_release);
 		w->periodic_update();
+	}
+	_pending.clear();
 }
 
 } // namespace Haruhi
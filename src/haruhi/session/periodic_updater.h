@@ -16,7 +16,7 @@
 
 // Standard:
 #include <cstddef>
-#include <set>
+#include <vector>
 
 // Qt:
 #include <QTimer>
@@ -24,7 +24,8 @@
 
 // Haruhi:
 #include <haruhi/config/all.h>
-#include <haruhi/utility/mutex.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/lock_free_queue.h>
 
 
 namespace Haruhi {
@@ -33,6 +34,10 @@ namespace Haruhi {
  * PeriodicUpdater calls periodically update() method
  * on all queued widgets. It's useful for UI updates
  * where no instant reaction is needed (knobs and other MIDI controls).
+ *
+ * Scheduling doesn't lock nor allocate, so it can be done from the audio thread.
+ * Each Receiver has a flag telling whether it's already queued, so
+ * a Receiver is in the queue at most once, no matter how often it's scheduled.
  */
 class PeriodicUpdater: public QObject
 {
@@ -41,11 +46,13 @@ class PeriodicUpdater: public QObject
   public:
 	class Receiver
 	{
+		friend class PeriodicUpdater;
+
 	  public:
 		/**
-		 * Receiver MUST NOT call schedule_for_update() or forget_about_update()
-		 * or PeriodicUpdater schedule()/forget() inside periodic_update()
-		 * as it would lead to deadlock.
+		 * Receiver MUST NOT call forget_about_update() or PeriodicUpdater::forget()
+		 * inside periodic_update(). Scheduling is allowed, receiver will be updated
+		 * on the next round.
 		 */
 		virtual void
 		periodic_update() = 0;
@@ -63,10 +70,17 @@ class PeriodicUpdater: public QObject
 		 */
 		void
 		forget_about_update();
+
+	  private:
+		Atomic<bool>	_scheduled { false };
 	};
 
   private:
-	typedef std::set<Receiver*> Set;
+	typedef std::vector<Receiver*>	Receivers;
+
+	// Maximum number of receivers waiting for update. Should be more
+	// than the number of widgets, since each receiver is queued at most once:
+	static constexpr std::size_t	QueueCapacity = 16384;
 
   public:
 	/**
@@ -80,27 +94,37 @@ class PeriodicUpdater: public QObject
 	singleton();
 
 	/**
-	 * Adds widget to set. After update object is removed.
+	 * Adds widget to queue. After update object is removed.
+	 * Wait-free if receiver is already queued, lock-free otherwise.
 	 * \threadsafe
 	 */
 	void
-	schedule (Receiver* receiver);
+	schedule (Receiver* receiver) noexcept;
 
 	/**
-	 * Removes widget from set.
+	 * Removes widget from queue.
 	 * Can be called only from the UI thread.
 	 */
 	void
 	forget (Receiver* receiver);
 
+  private:
+	/**
+	 * Move receivers from the lock-free queue to _pending list.
+	 * Called from the UI thread.
+	 */
+	void
+	take_scheduled();
+
   private slots:
 	void
 	timeout();
 
   private:
 	static owner<PeriodicUpdater*>	_singleton;
-	Set								_set;
-	Mutex							_set_mutex;
+	LockFreeQueue<Receiver*>		_queue;
+	// Accessed only from the UI thread:
+	Receivers						_pending;
 	Unique<QTimer>					_timer;
 };
 
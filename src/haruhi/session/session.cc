@@ -14,6 +14,7 @@
 // Standard:
 #include <cstddef>
 #include <typeinfo>
+#include <fstream>
 
 // Qt:
 #include <QFile>
@@ -37,12 +38,14 @@
 #include <haruhi/application/services.h>
 #include <haruhi/components/audio_backend/backend.h>
 #include <haruhi/components/event_backend/backend.h>
+#include <haruhi/session/cpu_stats_dump.h>
 #include <haruhi/session/periodic_updater.h>
 #include <haruhi/settings/haruhi_settings.h>
 #include <haruhi/settings/session_loader_settings.h>
 #include <haruhi/widgets/clickable_label.h>
 #include <haruhi/utility/numeric.h>
 #include <haruhi/utility/qdom.h>
+#include <haruhi/utility/trace.h>
 
 // Local:
 #include "session.h"
@@ -212,6 +215,16 @@ Private::HaruhiGlobal::HaruhiGlobal (Session* session, QWidget* parent):
 	_engine_thread_priority->setToolTip ("Higher values mean higher priority");
 	QObject::connect (_engine_thread_priority.get(), SIGNAL (valueChanged (int)), this, SLOT (update_params()));
 
+	_synchronous_engine = std::make_unique<QCheckBox> ("Process in JACK callback", this);
+	_synchronous_engine->setToolTip ("Removes one period of latency. Takes effect when session is loaded again.");
+	QObject::connect (_synchronous_engine.get(), SIGNAL (toggled (bool)), this, SLOT (update_params()));
+
+	_graph_threads = std::make_unique<QSpinBox> (this);
+	_graph_threads->setRange (0, 64);
+	_graph_threads->setValue (0);
+	_graph_threads->setToolTip ("Threads processing independent plugins concurrently, taken from voice rendering. Takes effect after restart.");
+	QObject::connect (_graph_threads.get(), SIGNAL (valueChanged (int)), this, SLOT (update_params()));
+
 	_level_meter_fps = std::make_unique<QSpinBox> (this);
 	_level_meter_fps->setRange (10, 50);
 	_level_meter_fps->setValue (30);
@@ -220,10 +233,13 @@ Private::HaruhiGlobal::HaruhiGlobal (Session* session, QWidget* parent):
 	auto group_layout = new QGridLayout (this);
 	group_layout->addWidget (new QLabel ("Engine thread priority:", this), 0, 0);
 	group_layout->addWidget (_engine_thread_priority.get(), 0, 1);
-	group_layout->addWidget (new QLabel ("Level Meter FPS:", this), 1, 0);
-	group_layout->addWidget (_level_meter_fps.get(), 1, 1);
+	group_layout->addWidget (_synchronous_engine.get(), 1, 1);
+	group_layout->addWidget (new QLabel ("Graph threads:", this), 2, 0);
+	group_layout->addWidget (_graph_threads.get(), 2, 1);
+	group_layout->addWidget (new QLabel ("Level Meter FPS:", this), 3, 0);
+	group_layout->addWidget (_level_meter_fps.get(), 3, 1);
 	group_layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Expanding, QSizePolicy::Fixed), 0, 2);
-	group_layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Fixed, QSizePolicy::Expanding), 2, 0);
+	group_layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Fixed, QSizePolicy::Expanding), 4, 0);
 
 	update_widgets();
 }
@@ -236,6 +252,8 @@ Private::HaruhiGlobal::load_params()
 
 	_loading_params = true;
 	_engine_thread_priority->setValue (haruhi_settings->engine_thread_priority());
+	_synchronous_engine->setChecked (haruhi_settings->synchronous_engine());
+	_graph_threads->setValue (haruhi_settings->graph_threads());
 	_level_meter_fps->setValue (haruhi_settings->level_meter_fps());
 	_loading_params = false;
 
@@ -252,6 +270,8 @@ Private::HaruhiGlobal::update_params()
 	auto haruhi_settings = Haruhi::haruhi()->haruhi_settings();
 
 	haruhi_settings->set_engine_thread_priority (_engine_thread_priority->value());
+	haruhi_settings->set_synchronous_engine (_synchronous_engine->isChecked());
+	haruhi_settings->set_graph_threads (_graph_threads->value());
 	haruhi_settings->set_level_meter_fps (_level_meter_fps->value());
 	haruhi_settings->save();
 	update_widgets();
@@ -465,8 +485,16 @@ Session::Session (QWidget* parent):
 	_haruhi_settings->addTab (_haruhi_global.get(), Resources::Icons16::configure(), "Haruhi settings");
 	_haruhi_settings->addTab (_devices_manager.get(), Resources::Icons16::keyboard(), "Device templates");
 
+	if (Trace::enabled())
+		_trace_dumper = std::make_unique<TraceDumper> (_graph.get());
+
+	_graph->execution_plan_invalidated.connect (this, &Session::execution_plan_invalidated);
+
 	// Start engine and backends before program is loaded:
-	_engine = std::make_unique<Engine> (this);
+	_engine = std::make_unique<Engine> (this, engine_mode());
+	// Process independent units concurrently, if configured:
+	_graph->set_work_performer (Services::graph_work_performer());
+
 	start_event_backend();
 	start_audio_backend();
 	_engine->start();
@@ -486,12 +514,16 @@ Session::Session (QWidget* parent):
 Session::~Session()
 {
 	// In this order:
+	_trace_dumper.reset();
 	_program.reset();
 	_plugin_loader.reset();
 
 	_engine.reset();
 	stop_audio_backend();
 	stop_event_backend();
+	// Graph won't exist when call-out is made:
+	if (_execution_plan_call_out)
+		_execution_plan_call_out->cancel();
 	_graph.reset();
 }
 
@@ -506,6 +538,8 @@ Session::apply_parameters()
 	engine()->set_sched (Thread::SchedFIFO, prio);
 	Services::hi_priority_work_performer()->set_sched (Thread::SchedFIFO, prio);
 	Services::lo_priority_work_performer()->set_sched (Thread::SchedOther, 0);
+	if (Services::graph_work_performer())
+		Services::graph_work_performer()->set_sched (Thread::SchedFIFO, prio);
 	meter_panel()->level_meters_group()->set_fps (haruhi_settings->level_meter_fps());
 	meter_panel()->master_volume()->setValue (_parameters.master_volume);
 }
@@ -530,6 +564,9 @@ Session::load_session (QString const& file_name)
 		else
 			throw Exception ("Failed to process session file: invalid XML root element.");
 
+		// Don't wait for the call-out, session may be rendered right away:
+		_graph->update_execution_plan();
+
 		_file_name = file_name;
 
 		// Add session to recent sessions list:
@@ -654,7 +691,7 @@ Session::load_state (QDomElement const& element)
 		if (auto sst = dynamic_cast<SaveableState*> (_event_backend.get()))
 			sst->load_state (event_backend_element);
 
-		_engine = std::make_unique<Engine> (this);
+		_engine = std::make_unique<Engine> (this, engine_mode());
 		_program->load_state (program_element);
 
 		// Restore connections, parameters, etc. before starting engine:
@@ -744,6 +781,56 @@ Session::save_session_as()
 }
 
 
+void
+Session::save_cpu_stats()
+{
+	auto file_dialog = new QFileDialog (this, "Save CPU statistics", ".", QString());
+	file_dialog->setNameFilter ("JSON files (*.json)");
+	file_dialog->setFileMode (QFileDialog::AnyFile);
+	file_dialog->setAcceptMode (QFileDialog::AcceptSave);
+	if (file_dialog->exec() == QFileDialog::Accepted)
+	{
+		QString file_name = file_dialog->selectedFiles().front();
+		if (!file_name.endsWith (".json", Qt::CaseInsensitive))
+			file_name += ".json";
+
+		std::ofstream file (file_name.toStdString());
+		if (file)
+		{
+			Haruhi::dump_cpu_stats (file, graph());
+			file << std::endl;
+		}
+		if (!file)
+			QMessageBox::warning (this, "Error while saving CPU statistics", "Could not write to file " + file_name.toHtmlEscaped() + ".");
+	}
+}
+
+
+void
+Session::save_trace()
+{
+	if (!_trace_dumper)
+	{
+		QMessageBox::warning (this, "Tracing not available", "Haruhi has been compiled without tracing support (HARUHI_TRACE).");
+		return;
+	}
+
+	auto file_dialog = new QFileDialog (this, "Save trace", ".", QString());
+	file_dialog->setNameFilter ("Chrome/Perfetto trace files (*.json)");
+	file_dialog->setFileMode (QFileDialog::AnyFile);
+	file_dialog->setAcceptMode (QFileDialog::AcceptSave);
+	if (file_dialog->exec() == QFileDialog::Accepted)
+	{
+		QString file_name = file_dialog->selectedFiles().front();
+		if (!file_name.endsWith (".json", Qt::CaseInsensitive))
+			file_name += ".json";
+
+		if (!_trace_dumper->dump (file_name))
+			QMessageBox::warning (this, "Error while saving trace", "Could not write to file " + file_name.toHtmlEscaped() + ".");
+	}
+}
+
+
 void
 Session::rename_session()
 {
@@ -797,6 +884,8 @@ Session::create_main_menu()
 	_main_menu->addAction (Resources::Icons16::save_as(), "Sa&ve as…", this, SLOT (save_session_as()), Qt::CTRL + Qt::SHIFT + Qt::Key_S);
 	_main_menu->addSeparator();
 	_main_menu->addAction (Resources::Icons16::disconnect(), "&Reconnect to JACK", this, SLOT (reconnect_to_jack()), Qt::CTRL + Qt::Key_J);
+	_main_menu->addAction ("Save &CPU statistics…", this, SLOT (save_cpu_stats()));
+	_main_menu->addAction ("Save &trace…", this, SLOT (save_trace()));
 	_main_menu->addSeparator();
 	_main_menu->addAction (Resources::Icons16::exit(), "&Quit", Haruhi::haruhi()->application(), SLOT (quit()), Qt::CTRL + Qt::Key_Q);
 }
@@ -885,6 +974,19 @@ Session::audio_backend_state_change (bool)
 }
 
 
+void
+Session::execution_plan_invalidated()
+{
+	// Graph emits the signal only once until plan is updated,
+	// so there's at most one call-out pending:
+	_execution_plan_call_out = Services::call_out ([this] {
+		Mutex::Lock lock (*_graph);
+		_execution_plan_call_out = nullptr;
+		_graph->update_execution_plan();
+	});
+}
+
+
 void
 Session::master_volume_changed (int value)
 {
@@ -939,5 +1041,14 @@ Session::create_container (QWidget* parent)
 	return w;
 }
 
+
+Engine::Mode
+Session::engine_mode() const
+{
+	if (Haruhi::haruhi()->haruhi_settings()->synchronous_engine())
+		return Engine::Mode::Synchronous;
+	return Engine::Mode::Threaded;
+}
+
 } // namespace Haruhi
 
@@ -21,6 +21,7 @@
 #include <QWidget>
 #include <QTabWidget>
 #include <QSpinBox>
+#include <QCheckBox>
 #include <QPushButton>
 #include <QDialog>
 #include <QLineEdit>
@@ -30,6 +31,7 @@
 
 // Haruhi:
 #include <haruhi/config/all.h>
+#include <haruhi/application/services.h>
 #include <haruhi/graph/graph.h>
 #include <haruhi/components/audio_backend/backend.h>
 #include <haruhi/components/event_backend/backend.h>
@@ -37,6 +39,7 @@
 #include <haruhi/plugin/plugin_loader.h>
 #include <haruhi/session/engine.h>
 #include <haruhi/session/program.h>
+#include <haruhi/session/trace_dumper.h>
 #include <haruhi/utility/thread.h>
 #include <haruhi/utility/mutex.h>
 #include <haruhi/utility/signal.h>
@@ -133,6 +136,8 @@ namespace SessionPrivate {
 		bool				_loading_params;
 
 		Unique<QSpinBox>	_engine_thread_priority;
+		Unique<QCheckBox>	_synchronous_engine;
+		Unique<QSpinBox>	_graph_threads;
 		Unique<QSpinBox>	_level_meter_fps;
 	};
 
@@ -287,6 +292,18 @@ class Session:
 	void
 	save_session_as();
 
+	/**
+	 * Ask for file name and write CPU statistics there.
+	 */
+	void
+	save_cpu_stats();
+
+	/**
+	 * Ask for file name and write trace of real-time threads there.
+	 */
+	void
+	save_trace();
+
 	void
 	rename_session();
 
@@ -320,6 +337,14 @@ class Session:
 	void
 	audio_backend_state_change (bool);
 
+	/**
+	 * Schedules compilation of Graph's execution plan from within
+	 * Qt event loop, that is after current batch of changes.
+	 * \entry	Graph locked.
+	 */
+	void
+	execution_plan_invalidated();
+
 	void
 	show_program();
 
@@ -349,6 +374,12 @@ class Session:
 	Unique<QWidget>
 	create_container (QWidget* parent);
 
+	/**
+	 * Return engine mode selected in Haruhi settings.
+	 */
+	Engine::Mode
+	engine_mode() const;
+
   private:
 	QString									_name;
 	QString									_file_name;
@@ -364,9 +395,13 @@ class Session:
 
 	// In this order:
 	Unique<Graph>							_graph;
+	// Pending update of Graph's execution plan, guarded by Graph lock:
+	Services::CallOutEvent*					_execution_plan_call_out	= nullptr;
 	Unique<Engine>							_engine;
 	Unique<PluginLoader>					_plugin_loader;
 	Unique<Program>							_program;
+	// Only if tracing is compiled in:
+	Unique<TraceDumper>						_trace_dumper;
 
 	Unique<QTabWidget>						_session_settings;
 	Unique<QTabWidget>						_haruhi_settings;
@@ -0,0 +1,120 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+// Qt:
+#include <QDateTime>
+#include <QDir>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/graph/execution_plan.h>
+#include <haruhi/graph/graph.h>
+#include <haruhi/graph/unit.h>
+#include <haruhi/utility/trace.h>
+
+// Local:
+#include "trace_dumper.h"
+
+
+namespace Haruhi {
+
+constexpr int TraceDumper::CheckPeriodMs;
+
+
+TraceDumper::TraceDumper (Graph* graph):
+	_graph (graph)
+{
+	// Keep spans preceding an xrun until check_xruns() dumps them:
+	Trace::set_freeze_on_xrun (true);
+
+	_timer = std::make_unique<QTimer> (this);
+	QObject::connect (_timer.get(), SIGNAL (timeout()), this, SLOT (check_xruns()));
+	_timer->start (CheckPeriodMs);
+}
+
+
+TraceDumper::~TraceDumper()
+{
+	Trace::set_freeze_on_xrun (false);
+	Trace::thaw();
+}
+
+
+void
+TraceDumper::dump (std::ostream& out) const
+{
+	std::map<int64_t, std::string> unit_titles;
+	_graph->synchronize ([&] {
+		for (Unit* u: _graph->units())
+			unit_titles[u->id()] = u->title();
+	});
+
+	Trace::write_chrome_json (out, [&] (Trace::Event const& event) -> std::string {
+		if (event.name == ExecutionPlan::UnitProcessSpan)
+		{
+			auto title = unit_titles.find (event.argument);
+			if (title != unit_titles.end())
+				return title->second;
+		}
+		return event.name;
+	});
+	out << std::endl;
+}
+
+
+bool
+TraceDumper::dump (QString const& file_name) const
+{
+	std::ofstream file (file_name.toStdString());
+	if (file)
+		dump (file);
+	return !!file;
+}
+
+
+void
+TraceDumper::check_xruns()
+{
+	// Minimum time between automatic dumps, so that a series of xruns
+	// doesn't flood the disk:
+	Time const dump_interval = 10_s;
+
+	if (!Trace::take_xrun())
+		return;
+
+	Time const now = Time::now();
+	if (now - _last_dump >= dump_interval)
+	{
+		_last_dump = now;
+
+		QString const file_name = QDir (QDir::tempPath()).filePath ("haruhi-xrun-" + QDateTime::currentDateTime().toString ("yyyyMMdd-hhmmss") + ".json");
+		if (dump (file_name))
+			std::clog << "INFO[Trace] xrun, trace saved to " << file_name.toStdString() << std::endl;
+		else
+			std::clog << "ERROR[Trace] xrun, could not save trace to " << file_name.toStdString() << std::endl;
+	}
+
+	// Buffers were frozen by the xrun:
+	Trace::thaw();
+}
+
+} // namespace Haruhi
+
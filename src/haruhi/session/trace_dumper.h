@@ -0,0 +1,86 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__SESSION__TRACE_DUMPER_H__INCLUDED
+#define HARUHI__SESSION__TRACE_DUMPER_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <ostream>
+
+// Qt:
+#include <QObject>
+#include <QTimer>
+#include <QString>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+
+namespace Haruhi {
+
+class Graph;
+
+/**
+ * Writes trace recorded by Trace to files. Checks periodically
+ * if there was an xrun, and if so, dumps the trace of last moments
+ * before it into a file in temporary directory. Trace buffers are
+ * frozen from the xrun until the dump is written.
+ */
+class TraceDumper: public QObject
+{
+	Q_OBJECT
+
+	// How often to check for xruns:
+	static constexpr int	CheckPeriodMs	= 500;
+
+  public:
+	/**
+	 * \param	graph Graph which units' titles will be used as span labels.
+	 */
+	explicit
+	TraceDumper (Graph* graph);
+
+	// Dtor
+	~TraceDumper();
+
+	/**
+	 * Write trace as Chrome/Perfetto JSON.
+	 */
+	void
+	dump (std::ostream&) const;
+
+	/**
+	 * Write trace into given file.
+	 * Return false on error.
+	 */
+	bool
+	dump (QString const& file_name) const;
+
+  private slots:
+	/**
+	 * Dump trace if there was an xrun.
+	 */
+	void
+	check_xruns();
+
+  private:
+	Graph*			_graph;
+	Unique<QTimer>	_timer;
+	Time			_last_dump		= 0_s;
+};
+
+} // namespace Haruhi
+
+#endif
+
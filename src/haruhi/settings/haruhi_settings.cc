@@ -28,6 +28,8 @@ namespace Haruhi {
 HaruhiSettings::HaruhiSettings():
 	Module ("haruhi"),
 	_engine_thread_priority (50),
+	_synchronous_engine (false),
+	_graph_threads (0),
 	_level_meter_fps (30)
 {
 }
@@ -40,11 +42,16 @@ HaruhiSettings::load_state (QDomElement const& element)
 	{
 		if (e.tagName() == "engine-thread-priority")
 			_engine_thread_priority = e.text().toInt();
+		else if (e.tagName() == "synchronous-engine")
+			_synchronous_engine = e.text() == "true";
+		else if (e.tagName() == "graph-threads")
+			_graph_threads = e.text().toInt();
 		else if (e.tagName() == "level-meter-fps")
 			_level_meter_fps = e.text().toInt();
 	}
 
 	clamp (_engine_thread_priority, 1, 99);
+	clamp (_graph_threads, 0, 64);
 	clamp (_level_meter_fps, 10, 50);
 }
 
@@ -55,10 +62,18 @@ HaruhiSettings::save_state (QDomElement& element) const
 	QDomElement par_engine_thread_priority = element.ownerDocument().createElement ("engine-thread-priority");
 	par_engine_thread_priority.appendChild (element.ownerDocument().createTextNode (QString::number (_engine_thread_priority)));
 
+	QDomElement par_synchronous_engine = element.ownerDocument().createElement ("synchronous-engine");
+	par_synchronous_engine.appendChild (element.ownerDocument().createTextNode (_synchronous_engine ? "true" : "false"));
+
+	QDomElement par_graph_threads = element.ownerDocument().createElement ("graph-threads");
+	par_graph_threads.appendChild (element.ownerDocument().createTextNode (QString::number (_graph_threads)));
+
 	QDomElement par_level_meter_fps = element.ownerDocument().createElement ("level-meter-fps");
 	par_level_meter_fps.appendChild (element.ownerDocument().createTextNode (QString::number (_level_meter_fps)));
 
 	element.appendChild (par_engine_thread_priority);
+	element.appendChild (par_synchronous_engine);
+	element.appendChild (par_graph_threads);
 	element.appendChild (par_level_meter_fps);
 }
 
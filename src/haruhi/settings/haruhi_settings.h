@@ -40,6 +40,26 @@ class HaruhiSettings: public Settings::Module
 	void
 	set_engine_thread_priority (int value);
 
+	/**
+	 * Whether to run processing rounds directly from audio subsystem's callback.
+	 */
+	bool
+	synchronous_engine() const;
+
+	void
+	set_synchronous_engine (bool value);
+
+	/**
+	 * Number of threads processing independent graph units together
+	 * with the engine thread. 0 means units are processed serially.
+	 * Takes effect after restart.
+	 */
+	int
+	graph_threads() const;
+
+	void
+	set_graph_threads (int value);
+
 	int
 	level_meter_fps() const;
 
@@ -57,8 +77,10 @@ class HaruhiSettings: public Settings::Module
 	save_state (QDomElement& element) const override;
 
   private:
-	int	_engine_thread_priority;
-	int	_level_meter_fps;
+	int		_engine_thread_priority;
+	bool	_synchronous_engine;
+	int		_graph_threads;
+	int		_level_meter_fps;
 };
 
 
@@ -76,6 +98,34 @@ HaruhiSettings::set_engine_thread_priority (int value)
 }
 
 
+inline bool
+HaruhiSettings::synchronous_engine() const
+{
+	return _synchronous_engine;
+}
+
+
+inline void
+HaruhiSettings::set_synchronous_engine (bool value)
+{
+	_synchronous_engine = value;
+}
+
+
+inline int
+HaruhiSettings::graph_threads() const
+{
+	return _graph_threads;
+}
+
+
+inline void
+HaruhiSettings::set_graph_threads (int value)
+{
+	_graph_threads = value;
+}
+
+
 inline int
 HaruhiSettings::level_meter_fps() const
 {
@@ -0,0 +1,88 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__UTILITY__COUNTDOWN_LATCH_H__INCLUDED
+#define HARUHI__UTILITY__COUNTDOWN_LATCH_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/noncopyable.h>
+#include <haruhi/utility/semaphore.h>
+
+
+/**
+ * Lets one thread wait until a number of tasks running on other threads
+ * are done. Each task calls count_down() once; the last one wakes up
+ * the waiting thread. Can be reused after wait() returns.
+ */
+class CountdownLatch: private Noncopyable
+{
+  public:
+	/**
+	 * Set number of count_down() calls to wait for.
+	 * No thread may wait on the latch or count it down at the moment of the call.
+	 */
+	void
+	reset (std::size_t count) noexcept;
+
+	/**
+	 * Mark one task as done.
+	 * \threadsafe
+	 */
+	void
+	count_down() noexcept;
+
+	/**
+	 * Block until counter reaches zero.
+	 * There can be only one waiting thread.
+	 */
+	void
+	wait() const noexcept;
+
+  private:
+	Atomic<std::size_t>	_count		{ 0 };
+	// Set in reset(), tells whether there will be a post on the semaphore:
+	bool				_armed		= false;
+	Semaphore			_semaphore;
+};
+
+
+inline void
+CountdownLatch::reset (std::size_t count) noexcept
+{
+	_armed = count > 0;
+	_count.store (count, std::memory_order_release);
+}
+
+
+inline void
+CountdownLatch::count_down() noexcept
+{
+	if (_count.fetch_sub (1, std::memory_order_acq_rel) == 1)
+		_semaphore.post();
+}
+
+
+inline void
+CountdownLatch::wait() const noexcept
+{
+	if (_armed)
+		_semaphore.wait();
+}
+
+#endif
+
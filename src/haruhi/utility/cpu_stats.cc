@@ -0,0 +1,84 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+
+// Local:
+#include "cpu_stats.h"
+
+
+constexpr std::size_t CPUStats::BucketsNumber;
+
+
+CPUStats::Nanoseconds
+CPUStats::Snapshot::mean() const noexcept
+{
+	return samples > 0 ? total / samples : 0;
+}
+
+
+CPUStats::Nanoseconds
+CPUStats::Snapshot::percentile (double p) const noexcept
+{
+	if (samples == 0)
+		return 0;
+
+	uint64_t const rank = std::max<uint64_t> (1, std::ceil (p / 100.0 * samples));
+	uint64_t accumulated = 0;
+
+	for (std::size_t i = 0; i < BucketsNumber; ++i)
+	{
+		accumulated += buckets[i];
+		if (accumulated >= rank)
+			return std::min (worst, (Nanoseconds (1) << (i + 1)) - 1);
+	}
+
+	return worst;
+}
+
+
+CPUStats::Snapshot&
+CPUStats::Snapshot::operator+= (Snapshot const& other) noexcept
+{
+	samples += other.samples;
+	total += other.total;
+	worst = std::max (worst, other.worst);
+	last = other.last;
+	overruns += other.overruns;
+	overrun_total += other.overrun_total;
+	overrun_worst = std::max (overrun_worst, other.overrun_worst);
+	for (std::size_t i = 0; i < BucketsNumber; ++i)
+		buckets[i] += other.buckets[i];
+	return *this;
+}
+
+
+CPUStats::Snapshot
+CPUStats::snapshot() const noexcept
+{
+	Snapshot result;
+	result.samples = _samples.load (std::memory_order_relaxed);
+	result.total = _total.load (std::memory_order_relaxed);
+	result.worst = _worst.load (std::memory_order_relaxed);
+	result.last = _last.load (std::memory_order_relaxed);
+	result.overruns = _overruns.load (std::memory_order_relaxed);
+	result.overrun_total = _overrun_total.load (std::memory_order_relaxed);
+	result.overrun_worst = _overrun_worst.load (std::memory_order_relaxed);
+	for (std::size_t i = 0; i < BucketsNumber; ++i)
+		result.buckets[i] = _buckets[i].load (std::memory_order_relaxed);
+	return result;
+}
+
@@ -0,0 +1,313 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__UTILITY__CPU_STATS_H__INCLUDED
+#define HARUHI__UTILITY__CPU_STATS_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+// System:
+#include <time.h>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/noncopyable.h>
+
+
+/**
+ * Lock-free statistics of time spent in some piece of code, like
+ * Unit::process(), rendering of a synth part or WorkPerformer jobs.
+ *
+ * Durations are kept in a logarithmic histogram (bucket n holds samples
+ * in range [2^n, 2^(n+1)) ns), so percentiles can be estimated without
+ * storing samples. Samples that were taken in processing rounds that didn't
+ * fit in the period budget can be additionally accounted as overrun samples
+ * with mark_overrun().
+ *
+ * There may be only one writer at a time (successive writers must be
+ * synchronized with each other, which is true for code run once per
+ * processing round), but any number of readers calling snapshot().
+ *
+ * Time is measured with CLOCK_MONOTONIC_RAW, which doesn't need
+ * calibration and is consistent between CPU cores. Measurements are compiled
+ * in only if HARUHI_CPU_STATS is defined. Otherwise Measurement and Stopwatch
+ * do nothing and statistics stay empty.
+ */
+class CPUStats: private Noncopyable
+{
+  public:
+	typedef uint64_t Nanoseconds;
+
+	static constexpr std::size_t BucketsNumber = 32;
+
+	/**
+	 * Copy of statistics at some point in time.
+	 */
+	struct Snapshot
+	{
+		uint64_t								samples			= 0;
+		Nanoseconds								total			= 0;
+		Nanoseconds								worst			= 0;
+		Nanoseconds								last			= 0;
+		uint64_t								overruns		= 0;
+		Nanoseconds								overrun_total	= 0;
+		Nanoseconds								overrun_worst	= 0;
+		std::array<uint64_t, BucketsNumber>		buckets			= { };
+
+		/**
+		 * Return mean duration or 0 if there are no samples.
+		 */
+		Nanoseconds
+		mean() const noexcept;
+
+		/**
+		 * Estimate percentile (0…100) from histogram.
+		 * Return upper bound of the bucket containing given percentile.
+		 */
+		Nanoseconds
+		percentile (double p) const noexcept;
+
+		/**
+		 * Add samples from other snapshot (eg. to sum per-thread statistics).
+		 */
+		Snapshot&
+		operator+= (Snapshot const&) noexcept;
+	};
+
+	/**
+	 * Records time between construction and destruction.
+	 */
+	class Measurement: private Noncopyable
+	{
+	  public:
+		explicit
+		Measurement (CPUStats&) noexcept;
+
+		~Measurement();
+
+#ifdef HARUHI_CPU_STATS
+	  private:
+		CPUStats&	_stats;
+		Nanoseconds	_start;
+#endif
+	};
+
+	/**
+	 * Stores time between construction and destruction in given variable.
+	 * Variable is not touched if measurements are compiled out.
+	 */
+	class Stopwatch: private Noncopyable
+	{
+	  public:
+		explicit
+		Stopwatch (Nanoseconds& result) noexcept;
+
+		~Stopwatch();
+
+#ifdef HARUHI_CPU_STATS
+	  private:
+		Nanoseconds&	_result;
+		Nanoseconds		_start;
+#endif
+	};
+
+  public:
+	/**
+	 * Return true if measurements are compiled in.
+	 */
+	static constexpr bool
+	enabled() noexcept;
+
+	/**
+	 * Return current time.
+	 */
+	static Nanoseconds
+	now() noexcept;
+
+	/**
+	 * Add sample.
+	 * \entry	One writer at a time.
+	 */
+	void
+	record (Nanoseconds) noexcept;
+
+	/**
+	 * Account last recorded sample also as overrun sample.
+	 * \entry	One writer at a time.
+	 */
+	void
+	mark_overrun() noexcept;
+
+	/**
+	 * Return copy of statistics. Values are read one by one,
+	 * so a snapshot taken while a sample is being recorded may
+	 * be off by that sample.
+	 * \threadsafe
+	 */
+	Snapshot
+	snapshot() const noexcept;
+
+  private:
+	/**
+	 * Return histogram bucket for given duration.
+	 */
+	static std::size_t
+	bucket_for (Nanoseconds) noexcept;
+
+	/**
+	 * Add to value. Doesn't need atomic read-modify-write,
+	 * since there's only one writer.
+	 */
+	static void
+	add (Atomic<uint64_t>&, uint64_t) noexcept;
+
+	/**
+	 * Set value to maximum of itself and given value.
+	 */
+	static void
+	maximize (Atomic<uint64_t>&, uint64_t) noexcept;
+
+  private:
+	Atomic<uint64_t>							_samples		{ 0 };
+	Atomic<Nanoseconds>							_total			{ 0 };
+	Atomic<Nanoseconds>							_worst			{ 0 };
+	Atomic<Nanoseconds>							_last			{ 0 };
+	Atomic<uint64_t>							_overruns		{ 0 };
+	Atomic<Nanoseconds>							_overrun_total	{ 0 };
+	Atomic<Nanoseconds>							_overrun_worst	{ 0 };
+	std::array<Atomic<uint64_t>, BucketsNumber>	_buckets		= { };
+};
+
+
+#ifdef HARUHI_CPU_STATS
+
+inline
+CPUStats::Measurement::Measurement (CPUStats& stats) noexcept:
+	_stats (stats),
+	_start (CPUStats::now())
+{ }
+
+
+inline
+CPUStats::Measurement::~Measurement()
+{
+	_stats.record (CPUStats::now() - _start);
+}
+
+
+inline
+CPUStats::Stopwatch::Stopwatch (Nanoseconds& result) noexcept:
+	_result (result),
+	_start (CPUStats::now())
+{ }
+
+
+inline
+CPUStats::Stopwatch::~Stopwatch()
+{
+	_result = CPUStats::now() - _start;
+}
+
+#else
+
+inline
+CPUStats::Measurement::Measurement (CPUStats&) noexcept
+{ }
+
+
+inline
+CPUStats::Measurement::~Measurement()
+{ }
+
+
+inline
+CPUStats::Stopwatch::Stopwatch (Nanoseconds&) noexcept
+{ }
+
+
+inline
+CPUStats::Stopwatch::~Stopwatch()
+{ }
+
+#endif
+
+
+inline constexpr bool
+CPUStats::enabled() noexcept
+{
+#ifdef HARUHI_CPU_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+inline CPUStats::Nanoseconds
+CPUStats::now() noexcept
+{
+	struct timespec ts;
+	::clock_gettime (CLOCK_MONOTONIC_RAW, &ts);
+	return static_cast<Nanoseconds> (ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+
+inline void
+CPUStats::record (Nanoseconds duration) noexcept
+{
+	add (_samples, 1);
+	add (_total, duration);
+	maximize (_worst, duration);
+	_last.store (duration, std::memory_order_relaxed);
+	add (_buckets[bucket_for (duration)], 1);
+}
+
+
+inline void
+CPUStats::mark_overrun() noexcept
+{
+	Nanoseconds const last = _last.load (std::memory_order_relaxed);
+	add (_overruns, 1);
+	add (_overrun_total, last);
+	maximize (_overrun_worst, last);
+}
+
+
+inline std::size_t
+CPUStats::bucket_for (Nanoseconds duration) noexcept
+{
+	std::size_t const log2 = 63 - __builtin_clzll (duration | 1);
+	return log2 < BucketsNumber ? log2 : BucketsNumber - 1;
+}
+
+
+inline void
+CPUStats::add (Atomic<uint64_t>& value, uint64_t addend) noexcept
+{
+	value.store (value.load (std::memory_order_relaxed) + addend, std::memory_order_relaxed);
+}
+
+
+inline void
+CPUStats::maximize (Atomic<uint64_t>& value, uint64_t candidate) noexcept
+{
+	if (candidate > value.load (std::memory_order_relaxed))
+		value.store (candidate, std::memory_order_relaxed);
+}
+
+#endif
+
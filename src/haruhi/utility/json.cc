@@ -0,0 +1,50 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Local:
+#include "json.h"
+
+
+std::string
+json_quoted (std::string const& string)
+{
+	std::string result = "\"";
+	for (char c: string)
+	{
+		switch (c)
+		{
+			case '"':	result += "\\\""; break;
+			case '\\':	result += "\\\\"; break;
+			case '\b':	result += "\\b"; break;
+			case '\f':	result += "\\f"; break;
+			case '\n':	result += "\\n"; break;
+			case '\r':	result += "\\r"; break;
+			case '\t':	result += "\\t"; break;
+			default:
+				if (static_cast<unsigned char> (c) < 0x20)
+				{
+					char escaped[7];
+					std::snprintf (escaped, sizeof (escaped), "\\u%04x", static_cast<unsigned int> (c));
+					result += escaped;
+				}
+				else
+					result += c;
+		}
+	}
+	return result + "\"";
+}
@@ -0,0 +1,33 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__UTILITY__JSON_H__INCLUDED
+#define HARUHI__UTILITY__JSON_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <string>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+
+/**
+ * Return string as JSON string literal, with quotes and escape sequences.
+ * String is assumed to be UTF-8 encoded, non-ASCII bytes are left as they are.
+ */
+std::string
+json_quoted (std::string const& string);
+
+#endif
+
@@ -0,0 +1,198 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__UTILITY__LOCK_FREE_QUEUE_H__INCLUDED
+#define HARUHI__UTILITY__LOCK_FREE_QUEUE_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/noncopyable.h>
+
+
+/**
+ * Bounded multi-producer, multi-consumer FIFO queue (Dmitry Vyukov's design).
+ * Each slot has a sequence number telling whether it's ready to be written
+ * or read, so push() and pop() only need one CAS each and never block.
+ * Doesn't allocate memory after construction.
+ *
+ * T should be trivially copyable (typically a pointer).
+ * \threadsafe
+ */
+template<class tValueType>
+	class LockFreeQueue: private Noncopyable
+	{
+		static_assert (std::is_trivially_copyable<tValueType>::value, "LockFreeQueue value must be trivially copyable");
+
+	  public:
+		typedef tValueType ValueType;
+
+	  private:
+		struct Cell
+		{
+			Atomic<std::size_t>	sequence;
+			ValueType			value;
+		};
+
+	  public:
+		/**
+		 * \param	capacity Maximum number of elements in queue.
+		 * 			Rounded up to power of two.
+		 */
+		explicit
+		LockFreeQueue (std::size_t capacity);
+
+		~LockFreeQueue();
+
+		/**
+		 * Add element to the queue.
+		 * \returns	false if queue is full.
+		 */
+		bool
+		push (ValueType value) noexcept;
+
+		/**
+		 * Take element from the queue.
+		 * \returns	false if queue is empty.
+		 */
+		bool
+		pop (ValueType& value) noexcept;
+
+		/**
+		 * Return true if queue seems to be empty.
+		 * Result may be outdated when it's returned.
+		 */
+		bool
+		empty() const noexcept;
+
+		/**
+		 * Return capacity of the queue.
+		 */
+		std::size_t
+		capacity() const noexcept;
+
+	  private:
+		Cell*		_cells;
+		std::size_t	_mask;
+		// Producers and consumers use separate cache lines:
+		alignas (std::hardware_destructive_interference_size) Atomic<std::size_t>	_push_position	{ 0 };
+		alignas (std::hardware_destructive_interference_size) Atomic<std::size_t>	_pop_position	{ 0 };
+	};
+
+
+template<class T>
+	inline
+	LockFreeQueue<T>::LockFreeQueue (std::size_t capacity)
+	{
+		std::size_t size = 2;
+		while (size < capacity)
+			size *= 2;
+
+		_mask = size - 1;
+		_cells = new Cell[size];
+		for (std::size_t i = 0; i < size; ++i)
+			_cells[i].sequence.store (i, std::memory_order_relaxed);
+	}
+
+
+template<class T>
+	inline
+	LockFreeQueue<T>::~LockFreeQueue()
+	{
+		delete[] _cells;
+	}
+
+
+template<class T>
+	inline bool
+	LockFreeQueue<T>::push (ValueType value) noexcept
+	{
+		Cell* cell;
+		std::size_t position = _push_position.load (std::memory_order_relaxed);
+
+		while (true)
+		{
+			cell = &_cells[position & _mask];
+			std::size_t sequence = cell->sequence.load (std::memory_order_acquire);
+			std::intptr_t diff = static_cast<std::intptr_t> (sequence) - static_cast<std::intptr_t> (position);
+
+			if (diff == 0)
+			{
+				if (_push_position.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;
+			else
+				position = _push_position.load (std::memory_order_relaxed);
+		}
+
+		cell->value = value;
+		cell->sequence.store (position + 1, std::memory_order_release);
+		return true;
+	}
+
+
+template<class T>
+	inline bool
+	LockFreeQueue<T>::pop (ValueType& value) noexcept
+	{
+		Cell* cell;
+		std::size_t position = _pop_position.load (std::memory_order_relaxed);
+
+		while (true)
+		{
+			cell = &_cells[position & _mask];
+			std::size_t sequence = cell->sequence.load (std::memory_order_acquire);
+			std::intptr_t diff = static_cast<std::intptr_t> (sequence) - static_cast<std::intptr_t> (position + 1);
+
+			if (diff == 0)
+			{
+				if (_pop_position.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;
+			else
+				position = _pop_position.load (std::memory_order_relaxed);
+		}
+
+		value = cell->value;
+		cell->sequence.store (position + _mask + 1, std::memory_order_release);
+		return true;
+	}
+
+
+template<class T>
+	inline bool
+	LockFreeQueue<T>::empty() const noexcept
+	{
+		return _pop_position.load (std::memory_order_acquire) >= _push_position.load (std::memory_order_acquire);
+	}
+
+
+template<class T>
+	inline std::size_t
+	LockFreeQueue<T>::capacity() const noexcept
+	{
+		return _mask + 1;
+	}
+
+#endif
+
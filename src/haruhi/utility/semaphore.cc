@@ -18,6 +18,9 @@
 #include <semaphore.h>
 #include <errno.h>
 
+// Haruhi:
+#include <haruhi/utility/trace.h>
+
 // Local:
 #include "semaphore.h"
 
@@ -55,6 +58,7 @@ Semaphore::value() const noexcept
 void
 Semaphore::wait() const noexcept
 {
+	Trace::Span span ("Semaphore::wait");
 	::sem_wait (&_semaphore);
 }
 
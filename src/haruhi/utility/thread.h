@@ -26,6 +26,11 @@
 #include <haruhi/utility/atomic.h>
 #include <haruhi/utility/noncopyable.h>
 
+// System:
+#ifdef HARUHI_SSE1
+#include <xmmintrin.h>
+#endif
+
 
 /**
  * Thread is created in "detached" state, that means it will
@@ -102,6 +107,13 @@ class Thread: private Noncopyable
 	static void
 	yield() noexcept;
 
+	/**
+	 * Tells the CPU that calling thread is busy-waiting.
+	 * Use in spin loops, doesn't relinquish the processor.
+	 */
+	static void
+	spin_pause() noexcept;
+
 	static ID
 	id() noexcept;
 
@@ -125,5 +137,14 @@ class Thread: private Noncopyable
 	Mutex			_wait;
 };
 
+
+inline void
+Thread::spin_pause() noexcept
+{
+#ifdef HARUHI_SSE1
+	_mm_pause();
+#endif
+}
+
 #endif
 
@@ -0,0 +1,254 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/json.h>
+#include <haruhi/utility/mutex.h>
+
+// Local:
+#include "trace.h"
+
+
+/**
+ * Ring buffer with spans of one thread. There's only one writer (the owning
+ * thread), readers may copy spans concurrently. Writer publishes _begun before
+ * and _committed after writing an event, so that readers can discard events
+ * that might have been overwritten during copying (like in a seqlock).
+ */
+class Trace::Buffer
+{
+  public:
+	struct Slot
+	{
+		Atomic<char const*>				name		{ nullptr };
+		Atomic<int64_t>					argument	{ 0 };
+		Atomic<CPUStats::Nanoseconds>	begin		{ 0 };
+		Atomic<CPUStats::Nanoseconds>	end			{ 0 };
+	};
+
+  public:
+	explicit
+	Buffer (unsigned int thread_id):
+		thread_id (thread_id),
+		_slots (BufferCapacity)
+	{ }
+
+	/**
+	 * Reset buffer for use by new thread.
+	 * No thread may be writing to the buffer.
+	 */
+	void
+	reset (std::string const& new_thread_name)
+	{
+		thread_name = new_thread_name;
+		_begun.store (0, std::memory_order_relaxed);
+		_committed.store (0, std::memory_order_release);
+	}
+
+	/**
+	 * Add event, overwriting oldest one if buffer is full.
+	 * Only called by owning thread.
+	 */
+	void
+	write (Event const& event) noexcept
+	{
+		uint64_t const index = _committed.load (std::memory_order_relaxed);
+		_begun.store (index + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence (std::memory_order_release);
+		Slot& slot = _slots[index % BufferCapacity];
+		slot.name.store (event.name, std::memory_order_relaxed);
+		slot.argument.store (event.argument, std::memory_order_relaxed);
+		slot.begin.store (event.begin, std::memory_order_relaxed);
+		slot.end.store (event.end, std::memory_order_relaxed);
+		_committed.store (index + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Copy consistent events, oldest first.
+	 * \threadsafe
+	 */
+	std::vector<Event>
+	read() const
+	{
+		uint64_t const committed = _committed.load (std::memory_order_acquire);
+		uint64_t const first = committed > BufferCapacity ? committed - BufferCapacity : 0;
+
+		std::vector<Event> events;
+		events.reserve (committed - first);
+		for (uint64_t i = first; i < committed; ++i)
+		{
+			Slot const& slot = _slots[i % BufferCapacity];
+			events.push_back ({
+				slot.name.load (std::memory_order_relaxed),
+				slot.argument.load (std::memory_order_relaxed),
+				slot.begin.load (std::memory_order_relaxed),
+				slot.end.load (std::memory_order_relaxed),
+			});
+		}
+
+		// Drop events that writer could have overwritten while they were copied:
+		std::atomic_thread_fence (std::memory_order_acquire);
+		uint64_t const begun = _begun.load (std::memory_order_relaxed);
+		uint64_t const first_valid = begun > BufferCapacity ? begun - BufferCapacity : 0;
+		if (first_valid > first)
+			events.erase (events.begin(), events.begin() + std::min<uint64_t> (first_valid - first, events.size()));
+
+		return events;
+	}
+
+  public:
+	unsigned int const	thread_id;
+	std::string			thread_name;
+	// True if owned by a running thread:
+	bool				in_use			= false;
+
+  private:
+	std::vector<Slot>	_slots;
+	Atomic<uint64_t>	_begun			{ 0 };
+	Atomic<uint64_t>	_committed		{ 0 };
+};
+
+
+constexpr std::size_t							Trace::BufferCapacity;
+constexpr std::size_t							Trace::XrunsCapacity;
+Mutex											Trace::_buffers_mutex;
+std::vector<std::unique_ptr<Trace::Buffer>>		Trace::_buffers;
+thread_local Trace::Buffer*						Trace::_thread_buffer = nullptr;
+Atomic<bool>									Trace::_xrun { false };
+Atomic<bool>									Trace::_freeze_on_xrun { false };
+Atomic<bool>									Trace::_frozen { false };
+Atomic<CPUStats::Nanoseconds>					Trace::_xrun_times[XrunsCapacity];
+Atomic<uint64_t>								Trace::_xruns_number { 0 };
+
+
+Trace::ThreadGuard::~ThreadGuard()
+{
+	Mutex::Lock lock (_buffers_mutex);
+	if (_thread_buffer)
+		_thread_buffer->in_use = false;
+	_thread_buffer = nullptr;
+}
+
+
+void
+Trace::register_thread (std::string const& thread_name)
+{
+	if (!enabled())
+		return;
+
+	// Destroyed when thread exits:
+	static thread_local ThreadGuard thread_guard;
+
+	Mutex::Lock lock (_buffers_mutex);
+
+	if (!_thread_buffer)
+	{
+		auto unused = std::find_if (_buffers.begin(), _buffers.end(), [](auto const& b) { return !b->in_use; });
+		if (unused == _buffers.end())
+		{
+			_buffers.push_back (std::make_unique<Buffer> (_buffers.size() + 1));
+			unused = _buffers.end() - 1;
+		}
+		_thread_buffer = unused->get();
+		_thread_buffer->in_use = true;
+	}
+
+	_thread_buffer->reset (thread_name);
+}
+
+
+void
+Trace::record (char const* name, int64_t argument, CPUStats::Nanoseconds begin, CPUStats::Nanoseconds end) noexcept
+{
+	if (enabled() && _thread_buffer && !_frozen.load (std::memory_order_relaxed))
+		_thread_buffer->write ({ name, argument, begin, end });
+}
+
+
+void
+Trace::mark_xrun() noexcept
+{
+	if (enabled())
+	{
+		// Claim the slot first, so that concurrent callers (JACK's xrun thread
+		// and the graph) never write the same one:
+		uint64_t const index = _xruns_number.fetch_add (1, std::memory_order_relaxed);
+		_xrun_times[index % XrunsCapacity].store (CPUStats::now(), std::memory_order_release);
+
+		if (_freeze_on_xrun.load (std::memory_order_relaxed))
+			_frozen.store (true, std::memory_order_relaxed);
+	}
+
+	_xrun.store (true, std::memory_order_relaxed);
+}
+
+
+void
+Trace::write_chrome_json (std::ostream& out, Labeler const& labeler)
+{
+	std::ios::fmtflags const flags = out.flags();
+	std::streamsize const precision = out.precision();
+	out << std::fixed << std::setprecision (3);
+
+	Mutex::Lock lock (_buffers_mutex);
+
+	bool first = true;
+	auto separator = [&] {
+		out << (first ? "\n\t\t" : ",\n\t\t");
+		first = false;
+	};
+
+	out << "{\n\t\"displayTimeUnit\": \"ns\",\n\t\"traceEvents\": [";
+	for (auto const& buffer: _buffers)
+	{
+		separator();
+		out << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread_id
+			<< ", \"args\": { \"name\": " << json_quoted (buffer->thread_name) << " } }";
+
+		for (Event const& event: buffer->read())
+		{
+			separator();
+			out << "{ \"name\": " << json_quoted (labeler ? labeler (event) : event.name)
+				<< ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->thread_id
+				<< ", \"ts\": " << 1e-3 * event.begin
+				<< ", \"dur\": " << 1e-3 * (event.end - event.begin)
+				<< ", \"args\": { \"argument\": " << event.argument << " } }";
+		}
+	}
+
+	// Xruns as global instant events, shown across all threads:
+	// A slot may be claimed but not yet written; never written slots are skipped:
+	uint64_t const xruns_number = _xruns_number.load (std::memory_order_relaxed);
+	for (uint64_t i = xruns_number > XrunsCapacity ? xruns_number - XrunsCapacity : 0; i < xruns_number; ++i)
+	{
+		CPUStats::Nanoseconds const time = _xrun_times[i % XrunsCapacity].load (std::memory_order_acquire);
+		if (time == 0)
+			continue;
+
+		separator();
+		out << "{ \"name\": \"xrun\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 0"
+			<< ", \"ts\": " << 1e-3 * time << " }";
+	}
+	out << "\n\t]\n}";
+
+	out.flags (flags);
+	out.precision (precision);
+}
+
@@ -0,0 +1,250 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__UTILITY__TRACE_H__INCLUDED
+#define HARUHI__UTILITY__TRACE_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <memory>
+#include <functional>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/utility/atomic.h>
+#include <haruhi/utility/cpu_stats.h>
+#include <haruhi/utility/mutex.h>
+#include <haruhi/utility/noncopyable.h>
+
+
+/**
+ * Records timeline of spans (named time ranges) executed by real-time threads,
+ * to be viewed in chrome://tracing or Perfetto.
+ *
+ * Each thread that wants its spans recorded must call register_thread() first
+ * (outside of real-time context, since it allocates). Spans are then written
+ * into the thread's ring buffer without locking or allocating. When the ring
+ * is full, oldest spans are overwritten, so the trace always contains the most
+ * recent history of each thread. Spans executed by unregistered threads are
+ * ignored.
+ *
+ * Xruns are recorded as instant events. Optionally recording of spans stops
+ * on xrun, so that the history before it is kept until someone dumps it.
+ *
+ * Tracing is compiled in only if HARUHI_TRACE is defined. Otherwise Span does
+ * nothing and traces are empty.
+ */
+class Trace: private Noncopyable
+{
+  public:
+	// Number of spans remembered per thread:
+	static constexpr std::size_t	BufferCapacity	= 16384;
+	// Number of xrun instants remembered:
+	static constexpr std::size_t	XrunsCapacity	= 64;
+
+	/**
+	 * Recorded span. Span names must be string literals (or otherwise
+	 * live as long as the program). Meaning of the argument depends on the name.
+	 */
+	struct Event
+	{
+		char const*				name;
+		int64_t					argument;
+		CPUStats::Nanoseconds	begin;
+		CPUStats::Nanoseconds	end;
+	};
+
+	/**
+	 * Returns label for given event shown in the exported trace.
+	 */
+	typedef std::function<std::string (Event const&)> Labeler;
+
+	/**
+	 * Records span from construction to destruction.
+	 */
+	class Span: private Noncopyable
+	{
+	  public:
+		explicit
+		Span (char const* name, int64_t argument = 0) noexcept;
+
+		~Span();
+
+#ifdef HARUHI_TRACE
+	  private:
+		char const*				_name;
+		int64_t					_argument;
+		CPUStats::Nanoseconds	_begin;
+#endif
+	};
+
+  private:
+	class Buffer;
+
+	/**
+	 * Releases thread's buffer when thread exits.
+	 */
+	class ThreadGuard
+	{
+	  public:
+		~ThreadGuard();
+	};
+
+  public:
+	/**
+	 * Return true if tracing is compiled in.
+	 */
+	static constexpr bool
+	enabled() noexcept;
+
+	/**
+	 * Assign ring buffer to the current thread. Buffers of threads
+	 * that have finished are reused, but their spans are kept
+	 * until then, so they're still present in exported traces.
+	 * Does nothing if tracing is compiled out.
+	 * \threadsafe
+	 */
+	static void
+	register_thread (std::string const& thread_name);
+
+	/**
+	 * Record span with given bounds in current thread's buffer.
+	 * Wait-free.
+	 */
+	static void
+	record (char const* name, int64_t argument, CPUStats::Nanoseconds begin, CPUStats::Nanoseconds end) noexcept;
+
+	/**
+	 * Tell that an xrun happened. Records the moment as an instant event
+	 * and, if enabled with set_freeze_on_xrun(), stops recording spans.
+	 * Real-time safe. Use take_xrun() from a non-real-time thread
+	 * to dump the trace.
+	 * \threadsafe
+	 */
+	static void
+	mark_xrun() noexcept;
+
+	/**
+	 * If enabled, mark_xrun() freezes buffers until thaw() is called,
+	 * so that spans preceding the xrun aren't overwritten before
+	 * they're dumped. Disabled by default.
+	 * \threadsafe
+	 */
+	static void
+	set_freeze_on_xrun (bool enabled) noexcept;
+
+	/**
+	 * Resume recording of spans after xrun.
+	 * \threadsafe
+	 */
+	static void
+	thaw() noexcept;
+
+	/**
+	 * Return true if there was an xrun since last call.
+	 * \threadsafe
+	 */
+	static bool
+	take_xrun() noexcept;
+
+	/**
+	 * Write spans of all threads in Chrome trace event format (JSON),
+	 * also understood by Perfetto. Doesn't block threads recording spans.
+	 * \param	labeler Optional function returning names for events.
+	 *			If not given, span names are used.
+	 * \threadsafe
+	 */
+	static void
+	write_chrome_json (std::ostream&, Labeler const& labeler = Labeler());
+
+  private:
+	static Mutex									_buffers_mutex;
+	static std::vector<std::unique_ptr<Buffer>>	_buffers;
+	static thread_local Buffer*					_thread_buffer;
+	static Atomic<bool>								_xrun;
+	static Atomic<bool>								_freeze_on_xrun;
+	static Atomic<bool>								_frozen;
+	// Times of recent xruns, used as a ring buffer:
+	static Atomic<CPUStats::Nanoseconds>			_xrun_times[XrunsCapacity];
+	static Atomic<uint64_t>							_xruns_number;
+};
+
+
+#ifdef HARUHI_TRACE
+
+inline
+Trace::Span::Span (char const* name, int64_t argument) noexcept:
+	_name (name),
+	_argument (argument),
+	_begin (_thread_buffer ? CPUStats::now() : 0)
+{ }
+
+
+inline
+Trace::Span::~Span()
+{
+	if (_thread_buffer)
+		record (_name, _argument, _begin, CPUStats::now());
+}
+
+#else
+
+inline
+Trace::Span::Span (char const*, int64_t) noexcept
+{ }
+
+
+inline
+Trace::Span::~Span()
+{ }
+
+#endif
+
+
+inline constexpr bool
+Trace::enabled() noexcept
+{
+#ifdef HARUHI_TRACE
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+inline void
+Trace::set_freeze_on_xrun (bool enabled) noexcept
+{
+	_freeze_on_xrun.store (enabled, std::memory_order_relaxed);
+}
+
+
+inline void
+Trace::thaw() noexcept
+{
+	_frozen.store (false, std::memory_order_relaxed);
+}
+
+
+inline bool
+Trace::take_xrun() noexcept
+{
+	return _xrun.exchange (false, std::memory_order_relaxed);
+}
+
+#endif
+
@@ -12,16 +12,22 @@
  */
 
 // Standard:
+#include <algorithm>
 #include <cstddef>
+#include <string>
 #include <utility>
 
 // Local:
 #include "work_performer.h"
 
 
-WorkPerformer::Performer::Performer (WorkPerformer* work_performer, unsigned int thread_id) noexcept:
+thread_local WorkPerformer::Performer* WorkPerformer::_current_performer = nullptr;
+
+
+WorkPerformer::Performer::Performer (WorkPerformer* work_performer, unsigned int thread_id):
 	_work_performer (work_performer),
-	_thread_id (thread_id)
+	_thread_id (thread_id),
+	_queue (QueueCapacity)
 {
 	// 128k-words stack (512kB on 32-bit, 1MB on 64-bit system) should be sufficient for most operations:
 	set_stack_size (128 * sizeof (size_t) * 1024);
@@ -31,51 +37,53 @@ WorkPerformer::Performer::Performer (WorkPerformer* work_performer, unsigned int
 void
 WorkPerformer::Performer::run()
 {
+	_current_performer = this;
+	Trace::register_thread (_work_performer->_name + " " + std::to_string (_thread_id));
+
 	Unit* unit = nullptr;
-	while ((unit = _work_performer->take_unit()))
+	while ((unit = _work_performer->take_unit (_thread_id)))
 	{
 		unit->_is_ready.store (false);
 		unit->_thread_id = _thread_id;
-		unit->execute();
-		unit->_is_ready.store (true);
-		unit->_wait_sem.post();
+		{
+			CPUStats::Measurement measurement (_cpu_stats);
+			unit->execute();
+		}
+		unit->done();
 	}
 }
 
 
-WorkPerformer::WorkPerformer (unsigned int threads_number)
+WorkPerformer::WorkPerformer (unsigned int threads_number, std::string const& name):
+	_name (name)
 {
 	threads_number = std::max (1u, threads_number);
 
+	// Performers steal from each other, so create all of them before starting any:
 	for (unsigned int i = 0; i < threads_number; ++i)
-	{
 		_performers.push_back (std::make_unique<Performer> (this, i));
-		_performers.back()->start();
-	}
+	for (auto& p: _performers)
+		p->start();
 }
 
 
 WorkPerformer::~WorkPerformer()
 {
+	_quit.store (true);
 	for (decltype (_performers.size()) i = 0; i < _performers.size(); ++i)
-		_queue_semaphore.post();
+		_wake_up_semaphore.post();
 
 	for (auto& p: _performers)
-	{
 		p->wait();
-		p.reset();
-	}
+	_performers.clear();
 }
 
 
 void
 WorkPerformer::add (Unit* unit)
 {
-	_queue_mutex.synchronize ([&] {
-		unit->added_to_queue();
-		_queue.push (unit);
-	});
-	_queue_semaphore.post();
+	enqueue (unit);
+	wake_up (1);
 }
 
 
@@ -87,19 +95,116 @@ WorkPerformer::set_sched (Thread::SchedType sched_type, int priority) noexcept
 }
 
 
+CPUStats::Snapshot
+WorkPerformer::cpu_stats() const noexcept
+{
+	CPUStats::Snapshot result;
+	for (auto const& p: _performers)
+		result += p->_cpu_stats.snapshot();
+	return result;
+}
+
+
+void
+WorkPerformer::enqueue (Unit* unit) noexcept
+{
+	unit->added_to_queue();
+
+	// Keep units added by performer threads local:
+	Performer* current = _current_performer;
+	if (current && current->_work_performer == this && current->_queue.push (unit))
+		return;
+
+	std::size_t const n = _performers.size();
+	std::size_t const first = _next_queue.fetch_add (1, std::memory_order_relaxed);
+
+	while (true)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+			if (_performers[(first + i) % n]->_queue.push (unit))
+				return;
+		// All queues are full, let performers catch up:
+		Thread::yield();
+	}
+}
+
+
+void
+WorkPerformer::wake_up (std::size_t units_number) noexcept
+{
+	// Pairs with the fence in take_unit(), so that either we see
+	// the thread going to sleep, or the thread sees queued units:
+	std::atomic_thread_fence (std::memory_order_seq_cst);
+
+	for (; units_number > 0; --units_number)
+	{
+		int sleeping = _sleeping.load();
+		do {
+			if (sleeping <= 0)
+				return;
+		} while (!_sleeping.compare_exchange_weak (sleeping, sleeping - 1));
+
+		_wake_up_semaphore.post();
+	}
+}
+
+
 WorkPerformer::Unit*
-WorkPerformer::take_unit()
+WorkPerformer::find_unit (unsigned int thread_id) noexcept
+{
+	std::size_t const n = _performers.size();
+	Unit* unit = nullptr;
+
+	for (std::size_t i = 0; i < n; ++i)
+		if (_performers[(thread_id + i) % n]->_queue.pop (unit))
+			return unit;
+
+	return nullptr;
+}
+
+
+bool
+WorkPerformer::has_units() const noexcept
 {
-	_queue_semaphore.wait();
-	Mutex::Lock lock (_queue_mutex);
+	for (auto& p: _performers)
+		if (!p->_queue.empty())
+			return true;
 
-	if (_queue.empty())
-		return 0;
-	else
+	return false;
+}
+
+
+WorkPerformer::Unit*
+WorkPerformer::take_unit (unsigned int thread_id)
+{
+	while (true)
 	{
-		Unit* u = _queue.front();
-		_queue.pop();
-		return u;
+		for (unsigned int i = 0; i < SpinIterations; ++i)
+		{
+			if (Unit* unit = find_unit (thread_id))
+				return unit;
+			if (_quit.load (std::memory_order_relaxed))
+				return nullptr;
+			Thread::spin_pause();
+		}
+
+		// Go to sleep:
+		_sleeping.fetch_add (1);
+		std::atomic_thread_fence (std::memory_order_seq_cst);
+
+		if (has_units() || _quit.load())
+		{
+			// Try to cancel sleeping. If counter is already zero,
+			// someone has posted the semaphore for us, so consume that:
+			int sleeping = _sleeping.load();
+			bool cancelled = false;
+			while (sleeping > 0 && !(cancelled = _sleeping.compare_exchange_weak (sleeping, sleeping - 1)))
+				continue;
+			if (cancelled)
+				continue;
+		}
+
+		_wake_up_semaphore.wait();
 	}
 }
 
@@ -16,38 +16,59 @@
 
 // Standard:
 #include <cstddef>
-#include <queue>
+#include <string>
+#include <vector>
 
 // Haruhi:
 #include <haruhi/config/all.h>
-#include <haruhi/utility/mutex.h>
+#include <haruhi/utility/lock_free_queue.h>
 #include <haruhi/utility/semaphore.h>
 #include <haruhi/utility/thread.h>
 #include <haruhi/utility/atomic.h>
+#include <haruhi/utility/cpu_stats.h>
 #include <haruhi/utility/noncopyable.h>
+#include <haruhi/utility/trace.h>
 
 
 /**
  * WorkPerformer queues work units (WorkUnit) and executes them in the context
  * of separate thread.
+ *
+ * Each thread has its own lock-free queue. Units added from outside are
+ * distributed among queues, units added from within a performer thread go
+ * to that thread's queue. Threads that run out of work steal from other
+ * queues, then spin for a while and finally sleep until new work arrives.
  */
 class WorkPerformer: private Noncopyable
 {
+  public:
+	class Unit;
+
   private:
+	// Max number of units waiting in one thread's queue:
+	static constexpr std::size_t	QueueCapacity	= 1024;
+	// Number of tries to find work before thread goes to sleep:
+	static constexpr unsigned int	SpinIterations	= 2048;
+
 	/**
 	 * Thread implementation.
 	 */
 	class Performer: public Thread
 	{
+		friend class WorkPerformer;
+
 	  public:
-		Performer (WorkPerformer*, unsigned int thread_id) noexcept;
+		Performer (WorkPerformer*, unsigned int thread_id);
 
 		void
 		run() override;
 
 	  private:
-		WorkPerformer*	_work_performer;
-		unsigned int	_thread_id;
+		WorkPerformer*			_work_performer;
+		unsigned int			_thread_id;
+		LockFreeQueue<Unit*>	_queue;
+		// Time spent executing units:
+		CPUStats				_cpu_stats;
 	};
 
   public:
@@ -91,6 +112,19 @@ class WorkPerformer: private Noncopyable
 		unsigned int
 		thread_id() const { return _thread_id; }
 
+	  protected:
+		/**
+		 * Called by the Performer after execute() returns.
+		 * Marks unit as ready and wakes up the thread waiting in wait().
+		 * Units that report completion some other way (for example
+		 * with a CountdownLatch shared by many units) may override it
+		 * to avoid per-unit semaphore posts. Unit may be reused
+		 * as soon as this method signals completion, so Performer
+		 * doesn't touch it afterwards.
+		 */
+		virtual void
+		done();
+
 	  private:
 		/**
 		 * Called by the WorkPerformer when unit is added to the queue.
@@ -105,16 +139,15 @@ class WorkPerformer: private Noncopyable
 	};
 
   private:
-	typedef std::queue<Unit*> Units;
-
 	friend class Performer;
 
   public:
 	/**
 	 * Create WorkPerformer with given number of threads.
 	 * The number of threads never changes.
+	 * \param	name Used to name threads in traces.
 	 */
-	WorkPerformer (unsigned int threads_number);
+	WorkPerformer (unsigned int threads_number, std::string const& name = "WorkPerformer");
 
 	/**
 	 * Waits for threads to finish before return.
@@ -129,6 +162,16 @@ class WorkPerformer: private Noncopyable
 	void
 	add (Unit*);
 
+	/**
+	 * Add many work units at once. Wakes up sleeping threads once,
+	 * after all units are queued.
+	 * \param	begin, end Range of Unit pointers.
+	 * \threadsafe
+	 */
+	template<class UnitIterator>
+		void
+		add (UnitIterator begin, UnitIterator end);
+
 	/**
 	 * Set scheduling parameter for all threads.
 	 */
@@ -141,6 +184,15 @@ class WorkPerformer: private Noncopyable
 	unsigned int
 	threads_number() const { return _performers.size(); }
 
+	/**
+	 * Return statistics of execution times of units,
+	 * summed over all threads.
+	 * Empty unless compiled with HARUHI_CPU_STATS.
+	 * \threadsafe
+	 */
+	CPUStats::Snapshot
+	cpu_stats() const noexcept;
+
 	/**
 	 * Unit adaptor.
 	 */
@@ -163,27 +215,79 @@ class WorkPerformer: private Noncopyable
 
   private:
 	/**
-	 * Take unit from the queue. If there are no units ready, wait
-	 * until new unit arrives. Return nullptr if thread should exit.
+	 * Put unit into one of the queues, without waking up any thread.
+	 * \threadsafe
+	 */
+	void
+	enqueue (Unit*) noexcept;
+
+	/**
+	 * Wake up sleeping threads, but no more than units_number.
+	 * \threadsafe
+	 */
+	void
+	wake_up (std::size_t units_number) noexcept;
+
+	/**
+	 * Take unit from thread's own queue or steal one from other threads.
+	 * Return nullptr if all queues are empty.
 	 * \threadsafe
 	 */
 	Unit*
-	take_unit();
+	find_unit (unsigned int thread_id) noexcept;
+
+	/**
+	 * Return true if any queue has units waiting.
+	 */
+	bool
+	has_units() const noexcept;
+
+	/**
+	 * Take unit from the queue. If there are no units ready, spin for a while
+	 * and then wait until new unit arrives. Return nullptr if thread should exit.
+	 * \threadsafe
+	 */
+	Unit*
+	take_unit (unsigned int thread_id);
 
   private:
-	// Current queue. Points either to _queues[1] or _queues[2]:
-	Units									_queue;
-	Mutex									_queue_mutex;
-	Semaphore								_queue_semaphore;
+	std::string								_name;
 	std::vector<Haruhi::Unique<Performer>>	_performers;
+	// Queue for next unit added from outside of performer threads:
+	Atomic<unsigned int>					_next_queue		{ 0 };
+	// Number of threads going to sleep on _wake_up_semaphore, not yet woken up:
+	Atomic<int>								_sleeping		{ 0 };
+	Semaphore								_wake_up_semaphore;
+	Atomic<bool>							_quit			{ false };
+	// Performer running in current thread, if any:
+	static thread_local Performer*			_current_performer;
 };
 
 
+inline void
+WorkPerformer::Unit::done()
+{
+	_is_ready.store (true);
+	_wait_sem.post();
+}
+
+
 inline void
 WorkPerformer::Unit::added_to_queue()
 {
 	_is_ready.store (false);
 }
 
+
+template<class UnitIterator>
+	inline void
+	WorkPerformer::add (UnitIterator begin, UnitIterator end)
+	{
+		std::size_t n = 0;
+		for (UnitIterator u = begin; u != end; ++u, ++n)
+			enqueue (*u);
+		wake_up (n);
+	}
+
 #endif
 
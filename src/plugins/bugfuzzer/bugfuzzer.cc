@@ -100,7 +100,7 @@ found:
 }
 
 
-Haruhi::Event*
+Haruhi::EventRecord
 BugFuzzer::get_random_event()
 {
 	switch (rand() % 3)
@@ -112,14 +112,12 @@ BugFuzzer::get_random_event()
 			Haruhi::VoiceEvent::Action action= t == 0
 				? Haruhi::VoiceEvent::Action::Create
 				: Haruhi::VoiceEvent::Action::Drop;
-			return new Haruhi::VoiceEvent (Time::now(), v, v, action);
+			return Haruhi::VoiceEvent (Time::now(), v, v, action);
 		}
 		case 1:
-			return new Haruhi::ControllerEvent (Time::now(), 1.0f * rand() / RAND_MAX);
-		case 2:
-			return new Haruhi::VoiceControllerEvent (Time::now(), rand() % 127, 1.0f * rand() / RAND_MAX);
+			return Haruhi::ControllerEvent (Time::now(), 1.0f * rand() / RAND_MAX);
 		default:
-			return 0;
+			return Haruhi::VoiceControllerEvent (Time::now(), rand() % 127, 1.0f * rand() / RAND_MAX);
 	}
 }
 
@@ -60,7 +60,7 @@ class BugFuzzer: public Haruhi::Plugin
 	connect_ports();
 
   private:
-	Haruhi::Event*
+	Haruhi::EventRecord
 	get_random_event();
 
   private:
@@ -13,6 +13,7 @@
 
 // Standard:
 #include <cstddef>
+#include <limits>
 
 // Qt:
 #include <QLayout>
@@ -91,23 +92,36 @@ Plugin::process()
 	sync_inputs();
 	clear_outputs();
 
-	for (auto knob: knobs())
-		knob->controller_proxy()->process_events();
-
-	_reverb_model.set_room_size (_param_room_size->to_f());
-	_reverb_model.set_width (_param_width->to_f());
-	_reverb_model.set_damping (_param_damping->to_f());
 	_reverb_model.set_mode (ReverbModel::Mode::Normal); // TODO configurable
 
 	auto buf_i_0 = _in[0]->buffer();
 	auto buf_i_1 = _in[1]->buffer();
 	auto buf_o_0 = _out[0]->buffer();
 	auto buf_o_1 = _out[1]->buffer();
+	std::size_t const size = buf_i_0->size();
+
+	// Split processing at controller events, so that parameter
+	// changes take effect at their exact frames:
+	for (std::size_t begin = 0, end = 0; begin < size; begin = end)
+	{
+		end = size;
+		for (auto knob: knobs())
+			end = knob->controller_proxy()->next_event_frame (begin, end);
+
+		// Events past the buffer are processed with the last segment:
+		for (auto knob: knobs())
+			knob->controller_proxy()->process_events (begin, end == size ? std::numeric_limits<std::size_t>::max() : end);
+
+		_reverb_model.set_room_size (_param_room_size->to_f());
+		_reverb_model.set_width (_param_width->to_f());
+		_reverb_model.set_damping (_param_damping->to_f());
+		_reverb_model.process (buf_i_0->begin() + begin, buf_i_1->begin() + begin, buf_o_0->begin() + begin, buf_o_1->begin() + begin, end - begin);
 
-	_reverb_model.process (buf_i_0->begin(), buf_i_1->begin(), buf_o_0->begin(), buf_o_1->begin(), buf_i_0->size());
+		_param_drywet_smoother.fill (_drywet_mix_buffer.begin() + begin, _drywet_mix_buffer.begin() + end, _param_drywet->to_f());
+	}
 
 	// Attenuation for wet output:
-	prepare_drywet_buffer (&_drywet_mix_buffer, _param_drywet->to_f());
+	SIMD::power_buffer_to_scalar (_drywet_mix_buffer.begin(), _drywet_mix_buffer.size(), M_E);
 
 	// Wet:
 	buf_o_0->attenuate (&_drywet_mix_buffer);
@@ -193,13 +207,5 @@ Plugin::knobs() const
 	return { _knob_drywet.get(), _knob_room_size.get(), _knob_width.get(), _knob_damping.get() };
 }
 
-
-void
-Plugin::prepare_drywet_buffer (Haruhi::AudioBuffer* buffer, float param)
-{
-	_param_drywet_smoother.fill (buffer->begin(), buffer->end(), param);
-	SIMD::power_buffer_to_scalar (buffer->begin(), buffer->size(), M_E);
-}
-
 } // namespace Freeverb
 
@@ -94,16 +94,6 @@ class Plugin:
 	std::array<Haruhi::Knob*, 4>
 	knobs() const;
 
-	/**
-	 * Prepare dry-wet mix buffer that will contain smoothed vector
-	 * of values used for mixing dry and wet sounds.
-	 *
-	 * \param	param
-	 *			Value of dry-wet param to use.
-	 */
-	void
-	prepare_drywet_buffer (Haruhi::AudioBuffer*, float param);
-
   private:
 	ReverbModel						_reverb_model;
 
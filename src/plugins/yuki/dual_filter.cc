@@ -13,6 +13,8 @@
 
 // Standard:
 #include <cstddef>
+#include <algorithm>
+#include <functional>
 
 // Local:
 #include "dual_filter.h"
@@ -21,6 +23,76 @@
 namespace Yuki {
 
 constexpr int DualFilter::MaxStages;
+constexpr std::size_t DualFilter::BatchSize;
+constexpr std::size_t DualFilter::ImpulseResponseCache::Capacity;
+constexpr std::size_t DualFilter::ImpulseResponseCache::MaxProbes;
+
+
+void
+DualFilter::ImpulseResponseCache::clear() noexcept
+{
+	for (Slot& slot: _slots)
+		slot.state.store (Empty, std::memory_order_relaxed);
+}
+
+
+FilterImpulseResponse const*
+DualFilter::ImpulseResponseCache::find (FilterImpulseResponse::Parameters const& parameters) const noexcept
+{
+	std::size_t const h = hash (parameters);
+
+	for (std::size_t i = 0; i < MaxProbes; ++i)
+	{
+		Slot const& slot = _slots[(h + i) % Capacity];
+		int const state = slot.state.load (std::memory_order_acquire);
+
+		if (state == Empty)
+			return nullptr;
+		// Slots being written are skipped, the caller will compute coefficients by itself:
+		if (state == Ready && slot.response.parameters() == parameters)
+			return &slot.response;
+	}
+
+	return nullptr;
+}
+
+
+void
+DualFilter::ImpulseResponseCache::insert (FilterImpulseResponse const& response) noexcept
+{
+	FilterImpulseResponse::Parameters const parameters = response.parameters();
+	std::size_t const h = hash (parameters);
+
+	for (std::size_t i = 0; i < MaxProbes; ++i)
+	{
+		Slot& slot = _slots[(h + i) % Capacity];
+		int state = slot.state.load (std::memory_order_acquire);
+
+		if (state == Ready && slot.response.parameters() == parameters)
+			return;
+
+		if (state == Empty && slot.state.compare_exchange_strong (state, Writing, std::memory_order_acquire))
+		{
+			// Copies coefficients instead of computing them:
+			slot.response.set_parameters (parameters, &response);
+			slot.state.store (Ready, std::memory_order_release);
+			return;
+		}
+	}
+}
+
+
+std::size_t
+DualFilter::ImpulseResponseCache::hash (FilterImpulseResponse::Parameters const& parameters) noexcept
+{
+	std::hash<Sample> sample_hash;
+	std::size_t h = static_cast<std::size_t> (parameters.type) * 2 + parameters.limiter;
+
+	for (Sample s: { parameters.frequency, parameters.resonance, parameters.gain, parameters.attenuation })
+		h ^= sample_hash (s) + 0x9e3779b9 + (h << 6) + (h >> 2);
+
+	return h;
+}
 
 
 DualFilter::DualFilter (Params::Filter* params_1, Params::Filter* params_2):
@@ -44,7 +116,7 @@ DualFilter::DualFilter (Params::Filter* params_1, Params::Filter* params_2):
 
 
 void
-DualFilter::reset()
+DualFilter::reset() noexcept
 {
 	// Two channels:
 	for (int c = 0; c < 2; ++c)
@@ -56,6 +128,18 @@ DualFilter::reset()
 			_filter_2[c][i].reset();
 		}
 	}
+
+	_smoother_1_frequency.reset();
+	_smoother_1_resonance.reset();
+	_smoother_1_gain.reset();
+	_smoother_1_attenuation.reset();
+	_smoother_2_frequency.reset();
+	_smoother_2_resonance.reset();
+	_smoother_2_gain.reset();
+	_smoother_2_attenuation.reset();
+
+	_coefficients_1.valid = false;
+	_coefficients_2.valid = false;
 }
 
 
@@ -94,135 +178,158 @@ DualFilter::set_oversampling (unsigned int oversampling)
 }
 
 
+void
+DualFilter::process (Haruhi::AudioBuffer* buffer_1, Haruhi::AudioBuffer* buffer_2, ImpulseResponseCache* cache)
+{
+	DualFilter* self = this;
+	process_batch (&self, &buffer_1, &buffer_2, 1, cache);
+}
+
+
+DualFilter::Topology
+DualFilter::topology() const noexcept
+{
+	Topology topology;
+	if (_params_1->enabled)
+		topology.stages_1 = std::min (MaxStages, _params_1->stages.get());
+	if (_params_2->enabled)
+		topology.stages_2 = std::min (MaxStages, _params_2->stages.get());
+	topology.parallel = _configuration == Parallel && topology.stages_1 > 0 && topology.stages_2 > 0;
+	return topology;
+}
+
+
 bool
-DualFilter::process (Haruhi::AudioBuffer* input_1, Haruhi::AudioBuffer* input_2,
-					 Haruhi::AudioBuffer* buffer_1, Haruhi::AudioBuffer* buffer_2,
-					 Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2)
+DualFilter::process_batch (DualFilter* const* filters, Haruhi::AudioBuffer* const* buffers_1, Haruhi::AudioBuffer* const* buffers_2, std::size_t count,
+						   ImpulseResponseCache* cache)
 {
-	assert (input_1->size() == input_2->size());
+	assert (count <= BatchSize);
 
-	bool filtered = true;
-	std::size_t nsamples = input_1->size();
+	if (count == 0)
+		return true;
 
-	int stages1 = std::min (MaxStages, _params_1->stages.get());
-	int stages2 = std::min (MaxStages, _params_2->stages.get());
+	Topology const topology = filters[0]->topology();
+	for (std::size_t i = 1; i < count; ++i)
+		if (filters[i]->topology() != topology)
+			return false;
 
-	bool f1 = _params_1->enabled;
-	bool f2 = _params_2->enabled;
+	std::size_t const nsamples = buffers_1[0]->size();
+	for (std::size_t i = 0; i < count; ++i)
+		filters[i]->update_impulse_responses (nsamples, cache, filters, i);
 
-	if (f1)
-	{
-		Sample const frequency = _smoother_1_frequency.process (0.5f * _params_1->frequency.get() / Params::Filter::FrequencyMax, nsamples);
-		Sample const resonance = _smoother_1_resonance.process (_params_1->resonance.to_f(), nsamples);
-		Sample const gain = _smoother_1_gain.process (_params_1->gain.to_f(), nsamples);
-		Sample const attenuation = _smoother_1_attenuation.process (_params_1->attenuation.to_f(), nsamples);
-
-		_impulse_response_1.set_type (static_cast<FilterImpulseResponse::Type> (_params_1->type.get()));
-		_impulse_response_1.set_frequency (frequency / _oversampling);
-		_impulse_response_1.set_resonance (resonance);
-		_impulse_response_1.set_gain (gain);
-		_impulse_response_1.set_attenuation (attenuation);
-		_impulse_response_1.set_limiter_enabled (_params_1->limiter_enabled);
-	}
+	// Filter 1 stages go first, then filter 2 stages. In parallel configuration
+	// both cascades get the same input and their outputs are summed:
+	int const stages = topology.stages_1 + topology.stages_2;
+	if (stages == 0)
+		return true;
+	int const split = topology.parallel ? topology.stages_1 : stages;
 
-	if (f2)
+	for (int c = 0; c < 2; ++c)
 	{
-		Sample const frequency = _smoother_2_frequency.process (0.5f * _params_2->frequency.get() / Params::Filter::FrequencyMax, nsamples);
-		Sample const resonance = _smoother_2_resonance.process (_params_2->resonance.to_f(), nsamples);
-		Sample const gain = _smoother_2_gain.process (_params_2->gain.to_f(), nsamples);
-		Sample const attenuation = _smoother_2_attenuation.process (_params_2->attenuation.to_f(), nsamples);
-
-		_impulse_response_2.set_type (static_cast<FilterImpulseResponse::Type> (_params_2->type.get()));
-		_impulse_response_2.set_frequency (frequency / _oversampling);
-		_impulse_response_2.set_resonance (resonance);
-		_impulse_response_2.set_gain (gain);
-		_impulse_response_2.set_attenuation (attenuation);
-		_impulse_response_2.set_limiter_enabled (_params_2->limiter_enabled);
-	}
+		DSP::BiquadBank bank (stages);
+		Sample* buffers[DSP::BiquadBank::Lanes] = { };
 
-	if (_configuration == Serial)
-	{
-		// Filter1 enabled only:
-		if (f1 && !f2)
-		{
-			filterout (_filter_1[0], stages1, input_1, buffer_1, output_1);
-			filterout (_filter_1[1], stages1, input_2, buffer_1, output_2);
-		}
-		// Filter2 enabled only:
-		else if (!f1 && f2)
+		for (std::size_t lane = 0; lane < count; ++lane)
 		{
-			filterout (_filter_2[0], stages2, input_1, buffer_1, output_1);
-			filterout (_filter_2[1], stages2, input_2, buffer_1, output_2);
+			buffers[lane] = (c == 0 ? buffers_1 : buffers_2)[lane]->begin();
+			for (int s = 0; s < stages; ++s)
+			{
+				FilterType& filter = filters[lane]->stage_filter (topology, c, s);
+				Coefficients const& coefficients = filters[lane]->stage_coefficients (topology, s);
+				if (coefficients.valid)
+				{
+					bank.set_coefficients (s, lane, coefficients.a, coefficients.b);
+					bank.set_target_coefficients (s, lane, filter.impulse_response()->a, filter.impulse_response()->b, nsamples);
+				}
+				else
+					bank.set_coefficients (s, lane, filter.impulse_response()->a, filter.impulse_response()->b);
+				bank.load_state (s, lane, filter.previous_inputs(), filter.previous_outputs());
+			}
 		}
-		// Both enabled:
-		else if (f1 && f2)
+
+		bank.process (buffers, nsamples, split);
+
+		for (std::size_t lane = 0; lane < count; ++lane)
 		{
-			filterout (_filter_1[0], stages1, input_1, buffer_1, buffer_2);
-			filterout (_filter_2[0], stages2, buffer_2, buffer_1, output_1);
-			filterout (_filter_1[1], stages1, input_2, buffer_1, buffer_2);
-			filterout (_filter_2[1], stages2, buffer_2, buffer_1, output_2);
+			for (int s = 0; s < stages; ++s)
+			{
+				FilterType& filter = filters[lane]->stage_filter (topology, c, s);
+				bank.store_state (s, lane, filter.previous_inputs(), filter.previous_outputs());
+			}
 		}
-		// Neither enabled:
-		else
-			filtered = false;
 	}
-	else if (_configuration == Parallel)
+
+	// Remember coefficients for interpolation in the next call. Disabled filters
+	// will start with their target coefficients when enabled again:
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		// Filter1 enabled only:
-		if (f1 && !f2)
-		{
-			filterout (_filter_1[0], stages1, input_1, buffer_1, output_1);
-			filterout (_filter_1[1], stages1, input_2, buffer_1, output_2);
-		}
-		// Filter2 enabled only:
-		else if (!f1 && f2)
-		{
-			filterout (_filter_2[0], stages2, input_1, buffer_1, output_1);
-			filterout (_filter_2[1], stages2, input_2, buffer_1, output_2);
-		}
-		// Both enabled:
-		else if (f1 && f2)
-		{
-			filterout (_filter_1[0], stages1, input_1, buffer_1, output_1);
-			filterout (_filter_2[0], stages2, input_1, buffer_1, buffer_2);
-			// Mix in buffer into output:
-			output_1->mixin (buffer_2);
-			filterout (_filter_1[1], stages1, input_2, buffer_1, output_2);
-			filterout (_filter_2[1], stages2, input_2, buffer_1, buffer_2);
-			// Mix in buffer into output:
-			output_2->mixin (buffer_2);
-		}
-		// Neither enabled:
-		else
-			filtered = false;
+		DualFilter* f = filters[i];
+		f->_coefficients_1.valid = topology.stages_1 > 0;
+		f->_coefficients_2.valid = topology.stages_2 > 0;
+		std::copy (f->_impulse_response_1.a, f->_impulse_response_1.a + FilterImpulseResponse::Order, f->_coefficients_1.a);
+		std::copy (f->_impulse_response_1.b, f->_impulse_response_1.b + FilterImpulseResponse::Order, f->_coefficients_1.b);
+		std::copy (f->_impulse_response_2.a, f->_impulse_response_2.a + FilterImpulseResponse::Order, f->_coefficients_2.a);
+		std::copy (f->_impulse_response_2.b, f->_impulse_response_2.b + FilterImpulseResponse::Order, f->_coefficients_2.b);
 	}
 
-	return filtered;
+	return true;
 }
 
 
 void
-DualFilter::filterout (FilterType* filters, int stages, Haruhi::AudioBuffer* input, Haruhi::AudioBuffer* buffer, Haruhi::AudioBuffer* output) noexcept
+DualFilter::update_impulse_responses (std::size_t nsamples, ImpulseResponseCache* cache, DualFilter* const* others, std::size_t others_number) noexcept
+{
+	if (_params_1->enabled)
+	{
+		FilterImpulseResponse::Parameters parameters;
+		parameters.type = static_cast<FilterImpulseResponse::Type> (_params_1->type.get());
+		parameters.frequency = _smoother_1_frequency.process (0.5f * _params_1->frequency.get() / Params::Filter::FrequencyMax, nsamples) / _oversampling;
+		parameters.resonance = _smoother_1_resonance.process (_params_1->resonance.to_f(), nsamples);
+		parameters.gain = _smoother_1_gain.process (_params_1->gain.to_f(), nsamples);
+		parameters.attenuation = _smoother_1_attenuation.process (_params_1->attenuation.to_f(), nsamples);
+		parameters.limiter = _params_1->limiter_enabled;
+
+		_impulse_response_1.set_parameters (parameters, find_impulse_response (parameters, cache, others, others_number));
+		if (cache)
+			cache->insert (_impulse_response_1);
+	}
+
+	if (_params_2->enabled)
+	{
+		FilterImpulseResponse::Parameters parameters;
+		parameters.type = static_cast<FilterImpulseResponse::Type> (_params_2->type.get());
+		parameters.frequency = _smoother_2_frequency.process (0.5f * _params_2->frequency.get() / Params::Filter::FrequencyMax, nsamples) / _oversampling;
+		parameters.resonance = _smoother_2_resonance.process (_params_2->resonance.to_f(), nsamples);
+		parameters.gain = _smoother_2_gain.process (_params_2->gain.to_f(), nsamples);
+		parameters.attenuation = _smoother_2_attenuation.process (_params_2->attenuation.to_f(), nsamples);
+		parameters.limiter = _params_2->limiter_enabled;
+
+		_impulse_response_2.set_parameters (parameters, find_impulse_response (parameters, cache, others, others_number));
+		if (cache)
+			cache->insert (_impulse_response_2);
+	}
+}
+
+
+FilterImpulseResponse const*
+DualFilter::find_impulse_response (FilterImpulseResponse::Parameters const& parameters, ImpulseResponseCache const* cache,
+									DualFilter* const* others, std::size_t others_number) noexcept
 {
-	// ↓ stages
-	// 1: in -> out
-	// 2: in -> buf -> out
-	// 3: in -> out -> buf -> out
-	// 4: in -> buf -> out -> buf -> out
-	// 5: in -> out -> buf -> out -> buf -> out
-
-	Haruhi::AudioBuffer* s = buffer;
-	Haruhi::AudioBuffer* t = output;
-	if (stages % 2 == 0)
-		std::swap (s, t);
-	// Now for odd number of stages, s is buffer, t is output.
-	// For even s is output, t is buffer.
-	filters[0].transform (input->begin(), input->end(), t->begin());
-	for (int i = 1; i < stages; ++i)
+	// Impulse responses store clamped parameters:
+	FilterImpulseResponse::Parameters const p = FilterImpulseResponse::clamped_parameters (parameters);
+
+	if (cache)
+		if (FilterImpulseResponse const* response = cache->find (p))
+			return response;
+
+	for (std::size_t i = 0; i < others_number; ++i)
 	{
-		std::swap (s, t);
-		filters[i].transform (s->begin(), s->end(), t->begin());
+		if (others[i]->_impulse_response_1.parameters() == p)
+			return &others[i]->_impulse_response_1;
+		if (others[i]->_impulse_response_2.parameters() == p)
+			return &others[i]->_impulse_response_2;
 	}
+	return nullptr;
 }
 
 } // namespace Yuki
@@ -16,11 +16,14 @@
 
 // Standard:
 #include <cstddef>
+#include <array>
 
 // Haruhi:
 #include <haruhi/graph/audio_buffer.h>
+#include <haruhi/dsp/biquad_bank.h>
 #include <haruhi/dsp/filter.h>
 #include <haruhi/dsp/one_pole_smoother.h>
+#include <haruhi/utility/atomic.h>
 
 // Local:
 #include "filter_ir.h"
@@ -36,20 +39,95 @@ class DualFilter
 
 	static constexpr int MaxStages = 5;
 
+	// Max number of filters processed together by process_batch():
+	static constexpr std::size_t BatchSize = DSP::BiquadBank::Lanes;
+
 	enum Configuration
 	{
 		Serial		= 0,
 		Parallel	= 1,
 	};
 
+	/**
+	 * Describes how filter stages are connected.
+	 * DualFilters with equal topologies can be processed together.
+	 */
+	struct Topology
+	{
+		bool
+		operator== (Topology const&) const noexcept;
+
+		bool
+		operator!= (Topology const&) const noexcept;
+
+		int		stages_1	= 0; // 0 if filter 1 is disabled.
+		int		stages_2	= 0; // 0 if filter 2 is disabled.
+		bool	parallel	= false; // Set only if both filters are enabled.
+	};
+
+	/**
+	 * Impulse responses computed during one processing round, keyed on their
+	 * parameters. Shared by all voices of a Part, so that coefficients for given
+	 * parameters are computed only once per round, not once per voice.
+	 * When the cache is full, responses are simply not cached.
+	 */
+	class ImpulseResponseCache
+	{
+		static constexpr std::size_t Capacity	= 256;
+		static constexpr std::size_t MaxProbes	= 8;
+
+		enum SlotState
+		{
+			Empty	= 0,
+			Writing	= 1,
+			Ready	= 2,
+		};
+
+		struct Slot
+		{
+			Atomic<int>				state { Empty };
+			FilterImpulseResponse	response;
+		};
+
+	  public:
+		/**
+		 * Forget all cached responses.
+		 * Must not be called concurrently with find() or insert().
+		 */
+		void
+		clear() noexcept;
+
+		/**
+		 * Return cached impulse response with given (clamped) parameters or nullptr.
+		 * 	hreadsafe
+		 */
+		FilterImpulseResponse const*
+		find (FilterImpulseResponse::Parameters const&) const noexcept;
+
+		/**
+		 * Cache copy of given impulse response, unless one with the same parameters
+		 * is already cached.
+		 * 	hreadsafe
+		 */
+		void
+		insert (FilterImpulseResponse const&) noexcept;
+
+	  private:
+		static std::size_t
+		hash (FilterImpulseResponse::Parameters const&) noexcept;
+
+	  private:
+		std::array<Slot, Capacity>	_slots;
+	};
+
   public:
 	DualFilter (Params::Filter* params_1, Params::Filter* params_2);
 
 	/**
-	 * Resets all filters to default state.
+	 * Resets all filters and parameter smoothers to default state.
 	 */
 	void
-	reset();
+	reset() noexcept;
 
 	/**
 	 * \param	configuration (serial/parallel)
@@ -64,21 +142,78 @@ class DualFilter
 	set_oversampling (unsigned int oversampling);
 
 	/**
-	 * Process (filter) buffers.
-	 * Return true if actual filtering was done, false otherwise (output buffer was not filled).
-	 * All buffers must be distinct.
+	 * Process (filter in place) buffers.
+	 * Buffers are left untouched if both filters are disabled.
+	 * \param	cache Optional cache of impulse responses shared with other voices.
+	 */
+	void
+	process (Haruhi::AudioBuffer* buffer_1, Haruhi::AudioBuffer* buffer_2, ImpulseResponseCache* cache = nullptr);
+
+	/**
+	 * Return current topology, according to configuration and parameters.
+	 */
+	Topology
+	topology() const noexcept;
+
+	/**
+	 * Process (filter in place) buffers of up to BatchSize DualFilters at once,
+	 * running the same stages of all filters through one SIMD recurrence.
+	 * Filter coefficients are interpolated sample by sample from values at the end
+	 * of previous call to values computed for the end of this one, so that
+	 * fast parameter sweeps don't get stepped at the buffer rate. Coefficients
+	 * are computed only once for filters with equal parameters.
+	 * \param	buffers_1, buffers_2 Buffers for each filter.
+	 * \param	cache Optional cache of impulse responses shared with filters
+	 *			processed in other batches.
+	 * \returns	false if filters have different topologies, in which case
+	 *			nothing is done and each filter has to be processed separately.
 	 */
-	bool
-	process (Haruhi::AudioBuffer* input_1, Haruhi::AudioBuffer* input_2,
-			 Haruhi::AudioBuffer* buffer_1, Haruhi::AudioBuffer* buffer_2,
-			 Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2);
+	static bool
+	process_batch (DualFilter* const* filters, Haruhi::AudioBuffer* const* buffers_1, Haruhi::AudioBuffer* const* buffers_2, std::size_t count,
+				   ImpulseResponseCache* cache = nullptr);
+
+  private:
+	// Filter coefficients used at the end of last processed buffer:
+	struct Coefficients
+	{
+		Sample	a[FilterImpulseResponse::Order];
+		Sample	b[FilterImpulseResponse::Order];
+		bool	valid = false;
+	};
 
   private:
 	/**
-	 * All buffers must be distinct.
+	 * Update impulse responses from smoothed parameters.
+	 * \param	samples Number of samples to be processed.
+	 * \param	cache Optional cache to look up impulse responses in and to add
+	 *			newly computed ones to.
+	 * \param	others Filters whose impulse responses have already been updated,
+	 *			coefficients are copied from them when parameters are equal.
+	 * \param	others_number Number of filters in others.
 	 */
 	void
-	filterout (FilterType* filters, int stages, Haruhi::AudioBuffer* input, Haruhi::AudioBuffer* buffer, Haruhi::AudioBuffer* output) noexcept;
+	update_impulse_responses (std::size_t samples, ImpulseResponseCache* cache, DualFilter* const* others, std::size_t others_number) noexcept;
+
+	/**
+	 * Return impulse response from cache or from others, that has given parameters, or nullptr.
+	 */
+	static FilterImpulseResponse const*
+	find_impulse_response (FilterImpulseResponse::Parameters const&, ImpulseResponseCache const* cache,
+						   DualFilter* const* others, std::size_t others_number) noexcept;
+
+	/**
+	 * Return filter for given stage of the cascade described by topology.
+	 * Stages of filter 1 go first, then stages of filter 2.
+	 */
+	FilterType&
+	stage_filter (Topology const&, int channel, int stage) noexcept;
+
+	/**
+	 * Return last used coefficients of filter for given stage
+	 * of the cascade described by topology.
+	 */
+	Coefficients&
+	stage_coefficients (Topology const&, int stage) noexcept;
 
   public:
 	Configuration			_configuration		= Serial;
@@ -91,6 +226,8 @@ class DualFilter
 	// Two channels, for each up to 5 stages:
 	FilterType				_filter_1[2][5];
 	FilterType				_filter_2[2][5];
+	Coefficients			_coefficients_1;
+	Coefficients			_coefficients_2;
 	// Smoothers:
 	DSP::OnePoleSmoother	_smoother_1_frequency;
 	DSP::OnePoleSmoother	_smoother_1_resonance;
@@ -102,6 +239,37 @@ class DualFilter
 	DSP::OnePoleSmoother	_smoother_2_attenuation;
 };
 
+
+inline bool
+DualFilter::Topology::operator== (Topology const& other) const noexcept
+{
+	return stages_1 == other.stages_1 && stages_2 == other.stages_2 && parallel == other.parallel;
+}
+
+
+inline bool
+DualFilter::Topology::operator!= (Topology const& other) const noexcept
+{
+	return !(*this == other);
+}
+
+
+inline DualFilter::FilterType&
+DualFilter::stage_filter (Topology const& topology, int channel, int stage) noexcept
+{
+	if (stage < topology.stages_1)
+		return _filter_1[channel][stage];
+	else
+		return _filter_2[channel][stage - topology.stages_1];
+}
+
+
+inline DualFilter::Coefficients&
+DualFilter::stage_coefficients (Topology const& topology, int stage) noexcept
+{
+	return stage < topology.stages_1 ? _coefficients_1 : _coefficients_2;
+}
+
 } // namespace Yuki
 
 #endif
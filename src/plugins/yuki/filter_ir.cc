@@ -13,11 +13,14 @@
 
 // Standard:
 #include <cstddef>
+#include <algorithm>
 #include <complex>
 #include <cmath>
 
 // Haruhi:
 #include <haruhi/config/all.h>
+#include <haruhi/dsp/functions.h>
+#include <haruhi/utility/fast_pow.h>
 
 // Local:
 #include "filter_ir.h"
@@ -43,6 +46,32 @@ FilterImpulseResponse::FilterImpulseResponse (Type type, Sample frequency, Sampl
 }
 
 
+void
+FilterImpulseResponse::set_parameters (Parameters parameters, FilterImpulseResponse const* candidate) noexcept
+{
+	parameters = clamped_parameters (parameters);
+
+	if (parameters == this->parameters())
+		return;
+
+	_type = parameters.type;
+	_frequency = parameters.frequency;
+	_resonance = parameters.resonance;
+	_gain = parameters.gain;
+	_attenuation = parameters.attenuation;
+	_limiter = parameters.limiter;
+
+	if (candidate && candidate->parameters() == parameters)
+	{
+		std::copy (candidate->a, candidate->a + Order, a);
+		std::copy (candidate->b, candidate->b + Order, b);
+		bump();
+	}
+	else
+		update();
+}
+
+
 Sample
 FilterImpulseResponse::response (Sample frequency) const noexcept
 {
@@ -60,11 +89,15 @@ FilterImpulseResponse::update() noexcept
 	if (_dont_update)
 		return;
 
-	float A = std::pow (10.0f, _gain / 40.0f);
-	float w0 = 2.0f * M_PI * _frequency;
-	float alpha = std::sin (w0) / (2.0f * _resonance);
-	float cos_w0 = 0.0f;
-	float sin_w0 = 0.0f;
+	// Use polynomial approximations instead of std::sin/cos/pow, since this is called
+	// for each voice each time filter parameters are modulated. For w0 = 2πf, cos (w0)
+	// is computed from 1 - cos (w0) = 2 sin² (πf), which remains precise for low frequencies:
+	float A = FastPow::pow_radix_10 (_gain / 40.0f);
+	float sin_w0 = DSP::base_sin<5> (2.0f * _frequency);
+	float sin_w0_2 = DSP::base_sin<5> (_frequency);
+	float one_minus_cos_w0 = 2.0f * sin_w0_2 * sin_w0_2;
+	float cos_w0 = 1.0f - one_minus_cos_w0;
+	float alpha = sin_w0 / (2.0f * _resonance);
 	float sqrt_A = 0.0f;
 	float sqrt_A_2_alpha = 0.0f;
 	float auto_attenuation = 1.0f;
@@ -72,13 +105,12 @@ FilterImpulseResponse::update() noexcept
 	switch (_type)
 	{
 		case LowPass:
-			cos_w0 = std::cos (w0);
 
 			a[0] =  1.0f + alpha;
 
-			b[0] = (1.0f - cos_w0) / 2.0f / a[0];
-			b[1] = (1.0f - cos_w0) / a[0];
-			b[2] = (1.0f - cos_w0) / 2.0f / a[0];
+			b[0] = one_minus_cos_w0 / 2.0f / a[0];
+			b[1] = one_minus_cos_w0 / a[0];
+			b[2] = one_minus_cos_w0 / 2.0f / a[0];
 
 			a[1] = -2.0f * cos_w0 / a[0];
 			a[2] = (1.0f - alpha) / a[0];
@@ -87,7 +119,6 @@ FilterImpulseResponse::update() noexcept
 			break;
 
 		case HighPass:
-			cos_w0 = std::cos (w0);
 
 			a[0] =   1.0f + alpha;
 
@@ -103,8 +134,6 @@ FilterImpulseResponse::update() noexcept
 
 		// When limiter is enabled, this BP works as BP-const-gain.
 		case BandPass:
-			sin_w0 = std::sin (w0);
-			cos_w0 = std::cos (w0);
 
 			a[0] =  1.0f + alpha;
 
@@ -119,7 +148,6 @@ FilterImpulseResponse::update() noexcept
 			break;
 
 		case Notch:
-			cos_w0 = std::cos (w0);
 
 			a[0] =  1.0f + alpha;
 
@@ -132,7 +160,6 @@ FilterImpulseResponse::update() noexcept
 			break;
 
 		case AllPass:
-			cos_w0 = std::cos (w0);
 
 			a[0] =  1.0f + alpha;
 
@@ -145,7 +172,6 @@ FilterImpulseResponse::update() noexcept
 			break;
 
 		case Peaking:
-			cos_w0 = std::cos (w0);
 
 			a[0] =  1.0f + alpha / A;
 
@@ -156,11 +182,10 @@ FilterImpulseResponse::update() noexcept
 			a[1] = -2.0f * cos_w0 / a[0];
 			a[2] = (1.0f - alpha / A) / a[0];
 
-			auto_attenuation = std::min (1.0f, 1.0f / std::pow (10.0f, _gain / 20.0f));
+			auto_attenuation = std::min (1.0f, 1.0f / FastPow::pow_radix_10 (_gain / 20.0f));
 			break;
 
 		case LowShelf:
-			cos_w0 = std::cos (w0);
 			sqrt_A = std::sqrt (A);
 			sqrt_A_2_alpha = 2.0f * sqrt_A * alpha;
 
@@ -173,11 +198,10 @@ FilterImpulseResponse::update() noexcept
 			a[1] =     -2.0f * ((A - 1.0f) + (A + 1.0f) * cos_w0) / a[0];
 			a[2] =             ((A + 1.0f) + (A - 1.0f) * cos_w0 - sqrt_A_2_alpha) / a[0];
 
-			auto_attenuation = std::min (1.0f, 1.0f / _resonance / std::pow (10.0f, _gain / 20.0f));
+			auto_attenuation = std::min (1.0f, 1.0f / _resonance / FastPow::pow_radix_10 (_gain / 20.0f));
 			break;
 
 		case HighShelf:
-			cos_w0 = std::cos (w0);
 			sqrt_A = std::sqrt (A);
 			sqrt_A_2_alpha = 2.0f * sqrt_A * alpha;
 
@@ -190,7 +214,7 @@ FilterImpulseResponse::update() noexcept
 			a[1] =      2.0f * ((A - 1.0f) - (A + 1.0f) * cos_w0) / a[0];
 			a[2] =             ((A + 1.0f) - (A - 1.0f) * cos_w0 - sqrt_A_2_alpha) / a[0];
 
-			auto_attenuation = std::min (1.0f, 1.0f / _resonance / std::pow (10.0f, _gain / 20.0f));
+			auto_attenuation = std::min (1.0f, 1.0f / _resonance / FastPow::pow_radix_10 (_gain / 20.0f));
 			break;
 	}
 
@@ -50,6 +50,25 @@ class FilterImpulseResponse: public DSP::ImpulseResponse<3, DSP::IIR>
 		HighShelf	= 7,
 	};
 
+	/**
+	 * Complete set of parameters that determine filter coefficients.
+	 */
+	struct Parameters
+	{
+		bool
+		operator== (Parameters const&) const noexcept;
+
+		bool
+		operator!= (Parameters const&) const noexcept;
+
+		Type	type		= LowPass;
+		Sample	frequency	= 0.0f;
+		Sample	resonance	= 0.0f;
+		Sample	gain		= 0.0f;
+		Sample	attenuation	= 0.0f;
+		bool	limiter		= false;
+	};
+
   public:
 	FilterImpulseResponse (Type type = LowPass, Sample frequency = 0.0f, Sample resonance = 0.0f, Sample gain = 0.0f, Sample attenuation = 0.0f) noexcept;
 
@@ -132,6 +151,28 @@ class FilterImpulseResponse: public DSP::ImpulseResponse<3, DSP::IIR>
 	void
 	set_limiter_enabled (bool enabled) noexcept;
 
+	/**
+	 * Return all parameters.
+	 */
+	Parameters
+	parameters() const noexcept;
+
+	/**
+	 * Set all parameters at once, recomputing coefficients at most once.
+	 * \param	candidate
+	 *			Optional impulse response, that possibly has the same parameters
+	 *			(eg. one of other voice). If it does, coefficients are copied from it
+	 *			instead of being computed.
+	 */
+	void
+	set_parameters (Parameters parameters, FilterImpulseResponse const* candidate = nullptr) noexcept;
+
+	/**
+	 * Return parameters limited to valid ranges, the same way as set_parameters() does.
+	 */
+	static Parameters
+	clamped_parameters (Parameters parameters) noexcept;
+
 	/*
 	 * ImpulseResponse API
 	 */
@@ -140,6 +181,12 @@ class FilterImpulseResponse: public DSP::ImpulseResponse<3, DSP::IIR>
 	response (Sample frequency) const noexcept;
 
   private:
+	static Sample
+	clamped_frequency (Sample frequency) noexcept;
+
+	static Sample
+	clamped_resonance (Sample resonance) noexcept;
+
 	void
 	update() noexcept;
 
@@ -155,6 +202,25 @@ class FilterImpulseResponse: public DSP::ImpulseResponse<3, DSP::IIR>
 };
 
 
+inline bool
+FilterImpulseResponse::Parameters::operator== (Parameters const& other) const noexcept
+{
+	return type == other.type
+		&& frequency == other.frequency
+		&& resonance == other.resonance
+		&& gain == other.gain
+		&& attenuation == other.attenuation
+		&& limiter == other.limiter;
+}
+
+
+inline bool
+FilterImpulseResponse::Parameters::operator!= (Parameters const& other) const noexcept
+{
+	return !(*this == other);
+}
+
+
 inline FilterImpulseResponse::Type
 FilterImpulseResponse::type() const noexcept
 {
@@ -183,8 +249,7 @@ FilterImpulseResponse::frequency() const noexcept
 inline void
 FilterImpulseResponse::set_frequency (Sample frequency) noexcept
 {
-	// Limit frequency to 32Hz…23.99kHz for fs=48kHz
-	frequency = clamped (frequency, 0.0006666666f, 0.4997916666f);
+	frequency = clamped_frequency (frequency);
 	if (_frequency != frequency)
 	{
 		_frequency = frequency;
@@ -203,8 +268,7 @@ FilterImpulseResponse::resonance() const noexcept
 inline void
 FilterImpulseResponse::set_resonance (Sample resonance) noexcept
 {
-	// Q must be greater than 0:
-	resonance = std::max (0.01f, resonance);
+	resonance = clamped_resonance (resonance);
 	if (_resonance != resonance)
 	{
 		_resonance = resonance;
@@ -266,6 +330,45 @@ FilterImpulseResponse::set_limiter_enabled (bool enabled) noexcept
 	}
 }
 
+
+inline FilterImpulseResponse::Parameters
+FilterImpulseResponse::parameters() const noexcept
+{
+	Parameters parameters;
+	parameters.type = _type;
+	parameters.frequency = _frequency;
+	parameters.resonance = _resonance;
+	parameters.gain = _gain;
+	parameters.attenuation = _attenuation;
+	parameters.limiter = _limiter;
+	return parameters;
+}
+
+
+inline FilterImpulseResponse::Parameters
+FilterImpulseResponse::clamped_parameters (Parameters parameters) noexcept
+{
+	parameters.frequency = clamped_frequency (parameters.frequency);
+	parameters.resonance = clamped_resonance (parameters.resonance);
+	return parameters;
+}
+
+
+inline Sample
+FilterImpulseResponse::clamped_frequency (Sample frequency) noexcept
+{
+	// Limit frequency to 32Hz…23.99kHz for fs=48kHz
+	return clamped (frequency, 0.0006666666f, 0.4997916666f);
+}
+
+
+inline Sample
+FilterImpulseResponse::clamped_resonance (Sample resonance) noexcept
+{
+	// Q must be greater than 0:
+	return std::max (0.01f, resonance);
+}
+
 } // namespace Yuki
 
 #endif
@@ -22,6 +22,7 @@
 // Haruhi:
 #include <haruhi/utility/numeric.h>
 #include <haruhi/dsp/modulated_wave.h>
+#include <haruhi/dsp/wavetable.h>
 
 // Local:
 #include "params.h"
@@ -157,7 +158,10 @@ Params::Part::Part():
 	modulator_type ({ 0, 1 }, Haruhi::DSP::ModulatedWave::Ring, "modulator_type"),
 	modulator_wave_type ({ 0, 3 }, 0, "modulator_wave_type"),
 	auto_center ({ 0, 1 }, 0, "auto_center"),
-	filter_configuration ({ 0, 1 }, 0, "filter_configuration")
+	filter_configuration ({ 0, 1 }, 0, "filter_configuration"),
+	wavetable_interpolation ({ 0, 2 }, Haruhi::DSP::Wavetable::Hermite, "wavetable_interpolation"),
+	// Power of two multiple of the smallest table size, 1024 samples:
+	wavetable_size ({ 0, 2 }, 1, "wavetable_size")
 {
 	for (unsigned int i = 0; i < HarmonicsNumber; ++i)
 		harmonics[i] = Haruhi::v06::ControllerParam ({ HarmonicMin, HarmonicMax }, HarmonicCenterValue, HarmonicDefault, HarmonicDenominator, QString ("harmonic[%1]").arg (i).toUtf8().data());
@@ -221,6 +225,8 @@ HARUHI_DEFINE_SAVEABLE_PARAMS (Part)
 	HARUHI_DEFINE_SAVEABLE_PARAM (modulator_wave_type)
 	HARUHI_DEFINE_SAVEABLE_PARAM (auto_center)
 	HARUHI_DEFINE_SAVEABLE_PARAM (filter_configuration)
+	HARUHI_DEFINE_SAVEABLE_PARAM (wavetable_interpolation)
+	HARUHI_DEFINE_SAVEABLE_PARAM (wavetable_size)
 HARUHI_FINISH_SAVEABLE_PARAMS_DEFINITION()
 
 } // namespace Yuki
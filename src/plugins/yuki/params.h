@@ -196,8 +196,10 @@ struct Params
 		Haruhi::v06::Param<unsigned int> modulator_wave_type;
 		Haruhi::v06::Param<unsigned int> auto_center;
 		Haruhi::v06::Param<unsigned int> filter_configuration;
+		Haruhi::v06::Param<unsigned int> wavetable_interpolation;
+		Haruhi::v06::Param<unsigned int> wavetable_size;
 
-		static const std::size_t NUM_PARAMS = 25 + HarmonicsNumber + HarmonicsNumber + 24;
+		static const std::size_t NUM_PARAMS = 27 + HarmonicsNumber + HarmonicsNumber + 24;
 
 		// Embedded Voice params template (also includes Filter params):
 		Voice voice;
@@ -13,6 +13,7 @@
 
 // Standard:
 #include <cstddef>
+#include <algorithm>
 #include <iterator>
 #include <functional>
 #include <utility>
@@ -21,6 +22,7 @@
 #include <haruhi/config/all.h>
 #include <haruhi/application/services.h>
 #include <haruhi/graph/event.h>
+#include <haruhi/dsp/fft.h>
 #include <haruhi/dsp/fft_filler.h>
 #include <haruhi/dsp/functions.h>
 #include <haruhi/dsp/modulated_wave.h>
@@ -29,6 +31,7 @@
 #include <haruhi/utility/fast_pow.h>
 #include <haruhi/utility/qdom.h>
 #include <haruhi/utility/signal.h>
+#include <haruhi/utility/trace.h>
 
 // Local:
 #include "part.h"
@@ -58,11 +61,22 @@ Part::UpdateWavetableWorkUnit::reset (DSP::Wavetable* wavetable, unsigned int se
 void
 Part::UpdateWavetableWorkUnit::execute()
 {
-	Unique<DSP::Wave> wave = _part->final_wave();
+	Trace::Span span ("Wavetable update", _part->id());
+	DSP::FFTFiller::Spectrum spectrum;
+	Unique<DSP::Wave> wave;
+	unsigned int const samples = _part->wavetable_size();
+
+	// Sample the final wave only if it can't be synthesized from spectrum:
+	if (!compute_final_spectrum (spectrum, samples))
+		wave = _part->final_wave();
 
 	DSP::FFTFiller filler (wave.get(), true, 0.000001f);
 	filler.set_cancel_predicate (std::bind (&UpdateWavetableWorkUnit::is_cancelled, this));
-	filler.fill (_wavetable, 4096);
+	filler.set_work_performer (Haruhi::Services::lo_priority_work_performer());
+	if (wave)
+		filler.fill (_wavetable, samples);
+	else
+		filler.fill (_wavetable, spectrum);
 
 	if (!filler.was_interrupted())
 	{
@@ -73,6 +87,47 @@ Part::UpdateWavetableWorkUnit::execute()
 }
 
 
+bool
+Part::UpdateWavetableWorkUnit::compute_final_spectrum (DSP::FFTFiller::Spectrum& spectrum, unsigned int samples)
+{
+	Params::Part const& params = _part->_part_params;
+
+	// Zero-amplitude modulation leaves the wave intact, any other doesn't
+	// map to simple operations on spectrum:
+	if (params.modulator_amplitude.to_f() != 0.0f || !_part->base_wave()->immutable())
+		return false;
+
+	auto const key = std::make_tuple (params.wave_type.get(), params.wave_shape.get(), samples);
+	auto base_spectrum = _base_spectra.find (key);
+	if (base_spectrum == _base_spectra.end())
+	{
+		// Shape is changed continuously with knob, don't let the cache grow without bounds:
+		if (_base_spectra.size() >= 64)
+			_base_spectra.clear();
+
+		Unique<DSP::ParametricWave> bw (_part->base_wave()->clone());
+		bw->set_param (params.wave_shape.to_f());
+		base_spectrum = _base_spectra.insert ({ key, DSP::FFTFiller::wave_spectrum (*bw, samples) }).first;
+	}
+
+	DSP::HarmonicsWave hw;
+	_part->apply_harmonics (&hw);
+	hw.compute_spectrum (base_spectrum->second, spectrum);
+
+	if (params.auto_center)
+	{
+		DSP::FFT::Real fft (samples);
+		std::copy (spectrum.begin(), spectrum.end(), fft.spectrum());
+		fft.inverse();
+		auto min_max = std::minmax_element (fft.signal(), fft.signal() + fft.size());
+		// Inverse transform is unnormalized, so is DC bin of the spectrum:
+		spectrum[0] -= 0.5f * (*min_max.first + *min_max.second);
+	}
+
+	return true;
+}
+
+
 Part::PartPorts::PartPorts (Plugin* plugin, unsigned int part_id)
 {
 	port_group = std::make_unique<Haruhi::PortGroup> (plugin->graph(), QString ("Part %1").arg (part_id).toStdString());
@@ -243,7 +298,7 @@ Part::PartControllerProxies::forward_messages (Haruhi::EventPort* source, Haruhi
 	if (target->back_connections().empty())
 	{
 		if (source->back_connections().empty())
-			target->buffer()->push (new Haruhi::ControllerEvent (Time::now(), source->default_value()));
+			target->push_change (source->default_value());
 		else
 			target->buffer()->mixin (source->buffer());
 	}
@@ -318,6 +373,9 @@ Part::Part (PartManager* part_manager, WorkPerformer* work_performer, Params::Ma
 	// Initially compute wavetable. Also makes it possible to wait
 	// on work unit in the destructor:
 	update_wavetable();
+	update_wavetable_interpolation();
+
+	_part_params.wavetable_interpolation.on_change.connect (this, &Part::update_wavetable_interpolation);
 
 #define UPDATE_WAVETABLE_ON_CHANGE(name) _part_params.name.on_change.connect (this, &Part::update_wavetable)
 	// Listen on params change. Only on params that need additional
@@ -330,6 +388,7 @@ Part::Part (PartManager* part_manager, WorkPerformer* work_performer, Params::Ma
 	UPDATE_WAVETABLE_ON_CHANGE (modulator_index);
 	UPDATE_WAVETABLE_ON_CHANGE (modulator_shape);
 	UPDATE_WAVETABLE_ON_CHANGE (auto_center);
+	UPDATE_WAVETABLE_ON_CHANGE (wavetable_size);
 	for (std::size_t i = 0; i < std::size (_part_params.harmonics); ++i)
 		UPDATE_WAVETABLE_ON_CHANGE (harmonics[i]);
 	for (std::size_t i = 0; i < std::size (_part_params.harmonic_phases); ++i)
@@ -459,6 +518,13 @@ Part::set_oversampling (unsigned int oversampling)
 }
 
 
+void
+Part::set_polyphony (unsigned int polyphony)
+{
+	_voice_manager->set_polyphony (polyphony);
+}
+
+
 void
 Part::update_wavetable()
 {
@@ -466,6 +532,22 @@ Part::update_wavetable()
 }
 
 
+void
+Part::update_wavetable_interpolation()
+{
+	auto interpolation = static_cast<DSP::Wavetable::Interpolation> (_part_params.wavetable_interpolation.get());
+	_wave_current.set_interpolation (interpolation);
+	_wave_next.set_interpolation (interpolation);
+}
+
+
+unsigned int
+Part::wavetable_size() const noexcept
+{
+	return MinWavetableSize << _part_params.wavetable_size.get();
+}
+
+
 void
 Part::check_wavetable_update_process()
 {
@@ -510,6 +592,7 @@ Part::async_render()
 		case DSP::CrossingWave::NotStarted:
 			if (_new_wavetable_ready.load())
 			{
+				Trace::Span span ("Wavetable swap", id());
 				_new_wavetable_ready.store (false);
 
 				swap (_wavetable_rendered, _wavetable_next);
@@ -576,6 +659,13 @@ Part::voices_number() const
 }
 
 
+CPUStats const&
+Part::render_cpu_stats() const noexcept
+{
+	return _voice_manager->render_cpu_stats();
+}
+
+
 Unique<DSP::Wave>
 Part::final_wave() const
 {
@@ -587,14 +677,7 @@ Part::final_wave() const
 
 	// Add harmonics:
 	DSP::HarmonicsWave* hw = new DSP::HarmonicsWave (bw, true);
-	for (std::size_t i = 0; i < Params::Part::HarmonicsNumber; ++i)
-	{
-		float h = _part_params.harmonics[i].to_f();
-		float p = _part_params.harmonic_phases[i].to_f();
-		// Apply exponential curve to harmonic value:
-		h = h > 0 ? FastPow::pow (h, M_E) : -FastPow::pow (-h, M_E);
-		hw->set_harmonic (i, h, p);
-	}
+	apply_harmonics (hw);
 
 	Unique<DSP::Wave> final = std::make_unique<DSP::ModulatedWave> (hw, mw, static_cast<DSP::ModulatedWave::Type> (_part_params.modulator_type.get()),
 																	_part_params.modulator_amplitude.to_f(), _part_params.modulator_index.get(), true, true);
@@ -610,6 +693,20 @@ Part::final_wave() const
 }
 
 
+void
+Part::apply_harmonics (DSP::HarmonicsWave* wave) const
+{
+	for (std::size_t i = 0; i < Params::Part::HarmonicsNumber; ++i)
+	{
+		float h = _part_params.harmonics[i].to_f();
+		float p = _part_params.harmonic_phases[i].to_f();
+		// Apply exponential curve to harmonic value:
+		h = h > 0 ? FastPow::pow (h, M_E) : -FastPow::pow (-h, M_E);
+		wave->set_harmonic (i, h, p);
+	}
+}
+
+
 void
 Part::save_state (QDomElement& element) const
 {
@@ -18,12 +18,17 @@
 #include <cstddef>
 #include <iterator>
 #include <list>
+#include <map>
+#include <tuple>
+#include <utility>
 
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/dsp/wavetable.h>
 #include <haruhi/dsp/parametric_wave.h>
 #include <haruhi/dsp/crossing_wave.h>
+#include <haruhi/dsp/fft_filler.h>
+#include <haruhi/dsp/harmonics_wave.h>
 #include <haruhi/graph/event.h>
 #include <haruhi/graph/event_port.h>
 #include <haruhi/graph/audio_buffer.h>
@@ -63,6 +68,11 @@ class Part:
 {
 	friend class PartWidget;
 
+	// Smallest number of samples in each of wavetables. The wavetable_size
+	// param selects it or one of its power of two multiples. Higher order
+	// interpolation allows using smaller tables without increasing aliasing:
+	static constexpr unsigned int MinWavetableSize = 1024;
+
 	class UpdateWavetableWorkUnit: public WorkPerformer::Unit
 	{
 	  public:
@@ -107,11 +117,25 @@ class Part:
 		bool
 		is_cancelled() const;
 
+		/**
+		 * Compute spectrum of the final wave without sampling it:
+		 * spectrum of the base wave is taken from cache and harmonics
+		 * are added to it in frequency domain.
+		 * \param	samples Number of samples in each table.
+		 * \returns	false if final wave is modulated or base wave is not immutable,
+		 *			in which case final wave must be sampled.
+		 */
+		bool
+		compute_final_spectrum (DSP::FFTFiller::Spectrum& spectrum, unsigned int samples);
+
 	  private:
 		Part*					_part;
 		DSP::Wavetable*			_wavetable		= nullptr;
 		unsigned int			_serial;
 		Atomic<bool>			_is_cancelled;
+		// Spectra of base waves for (wave type, wave shape, table size), used only by execute():
+		std::map<std::tuple<unsigned int, int, unsigned int>, DSP::FFTFiller::Spectrum>
+								_base_spectra;
 	};
 
 	/**
@@ -242,7 +266,7 @@ class Part:
 		 * Forward messages from the first EventPort to the second one,
 		 * unless first has any back connections. Also, if neither EventPort
 		 * is connected on back, make the second EventPort yield ControllerEvent
-		 * with source port's default value.
+		 * with source port's default value, if it hasn't already.
 		 */
 		void
 		forward_messages (Haruhi::EventPort* source, Haruhi::EventPort* target);
@@ -399,6 +423,13 @@ class Part:
 	void
 	set_oversampling (unsigned int oversampling);
 
+	/**
+	 * Preallocate voices for given polyphony.
+	 * Needs Graph lock.
+	 */
+	void
+	set_polyphony (unsigned int polyphony);
+
 	/**
 	 * Update wavetable according to new parameters.
 	 * Switch double-buffered wavetables.
@@ -408,6 +439,20 @@ class Part:
 	void
 	update_wavetable();
 
+	/**
+	 * Set interpolation used for accessing wavetables
+	 * according to the parameter.
+	 */
+	void
+	update_wavetable_interpolation();
+
+	/**
+	 * Return number of samples in each of wavetables,
+	 * according to the parameter.
+	 */
+	unsigned int
+	wavetable_size() const noexcept;
+
 	/**
 	 * Start voices rendering.
 	 */
@@ -432,6 +477,12 @@ class Part:
 	unsigned int
 	voices_number() const;
 
+	/**
+	 * Return statistics of CPU time spent rendering voices.
+	 */
+	CPUStats const&
+	render_cpu_stats() const noexcept;
+
 	/**
 	 * Return currently selected base wave object.
 	 */
@@ -453,6 +504,14 @@ class Part:
 	Unique<DSP::Wave>
 	final_wave() const;
 
+	/**
+	 * Set harmonics of given wave from parameters
+	 * taken at the time of the call.
+	 * \threadsafe
+	 */
+	void
+	apply_harmonics (DSP::HarmonicsWave*) const;
+
 	/*
 	 * SaveableState implementation
 	 */
@@ -15,6 +15,7 @@
 #include <cstddef>
 #include <algorithm>
 #include <functional>
+#include <string>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -82,6 +83,7 @@ PartManager::PartManager (Plugin* plugin):
 	_proxies (&_ports, &_main_params)
 {
 	_main_params.oversampling.on_change.connect (this, &PartManager::oversampling_updated);
+	_main_params.polyphony.on_change.connect (this, &PartManager::polyphony_updated);
 }
 
 
@@ -176,11 +178,10 @@ PartManager::process()
 	bool const enabled = _main_params.enabled.get();
 
 	// VoiceEvents:
-	for (auto e: _ports.voice_in->buffer()->events())
+	for (auto& e: _ports.voice_in->buffer()->events())
 	{
-		if (e->event_type() == Haruhi::Event::VoiceEventType)
+		if (auto ev = e.as<Haruhi::VoiceEvent>())
 		{
-			Haruhi::VoiceEvent const* ev = static_cast<Haruhi::VoiceEvent const*> (e.get());
 			if (enabled || ev->action() == Haruhi::VoiceEvent::Action::Drop)
 				for (Part* p: _parts)
 					p->handle_voice_event (ev);
@@ -191,11 +192,10 @@ PartManager::process()
 	{
 		// Pitch (frequency) events:
 		_ports.voice_pitch->sync();
-		for (auto e: _ports.voice_pitch->buffer()->events())
+		for (auto& e: _ports.voice_pitch->buffer()->events())
 		{
-			if (e->event_type() == Haruhi::Event::VoiceControllerEventType)
+			if (auto ev = e.as<Haruhi::VoiceControllerEvent>())
 			{
-				Haruhi::VoiceControllerEvent const* ev = static_cast<Haruhi::VoiceControllerEvent const*> (e.get());
 				for (Part* p: _parts)
 					p->handle_frequency_event (ev);
 			}
@@ -203,11 +203,10 @@ PartManager::process()
 
 		// Velocity (amplitude) events:
 		_ports.voice_velocity->sync();
-		for (auto e: _ports.voice_velocity->buffer()->events())
+		for (auto& e: _ports.voice_velocity->buffer()->events())
 		{
-			if (e->event_type() == Haruhi::Event::VoiceControllerEventType)
+			if (auto ev = e.as<Haruhi::VoiceControllerEvent>())
 			{
-				Haruhi::VoiceControllerEvent const* ev = static_cast<Haruhi::VoiceControllerEvent const*> (e.get());
 				for (Part* p: _parts)
 					p->handle_amplitude_event (ev);
 			}
@@ -306,6 +305,15 @@ PartManager::voices_number() const
 }
 
 
+void
+PartManager::collect_cpu_stats (std::vector<std::pair<std::string, CPUStats::Snapshot>>& result) const
+{
+	Mutex::Lock lock (_parts_mutex);
+	for (Part* p: _parts)
+		result.emplace_back ("Part " + std::to_string (p->id()), p->render_cpu_stats().snapshot());
+}
+
+
 void
 PartManager::save_state (QDomElement& element) const
 {
@@ -374,6 +382,23 @@ PartManager::set_oversampling (unsigned int oversampling)
 }
 
 
+void
+PartManager::polyphony_updated()
+{
+	Haruhi::Services::call_out (std::bind (&PartManager::set_polyphony, this, _main_params.polyphony.get()));
+}
+
+
+void
+PartManager::set_polyphony (unsigned int polyphony)
+{
+	auto graph_lock = get_graph_lock();
+
+	for (Part* p: _parts)
+		p->set_polyphony (polyphony);
+}
+
+
 Mutex::Lock
 PartManager::get_graph_lock() const
 {
@@ -16,6 +16,9 @@
 
 // Standard:
 #include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
 
 // Haruhi:
 #include <haruhi/config/all.h>
@@ -24,6 +27,7 @@
 #include <haruhi/graph/event_port.h>
 #include <haruhi/graph/event_buffer.h>
 #include <haruhi/lib/controller_proxy.h>
+#include <haruhi/utility/cpu_stats.h>
 #include <haruhi/utility/noncopyable.h>
 #include <haruhi/utility/signal.h>
 #include <haruhi/utility/mutex.h>
@@ -200,6 +204,12 @@ class PartManager:
 	unsigned int
 	voices_number() const;
 
+	/**
+	 * Append render statistics of all parts.
+	 */
+	void
+	collect_cpu_stats (std::vector<std::pair<std::string, CPUStats::Snapshot>>&) const;
+
 	/*
 	 * SaveableState implementation
 	 */
@@ -224,6 +234,19 @@ class PartManager:
 	void
 	set_oversampling (unsigned int oversampling);
 
+	/**
+	 * Called whenever polyphony parameter changes.
+	 * Calls-out set_polyphony() with proper value.
+	 */
+	void
+	polyphony_updated();
+
+	/**
+	 * Set polyphony on all parts.
+	 */
+	void
+	set_polyphony (unsigned int polyphony);
+
 	/**
 	 * Return graph lock if graph is available (unit is registered).
 	 */
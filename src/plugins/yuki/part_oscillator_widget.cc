@@ -25,6 +25,7 @@
 #include <haruhi/widgets/plot_frame.h>
 #include <haruhi/widgets/wave_plot.h>
 #include <haruhi/dsp/modulated_wave.h>
+#include <haruhi/dsp/wavetable.h>
 
 // Local:
 #include "part_oscillator_widget.h"
@@ -264,6 +265,24 @@ PartOscillatorWidget::PartOscillatorWidget (QWidget* parent, PartWidget* part_wi
 	_filter_configuration->setIconSize (Resources::Icons16::haruhi().size());
 	QObject::connect (_filter_configuration.get(), SIGNAL (activated (int)), _part_widget, SLOT (widgets_to_oscillator_params()));
 
+	// Wavetable interpolation:
+	_wavetable_interpolation = std::make_unique<QComboBox> (this);
+	_wavetable_interpolation->insertItem (DSP::Wavetable::Linear, "Linear");
+	_wavetable_interpolation->insertItem (DSP::Wavetable::Hermite, "Cubic Hermite");
+	_wavetable_interpolation->insertItem (DSP::Wavetable::Optimal, "Optimal 4-point");
+	_wavetable_interpolation->setCurrentIndex (pp->wavetable_interpolation);
+	_wavetable_interpolation->setToolTip ("Wavetable interpolation. Higher orders give less aliasing and take more CPU power.");
+	QObject::connect (_wavetable_interpolation.get(), SIGNAL (activated (int)), _part_widget, SLOT (widgets_to_oscillator_params()));
+
+	// Wavetable size:
+	_wavetable_size = std::make_unique<QComboBox> (this);
+	_wavetable_size->insertItem (0, "1024 samples");
+	_wavetable_size->insertItem (1, "2048 samples");
+	_wavetable_size->insertItem (2, "4096 samples");
+	_wavetable_size->setCurrentIndex (pp->wavetable_size);
+	_wavetable_size->setToolTip ("Number of samples in each wavetable. Larger tables give less aliasing and take more memory.");
+	QObject::connect (_wavetable_size.get(), SIGNAL (activated (int)), _part_widget, SLOT (widgets_to_oscillator_params()));
+
 	// Layouts:
 
 	auto pitchbend_range_layout = new QHBoxLayout();
@@ -284,6 +303,10 @@ PartOscillatorWidget::PartOscillatorWidget (QWidget* parent, PartWidget* part_wi
 	group1_layout->addWidget (_frequency_modulation_range.get(), 2, 1);
 	group1_layout->addWidget (new QLabel ("Transposition:", this), 3, 0);
 	group1_layout->addWidget (_transposition_semitones.get(), 3, 1);
+	group1_layout->addWidget (new QLabel ("Interpolation:", this), 4, 0);
+	group1_layout->addWidget (_wavetable_interpolation.get(), 4, 1);
+	group1_layout->addWidget (new QLabel ("Table size:", this), 5, 0);
+	group1_layout->addWidget (_wavetable_size.get(), 5, 1);
 
 	auto group2 = new QWidget (this);
 	auto group2_layout = new QVBoxLayout (group2);
@@ -354,6 +377,8 @@ PartOscillatorWidget::PartOscillatorWidget (QWidget* parent, PartWidget* part_wi
 	pp->modulator_wave_type.on_change.connect (_part_widget, &PartWidget::post_params_to_widgets);
 	pp->auto_center.on_change.connect (_part_widget, &PartWidget::post_params_to_widgets);
 	pp->filter_configuration.on_change.connect (_part_widget, &PartWidget::post_params_to_widgets);
+	pp->wavetable_interpolation.on_change.connect (_part_widget, &PartWidget::post_params_to_widgets);
+	pp->wavetable_size.on_change.connect (_part_widget, &PartWidget::post_params_to_widgets);
 }
 
 
@@ -393,6 +418,8 @@ PartOscillatorWidget::widgets_to_oscillator_params()
 	pp->unison_stereo = _unison_stereo->isChecked();
 	pp->pseudo_stereo = _pseudo_stereo->isChecked();
 	pp->filter_configuration = _filter_configuration->currentIndex();
+	pp->wavetable_interpolation = _wavetable_interpolation->currentIndex();
+	pp->wavetable_size = _wavetable_size->currentIndex();
 }
 
 
@@ -434,6 +461,8 @@ PartOscillatorWidget::params_to_widgets()
 	_unison_stereo->setChecked (pp->unison_stereo);
 	_pseudo_stereo->setChecked (pp->pseudo_stereo);
 	_filter_configuration->setCurrentIndex (pp->filter_configuration);
+	_wavetable_interpolation->setCurrentIndex (pp->wavetable_interpolation);
+	_wavetable_size->setCurrentIndex (pp->wavetable_size);
 }
 
 
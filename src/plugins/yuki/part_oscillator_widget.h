@@ -113,6 +113,8 @@ class PartOscillatorWidget: public QWidget
 	Unique<FilterWidget>		_filter_2;
 	Unique<Haruhi::WavePlot>	_base_wave_plot;
 	Unique<QComboBox>			_filter_configuration;
+	Unique<QComboBox>			_wavetable_interpolation;
+	Unique<QComboBox>			_wavetable_size;
 	Unique<Haruhi::WavePlot>	_final_wave_plot;
 
 	// Waveform knobs:
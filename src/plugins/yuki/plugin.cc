@@ -95,6 +95,13 @@ Plugin::voices_number() const
 }
 
 
+void
+Plugin::collect_cpu_stats (std::vector<std::pair<std::string, CPUStats::Snapshot>>& result) const
+{
+	_part_manager->collect_cpu_stats (result);
+}
+
+
 void
 Plugin::set_unit_bay (Haruhi::UnitBay* unit_bay)
 {
@@ -46,6 +46,12 @@ class Plugin:
 
 	~Plugin();
 
+	/**
+	 * Return PartManager.
+	 */
+	PartManager*
+	part_manager() const noexcept;
+
 	/*
 	 * Plugin implementation.
 	 */
@@ -68,6 +74,9 @@ class Plugin:
 	int
 	voices_number() const override;
 
+	void
+	collect_cpu_stats (std::vector<std::pair<std::string, CPUStats::Snapshot>>&) const override;
+
 	void
 	set_unit_bay (Haruhi::UnitBay*) override;
 
@@ -97,6 +106,13 @@ class Plugin:
 };
 
 
+inline PartManager*
+Plugin::part_manager() const noexcept
+{
+	return _part_manager.get();
+}
+
+
 inline void
 Plugin::save_preset (QDomElement& element) const
 {
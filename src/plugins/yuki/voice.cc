@@ -59,34 +59,57 @@ Voice::SharedResources::resize_buffers()
 }
 
 
-Voice::Voice (Haruhi::VoiceID id, Time timestamp, Params::Main* main_params, Params::Part* part_params,
-			  Amplitude amplitude, NormalizedFrequency frequency, Frequency sample_rate, std::size_t buffer_size, unsigned int oversampling):
-	_id (id),
-	_timestamp (timestamp),
-	_state (Voicing),
+Voice::Voice (Params::Main* main_params, Params::Part* part_params, Frequency sample_rate, std::size_t buffer_size, unsigned int oversampling):
+	_id (Haruhi::OmniVoice),
+	_timestamp (0_s),
+	_state (Finished),
 	_params (part_params->voice),
 	_part_params (part_params),
 	_main_params (main_params),
-	_amplitude (amplitude),
-	_frequency (frequency),
+	_amplitude (0.0f),
+	_frequency (0.0f),
 	_sample_rate (sample_rate),
 	_buffer_size (buffer_size),
 	_oversampling (oversampling),
 	_vmod (part_params, buffer_size),
 	_dual_filter (&_params.filters[0], &_params.filters[1]),
-	_target_frequency (frequency),
-	_frequency_change (0.0f),
+	_target_frequency (0.0f),
+	_frequency_change (1.0f),
 	_attack_sample (0),
 	_drop_sample (0),
+	_start_delay (0),
+	_drop_delay (0),
 	_first_pass (true)
 {
 	resize_buffers();
 
-	_vosc.set_phase (_part_params->phase.to_f());
-	_vosc.set_initial_phases_spread (_params.unison_init.to_f());
-
 	// This will call recompute_sampling_rate_dependents();
 	set_oversampling (_oversampling);
+}
+
+
+void
+Voice::start (Haruhi::VoiceID id, Time timestamp, std::size_t frame, Amplitude amplitude, NormalizedFrequency frequency) noexcept
+{
+	_id = id;
+	_timestamp = timestamp;
+	_state = Voicing;
+	_params = _part_params->voice;
+	_amplitude = amplitude;
+	_frequency = frequency;
+	_target_frequency = frequency;
+	_frequency_change = 1.0f;
+	_attack_sample = 0;
+	_drop_sample = 0;
+	_start_delay = frame * _oversampling;
+	_drop_delay = 0;
+	_first_pass = true;
+
+	_vmod.reset();
+	_dual_filter.reset();
+	_vosc.reset();
+	_vosc.set_phase (_part_params->phase.to_f());
+	_vosc.set_initial_phases_spread (_params.unison_init.to_f());
 
 	update_glide_parameters();
 }
@@ -94,6 +117,13 @@ Voice::Voice (Haruhi::VoiceID id, Time timestamp, Params::Main* main_params, Par
 
 bool
 Voice::render (SharedResources* res)
+{
+	return render_oscillation (res) && render_output (res, false);
+}
+
+
+bool
+Voice::render_oscillation (SharedResources* res)
 {
 	if (_state == Finished)
 		return false;
@@ -121,38 +151,60 @@ Voice::render (SharedResources* res)
 	_vosc.set_noise_enabled (_part_params->noise_enabled.get());
 	_vosc.fill (&_output_1, &_output_2);
 
-	// Filter:
 	_dual_filter.configure (static_cast<DualFilter::Configuration> (_part_params->filter_configuration.get()), _sample_rate);
-	bool filtered = _dual_filter.process (&_output_1, &_output_2, res->tmp_buf + 0, res->tmp_buf + 1, res->tmp_buf + 2, res->tmp_buf + 3);
-	Haruhi::AudioBuffer* filters_output_1 = filtered ? res->tmp_buf + 2 : &_output_1;
-	Haruhi::AudioBuffer* filters_output_2 = filtered ? res->tmp_buf + 3 : &_output_2;
+	return true;
+}
+
+
+bool
+Voice::render_output (SharedResources* res, bool filtered_in_place)
+{
+	// Filter:
+	if (!filtered_in_place)
+		_dual_filter.process (&_output_1, &_output_2, res->impulse_response_cache);
+
+	std::size_t const size = _buffer_size * _oversampling;
+
+	// Silence before the frame at which voice was started:
+	std::size_t const attack_begin = std::min (_start_delay, size);
+	if (attack_begin > 0)
+	{
+		std::fill (_output_1.begin(), _output_1.begin() + attack_begin, 0.0f);
+		std::fill (_output_2.begin(), _output_2.begin() + attack_begin, 0.0f);
+		_start_delay -= attack_begin;
+	}
 
-	// Smooth Attacking or dropping:
+	// Smooth attacking:
 	if (_attack_sample < _attack_samples)
 	{
 		// Voice phase in:
-		for (std::size_t i = 0; i < _buffer_size * _oversampling && _attack_sample < _attack_samples; ++i, ++_attack_sample)
+		for (std::size_t i = attack_begin; i < size && _attack_sample < _attack_samples; ++i, ++_attack_sample)
 		{
 			float const k = 1.0f * _attack_sample / _attack_samples;
-			(*filters_output_1)[i] *= k;
-			(*filters_output_2)[i] *= k;
+			_output_1[i] *= k;
+			_output_2[i] *= k;
 		}
 	}
-	else if (_state == Dropped)
+
+	// Smooth dropping. Voice may be dropped before its attack is finished,
+	// in which case both gains apply, so that the drop still starts at the
+	// right frame of this buffer:
+	if (_state == Dropped)
 	{
 		if (_drop_sample < _drop_samples)
 		{
-			// Voice phase out:
-			std::size_t i;
-			for (i = 0; i < _buffer_size * _oversampling && _drop_sample < _drop_samples; ++i, ++_drop_sample)
+			// Voice phase out, starting at the frame at which voice was dropped:
+			std::size_t i = std::min (_drop_delay, size);
+			_drop_delay -= i;
+			for (; i < size && _drop_sample < _drop_samples; ++i, ++_drop_sample)
 			{
 				float const k = 1.0f - 1.0f * _drop_sample / _drop_samples;
-				(*filters_output_1)[i] *= k;
-				(*filters_output_2)[i] *= k;
+				_output_1[i] *= k;
+				_output_2[i] *= k;
 			}
 			// Starting point is not 16-byte aligned, can't use SIMD operations:
-			std::fill (filters_output_1->begin() + i, filters_output_1->end(), 0.0f);
-			std::fill (filters_output_2->begin() + i, filters_output_2->end(), 0.0f);
+			std::fill (_output_1.begin() + i, _output_1.end(), 0.0f);
+			std::fill (_output_2.begin() + i, _output_2.end(), 0.0f);
 		}
 		else
 		{
@@ -171,29 +223,41 @@ Voice::render (SharedResources* res)
 		f = f > 1.0f ? 1.0 : f;
 		if (_first_pass)
 			_smoother_panorama_1.reset (f);
-		_smoother_panorama_1.multiply (filters_output_1->begin(), filters_output_1->end(), f);
+		_smoother_panorama_1.multiply (_output_1.begin(), _output_1.end(), f);
 
 		f = 1.0f - 1.0f / Params::Voice::PanoramaMin * _params.panorama.get();
 		f = f > 1.0f ? 1.0 : f;
 		if (_first_pass)
 			_smoother_panorama_2.reset (f);
-		_smoother_panorama_2.multiply (filters_output_2->begin(), filters_output_2->end(), f);
+		_smoother_panorama_2.multiply (_output_2.begin(), _output_2.end(), f);
 
 		__brainfuck (",>,>++++++[-<--------<-------->>]", &res->output_1, &res->output_2);
 		__brainfuck ("<<<<++++++[-<++++++++>]<.", &res);
 	}
 
-	// Final output:
-	if (filters_output_1 != &_output_1)
-		_output_1.fill (filters_output_1);
-	if (filters_output_2 != &_output_2)
-		_output_2.fill (filters_output_2);
-
 	_first_pass = false;
 	return true;
 }
 
 
+bool
+Voice::filter_batch (SharedResources* res, Voice* const* voices, std::size_t count)
+{
+	DualFilter* filters[DualFilter::BatchSize];
+	Haruhi::AudioBuffer* buffers_1[DualFilter::BatchSize];
+	Haruhi::AudioBuffer* buffers_2[DualFilter::BatchSize];
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		filters[i] = &voices[i]->_dual_filter;
+		buffers_1[i] = &voices[i]->_output_1;
+		buffers_2[i] = &voices[i]->_output_2;
+	}
+
+	return DualFilter::process_batch (filters, buffers_1, buffers_2, count, res->impulse_response_cache);
+}
+
+
 void
 Voice::graph_updated (Frequency sample_rate, std::size_t buffer_size)
 {
@@ -202,7 +266,7 @@ Voice::graph_updated (Frequency sample_rate, std::size_t buffer_size)
 
 	_vmod.graph_updated (buffer_size);
 	resize_buffers();
-
+	recompute_sampling_rate_dependents();
 }
 
 
@@ -216,6 +280,8 @@ Voice::set_oversampling (unsigned int oversampling)
 	// reflect position in buffer:
 	_attack_sample *= change_factor;
 	_drop_sample *= change_factor;
+	_start_delay *= change_factor;
+	_drop_delay *= change_factor;
 
 	_vmod.set_oversampling (oversampling);
 	_dual_filter.set_oversampling (oversampling);
@@ -61,6 +61,9 @@ Voice
 		Haruhi::AudioBuffer	frequency_buf;
 		Haruhi::AudioBuffer	fm_buf;
 		Haruhi::AudioBuffer	tmp_buf[6];
+		// Filter impulse responses computed by all threads in current round:
+		DualFilter::ImpulseResponseCache*
+							impulse_response_cache = nullptr;
 
 	  private:
 		void
@@ -76,9 +79,20 @@ Voice
 	static constexpr Time	DropTime		= 1_ms;
 
   public:
-	// Ctor.
-	Voice (Haruhi::VoiceID id, Time timestamp, Params::Main* main_params, Params::Part* part_params,
-		   Amplitude amplitude, NormalizedFrequency frequency, Frequency sample_rate, std::size_t buffer_size, unsigned int oversampling);
+	/**
+	 * Create voice with all buffers allocated. Voice is in Finished state
+	 * until it's started with start().
+	 */
+	Voice (Params::Main* main_params, Params::Part* part_params, Frequency sample_rate, std::size_t buffer_size, unsigned int oversampling);
+
+	/**
+	 * (Re)start voice with given ID. Brings voice into the state of a newly
+	 * created voice, reusing already allocated buffers, so it's safe to call
+	 * from the RT thread.
+	 * \param	frame Offset in samples in the next rendered buffer, at which voice should start sounding.
+	 */
+	void
+	start (Haruhi::VoiceID id, Time timestamp, std::size_t frame, Amplitude amplitude, NormalizedFrequency frequency) noexcept;
 
 	/**
 	 * Return voice's ID which came in Haruhi::VoiceEvent.
@@ -101,9 +115,10 @@ Voice
 	/**
 	 * Drop voice. Voice does not immediately stop sounding.
 	 * Use finished() to check if voice generation is really finished.
+	 * \param	frame Offset in samples in the next rendered buffer, at which voice should start dropping.
 	 */
 	void
-	drop() noexcept;
+	drop (std::size_t frame = 0) noexcept;
 
 	/**
 	 * Render voice.
@@ -112,6 +127,28 @@ Voice
 	bool
 	render (SharedResources*);
 
+	/**
+	 * First part of render(): generate unfiltered oscillation.
+	 * \return	false if voice is finished.
+	 */
+	bool
+	render_oscillation (SharedResources*);
+
+	/**
+	 * Second part of render(): filter, apply attack/drop and panorama.
+	 * \param	filtered_in_place True if output was already filtered with filter_batch().
+	 * \return	true if something were actually synthesized, false otherwise.
+	 */
+	bool
+	render_output (SharedResources*, bool filtered_in_place);
+
+	/**
+	 * Return topology of voice's filters. Voices with equal topologies
+	 * can be filtered together with filter_batch().
+	 */
+	DualFilter::Topology
+	filter_topology() const noexcept;
+
 	/**
 	 * Mix rendered voice into given buffers.
 	 */
@@ -164,6 +201,15 @@ Voice
 	static Voice*
 	return_older (Voice* a, Voice* b) noexcept;
 
+	/**
+	 * Filter outputs of up to DualFilter::BatchSize voices at once, between
+	 * render_oscillation() and render_output().
+	 * \returns	false if voices' filters have different topologies
+	 *			and nothing was done.
+	 */
+	static bool
+	filter_batch (SharedResources*, Voice* const* voices, std::size_t count);
+
   private:
 	/**
 	 * Update buffers sizes according to Graph params and oversampling.
@@ -237,6 +283,10 @@ Voice
 	std::size_t			_attack_samples;
 	std::size_t			_drop_sample;
 	std::size_t			_drop_samples;
+	// Number of (oversampled) samples to wait before attack or drop begins,
+	// for sample-accurate voice events:
+	std::size_t			_start_delay;
+	std::size_t			_drop_delay;
 
 	// Set initially to true, reset after first mixin():
 	bool				_first_pass;
@@ -265,9 +315,10 @@ Voice::state() const noexcept
 
 
 inline void
-Voice::drop() noexcept
+Voice::drop (std::size_t frame) noexcept
 {
 	_state = Dropped;
+	_drop_delay = frame * _oversampling;
 }
 
 
@@ -279,6 +330,13 @@ Voice::mix_result (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2)
 }
 
 
+inline DualFilter::Topology
+Voice::filter_topology() const noexcept
+{
+	return _dual_filter.topology();
+}
+
+
 inline Params::Voice*
 Voice::params() noexcept
 {
@@ -15,10 +15,13 @@
 #include <algorithm>
 #include <cstddef>
 #include <iterator>
+#include <tuple>
 
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/utility/memory.h>
+#include <haruhi/utility/numeric.h>
+#include <haruhi/utility/trace.h>
 #include <haruhi/utility/work_performer.h>
 #include <haruhi/utility/amplitude.h>
 
@@ -28,26 +31,62 @@
 
 namespace Yuki {
 
-POOL_ALLOCATOR_FOR (VoiceManager::RenderWorkUnit)
+VoiceManager::RenderJob::RenderJob (SharedResourcesVec& resources_vec, CountdownLatch& latch):
+	_resources_vec (resources_vec),
+	_latch (latch)
+{ }
 
 
-VoiceManager::RenderWorkUnit::RenderWorkUnit (Voice* voice, SharedResourcesVec& resources_vec):
-	_voice (voice),
-	_resources_vec (resources_vec)
-{ }
+void
+VoiceManager::RenderJob::set_voices (Voice* const* voices, std::size_t count) noexcept
+{
+	assert (count <= std::size (_voices));
+
+	std::copy (voices, voices + count, _voices);
+	_voices_number = count;
+}
 
 
 void
-VoiceManager::RenderWorkUnit::execute()
+VoiceManager::RenderJob::execute()
 {
-	_voice->render (_resources_vec[thread_id()].get());
+	Trace::Span span ("Voice render", _voices_number);
+	CPUStats::Stopwatch stopwatch (_render_time);
+	Voice::SharedResources* res = _resources_vec[thread_id()].get();
+
+	if (_voices_number == 1)
+	{
+		_voices[0]->render (res);
+		return;
+	}
+
+	// Generate oscillation for all voices first, so that their filters
+	// can be processed together:
+	Voice* rendered[DualFilter::BatchSize];
+	std::size_t rendered_number = 0;
+	for (std::size_t i = 0; i < _voices_number; ++i)
+		if (_voices[i]->render_oscillation (res))
+			rendered[rendered_number++] = _voices[i];
+
+	bool const filtered = Voice::filter_batch (res, rendered, rendered_number);
+
+	for (std::size_t i = 0; i < rendered_number; ++i)
+		rendered[i]->render_output (res, filtered);
 }
 
 
 void
-VoiceManager::RenderWorkUnit::mix_result (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2) const
+VoiceManager::RenderJob::mix_result (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2) const
 {
-	_voice->mix_result (output_1, output_2);
+	for (std::size_t i = 0; i < _voices_number; ++i)
+		_voices[i]->mix_result (output_1, output_2);
+}
+
+
+void
+VoiceManager::RenderJob::done()
+{
+	_latch.count_down();
 }
 
 
@@ -57,19 +96,13 @@ VoiceManager::VoiceManager (Params::Main* main_params, Params::Part* part_params
 	_part_params (part_params)
 {
 	for (unsigned int i = 0; i < _work_performer->threads_number(); ++i)
+	{
 		_shared_resources_vec.push_back (std::make_unique<Voice::SharedResources>());
+		_shared_resources_vec.back()->impulse_response_cache = &_impulse_response_cache;
+	}
 
-	for (AntialiasingFilter& filter: _antialiasing_filter_1)
-		filter.assign_impulse_response (&_antialiasing_filter_ir);
-	for (AntialiasingFilter& filter: _antialiasing_filter_2)
-		filter.assign_impulse_response (&_antialiasing_filter_ir);
 	set_oversampling (main_params->oversampling.get());
-}
-
-
-VoiceManager::~VoiceManager()
-{
-	kill_voices();
+	set_polyphony (main_params->polyphony.get());
 }
 
 
@@ -87,10 +120,10 @@ VoiceManager::handle_voice_event (Haruhi::VoiceEvent const* event)
 			// voice pitch event we got:
 			NormalizedFrequency initial_frequency = _last_voice_frequency / _sample_rate;
 
-			auto v = std::make_unique<Voice> (id, event->timestamp(), _main_params, _part_params, (0_dB).factor(), initial_frequency, _sample_rate, _buffer_size, _oversampling);
-			v->set_wave (_wave);
+			Voice* v = allocate_voice();
+			v->start (id, event->timestamp(), event->frame(), (0_dB).factor(), initial_frequency);
 
-			_voices_by_id[id] = _voices.insert (std::move (v)).first;
+			_voices_by_id.insert (id, v);
 			_active_voices_number++;
 
 			check_polyphony_limit();
@@ -101,7 +134,7 @@ VoiceManager::handle_voice_event (Haruhi::VoiceEvent const* event)
 		Voice* v = find_voice_by_id (event->voice_id());
 		if (v && v->state() == Voice::Voicing)
 		{
-			v->drop();
+			v->drop (event->frame());
 			_active_voices_number--;
 		}
 	}
@@ -128,8 +161,9 @@ VoiceManager::handle_frequency_event (Haruhi::VoiceControllerEvent const* event)
 void
 VoiceManager::panic()
 {
-	for (auto& v: _voices)
+	for (Voice* v: _voices)
 		v->drop();
+	_active_voices_number = 0;
 }
 
 
@@ -144,7 +178,7 @@ VoiceManager::graph_updated (Frequency sample_rate, std::size_t buffer_size)
 	for (auto& s: _shared_resources_vec)
 		s->graph_updated (sample_rate, buffer_size);
 
-	for (auto& v: _voices)
+	for (auto& v: _voice_pool)
 		v->graph_updated (sample_rate, buffer_size);
 }
 
@@ -155,22 +189,42 @@ VoiceManager::set_oversampling (unsigned int oversampling)
 	assert (oversampling >= 1);
 
 	_oversampling = oversampling;
+	_decimator_1.set_factor (_oversampling);
+	_decimator_2.set_factor (_oversampling);
 
 	resize_buffers();
 
 	for (auto& s: _shared_resources_vec)
 		s->set_oversampling (_oversampling);
 
-	for (auto& v: _voices)
+	for (auto& v: _voice_pool)
 		v->set_oversampling (_oversampling);
+}
+
+
+void
+VoiceManager::set_polyphony (unsigned int polyphony)
+{
+	// Each voice dropped because of polyphony limit still sounds
+	// for a couple of milliseconds, make room for them too:
+	std::size_t pool_size = 2 * std::max (polyphony, 1u);
 
-	// TODO replace with proper 4 or more pole antialiasing filter:
-	_antialiasing_filter_ir.set_type (FilterImpulseResponse::LowPass);
-	_antialiasing_filter_ir.set_frequency (0.4f / _oversampling);
-	_antialiasing_filter_ir.set_resonance (0.8f);
-	_antialiasing_filter_ir.set_gain (0.0f);
-	_antialiasing_filter_ir.set_attenuation (1.0f);
-	_antialiasing_filter_ir.set_limiter_enabled (false);
+	if (pool_size <= _voice_pool.size())
+		return;
+
+	_voices.reserve (pool_size);
+	_free_voices.reserve (pool_size);
+	_voices_by_id.reserve (pool_size);
+
+	while (_voice_pool.size() < pool_size)
+	{
+		auto v = std::make_unique<Voice> (_main_params, _part_params, _sample_rate, _buffer_size, _oversampling);
+		v->set_wave (_wave);
+		_free_voices.push_back (v.get());
+		_voice_pool.push_back (std::move (v));
+		_render_jobs.push_back (std::make_unique<RenderJob> (_shared_resources_vec, _render_latch));
+		_render_job_units.push_back (_render_jobs.back().get());
+	}
 }
 
 
@@ -179,7 +233,7 @@ VoiceManager::set_wave (DSP::Wave* wave)
 {
 	_wave = wave;
 
-	for (auto& v: _voices)
+	for (auto& v: _voice_pool)
 		v->set_wave (_wave);
 }
 
@@ -187,68 +241,80 @@ VoiceManager::set_wave (DSP::Wave* wave)
 void
 VoiceManager::async_render()
 {
-	assert (_work_units.empty());
+	assert (_render_jobs_started == 0);
+	assert (_voices.size() <= _render_jobs.size());
 
-	for (auto& v: _voices)
-		_work_units.push_back (std::make_unique<RenderWorkUnit> (v.get(), _shared_resources_vec));
+	// No jobs are running now. Filter coefficients are cached only for this round,
+	// since parameters change from buffer to buffer:
+	_impulse_response_cache.clear();
 
-	for (WorkUnits::size_type i = 0, n = _work_units.size(); i < n; ++i)
-		_work_performer->add (_work_units[i].get());
+	// Group voices with the same filter topology into batches. Don't make batches
+	// bigger than needed to keep all threads busy:
+	std::size_t const batch_size = clamped<std::size_t> (_voices.size() / _work_performer->threads_number(), 1, DualFilter::BatchSize);
+	auto topology_key = [](Voice const* voice) {
+		DualFilter::Topology const t = voice->filter_topology();
+		return std::make_tuple (t.stages_1, t.stages_2, t.parallel);
+	};
+
+	if (batch_size > 1)
+		std::sort (_voices.begin(), _voices.end(), [&](Voice const* a, Voice const* b) { return topology_key (a) < topology_key (b); });
+
+	for (std::size_t i = 0; i < _voices.size(); )
+	{
+		std::size_t n = 1;
+		while (n < batch_size && i + n < _voices.size() && topology_key (_voices[i + n]) == topology_key (_voices[i]))
+			++n;
+		_render_jobs[_render_jobs_started++]->set_voices (&_voices[i], n);
+		i += n;
+	}
+
+	_render_latch.reset (_render_jobs_started);
+
+	// Queue all jobs before waking up threads:
+	_work_performer->add (_render_job_units.begin(), _render_job_units.begin() + _render_jobs_started);
 }
 
 
 void
 VoiceManager::wait_for_render()
 {
+	{
+		Trace::Span span ("wait_for_render stall", _render_jobs_started);
+		_render_latch.wait();
+	}
+
+	Trace::Span span ("Mixdown", _render_jobs_started);
+
+	if (CPUStats::enabled() && _render_jobs_started > 0)
+	{
+		CPUStats::Nanoseconds render_time = 0;
+		for (std::size_t i = 0; i < _render_jobs_started; ++i)
+			render_time += _render_jobs[i]->render_time();
+		_render_cpu_stats.record (render_time);
+	}
+
 	if (_oversampling == 1)
 	{
 		_output_1.clear();
 		_output_2.clear();
 
-		for (WorkUnits::size_type i = 0, n = _work_units.size(); i < n; ++i)
-		{
-			_work_units[i]->wait();
-			_work_units[i]->mix_result (&_output_1, &_output_2);
-		}
+		for (std::size_t i = 0; i < _render_jobs_started; ++i)
+			_render_jobs[i]->mix_result (&_output_1, &_output_2);
 	}
 	else
 	{
 		_output_1_oversampled.clear();
 		_output_2_oversampled.clear();
 
-		for (WorkUnits::size_type i = 0, n = _work_units.size(); i < n; ++i)
-		{
-			_work_units[i]->wait();
-			_work_units[i]->mix_result (&_output_1_oversampled, &_output_2_oversampled);
-		}
-
-		// Antialiasing filtering:
-		Haruhi::AudioBuffer* s1 = &_output_1_oversampled;
-		Haruhi::AudioBuffer* t1 = &_output_1_filtered;
-		Haruhi::AudioBuffer* s2 = &_output_2_oversampled;
-		Haruhi::AudioBuffer* t2 = &_output_2_filtered;
-
-		for (std::size_t i = 0; i < std::size (_antialiasing_filter_1); ++i)
-		{
-			_antialiasing_filter_1[i].transform (s1->begin(), s1->end(), t1->begin());
-			std::swap (s1, t1);
-		}
-
-		for (std::size_t i = 0; i < std::size (_antialiasing_filter_1); ++i)
-		{
-			_antialiasing_filter_2[i].transform (s2->begin(), s2->end(), t2->begin());
-			std::swap (s2, t2);
-		}
-
-		// Downsample:
-		for (Haruhi::AudioBuffer::size_type i = 0; i < _output_1.size(); ++i)
-			_output_1[i] = _output_1_filtered[i * _oversampling];
+		for (std::size_t i = 0; i < _render_jobs_started; ++i)
+			_render_jobs[i]->mix_result (&_output_1_oversampled, &_output_2_oversampled);
 
-		for (Haruhi::AudioBuffer::size_type i = 0; i < _output_2.size(); ++i)
-			_output_2[i] = _output_2_filtered[i * _oversampling];
+		// Antialiasing filtering and downsampling:
+		_decimator_1.decimate (_output_1_oversampled.begin(), _output_1_oversampled.size(), _output_1.begin());
+		_decimator_2.decimate (_output_2_oversampled.begin(), _output_2_oversampled.size(), _output_2.begin());
 	}
 
-	_work_units.clear();
+	_render_jobs_started = 0;
 }
 
 
@@ -263,15 +329,19 @@ VoiceManager::mix_rendering_result (Haruhi::AudioBuffer* b1, Haruhi::AudioBuffer
 	b1->add (&_output_1);
 	b2->add (&_output_2);
 
-	for (Voices::iterator v = _voices.begin(); v != _voices.end(); )
+	// Return finished voices to the pool:
+	for (Voices::size_type i = 0; i < _voices.size(); )
 	{
-		if ((*v)->state() == Voice::Finished)
+		Voice* v = _voices[i];
+		if (v->state() == Voice::Finished)
 		{
-			_voices_by_id.erase ((*v)->id());
-			_voices.erase (v++);
+			_voices_by_id.erase (v->id());
+			_free_voices.push_back (v);
+			_voices[i] = _voices.back();
+			_voices.pop_back();
 		}
 		else
-			++v;
+			++i;
 	}
 }
 
@@ -281,7 +351,7 @@ VoiceManager::update_voice_parameter (Haruhi::VoiceID voice_id, Params::Voice::C
 {
 	if (voice_id == Haruhi::OmniVoice)
 	{
-		for (auto& v: _voices)
+		for (Voice* v: _voices)
 			(v->params()->*param_ptr).set (value);
 	}
 	else
@@ -300,8 +370,8 @@ VoiceManager::resize_buffers()
 	_output_2.resize (_buffer_size);
 	_output_1_oversampled.resize (_buffer_size * _oversampling);
 	_output_2_oversampled.resize (_buffer_size * _oversampling);
-	_output_1_filtered.resize (_buffer_size * _oversampling);
-	_output_2_filtered.resize (_buffer_size * _oversampling);
+	_decimator_1.reserve (_buffer_size * _oversampling);
+	_decimator_2.reserve (_buffer_size * _oversampling);
 }
 
 
@@ -314,13 +384,13 @@ VoiceManager::check_polyphony_limit()
 	{
 		// Select oldest Voice and drop it:
 		Voice* oldest = nullptr;
-		for (auto& v: _voices)
+		for (Voice* v: _voices)
 		{
 			if (v->state() == Voice::Dropped || v->state() == Voice::Finished)
 				continue;
 			oldest = oldest
-				? Voice::return_older (v.get(), oldest)
-				: v.get();
+				? Voice::return_older (v, oldest)
+				: v;
 		}
 		oldest->drop();
 		_active_voices_number--;
@@ -329,21 +399,43 @@ VoiceManager::check_polyphony_limit()
 
 
 Voice*
-VoiceManager::find_voice_by_id (Haruhi::VoiceID id)
+VoiceManager::find_voice_by_id (Haruhi::VoiceID id) const noexcept
 {
-	ID2VoiceMap::iterator k = _voices_by_id.find (id);
-	if (k != _voices_by_id.end())
-		return k->second->get();
-	return nullptr;
+	return _voices_by_id.find (id);
 }
 
 
-void
-VoiceManager::kill_voices()
+Voice*
+VoiceManager::allocate_voice() noexcept
 {
-	_voices.clear();
-	_voices_by_id.clear();
+	Voice* voice = nullptr;
+
+	if (!_free_voices.empty())
+	{
+		voice = _free_voices.back();
+		_free_voices.pop_back();
+		_voices.push_back (voice);
+	}
+	else
+	{
+		// Pool exhausted, steal the oldest voice. Dropped voices
+		// are about to finish anyway, so take them first:
+		for (Voice* v: _voices)
+		{
+			if (!voice || (v->state() != Voice::Voicing && voice->state() == Voice::Voicing))
+				voice = v;
+			else if ((v->state() == Voice::Voicing) == (voice->state() == Voice::Voicing))
+				voice = Voice::return_older (v, voice);
+		}
+
+		assert (voice);
+
+		if (voice->state() == Voice::Voicing)
+			_active_voices_number--;
+		_voices_by_id.erase (voice->id());
+	}
+
+	return voice;
 }
 
 } // namespace Yuki
-
@@ -16,19 +16,20 @@
 
 // Standard:
 #include <cstddef>
-#include <map>
 #include <vector>
 
 // Haruhi:
 #include <haruhi/config/all.h>
-#include <haruhi/dsp/filter.h>
+#include <haruhi/dsp/decimator.h>
 #include <haruhi/graph/audio_buffer.h>
 #include <haruhi/graph/event.h>
+#include <haruhi/utility/countdown_latch.h>
+#include <haruhi/utility/cpu_stats.h>
 #include <haruhi/utility/work_performer.h>
-#include <haruhi/utility/pool_allocator.h>
 
 // Local:
 #include "voice.h"
+#include "voice_map.h"
 #include "params.h"
 
 
@@ -38,41 +39,67 @@ using Haruhi::Unique;
 
 
 /**
- * Creates/destroys/mixes Voices upon incoming Core Events.
+ * Starts/drops/mixes Voices upon incoming Core Events.
+ *
+ * Voices are taken from a pool preallocated for current polyphony setting,
+ * so handling events on the RT thread doesn't allocate memory.
  */
 class VoiceManager
 {
-	class RenderWorkUnit;
+	class RenderJob;
 
-	typedef std::set<Unique<Voice>> Voices;
-	typedef DSP::Filter<FilterImpulseResponse::Order, FilterImpulseResponse::ResponseType> AntialiasingFilter;
-	typedef std::map<Haruhi::VoiceID, Voices::iterator> ID2VoiceMap;
-	typedef std::vector<Unique<RenderWorkUnit>> WorkUnits;
+	typedef std::vector<Unique<Voice>> VoicePool;
+	typedef std::vector<Voice*> Voices;
+	typedef std::vector<Unique<RenderJob>> RenderJobs;
+	typedef std::vector<WorkPerformer::Unit*> RenderJobUnits;
 	typedef std::vector<Unique<Voice::SharedResources>> SharedResourcesVec;
 
-	class RenderWorkUnit: public WorkPerformer::Unit
+	/**
+	 * Renders a batch of voices whose filters have the same topology,
+	 * so that their filters can be processed together with SIMD instructions.
+	 * Jobs are created together with voices in the pool and are assigned
+	 * voices to render in each processing round. Completion is reported
+	 * through the latch shared by all jobs.
+	 */
+	class RenderJob: public WorkPerformer::Unit
 	{
-		USES_POOL_ALLOCATOR (RenderWorkUnit)
-
 	  public:
-		RenderWorkUnit (Voice* voice, SharedResourcesVec& resources_vec);
+		RenderJob (SharedResourcesVec& resources_vec, CountdownLatch& latch);
+
+		/**
+		 * Set voices to render in this round.
+		 * \param	count Number of voices, at most DualFilter::BatchSize.
+		 */
+		void
+		set_voices (Voice* const* voices, std::size_t count) noexcept;
 
 		void
-		execute();
+		execute() override;
 
 		void
 		mix_result (Haruhi::AudioBuffer*, Haruhi::AudioBuffer*) const;
 
+		/**
+		 * Return time spent in last execute().
+		 */
+		CPUStats::Nanoseconds
+		render_time() const noexcept { return _render_time; }
+
+	  protected:
+		void
+		done() override;
+
 	  private:
-		Voice*				_voice;
+		Voice*				_voices[DualFilter::BatchSize];
+		std::size_t			_voices_number	= 0;
 		SharedResourcesVec&	_resources_vec;
+		CountdownLatch&		_latch;
+		CPUStats::Nanoseconds	_render_time	= 0;
 	};
 
   public:
 	VoiceManager (Params::Main*, Params::Part*, WorkPerformer*);
 
-	~VoiceManager();
-
 	/**
 	 * Process incoming VoiceEvent.
 	 */
@@ -111,6 +138,14 @@ class VoiceManager
 	void
 	set_oversampling (unsigned int oversampling);
 
+	/**
+	 * Preallocate voices for given polyphony.
+	 * Pool never shrinks, lowering polyphony only drops excess voices.
+	 * Needs Graph lock.
+	 */
+	void
+	set_polyphony (unsigned int polyphony);
+
 	/**
 	 * Make all current and future voices use given Wave.
 	 */
@@ -129,8 +164,8 @@ class VoiceManager
 	/**
 	 * Start rendering of all voices.
 	 *
-	 * This function is non-blocking. It will create WorkUnits
-	 * and pass them to configured WorkPerformer.
+	 * This function is non-blocking. It will pass render jobs
+	 * to configured WorkPerformer.
 	 *
 	 * Use wait_for_render() to wait until rendering is done.
 	 * Use mix_rendering_result() to mix rendered voices into given output buffers.
@@ -144,6 +179,14 @@ class VoiceManager
 	void
 	wait_for_render();
 
+	/**
+	 * Return statistics of CPU time spent rendering voices in each round
+	 * (summed over all render jobs).
+	 * Empty unless compiled with HARUHI_CPU_STATS.
+	 */
+	CPUStats const&
+	render_cpu_stats() const noexcept;
+
 	/**
 	 * Mix rendered voices into output buffer.
 	 * Remove voices that are finished.
@@ -188,35 +231,41 @@ class VoiceManager
 	 * Return voice by its ID. Return 0 if not found.
 	 */
 	Voice*
-	find_voice_by_id (Haruhi::VoiceID);
+	find_voice_by_id (Haruhi::VoiceID) const noexcept;
 
 	/**
-	 * Kills all voices - deletes them immediately.
+	 * Take unused voice from the pool. If there are none,
+	 * reuse the oldest one, preferring already dropped voices.
 	 */
-	void
-	kill_voices();
+	Voice*
+	allocate_voice() noexcept;
 
   private:
 	WorkPerformer*			_work_performer;
 	Params::Main*			_main_params;
 	Params::Part*			_part_params;
-	Voices					_voices;
-	WorkUnits				_work_units;
-	ID2VoiceMap				_voices_by_id;
+	VoicePool				_voice_pool;
+	Voices					_voices;				// Voices in use, including dropped ones.
+	Voices					_free_voices;
+	CountdownLatch			_render_latch;
+	RenderJobs				_render_jobs;			// One for each voice in the pool.
+	RenderJobUnits			_render_job_units;		// Same jobs, for WorkPerformer::add().
+	std::size_t				_render_jobs_started	= 0;
+	CPUStats				_render_cpu_stats;
+	VoiceMap				_voices_by_id;
 	SharedResourcesVec		_shared_resources_vec;
+	DualFilter::ImpulseResponseCache
+							_impulse_response_cache;	// Shared by render jobs.
 	Frequency				_sample_rate			= 0_Hz;
 	std::size_t				_buffer_size			= 0;
 	unsigned int			_oversampling			= 1;
-	FilterImpulseResponse	_antialiasing_filter_ir;
-	AntialiasingFilter		_antialiasing_filter_1[5]; // Multi-stage filtering, number must be odd.
-	AntialiasingFilter		_antialiasing_filter_2[5]; // Multi-stage filtering, number must be odd.
+	DSP::Decimator			_decimator_1;
+	DSP::Decimator			_decimator_2;
 	DSP::Wave*				_wave					= nullptr;
 	Haruhi::AudioBuffer		_output_1;
 	Haruhi::AudioBuffer		_output_2;
 	Haruhi::AudioBuffer		_output_1_oversampled;
 	Haruhi::AudioBuffer		_output_2_oversampled;
-	Haruhi::AudioBuffer		_output_1_filtered;
-	Haruhi::AudioBuffer		_output_2_filtered;
 	unsigned int			_active_voices_number	= 0;
 	Frequency				_last_voice_frequency	= 440_Hz; // Concert A
 };
@@ -229,13 +278,20 @@ VoiceManager::current_voices_number()
 }
 
 
+inline CPUStats const&
+VoiceManager::render_cpu_stats() const noexcept
+{
+	return _render_cpu_stats;
+}
+
+
 template<class PointerToParam>
 	inline void
 	VoiceManager::update_filter_parameter (Haruhi::VoiceID voice_id, unsigned int filter_no, PointerToParam param_ptr, int value)
 	{
 		if (voice_id == Haruhi::OmniVoice)
 		{
-			for (auto& v: _voices)
+			for (Voice* v: _voices)
 				(v->params()->filters[filter_no].*param_ptr).set (value);
 		}
 		else
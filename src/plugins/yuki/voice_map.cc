@@ -0,0 +1,112 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Standard:
+#include <cstddef>
+#include <utility>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+
+// Local:
+#include "voice_map.h"
+
+
+namespace Yuki {
+
+void
+VoiceMap::reserve (std::size_t voices)
+{
+	// Keep load factor at most 0.5 so that probe sequences stay short:
+	std::size_t capacity = 2;
+	unsigned int bits = 1;
+	while (capacity < 2 * voices)
+	{
+		capacity *= 2;
+		bits += 1;
+	}
+
+	if (capacity <= _slots.size())
+		return;
+
+	std::vector<Slot> old_slots (capacity);
+	std::swap (old_slots, _slots);
+	_mask = capacity - 1;
+	_shift = 32 - bits;
+	_size = 0;
+
+	for (Slot const& slot: old_slots)
+		if (slot.voice)
+			insert (slot.id, slot.voice);
+}
+
+
+void
+VoiceMap::insert (Haruhi::VoiceID id, Voice* voice) noexcept
+{
+	assert (voice);
+	assert (_size < _slots.size());
+
+	std::size_t i = home_index (id);
+	while (_slots[i].voice)
+		i = (i + 1) & _mask;
+
+	_slots[i].id = id;
+	_slots[i].voice = voice;
+	++_size;
+}
+
+
+void
+VoiceMap::erase (Haruhi::VoiceID id) noexcept
+{
+	if (_slots.empty())
+		return;
+
+	std::size_t i = home_index (id);
+	while (_slots[i].voice && _slots[i].id != id)
+		i = (i + 1) & _mask;
+
+	if (!_slots[i].voice)
+		return;
+
+	// Backward shift deletion - move following entries into the hole,
+	// unless they're already in their home position or after it,
+	// so that no tombstones are needed:
+	_slots[i].voice = nullptr;
+	--_size;
+
+	for (std::size_t j = (i + 1) & _mask; _slots[j].voice; j = (j + 1) & _mask)
+	{
+		std::size_t home = home_index (_slots[j].id);
+		// Distance from home to j compared with distance from home to the hole:
+		if (((j - home) & _mask) >= ((j - i) & _mask))
+		{
+			_slots[i] = _slots[j];
+			_slots[j].voice = nullptr;
+			i = j;
+		}
+	}
+}
+
+
+void
+VoiceMap::clear() noexcept
+{
+	for (Slot& slot: _slots)
+		slot.voice = nullptr;
+	_size = 0;
+}
+
+} // namespace Yuki
+
@@ -0,0 +1,116 @@
+/* vim:ts=4
+ *
+ * Copyleft 2008…2013  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef HARUHI__PLUGINS__YUKI__VOICE_MAP_H__INCLUDED
+#define HARUHI__PLUGINS__YUKI__VOICE_MAP_H__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Haruhi:
+#include <haruhi/config/all.h>
+#include <haruhi/graph/event.h>
+
+
+namespace Yuki {
+
+class Voice;
+
+/**
+ * Maps VoiceIDs to Voices. Open-addressing hash table with linear probing,
+ * so lookups touch one or two adjacent slots and insert/erase never
+ * allocate memory. Only reserve() allocates, so it must not be called
+ * from the RT thread.
+ */
+class VoiceMap
+{
+	struct Slot
+	{
+		Haruhi::VoiceID	id		= Haruhi::OmniVoice;
+		Voice*			voice	= nullptr; // nullptr means empty slot.
+	};
+
+  public:
+	/**
+	 * Make room for given number of Voices. Never shrinks.
+	 */
+	void
+	reserve (std::size_t voices);
+
+	/**
+	 * Return voice by its ID or nullptr if not found.
+	 */
+	Voice*
+	find (Haruhi::VoiceID) const noexcept;
+
+	/**
+	 * Add voice under given ID. ID must not be already in the map
+	 * and there must be room for the voice (see reserve()).
+	 */
+	void
+	insert (Haruhi::VoiceID, Voice*) noexcept;
+
+	/**
+	 * Remove voice with given ID, if it exists.
+	 */
+	void
+	erase (Haruhi::VoiceID) noexcept;
+
+	/**
+	 * Remove all voices.
+	 */
+	void
+	clear() noexcept;
+
+  private:
+	/**
+	 * Return index of the slot where search for given ID begins.
+	 */
+	std::size_t
+	home_index (Haruhi::VoiceID) const noexcept;
+
+  private:
+	std::vector<Slot>	_slots;
+	std::size_t			_mask	= 0;
+	unsigned int		_shift	= 32;
+	std::size_t			_size	= 0;
+};
+
+
+inline Voice*
+VoiceMap::find (Haruhi::VoiceID id) const noexcept
+{
+	if (_slots.empty())
+		return nullptr;
+
+	for (std::size_t i = home_index (id); _slots[i].voice; i = (i + 1) & _mask)
+		if (_slots[i].id == id)
+			return _slots[i].voice;
+
+	return nullptr;
+}
+
+
+inline std::size_t
+VoiceMap::home_index (Haruhi::VoiceID id) const noexcept
+{
+	// Fibonacci hashing - take high bits of the product:
+	return (static_cast<uint32_t> (id) * UINT32_C (2654435769)) >> _shift;
+}
+
+} // namespace Yuki
+
+#endif
+
@@ -103,6 +103,20 @@ VoiceModulator::set_oversampling (unsigned int oversampling)
 }
 
 
+void
+VoiceModulator::reset() noexcept
+{
+	for (Haruhi::AudioBuffer& buf: _operator_output)
+		buf.clear();
+
+	for (Haruhi::AudioBuffer& buf: _operator_fm_output)
+		buf.clear();
+
+	for (VoiceOperator& op: _operator)
+		op.reset();
+}
+
+
 void
 VoiceModulator::resize_buffers()
 {
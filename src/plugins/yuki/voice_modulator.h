@@ -61,6 +61,13 @@ class VoiceModulator
 	void
 	set_oversampling (unsigned int oversampling);
 
+	/**
+	 * Bring modulator to its initial state, without
+	 * reallocating buffers.
+	 */
+	void
+	reset() noexcept;
+
   private:
 	/**
 	 * Update buffers sizes according to Graph params and oversampling.
@@ -61,6 +61,12 @@ class VoiceOperator
 	void
 	fill (Haruhi::AudioBuffer* output, Haruhi::AudioBuffer* fm_output) noexcept;
 
+	/**
+	 * Reset oscillator phase.
+	 */
+	void
+	reset() noexcept;
+
   private:
 	Haruhi::AudioBuffer*	_frequency_source	= nullptr;
 	Haruhi::AudioBuffer*	_amplitude_source	= nullptr;
@@ -89,6 +95,13 @@ VoiceOperator::set_detune (Sample detune) noexcept
 	_detune = detune;
 }
 
+
+inline void
+VoiceOperator::reset() noexcept
+{
+	_phase = 0.0f;
+}
+
 } // namespace Yuki
 
 #endif
@@ -24,9 +24,9 @@ using Haruhi::Sample;
 
 
 VoiceOscillator::VoiceOscillator (DSP::Wave* wave) noexcept:
-	_wave_enabled (true),
-	_wave (wave)
+	_wave_enabled (true)
 {
+	set_wave (wave);
 	set_unison_number (1);
 	set_phase (0);
 }
@@ -37,8 +37,8 @@ VoiceOscillator::set_phase (Sample phase) noexcept
 {
 	for (int u = 0; u < _unison_number; ++u)
 	{
-		_unison[u].phase = 0.5f * (1.0f + phase);
-		_unison[u].vibrato_phase = 0.5f * (_noise.get (_noise_state) + 1.0f);
+		_unison.phase[u] = 0.5f * (1.0f + phase);
+		_unison.vibrato_phase[u] = 0.5f * (_noise.get (_noise_state) + 1.0f);
 		phase += _initial_phase_spread;
 	}
 }
@@ -56,11 +56,11 @@ VoiceOscillator::set_unison_number (int number) noexcept
 
 		if (number > _unison_number && _unison_number > 0)
 		{
-			Sample p = _unison[_unison_number-1].phase;
+			Sample p = _unison.phase[_unison_number-1];
 			for (int u = _unison_number; u < number; ++u)
 			{
-				_unison[u].phase = p += _initial_phase_spread;
-				_unison[u].vibrato_phase = 0.5f * (_noise.get (_noise_state) + 1.0f);
+				_unison.phase[u] = p += _initial_phase_spread;
+				_unison.vibrato_phase[u] = 0.5f * (_noise.get (_noise_state) + 1.0f);
 			}
 		}
 
@@ -69,5 +69,20 @@ VoiceOscillator::set_unison_number (int number) noexcept
 	}
 }
 
+
+void
+VoiceOscillator::reset() noexcept
+{
+	_initial_phase_spread = 0;
+	_unison_spread = 1.0;
+	_unison_noise = 0.0;
+	_unison_stereo = false;
+	_unison_vibrato_level = 0.0;
+	_unison_vibrato_frequency = 0.0;
+	_unison_number = -1;
+	set_unison_number (1);
+	set_phase (0);
+}
+
 } // namespace Yuki
 
@@ -17,18 +17,25 @@
 // Standard:
 #include <cstddef>
 #include <cmath>
+#include <algorithm>
 #include <vector>
 
 // Haruhi:
 #include <haruhi/config/all.h>
 #include <haruhi/graph/audio_buffer.h>
 #include <haruhi/dsp/wave.h>
+#include <haruhi/dsp/wavetable.h>
 #include <haruhi/dsp/noise.h>
 #include <haruhi/dsp/functions.h>
 #include <haruhi/utility/amplitude.h>
 #include <haruhi/utility/numeric.h>
 #include <haruhi/utility/normalized_frequency.h>
 
+// System:
+#ifdef HARUHI_SSE2
+#include <emmintrin.h>
+#endif
+
 
 namespace Yuki {
 
@@ -39,6 +46,9 @@ class VoiceOscillator
 {
 	enum {
 		MaxUnison = 10,
+		// Unison voices are processed in groups of 4 by SIMD code:
+		UnisonGroups = (MaxUnison + 3) / 4,
+		UnisonLanes = 4 * UnisonGroups,
 	};
 
   public:
@@ -109,6 +119,13 @@ class VoiceOscillator
 	void
 	set_initial_phases_spread (Sample spread) noexcept;
 
+	/**
+	 * Bring oscillator back to the state it had right after
+	 * construction (single unison voice, phase 0). Keeps the wave.
+	 */
+	void
+	reset() noexcept;
+
 	/**
 	 * Argument: [1…MaxUnison]
 	 */
@@ -160,37 +177,68 @@ class VoiceOscillator
 	Sample
 	noise_sample() noexcept;
 
+#ifdef HARUHI_SSE2
+	/**
+	 * Vectorized version of noise_sample(), returns four samples.
+	 */
+	__m128
+	vec4_noise_sample() noexcept;
+#endif
+
 	void
 	update_unison_coefficients() noexcept;
 
+	/**
+	 * Generic implementation, processes unison voices one by one.
+	 * \param	wave Functor (phase, frequency, sample) returning wave sample.
+	 */
+	template<bool with_noise, bool unison_stereo, class WaveFunction>
+		void
+		fill_impl (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2, WaveFunction wave) noexcept;
+
+#ifdef HARUHI_SSE2
+	/**
+	 * Processes four unison voices at once, reading samples directly
+	 * from the wavetable.
+	 */
 	template<bool with_noise, bool unison_stereo>
 		void
-		fill_impl (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2) noexcept;
+		fill_impl_sse (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2) noexcept;
+
+	/**
+	 * Vectorized mod1().
+	 */
+	static __m128
+	vec4_mod1 (__m128) noexcept;
+#endif
 
   private:
 	/**
-	 * One unison voice params.
+	 * Params of all unison voices. Each param is stored in separate array,
+	 * so that SIMD code can process a number of unison voices at once.
 	 */
-	struct UnisonVoice
+	struct alignas (16) UnisonVoices
 	{
-		Sample relative_frequency;
-		Sample phase;
-		Sample noise_level;
-		Sample stereo_level_1; // Level in channel 1 (left)
-		Sample stereo_level_2; // Level in channel 1 (right)
-		Sample vibrato_level;
-		Sample vibrato_frequency;
-		Sample vibrato_phase;
+		Sample relative_frequency[UnisonLanes];
+		Sample phase[UnisonLanes];
+		Sample noise_level[UnisonLanes];
+		Sample stereo_level_1[UnisonLanes]; // Level in channel 1 (left)
+		Sample stereo_level_2[UnisonLanes]; // Level in channel 1 (right)
+		Sample vibrato_level[UnisonLanes];
+		Sample vibrato_frequency[UnisonLanes];
+		Sample vibrato_phase[UnisonLanes];
 	};
 
   private:
 	bool					_wave_enabled;
 	DSP::Wave*				_wave						= nullptr;
+	// Set if _wave is a plain wavetable, so it can be accessed without virtual calls:
+	DSP::Wavetable::WaveAdapter*	_wave_adapter		= nullptr;
+	DSP::Wavetable*			_wavetable					= nullptr;
 	Haruhi::AudioBuffer*	_frequency_source			= nullptr;
 	Haruhi::AudioBuffer*	_amplitude_source			= nullptr;
 	Haruhi::AudioBuffer*	_fm_source					= nullptr;
-	Sample					_vibrato[MaxUnison];
-	UnisonVoice				_unison[MaxUnison];
+	UnisonVoices			_unison						{ };
 
 	// Unison:
 	Sample					_initial_phase_spread		= 0;
@@ -204,7 +252,7 @@ class VoiceOscillator
 
 	// Used for both white noise and unison noise:
 	DSP::Noise				_noise;
-	DSP::Noise::State		_noise_state				{ _noise.state() };
+	DSP::Noise::State		_noise_state;
 	bool					_noise_enabled				= false;
 	Amplitude				_noise_amplitude			= 0.0;
 };
@@ -221,6 +269,9 @@ inline void
 VoiceOscillator::set_wave (DSP::Wave* wave) noexcept
 {
 	_wave = wave;
+
+	_wave_adapter = dynamic_cast<DSP::Wavetable::WaveAdapter*> (wave);
+	_wavetable = _wave_adapter ? _wave_adapter->wavetable() : nullptr;
 }
 
 
@@ -339,19 +390,64 @@ VoiceOscillator::fill (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* outpu
 	}
 	else
 	{
-		if (_unison_noise > 0.0f)
+		if (_wavetable)
 		{
-			if (_unison_stereo)
-				fill_impl<true, true> (output_1, output_2);
+#ifdef HARUHI_SSE2
+			if (_unison_noise > 0.0f)
+			{
+				if (_unison_stereo)
+					fill_impl_sse<true, true> (output_1, output_2);
+				else
+					fill_impl_sse<true, false> (output_1, output_2);
+			}
 			else
-				fill_impl<true, false> (output_1, output_2);
+			{
+				if (_unison_stereo)
+					fill_impl_sse<false, true> (output_1, output_2);
+				else
+					fill_impl_sse<false, false> (output_1, output_2);
+			}
+#else
+			auto wave = [this, interpolation = _wave_adapter->interpolation()] (Sample phase, Sample frequency, std::size_t) {
+				return (*_wavetable)(phase, frequency, interpolation);
+			};
+
+			if (_unison_noise > 0.0f)
+			{
+				if (_unison_stereo)
+					fill_impl<true, true> (output_1, output_2, wave);
+				else
+					fill_impl<true, false> (output_1, output_2, wave);
+			}
+			else
+			{
+				if (_unison_stereo)
+					fill_impl<false, true> (output_1, output_2, wave);
+				else
+					fill_impl<false, false> (output_1, output_2, wave);
+			}
+#endif
 		}
 		else
 		{
-			if (_unison_stereo)
-				fill_impl<false, true> (output_1, output_2);
+			auto wave = [this] (Sample phase, Sample frequency, std::size_t sample) {
+				return (*_wave)(phase, frequency, sample);
+			};
+
+			if (_unison_noise > 0.0f)
+			{
+				if (_unison_stereo)
+					fill_impl<true, true> (output_1, output_2, wave);
+				else
+					fill_impl<true, false> (output_1, output_2, wave);
+			}
 			else
-				fill_impl<false, false> (output_1, output_2);
+			{
+				if (_unison_stereo)
+					fill_impl<false, true> (output_1, output_2, wave);
+				else
+					fill_impl<false, false> (output_1, output_2, wave);
+			}
 		}
 		mul = true;
 	}
@@ -359,11 +455,21 @@ VoiceOscillator::fill (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* outpu
 	// Add noise:
 	if (_noise_enabled && _noise_amplitude > 0.0f)
 	{
-		for (std::size_t i = 0, n = output_1->size(); i < n; ++i)
+		// Generate noise in chunks, to keep them in L1 cache:
+		constexpr std::size_t ChunkSize = 64;
+		alignas (16) Sample noise[ChunkSize];
+		float const amplitude = _noise_amplitude;
+
+		for (std::size_t i = 0, n = output_1->size(); i < n; i += ChunkSize)
 		{
-			float const x = static_cast<float> (_noise_amplitude * _noise.get (_noise_state));
-			o1[i] += x;
-			o2[i] += x;
+			std::size_t const chunk = std::min (ChunkSize, n - i);
+			_noise.fill (noise, noise + chunk, _noise_state);
+			for (std::size_t k = 0; k < chunk; ++k)
+			{
+				float const x = amplitude * noise[k];
+				o1[i + k] += x;
+				o2[i + k] += x;
+			}
 		}
 		mul = true;
 	}
@@ -385,6 +491,15 @@ VoiceOscillator::noise_sample() noexcept
 }
 
 
+#ifdef HARUHI_SSE2
+inline __m128
+VoiceOscillator::vec4_noise_sample() noexcept
+{
+	return _mm_add_ps (_noise.vec4_get (_noise_state), _noise.vec4_get (_noise_state));
+}
+#endif
+
+
 inline void
 VoiceOscillator::update_unison_coefficients() noexcept
 {
@@ -397,39 +512,39 @@ VoiceOscillator::update_unison_coefficients() noexcept
 	_1_div_unison_number = 1.0f / _unison_number;
 	// Noise levels for each unison voice:
 	if (_unison_number == 1)
-		_unison[0].noise_level = 1.0f;
+		_unison.noise_level[0] = 1.0f;
 	else if (_unison_number == 2)
-		_unison[0].noise_level = _unison[1].noise_level = 1.0f;
+		_unison.noise_level[0] = _unison.noise_level[1] = 1.0f;
 	else
 	{
 		for (int u = 0; u <= _unison_number / 2; ++u)
-			_unison[u].noise_level = 1.0f * (u + 1) / (_unison_number / 2 + 1);
+			_unison.noise_level[u] = 1.0f * (u + 1) / (_unison_number / 2 + 1);
 		for (int u = 0; u <= _unison_number / 2; ++u)
-			_unison[_unison_number - u - 1].noise_level = _unison[u].noise_level;
+			_unison.noise_level[_unison_number - u - 1] = _unison.noise_level[u];
 	}
 	// Relative frequencies and stereo spread values:
 	for (int u = 0; u < _unison_number; ++u)
 	{
-		_unison[u].relative_frequency = u == 0
+		_unison.relative_frequency[u] = u == 0
 			? first_frequency
-			: _unison[u - 1].relative_frequency * freq_multiplier;
-		_unison[u].stereo_level_1 = pow2 (_1_div_unison_number * (u + 1));
+			: _unison.relative_frequency[u - 1] * freq_multiplier;
+		_unison.stereo_level_1[u] = pow2 (_1_div_unison_number * (u + 1));
 	}
 	for (int u = 0; u < _unison_number; ++u)
-		_unison[u].stereo_level_2 = _unison[_unison_number - u - 1].stereo_level_1;
+		_unison.stereo_level_2[u] = _unison.stereo_level_1[_unison_number - u - 1];
 	// Vibrato coefficients:
 	for (int u = 0; u < _unison_number; ++u)
 	{
-		_unison[u].vibrato_level = 0.025f * _unison_vibrato_level * _unison_spread;
-		_unison[u].vibrato_frequency = _unison_vibrato_frequency * renormalize (_noise.get (_noise_state), -1.0f, 1.0f, 0.5f, 2.0f);
-		clamp (_unison[u].vibrato_frequency, 0.0f, 0.5f);
+		_unison.vibrato_level[u] = 0.025f * _unison_vibrato_level * _unison_spread;
+		_unison.vibrato_frequency[u] = _unison_vibrato_frequency * renormalize (_noise.get (_noise_state), -1.0f, 1.0f, 0.5f, 2.0f);
+		clamp (_unison.vibrato_frequency[u], 0.0f, 0.5f);
 	}
 }
 
 
-template<bool with_noise, bool unison_stereo>
+template<bool with_noise, bool unison_stereo, class WaveFunction>
 	inline void
-	VoiceOscillator::fill_impl (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2) noexcept
+	VoiceOscillator::fill_impl (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2, WaveFunction wave) noexcept
 	{
 		assert (output_1->size() == output_2->size());
 		assert (output_1->size() == _amplitude_source->size());
@@ -450,26 +565,26 @@ template<bool with_noise, bool unison_stereo>
 			// Add unisons:
 			for (int u = 0; u < _unison_number; ++u)
 			{
-				g = fs[i] * _unison[u].relative_frequency;
+				g = fs[i] * _unison.relative_frequency[u];
 				f = g * _fm_source->begin()[i];
 				clamp (f, 0.0f, 0.5f);
 				// Unison vibrato:
-				_unison[u].vibrato_phase = mod1 (_unison[u].vibrato_phase + _unison[u].vibrato_frequency);
-				v = fs[i] * _unison[u].vibrato_level * DSP::base_sin<5, Sample> (_unison[u].vibrato_phase * 2.0f - 1.0f);
+				_unison.vibrato_phase[u] = mod1 (_unison.vibrato_phase[u] + _unison.vibrato_frequency[u]);
+				v = fs[i] * _unison.vibrato_level[u] * DSP::base_sin<5, Sample> (_unison.vibrato_phase[u] * 2.0f - 1.0f);
 				// Update phases:
 				if (with_noise)
-					_unison[u].phase = mod1 (_unison[u].phase + v + f + e * noise_sample() * _unison[u].noise_level);
+					_unison.phase[u] = mod1 (_unison.phase[u] + v + f + e * noise_sample() * _unison.noise_level[u]);
 				else
-					_unison[u].phase = mod1 (_unison[u].phase + v + f);
+					_unison.phase[u] = mod1 (_unison.phase[u] + v + f);
 				// Don't take "noised f" as wave's frequency, because this might result in frequent jumping
 				// between two waves and unwanted audible noise on some notes. It's better to get
 				// some (inaudible) aliasing than that:
-				tmpsum = (*_wave)(_unison[u].phase, g, i);
+				tmpsum = wave (_unison.phase[u], g, i);
 				// Stereo:
 				if (unison_stereo)
 				{
-					sum1 += _unison[u].stereo_level_1 * tmpsum;
-					sum2 += _unison[u].stereo_level_2 * tmpsum;
+					sum1 += _unison.stereo_level_1[u] * tmpsum;
+					sum2 += _unison.stereo_level_2[u] * tmpsum;
 				}
 				else
 				{
@@ -482,6 +597,131 @@ template<bool with_noise, bool unison_stereo>
 		}
 	}
 
+
+#ifdef HARUHI_SSE2
+template<bool with_noise, bool unison_stereo>
+	inline void
+	VoiceOscillator::fill_impl_sse (Haruhi::AudioBuffer* output_1, Haruhi::AudioBuffer* output_2) noexcept
+	{
+		assert (output_1->size() == output_2->size());
+		assert (output_1->size() == _amplitude_source->size());
+		assert (output_1->size() == _frequency_source->size());
+		assert (output_1->size() == _fm_source->size());
+
+		Sample* const o1 = output_1->begin();
+		Sample* const o2 = output_2->begin();
+		Sample const* const fs = _frequency_source->begin();
+		Sample const* const fm = _fm_source->begin();
+		std::size_t const size = output_1->size();
+		int const groups = (_unison_number + 3) / 4;
+		DSP::Wavetable::Interpolation const interpolation = _wave_adapter->interpolation();
+
+		__m128 const zero = _mm_setzero_ps();
+		__m128 const half = _mm_set_ps1 (0.5f);
+		__m128 const one = _mm_set_ps1 (1.0f);
+		__m128 const two = _mm_set_ps1 (2.0f);
+
+		// Frequency range in this buffer, to check if wavetable level can change:
+		Sample fs_min = fs[0];
+		Sample fs_max = fs[0];
+		for (std::size_t i = 1; i < size; ++i)
+		{
+			fs_min = std::min (fs_min, fs[i]);
+			fs_max = std::max (fs_max, fs[i]);
+		}
+
+		// Each group of four unison voices adds its contribution to the output,
+		// so that group's state can be kept in registers for the whole buffer:
+		for (int group = 0; group < groups; ++group)
+		{
+			int const lane = 4 * group;
+			__m128 const relative_frequency = _mm_load_ps (_unison.relative_frequency + lane);
+			__m128 const noise_level = _mm_load_ps (_unison.noise_level + lane);
+			__m128 const vibrato_level = _mm_load_ps (_unison.vibrato_level + lane);
+			__m128 const vibrato_frequency = _mm_load_ps (_unison.vibrato_frequency + lane);
+			__m128 phase = _mm_load_ps (_unison.phase + lane);
+			__m128 vibrato_phase = _mm_load_ps (_unison.vibrato_phase + lane);
+			// Silence lanes past _unison_number:
+			__m128 const lane_index = _mm_set_ps (lane + 3, lane + 2, lane + 1, lane);
+			__m128 const mask = _mm_cmplt_ps (lane_index, _mm_set_ps1 (_unison_number));
+			__m128 level_1 = _mm_and_ps (mask, one);
+			__m128 level_2 = level_1;
+			if (unison_stereo)
+			{
+				level_1 = _mm_and_ps (mask, _mm_load_ps (_unison.stereo_level_1 + lane));
+				level_2 = _mm_and_ps (mask, _mm_load_ps (_unison.stereo_level_2 + lane));
+			}
+			// Levels are monotonic in frequency, so if both ends of the range
+			// map to the same tables, tables can be selected once per buffer:
+			__m128i const table_offsets = _wavetable->table_offsets (_mm_mul_ps (_mm_set_ps1 (fs_min), relative_frequency));
+			__m128i const max_table_offsets = _wavetable->table_offsets (_mm_mul_ps (_mm_set_ps1 (fs_max), relative_frequency));
+			bool const fixed_tables = _mm_movemask_epi8 (_mm_cmpeq_epi32 (table_offsets, max_table_offsets)) == 0xffff;
+
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				__m128 const fs4 = _mm_set_ps1 (fs[i]);
+				__m128 const g = _mm_mul_ps (fs4, relative_frequency);
+				__m128 const f = _mm_min_ps (_mm_max_ps (_mm_mul_ps (g, _mm_set_ps1 (fm[i])), zero), half);
+				// Unison vibrato:
+				vibrato_phase = vec4_mod1 (_mm_add_ps (vibrato_phase, vibrato_frequency));
+				__m128 const vibrato = DSP::vec4_base_sin_5 (_mm_sub_ps (_mm_mul_ps (vibrato_phase, two), one));
+				__m128 const v = _mm_mul_ps (_mm_mul_ps (fs4, vibrato_level), vibrato);
+				// Update phases:
+				__m128 delta = _mm_add_ps (v, f);
+				if (with_noise)
+				{
+					Sample const e = std::sqrt (fs[i]) * _unison_noise;
+					delta = _mm_add_ps (delta, _mm_mul_ps (_mm_mul_ps (_mm_set_ps1 (e), vec4_noise_sample()), noise_level));
+				}
+				phase = vec4_mod1 (_mm_add_ps (phase, delta));
+				// Use g, not "noised f" as wave's frequency, see fill_impl():
+				__m128 const samples = fixed_tables
+					? (*_wavetable)(phase, table_offsets, interpolation)
+					: (*_wavetable)(phase, g, interpolation);
+
+				__m128 sum1 = _mm_mul_ps (samples, level_1);
+				// Horizontal sum:
+				sum1 = _mm_add_ps (sum1, _mm_movehl_ps (sum1, sum1));
+				sum1 = _mm_add_ss (sum1, _mm_shuffle_ps (sum1, sum1, 1));
+				Sample const s1 = _mm_cvtss_f32 (sum1);
+				Sample s2 = s1;
+
+				if (unison_stereo)
+				{
+					__m128 sum2 = _mm_mul_ps (samples, level_2);
+					sum2 = _mm_add_ps (sum2, _mm_movehl_ps (sum2, sum2));
+					sum2 = _mm_add_ss (sum2, _mm_shuffle_ps (sum2, sum2, 1));
+					s2 = _mm_cvtss_f32 (sum2);
+				}
+
+				if (group == 0)
+				{
+					o1[i] = s1;
+					o2[i] = s2;
+				}
+				else
+				{
+					o1[i] += s1;
+					o2[i] += s2;
+				}
+			}
+
+			_mm_store_ps (_unison.phase + lane, phase);
+			_mm_store_ps (_unison.vibrato_phase + lane, vibrato_phase);
+		}
+	}
+
+
+inline __m128
+VoiceOscillator::vec4_mod1 (__m128 x) noexcept
+{
+	// floor(x) = trunc(x), minus 1 for negative non-integers:
+	__m128 floor = _mm_cvtepi32_ps (_mm_cvttps_epi32 (x));
+	floor = _mm_sub_ps (floor, _mm_and_ps (_mm_cmpgt_ps (floor, x), _mm_set_ps1 (1.0f)));
+	return _mm_sub_ps (x, floor);
+}
+#endif
+
 } // namespace Yuki
 
 #endif